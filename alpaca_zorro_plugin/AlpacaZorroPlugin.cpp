@@ -11,16 +11,33 @@
 #include "AlpacaZorroPlugin.h"
 
 // standard library
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "alpaca/client.h"
+#include "alpaca/exit_orders.h"
+#include "alpaca/order_poller.h"
+#include "alpaca/order_store.h"
+#include "alpaca/portfolio.h"
+#include "alpaca/risk_check.h"
+#include "alpaca/trade_stream.h"
 #include "logger.h"
+#include "negative_cache.h"
 #include "include/functions.h"
 #include "market_data/alpaca_market_data.h"
 #include "market_data/polygon.h"
+#include "market_data/hedged_market_data.h"
+#include "market_data/live_bars.h"
+#include "market_data/quote_book.h"
+#include "market_data/t6_sink.h"
+#include "market_data/history_export.h"
+#include "date/date.h"
 
 #define PLUGIN_VERSION	2
 
@@ -33,7 +50,60 @@ namespace {
     Logger* s_logger = nullptr;
     std::string s_nextOrderText;
     int s_priceType = 0;
-    std::unordered_map<uint32_t, Order> s_mapOrderByClientOrderId;
+    int s_hedgePercentile = 95;
+    OrderStore s_orders;
+    __time32_t s_nextEviction = 0;
+    std::unordered_set<std::string> s_assets;   // subscribed by Zorro
+    std::unordered_map<std::string, std::pair<double, double>> s_lastPrices;    // ask and bid of the last BrokerAsset
+    RiskCheck s_riskCheck;
+    ExitBook s_exits;
+    bool s_venueStops = false;  // SET_ORDERTYPE +8, the stop of BrokerBuy2 is executed by Alpaca
+    std::string s_streamKey;
+    std::string s_streamSecret;
+    std::string s_streamFeed;
+
+    // "not found" answers that are not asked again for a while
+    constexpr uint32_t UNKNOWN_SYMBOL_TTL_MS = 5 * 60 * 1000;
+    NegativeCache s_unknownSymbols(UNKNOWN_SYMBOL_TTL_MS);
+
+    // how often final orders past their maximum age are evicted
+    constexpr __time32_t EVICTION_INTERVAL = 60;
+
+    // how long a snapshot of the open orders answers BrokerTrade while the trade stream is down
+    constexpr uint32_t ORDER_POLL_MS = 1000;
+
+    // how long an IOC/FOK order waits for its final state on the trade stream before its status is polled
+    constexpr uint32_t ORDER_WAIT_MS = 1000;
+
+    // how long a cancel is followed before it is read from REST one last time
+    constexpr uint32_t CANCEL_DEADLINE_MS = 10000;
+
+    // a cancel sent without waiting for its confirmation
+    struct PendingCancel {
+        std::string id;
+        int32_t tradeId;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    std::vector<PendingCancel> s_pendingCancels;
+    std::chrono::steady_clock::time_point s_nextCancelCheck;
+
+    struct CancelMetrics {
+        uint64_t sent = 0;
+        uint64_t confirmed = 0;
+        uint64_t filledFirst = 0;   // the order filled before the cancel took effect
+        uint64_t overdue = 0;       // not confirmed by the deadline
+        uint64_t blockedNanos = 0;  // Zorro's time spent in the cancel calls
+    } s_cancelMetrics;
+
+    bool isNotFound(int code, const std::string& message) {
+        if (code == 40410000) {
+            return true;
+        }
+        // a last quote of an unknown symbol comes back as "<symbol> <status>"
+        std::string text(message);
+        std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+        return text.find("not found") != std::string::npos || text.find("notfound") != std::string::npos;
+    }
 }
 
 namespace alpaca
@@ -41,7 +111,173 @@ namespace alpaca
     std::unique_ptr<Client> client = nullptr;
     std::unique_ptr<AlpacaMarketData> alpacaMD = nullptr;
     std::unique_ptr<Polygon> polygon = nullptr;
+    std::unique_ptr<HedgedMarketData> hedgedMD = nullptr;
     MarketData* pMarketData = nullptr;
+    std::unique_ptr<DataStream> dataStream = nullptr;
+    std::unique_ptr<LiveBars> liveBars = nullptr;
+    std::unique_ptr<QuoteBook> quoteBook = nullptr;
+    std::unique_ptr<OrderUpdates> orderUpdates = nullptr;
+    std::unique_ptr<TradeStream> tradeStream = nullptr;
+    std::unique_ptr<OrderPoller> orderPoller = nullptr;
+    std::unique_ptr<Portfolio> portfolio = nullptr;
+
+    /**
+     * The account and the positions have to be read again, e.g. after a fill.
+     */
+    void invalidatePortfolio() {
+        if (portfolio) {
+            portfolio->invalidate();
+        }
+    }
+
+    /**
+     * Apply the fills pushed by the trade stream, of our orders or any other.
+     */
+    void takeFills() {
+        if (orderUpdates) {
+            static std::vector<std::string> filled;
+            filled.clear();
+            orderUpdates->takeFilledSymbols(filled);
+            if (!filled.empty()) {
+                invalidatePortfolio();
+            }
+        }
+    }
+
+    /**
+     * Read an order from the trade stream, or from the open order snapshot or REST if the stream doesn't have its
+     * current state. waitMs > 0 waits that long for the order to reach a final state, the snapshot is skipped then.
+     */
+    Response<Order> readOrder(const std::string& id, uint32_t waitMs = 0) {
+        Order order;
+        if (orderUpdates && (waitMs ? orderUpdates->wait(id, waitMs, order) : orderUpdates->get(id, order))) {
+            return Response<Order>(0, "OK", std::move(order));
+        }
+        if (!waitMs && orderPoller && orderPoller->get(id, order)) {
+            return Response<Order>(0, "OK", std::move(order));
+        }
+        auto epoch = orderUpdates ? orderUpdates->epoch() : 0;
+        auto response = client->getOrder(id);
+        if (response && orderUpdates) {
+            // the stream keeps it current from here on
+            orderUpdates->seed(response.content(), epoch);
+        }
+        if (response && orderPoller) {
+            orderPoller->put(response.content());
+        }
+        return response;
+    }
+
+    /**
+     * Drop the orders that are final for longer than the maximum age, at most once per EVICTION_INTERVAL.
+     */
+    void evictOrders() {
+        auto now = (__time32_t)std::time(nullptr);
+        if (now < s_nextEviction) {
+            return;
+        }
+        s_nextEviction = now + EVICTION_INTERVAL;
+        auto before = ((int64_t)now - s_orders.maxAge()) * 1000000000ll;
+        auto evicted = s_orders.evict((int64_t)now * 1000000000ll);
+        if (orderUpdates) {
+            orderUpdates->evict(before);
+        }
+        if (evicted) {
+            s_logger->logDebug("Evicted %zu final orders, %zu left\n", evicted, s_orders.size());
+            s_exits.evict([](int32_t tradeId, const Exit&) { return s_orders.find(tradeId) != nullptr; });
+        }
+    }
+
+    /**
+     * Send the cancel of a trade's order without waiting for it, confirmCancels() follows it from there. Returns the order as
+     * the cancel left it, pending_cancel, or final if it was final already.
+     */
+    Response<Order> cancelAsync(const std::string& id, int32_t tradeId) {
+        auto start = std::chrono::steady_clock::now();
+        if (orderPoller) {
+            orderPoller->invalidate(id);
+        }
+        auto response = client->cancelOrder(id);
+        if (response) {
+            auto& order = response.content();
+            if (isFinal(order.status)) {
+                s_orders.put(order);
+            }
+            else {
+                s_orders.markPendingCancel(tradeId);
+                s_pendingCancels.push_back({ id, tradeId, start + std::chrono::milliseconds(CANCEL_DEADLINE_MS) });
+            }
+        }
+        ++s_cancelMetrics.sent;
+        s_cancelMetrics.blockedNanos += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return response;
+    }
+
+    /**
+     * Confirm the cancels sent without waiting, from the trade stream or the open order snapshot, at most once per ORDER_POLL_MS.
+     * An order gone from the snapshot is read from REST once. A cancel not confirmed by its deadline is not followed any further,
+     * the order keeps the state it was last read in and the next BrokerSell2 sends the cancel again.
+     */
+    void confirmCancels() {
+        auto now = std::chrono::steady_clock::now();
+        if (s_pendingCancels.empty() || now < s_nextCancelCheck) {
+            return;
+        }
+        s_nextCancelCheck = now + std::chrono::milliseconds(ORDER_POLL_MS);
+
+        for (auto it = s_pendingCancels.begin(); it != s_pendingCancels.end();) {
+            Order order;
+            bool read = orderUpdates && orderUpdates->get(it->id, order);
+            bool overdue = now >= it->deadline;
+            if (!read && (overdue || !orderPoller || !orderPoller->get(it->id, order))) {
+                auto response = client->getOrder(it->id);
+                if (response) {
+                    order = std::move(response.content());
+                    read = true;
+                }
+            }
+            if (!read || !isFinal(order.status)) {
+                if (overdue) {
+                    ++s_cancelMetrics.overdue;
+                    if (read) {
+                        s_orders.put(order);
+                    }
+                    else {
+                        s_orders.clearPendingCancel(it->tradeId);
+                    }
+                    auto text = "Cancel of order " + std::to_string(it->tradeId) + " not confirmed after " + std::to_string(CANCEL_DEADLINE_MS) +
+                        " ms, order " + (read ? order.status : std::string("not readable")) + ".";
+                    BrokerError(text.c_str());
+                    s_logger->logWarning("%s\n", text.c_str());
+                    it = s_pendingCancels.erase(it);
+                }
+                else {
+                    ++it;
+                }
+                continue;
+            }
+
+            ++s_cancelMetrics.confirmed;
+            s_orders.put(order);
+            if (order.filled_qty) {
+                ++s_cancelMetrics.filledFirst;
+                invalidatePortfolio();
+                BrokerError(("Order " + std::to_string(it->tradeId) + " filled " + std::to_string(order.filled_qty) + " before it was canceled.").c_str());
+            }
+            it = s_pendingCancels.erase(it);
+        }
+    }
+
+    /**
+     * Stop hedging, the primary becomes the market data source again.
+     */
+    void unhedgeMarketData() {
+        if (!hedgedMD) {
+            return;
+        }
+        pMarketData = (&hedgedMD->primary() == polygon.get()) ? (MarketData*)polygon.get() : (MarketData*)alpacaMD.get();
+        hedgedMD.reset();
+    }
 
     ////////////////////////////////////////////////////////////////
     DLLFUNC_C int BrokerOpen(char* Name, FARPROC fpError, FARPROC fpProgress)
@@ -65,6 +301,19 @@ namespace alpaca
     {
         if (!User) // log out
         {
+            // the stream thread must be gone before the DLL is unloaded
+            dataStream.reset();
+            // it holds requests in flight and the providers a new login replaces
+            unhedgeMarketData();
+            liveBars.reset();
+            quoteBook.reset();
+            tradeStream.reset();
+            orderPoller.reset();
+            portfolio.reset();
+            orderUpdates.reset();
+            s_unknownSymbols.clear();
+            s_lastPrices.clear();
+            s_pendingCancels.clear();
             return 0;
         }
 
@@ -78,8 +327,16 @@ namespace alpaca
             apiKey = apiKey.substr(0, pos);
         }
 
+        // the trade stream and the hedger log through the client, the hedger also holds the providers replaced below
+        unhedgeMarketData();
+        tradeStream.reset();
+        orderPoller.reset();
+        portfolio.reset();
         client = std::make_unique<Client>(apiKey, Pwd, isPaperTrading);
         s_logger = &client->logger();
+        s_streamKey = apiKey;
+        s_streamSecret = Pwd;
+        s_streamFeed = isPaperTrading ? "iex" : "sip";
 
         if (!isPaperTrading) {
             polygon = std::move(std::make_unique<Polygon>(apiKey, client->logger()));
@@ -108,6 +365,22 @@ namespace alpaca
             return 0;
         }
 
+        if (!client->loadCalendar()) {
+            BrokerError("Failed to load market calendar, weekends are skipped but holidays are not.");
+        }
+        pMarketData->setCalendar(&client->calendar());
+
+        if (!client->loadAssets()) {
+            BrokerError("Failed to load the asset catalog, symbols are not checked before orders.");
+        }
+
+        // order states are pushed from here on, orders are read from REST only while the stream is down
+        orderUpdates = std::make_unique<OrderUpdates>();
+        tradeStream = std::make_unique<TradeStream>(client->baseUrl(), apiKey, Pwd, *orderUpdates, client->logger());
+        tradeStream->start();
+        orderPoller = std::make_unique<OrderPoller>(*client, client->logger(), ORDER_POLL_MS);
+        portfolio = std::make_unique<Portfolio>(*client, client->logger());
+
         auto& account = response.content().account_number;
         BrokerError(("Account " + account).c_str());
         sprintf_s(Account, 1024, account.c_str());
@@ -126,34 +399,66 @@ namespace alpaca
 
     DLLFUNC_C int BrokerTime(DATE* pTimeGMT)
     {
-        auto response = client->getClock();
-        if (!response) {
+        client->pollAssets();
+        evictOrders();
+        confirmCancels();
+
+        // served from the local clock, synced with Alpaca every few minutes and at market open and close
+        int64_t nanos;
+        bool isOpen;
+        if (!client->serverTime(nanos, isOpen)) {
 #ifdef _DEBUG
-            BrokerError(response.what().c_str());
+            BrokerError("Failed to get the server time.");
 #endif
             return 0;
         }
 
-        auto& clock = response.content();
-
-        *pTimeGMT = convertTime(clock.timestamp);
-        return clock.is_open ? 2 : 1;
+        // with the sub-second part, convertTime would cut it to whole seconds
+        *pTimeGMT = nanos / 1e9 / 86400. + 25569.;
+        return isOpen ? 2 : 1;
     }
 
     DLLFUNC_C int BrokerAsset(char* Asset, double* pPrice, double* pSpread, double* pVolume, double* pPip, double* pPipCost, double* pLotAmount, double* pMarginCost, double* pRollLong, double* pRollShort)
     {
         if (!pPrice) {
             // this is subscribe
+            AssetInfo info;
+            if (client->assets().find(Asset, info)) {
+                if (!info.tradable) {
+                    BrokerError((std::string(Asset) + " is not tradable on Alpaca.").c_str());
+                }
+            }
+            else if (!client->assets().empty()) {
+                // the quote requests are skipped until the cache expires, a new listing is asked for then
+                BrokerError((std::string(Asset) + " is not an Alpaca asset.").c_str());
+                s_unknownSymbols.add(Asset);
+            }
+            s_assets.insert(Asset);
+            if (liveBars) {
+                liveBars->watch(Asset);
+                dataStream->subscribeTrades(Asset);
+            }
+            if (quoteBook) {
+                dataStream->subscribeQuotes(Asset);
+            }
             return 1;
         }
 
+        if (s_unknownSymbols.contains(Asset)) {
+            return 0;
+        }
+
         auto response = pMarketData->getLastQuote(Asset);
         if (!response) {
             BrokerError(("Failed to get assert " + std::string(Asset) + " error: " + response.what()).c_str());
+            if (isNotFound(response.getCode(), response.what())) {
+                s_unknownSymbols.add(Asset);
+            }
             return 0;
         }
 
         auto& lastQuote = response.content();
+        s_lastPrices[Asset] = std::make_pair(lastQuote.quote.ask_price, lastQuote.quote.bid_price);
 
         if (pPrice) {
             *pPrice = lastQuote.quote.ask_price;
@@ -164,10 +469,10 @@ namespace alpaca
         }
 
         if (pVolume) {
-            auto barResponse = pMarketData->getBars({ Asset }, 0, 0, 1, 1);
-            auto& bars = barResponse.content();
-            if (barResponse && !bars.empty()) {
-                *pVolume = bars.front().volume;
+            VectorBarSink sink(0, 0, 1);
+            auto barResponse = pMarketData->getBars({ Asset }, 0, 0, 1, sink);
+            if (barResponse && !sink.bars.empty()) {
+                *pVolume = sink.bars.front().volume;
             }
         }
 
@@ -190,79 +495,304 @@ namespace alpaca
     {
         if (!client || !Asset || !ticks || !nTicks) return 0;
 
-        if (!nTickMinutes) {
-            BrokerError("Tick data download is not supported by Alpaca.");
-            return 0;
-        }
-
-        // Alpaca only suport 1Min, 5Min, 15Min and 1D bars
-        assert(nTickMinutes == 1 || nTickMinutes == 5 || nTickMinutes == 15 || nTickMinutes == 1440);
-
         auto start = convertTime(tStart);
         auto end = convertTime(tEnd);
 
         s_logger->logDebug("BorkerHisotry %s start: %d end: %d nTickMinutes: %d nTicks: %d\n", Asset, start, end, nTickMinutes, nTicks);
 
-        int barsDownloaded = 0;
-
-        // make sure enough bar downloaded logic seems doesn't need. Comment out for now
-
-        //do {
-            //s_logger->logDebug("download bars %s start: %d end: %d nTickMinutes: %d nTicks: %d\n", Asset, start, end, nTickMinutes, nTicks);
+        if (!nTickMinutes) {
+            // tick data, every trade becomes a T6 with all prices set to the trade price
+            T6TickSink sink(start, end, nTicks, ticks);
+            auto response = pMarketData->getTicks({ Asset }, start, end, TickType::Trades, sink);
+            if (!response) {
+                BrokerError(response.what().c_str());
+            }
+            return (int)sink.count();
+        }
 
-            auto response = pMarketData->getBars({ Asset }, start, end, nTickMinutes, nTicks);
+        // bars are converted straight into ticks, newest first as Zorro expects
+        T6Sink sink(start, end, nTicks, nTickMinutes, ticks);
+        auto restEnd = end;
+        if (liveBars) {
+            // the newest bars come from the trade stream, REST only has to fill in the older ones
+            auto coveredFrom = liveBars->read(Asset, start, end, nTickMinutes, sink);
+            if (coveredFrom != std::numeric_limits<uint32_t>::max() && (!end || (uint32_t)end >= coveredFrom)) {
+                restEnd = (__time32_t)coveredFrom - 1;
+            }
+        }
+        if (sink.wantsMore() && restEnd >= start) {
+            // then the history exported with brokerCommand(2003, "...;bars"), as far as it is complete
+            restEnd = readCachedBars(Asset, start, restEnd, nTickMinutes, sink);
+        }
+        if (sink.wantsMore() && restEnd >= start) {
+            auto response = pMarketData->getBars({ Asset }, start, restEnd, nTickMinutes, sink);
             if (!response) {
                 BrokerError(response.what().c_str());
-                return barsDownloaded;
-            }
-
-            auto& bars = response.content();
-            if (bars.empty()) {
-                return barsDownloaded;
-            }
-
-            for (int i = bars.size() - 1; i >= 0; --i) {
-                auto& bar = bars[i];
-                //if (i == iter->second.size() - 1) {
-                //    s_logger->logDebug("first bar %s\n", timeToString(bar.time).c_str());
-                //}
-                auto& tick = ticks[barsDownloaded++];
-                // change time to bar close time
-                __time32_t barCloseTime = bar.time + nTickMinutes * 60;
-                tick.time = convertTime(barCloseTime);
-                tick.fOpen = bar.open_price;
-                tick.fHigh = bar.high_price;
-                tick.fLow = bar.low_price;
-                tick.fClose = bar.close_price;
-                tick.fVol = bar.volume;
-            }
-        //    s_logger->logDebug("last bar %s\n", timeToString(iter->second.front().time).c_str());
-        //    nTicks -= iter->second.size();
-        //    end = iter->second.front().time - nTickMinutes * 60;
-        //    s_logger->logDebug("next end %s\n", timeToString(end).c_str());
-        //    s_logger->logDebug("%d bars downloaded\n", iter->second.size());
-        //} while (nTicks && end >= start);
-        return barsDownloaded;
+            }
+        }
+
+        auto& check = sink.check();
+        if (check.invalid) {
+            s_logger->logWarning("%s: %d invalid bars. high < low: %d, NaN price: %d, time out of order: %d\n",
+                Asset, check.invalid, check.highBelowLow, check.nan, check.timeOrder);
+        }
+        return (int)sink.count();
     }
 
     DLLFUNC_C int BrokerAccount(char* Account, double* pdBalance, double* pdTradeVal, double* pdMarginVal)
     {
-        auto response = client->getAccount();
-        if (!response) {
+        takeFills();
+        auto* account = portfolio->account();
+        if (!account) {
             return 0;
         }
 
         if (pdBalance) {
-            *pdBalance = response.content().cash;
+            *pdBalance = account->cash;
         }
 
         if (pdTradeVal) {
-            *pdTradeVal = response.content().equity - response.content().cash;
+            *pdTradeVal = account->equity - account->cash;
         }
         return 1;
     }
 
-    DLLFUNC_C int BrokerBuy2(char* Asset, int nAmount, double dStopDist, double dLimit, double* pPrice, int* pFill) 
+    /**
+     * The price an order is likely to fill at without a request: the limit, the streamed quote or the last BrokerAsset quote.
+     */
+    double estimatePrice(const std::string& symbol, bool buy, double limit) {
+        if (limit) {
+            return limit;
+        }
+        Quote quote;
+        if (quoteBook && quoteBook->get(symbol, quote)) {
+            return buy ? quote.ask_price : quote.bid_price;
+        }
+        auto it = s_lastPrices.find(symbol);
+        if (it != s_lastPrices.end()) {
+            return buy ? it->second.first : it->second.second;
+        }
+        return 0.;
+    }
+
+    /**
+     * A position of the plugin was opened today (New York time), reducing it would be a day trade.
+     */
+    bool openedToday(const std::string& symbol, int32_t position) {
+        auto now = (__time32_t)std::time(nullptr);
+        auto offset = getNewYorkOffset(now);
+        int64_t midnight = ((int64_t)(now + offset) / 86400 * 86400 - offset) * 1000000000ll;
+        auto side = position > 0 ? OrderSide::Buy : OrderSide::Sell;
+        bool today = false;
+        s_orders.forEachOfSymbol(symbol, [&](const OrderRecord& record) {
+            today |= record.filledQty && record.side == side && record.updated >= midnight;
+        });
+        return today;
+    }
+
+    /**
+     * Run the pre-trade check of an order, returns the amount that may be sent, 0 if the order is rejected. The check reads
+     * the last snapshots even if a fill invalidated them, asking again would cost more round trips than a rare rejection it
+     * saves, Alpaca keeps the final say. With buyingPower the check takes that instead of the account's and deducts what
+     * the order opens, e.g. for the orders of a batch that are all sent before the first fills.
+     */
+    int preTradeCheck(const char* Asset, int nAmount, double dLimit, double* buyingPower = nullptr) {
+        RiskOrder order;
+        order.qty = nAmount;
+        order.price = estimatePrice(Asset, nAmount > 0, dLimit);
+        if (!portfolio->position(Asset, order.position, true)) {
+            // the rules need the position, Alpaca decides
+            return nAmount;
+        }
+        order.openedToday = order.position && openedToday(Asset, order.position);
+
+        AssetInfo info;
+        bool hasAsset = client->assets().find(Asset, info);
+        std::string reason;
+        auto* account = portfolio->account(true);
+        Account batchAccount;
+        if (account && buyingPower) {
+            batchAccount = *account;
+            batchAccount.buying_power = *buyingPower;
+            account = &batchAccount;
+        }
+        auto qty = s_riskCheck.check(order, account, hasAsset ? &info : nullptr, reason);
+        if (qty && account && buyingPower) {
+            // a sell doesn't free any, it may fill after the buys
+            bool sameSide = !order.position || (order.position > 0) == (qty > 0);
+            auto opening = sameSide ? std::abs(qty) : std::max(std::abs(qty) - std::abs(order.position), 0);
+            *buyingPower -= opening * order.price;
+        }
+        if (!qty) {
+            BrokerError(("Order for " + std::string(Asset) + " rejected: " + reason + ".").c_str());
+        }
+        else if (qty != nAmount) {
+            BrokerError(("Order for " + std::string(Asset) + " clipped to " + std::to_string(qty) + ": " + reason + ".").c_str());
+        }
+        return qty;
+    }
+
+    /**
+     * The entry can carry its exits as bracket or OTO legs, Alpaca holds them until it fills. A trailing stop can't be a leg
+     * and IOC/FOK entries can't have any, their exits are sent on their own once the entry filled.
+     */
+    bool attachesExits() {
+        return s_exits.config().stop != StopType::TrailingStop && (s_tif == TimeInForce::Day || s_tif == TimeInForce::GTC);
+    }
+
+    /**
+     * Send the exits of a filled entry as orders of their own, an OCO of take profit and stop or a single stop. They are GTC
+     * and sent outside the session as well, Alpaca holds them until the next one.
+     */
+    bool placeExits(int32_t tradeId, Exit& exit, const std::string& symbol, OrderSide entrySide, double entryPrice) {
+        auto prices = exitPrices(s_exits.config(), entrySide, entryPrice, exit.stopDist);
+        auto side = entrySide == OrderSide::Buy ? OrderSide::Sell : OrderSide::Buy;
+        Response<Order> response;
+        if (prices.trail) {
+            TrailingStopParams trailingStop;
+            trailingStop.trailPrice = formatPrice(prices.trail);
+            response = client->submitOrder(symbol, exit.qty, side, OrderType::TrailingStop, TimeInForce::GTC, "", "", false, "EXIT",
+                OrderClass::Simple, nullptr, nullptr, &trailingStop, false);
+        }
+        else if (prices.takeProfit) {
+            TakeProfitParams takeProfit;
+            takeProfit.limitPrice = formatPrice(prices.takeProfit);
+            StopLossParams stopLoss;
+            stopLoss.stopPrice = formatPrice(prices.stop);
+            if (prices.stopLimit) {
+                stopLoss.limitPrice = formatPrice(prices.stopLimit);
+            }
+            response = client->submitOrder(symbol, exit.qty, side, OrderType::Limit, TimeInForce::GTC, "", "", false, "EXIT",
+                OrderClass::OCO, &takeProfit, &stopLoss, nullptr, false);
+        }
+        else if (prices.stop) {
+            response = client->submitOrder(symbol, exit.qty, side, prices.stopLimit ? OrderType::StopLimit : OrderType::Stop, TimeInForce::GTC,
+                prices.stopLimit ? formatPrice(prices.stopLimit) : "", formatPrice(prices.stop), false, "EXIT",
+                OrderClass::Simple, nullptr, nullptr, nullptr, false);
+        }
+        else {
+            response = Response<Order>(1, "no entry price");
+        }
+
+        if (!response) {
+            ++s_exits.metrics().failed;
+            BrokerError(("Failed to place the stop of trade " + std::to_string(tradeId) + ", Zorro has to handle it. " + response.what()).c_str());
+            return false;
+        }
+        auto& order = response.content();
+        exit.orders.clear();
+        exit.orders.push_back(order.id);
+        for (auto& leg : order.legs) {
+            exit.orders.push_back(leg.id);
+        }
+        exit.placed = true;
+        ++s_exits.metrics().placed;
+        if (orderPoller) {
+            orderPoller->put(order);
+        }
+        return true;
+    }
+
+    /**
+     * Send the exits that wait for their entry to fill, once the entry is final. An entry that didn't fill needs none.
+     */
+    void sendPendingExits(int32_t tradeId, const std::string& symbol, OrderSide side, bool final, uint32_t filledQty, double filledAvgPrice) {
+        auto* exit = s_exits.find(tradeId);
+        if (!exit || exit->placed || !final) {
+            return;
+        }
+        if (filledQty) {
+            exit->qty = filledQty;
+            if (placeExits(tradeId, *exit, symbol, side, filledAvgPrice)) {
+                return;
+            }
+        }
+        s_exits.erase(tradeId);
+    }
+
+    /**
+     * The quantity the exit orders of a trade filled, with their average price and how far the stop filled past the stop price.
+     */
+    uint32_t exitFills(const Order& order, double& value, double& slippage) {
+        if (order.filled_qty && (order.type == OrderType::Stop || order.type == OrderType::StopLimit || order.type == OrderType::TrailingStop)) {
+            slippage += (order.side == OrderSide::Sell ? order.stop_price - order.filled_avg_price : order.filled_avg_price - order.stop_price) * order.filled_qty;
+        }
+        value += order.filled_avg_price * order.filled_qty;
+        return order.filled_qty;
+    }
+
+    /**
+     * The exits closed the trade at the venue, Zorro learns it from BrokerTrade.
+     */
+    void exitClosed(int32_t tradeId, Exit& exit, uint32_t filled, double value, double slippage) {
+        exit.closed = true;
+        exit.closePrice = value / filled;
+        auto& metrics = s_exits.metrics();
+        ++metrics.triggered;
+        if (slippage) {
+            metrics.slippage += slippage / filled;
+            ++metrics.stopFills;
+        }
+        s_orders.markClosed(tradeId);
+        invalidatePortfolio();
+    }
+
+    /**
+     * Read the exits of a trade, they may have closed it.
+     */
+    void readExits(int32_t tradeId, Exit& exit) {
+        uint32_t filled = 0;
+        double value = 0.;
+        double slippage = 0.;
+        for (auto& id : exit.orders) {
+            auto response = readOrder(id);
+            if (response) {
+                filled += exitFills(response.content(), value, slippage);
+            }
+        }
+        if (filled && filled >= exit.qty) {
+            exitClosed(tradeId, exit, filled, value, slippage);
+        }
+    }
+
+    /**
+     * Cancel the exits of a trade Zorro closes itself, returns the quantity they filled before.
+     */
+    uint32_t cancelExits(int32_t tradeId, Exit& exit) {
+        uint32_t filled = 0;
+        double value = 0.;
+        double slippage = 0.;
+        for (auto& id : exit.orders) {
+            if (orderPoller) {
+                orderPoller->invalidate(id);
+            }
+            // the other side of an OCO is canceled with the first one, its final state comes back all the same
+            client->cancelOrder(id);
+        }
+        // what they filled decides what is left to close, so their final states are waited for
+        for (auto& id : exit.orders) {
+            auto response = readOrder(id, ORDER_WAIT_MS);
+            if (response) {
+                filled += exitFills(response.content(), value, slippage);
+            }
+        }
+        exit.orders.clear();
+        exit.placed = false;
+        if (filled && filled >= exit.qty) {
+            exitClosed(tradeId, exit, filled, value, slippage);
+        }
+        else {
+            exit.qty -= filled;
+            ++s_exits.metrics().canceled;
+        }
+        return filled;
+    }
+
+    /**
+     * BrokerBuy2, and the closing order of BrokerSell2 without the pre-trade check. Zorro has to be able to close a trade
+     * whatever the limits say.
+     */
+    int sendOrder(char* Asset, int nAmount, double dStopDist, double dLimit, double* pPrice, int* pFill, bool check)
     {
         auto start = std::time(nullptr);
 
@@ -276,22 +806,65 @@ namespace alpaca
             limit = std::to_string(dLimit);
         }
         std::string stop;
-        if (dStopDist) {
 
+        s_logger->logDebug("BrokerBuy2 %s orderText=%s nAmount=%d dStopDist=%f limit=%f\n", Asset, s_nextOrderText.c_str(), nAmount, dStopDist, dLimit);
+
+        // Alpaca would reject it anyway, the local check saves the round trip
+        if (check) {
+            nAmount = preTradeCheck(Asset, nAmount, dLimit);
+            if (!nAmount) {
+                return 0;
+            }
         }
 
-        s_logger->logDebug("BrokerBuy2 %s orderText=%s nAmount=%d dStopDist=%f limit=%f\n", Asset, s_nextOrderText.c_str(), nAmount, dStopDist, dLimit);
+        // the stop is executed at the venue instead of by Zorro a loop and a round trip later, -1 closes a position
+        bool withExits = s_venueStops && dStopDist > 0.;
+        auto orderClass = OrderClass::Simple;
+        TakeProfitParams takeProfit;
+        StopLossParams stopLoss;
+        if (withExits && attachesExits()) {
+            auto prices = exitPrices(s_exits.config(), side, estimatePrice(Asset, nAmount > 0, dLimit), dStopDist);
+            if (prices.stop) {
+                stopLoss.stopPrice = formatPrice(prices.stop);
+                if (prices.stopLimit) {
+                    stopLoss.limitPrice = formatPrice(prices.stopLimit);
+                }
+                if (prices.takeProfit) {
+                    takeProfit.limitPrice = formatPrice(prices.takeProfit);
+                }
+                orderClass = prices.takeProfit ? OrderClass::Bracket : OrderClass::OTO;
+            }
+        }
 
-        auto response = client->submitOrder(Asset, std::abs(nAmount), side, type, s_tif, limit, stop, false, s_nextOrderText);
+        auto response = client->submitOrder(Asset, std::abs(nAmount), side, type, s_tif, limit, stop, false, s_nextOrderText, orderClass,
+            takeProfit.limitPrice.empty() ? nullptr : &takeProfit, stopLoss.stopPrice.empty() ? nullptr : &stopLoss);
         if (!response) {
             BrokerError(response.what().c_str());
             return 0;
         }
+        // the order may fill any moment, the position has to be asked again
+        invalidatePortfolio();
 
         auto* order = &response.content();
         auto exchOrdId = order->id;
         auto internalOrdId = order->internal_id;
-        s_mapOrderByClientOrderId.emplace(internalOrdId, *order);
+        if (withExits) {
+            auto& exit = s_exits.add(internalOrdId);
+            exit.stopDist = dStopDist;
+            exit.qty = (uint32_t)std::abs(nAmount);
+            for (auto& leg : order->legs) {
+                exit.orders.push_back(leg.id);
+            }
+            exit.placed = !exit.orders.empty();
+            if (exit.placed) {
+                ++s_exits.metrics().attached;
+            }
+        }
+        s_orders.put(*order);
+        if (orderPoller) {
+            // fresh even if the last snapshot was taken before
+            orderPoller->put(*order);
+        }
 
         if (order->filled_qty) {
             if (pPrice) {
@@ -300,6 +873,7 @@ namespace alpaca
             if (pFill) {
                 *pFill = response.content().filled_qty;
             }
+            sendPendingExits(internalOrdId, order->symbol, order->side, isFinal(order->status), order->filled_qty, order->filled_avg_price);
             //return -1;
             return internalOrdId;
         }
@@ -307,13 +881,14 @@ namespace alpaca
         if (s_tif == TimeInForce::IOC || s_tif == TimeInForce::FOK) {
             // order not filled in the submitOrder response
             // query order status to get fill status
+            Response<Order> response2;
             do {
-                auto response2 = client->getOrder(exchOrdId, false, true);
+                response2 = readOrder(exchOrdId, ORDER_WAIT_MS);
                 if (!response2) {
                     break;
                 }
                 order = &response2.content();
-                s_mapOrderByClientOrderId[internalOrdId] = *order;
+                s_orders.put(*order);
                 if (pPrice) {
                     *pPrice = order->filled_avg_price;
                 }
@@ -329,18 +904,43 @@ namespace alpaca
 
                 auto timePast = std::difftime(std::time(nullptr), start);
                 if (timePast >= 30) {
-                    auto response3 = client->cancelOrder(exchOrdId);
+                    auto response3 = cancelAsync(exchOrdId, internalOrdId);
                     if (!response3) {
                         BrokerError(("Failed to cancel unfilled FOK/IOC order " + exchOrdId + " " + response3.what()).c_str());
                     }
+                    s_exits.erase(internalOrdId);
                     return 0;
                 }
             } while (!order->filled_qty);
+            sendPendingExits(internalOrdId, order->symbol, order->side, isFinal(order->status), order->filled_qty, order->filled_avg_price);
         }
         //return -1;
         return internalOrdId;
     }
 
+    DLLFUNC_C int BrokerBuy2(char* Asset, int nAmount, double dStopDist, double dLimit, double* pPrice, int* pFill)
+    {
+        return sendOrder(Asset, nAmount, dStopDist, dLimit, pPrice, pFill, true);
+    }
+
+    /**
+     * Fill in the BrokerTrade results of an order, returns the filled quantity.
+     */
+    int tradeResult(const std::string& symbol, OrderSide side, double filledAvgPrice, uint32_t filledQty, double* pOpen, double* pProfit) {
+        if (pOpen) {
+            *pOpen = filledAvgPrice;
+        }
+
+        if (pProfit && filledQty) {
+            auto resp = pMarketData->getLastQuote(symbol);
+            if (resp) {
+                auto& quote = resp.content().quote;
+                *pProfit = side == OrderSide::Buy ? ((quote.ask_price - filledAvgPrice) * filledQty) : (filledAvgPrice - quote.bid_price) * filledQty;
+            }
+        }
+        return filledQty;
+    }
+
     DLLFUNC_C int BrokerTrade(int nTradeID, double* pOpen, double* pClose, double* pCost, double *pProfit) {
         s_logger->logInfo("BrokerTrade: %d\n", nTradeID);
        /* if (nTradeID != -1) {
@@ -348,9 +948,41 @@ namespace alpaca
             return NAY;
         }*/
         
+        auto* known = s_orders.find(nTradeID);
+        auto* exit = s_exits.find(nTradeID);
+        if (known && exit && exit->placed && !exit->closed && known->filledQty) {
+            readExits(nTradeID, *exit);
+        }
+        if (known && exit && exit->closed) {
+            // closed by its stop or take profit at the venue
+            auto qty = exit->qty;
+            if (pOpen) {
+                *pOpen = known->filledAvgPrice;
+            }
+            if (pClose) {
+                *pClose = exit->closePrice;
+            }
+            if (pProfit) {
+                *pProfit = (exit->closePrice - known->filledAvgPrice) * qty * (known->side == OrderSide::Buy ? 1 : -1);
+            }
+            return -(int)qty;
+        }
+
+        if (known && known->closed && known->filledQty) {
+            // e.g. by brokerCommand(2015)
+            tradeResult(s_orders.symbolOf(*known), known->side, known->filledAvgPrice, known->filledQty, pOpen, nullptr);
+            return -(int)known->filledQty;
+        }
+
+        if (known && known->isFinal()) {
+            // a final order doesn't change any more, nothing to read
+            sendPendingExits(nTradeID, s_orders.symbolOf(*known), known->side, true, known->filledQty, known->filledAvgPrice);
+            return tradeResult(s_orders.symbolOf(*known), known->side, known->filledAvgPrice, known->filledQty, pOpen, pProfit);
+        }
+
         Response<Order> response;
-        auto iter = s_mapOrderByClientOrderId.find(nTradeID);
-        if (iter == s_mapOrderByClientOrderId.end()) {
+        uint32_t filledBefore = 0;
+        if (!known) {
             // unknown order?
             std::stringstream clientOrderId;
             clientOrderId << "ZORRO_";
@@ -363,10 +995,10 @@ namespace alpaca
                 BrokerError(response.what().c_str());
                 return NAY;
             }
-            s_mapOrderByClientOrderId.insert(std::make_pair(nTradeID, response.content()));
         }
         else {
-            response = client->getOrder(iter->second.id);
+            filledBefore = known->filledQty;
+            response = readOrder(s_orders.idOf(*known));
             if (!response) {
                 BrokerError(response.what().c_str());
                 return NAY;
@@ -374,70 +1006,120 @@ namespace alpaca
         }
 
         auto& order = response.content();
-        s_mapOrderByClientOrderId[nTradeID] = order;
-
-        if (pOpen) {
-            *pOpen = order.filled_avg_price;
-        }
-
-        if (pProfit && order.filled_qty) {
-            auto resp = pMarketData->getLastQuote(order.symbol);
-            if (resp) {
-                auto& quote = resp.content().quote;
-                *pProfit = order.side == OrderSide::Buy ? ((quote.ask_price - order.filled_avg_price) * order.filled_qty) : (order.filled_avg_price - quote.bid_price) * order.filled_qty;
-            }
+        s_orders.put(order);
+        if (order.filled_qty != filledBefore) {
+            // a fill opened or changed the position
+            invalidatePortfolio();
         }
-        return order.filled_qty;
+        sendPendingExits(nTradeID, order.symbol, order.side, isFinal(order.status), order.filled_qty, order.filled_avg_price);
+        return tradeResult(order.symbol, order.side, order.filled_avg_price, order.filled_qty, pOpen, pProfit);
     }
 
     DLLFUNC_C int BrokerSell2(int nTradeID, int nAmount, double Limit, double* pClose, double* pCost, double* pProfit, int* pFill) {
         s_logger->logDebug("BrokerSell2 nTradeID=%d nAmount=%d limit=%f\n", nTradeID,nAmount, Limit);
 
-        auto iter = s_mapOrderByClientOrderId.find(nTradeID);
-        if (iter == s_mapOrderByClientOrderId.end()) {
+        auto* known = s_orders.find(nTradeID);
+        if (!known) {
             BrokerError(("Order " + std::to_string(nTradeID) + " not found.").c_str());
             return 0;
         }
 
-        auto& order = iter->second;
-        if (order.status == "filled") {
+        // a copy, the closing order below may move the records
+        auto order = *known;
+        auto symbol = s_orders.symbolOf(order);
+        if (order.status == OrderStatus::Filled) {
             // order has been filled
-            auto closeTradeId = BrokerBuy2((char*)order.symbol.c_str(), -nAmount, 0, Limit, pProfit, pFill);
+            auto requested = (uint32_t)std::abs(nAmount);
+            auto* exit = s_exits.find(nTradeID);
+            if (exit && exit->placed && !exit->closed) {
+                // they would close the position a second time, unless they closed (some of) it already
+                auto exited = (int)std::min<uint32_t>(cancelExits(nTradeID, *exit), (uint32_t)std::abs(nAmount));
+                nAmount = nAmount > 0 ? nAmount - exited : nAmount + exited;
+            }
+            if (exit && exit->closed) {
+                if (pClose) {
+                    *pClose = exit->closePrice;
+                }
+                if (pFill) {
+                    *pFill = (int)exit->qty;
+                }
+                if (pProfit) {
+                    *pProfit = (exit->closePrice - order.filledAvgPrice) * exit->qty * (order.side == OrderSide::Buy ? 1 : -1);
+                }
+                return nTradeID;
+            }
+
+            auto closeTradeId = nAmount ? sendOrder((char*)symbol.c_str(), -nAmount, 0, Limit, pProfit, pFill, false) : 0;
+            if (exit) {
+                // the rest of the position keeps its stop
+                auto closed = closeTradeId ? (uint32_t)std::abs(nAmount) : 0;
+                exit = s_exits.find(nTradeID);
+                if (exit && exit->qty > closed && !exit->placed) {
+                    exit->qty -= closed;
+                    placeExits(nTradeID, *exit, symbol, order.side, order.filledAvgPrice);
+                }
+                else {
+                    s_exits.erase(nTradeID);
+                }
+            }
             if (closeTradeId) {
-                auto iter2 = s_mapOrderByClientOrderId.find(closeTradeId);
-                if (iter2 != s_mapOrderByClientOrderId.end()) {
-                    auto& closeTrade = iter2->second;
+                auto* closeTrade = s_orders.find(closeTradeId);
+                if (closeTrade) {
                     if (pClose) {
-                        *pClose = closeTrade.filled_avg_price;
+                        *pClose = closeTrade->filledAvgPrice;
                     }
                     if (pFill) {
-                        *pFill = closeTrade.filled_qty;
+                        *pFill = closeTrade->filledQty;
                     }
                     if (pProfit) {
-                        *pProfit = (closeTrade.filled_avg_price - order.filled_avg_price) * closeTrade.filled_qty;
+                        *pProfit = (closeTrade->filledAvgPrice - order.filledAvgPrice) * closeTrade->filledQty * (order.side == OrderSide::Buy ? 1 : -1);
                     }
                 }
+                // neither opens a trade any more
+                s_orders.markClosed(closeTradeId);
+                if (requested >= order.filledQty) {
+                    s_orders.markClosed(nTradeID);
+                }
                 return nTradeID;
             }
-            return 0;
+            // nothing left to close if the exits filled the amount
+            return nAmount ? 0 : nTradeID;
         }
         else {
             // close working order?
             BrokerError(("Close working order " + std::to_string(nTradeID)).c_str());
             if (std::abs(nAmount) == order.qty) {
-                auto response = client->cancelOrder(iter->second.id);
+                if (order.status == OrderStatus::PendingCancel) {
+                    // sent before, not confirmed yet
+                    return nTradeID;
+                }
+                auto response = cancelAsync(s_orders.idOf(order), nTradeID);
+                if (response && response.content().status == "filled") {
+                    BrokerError(("Order " + std::to_string(nTradeID) + " filled before it could be canceled.").c_str());
+                    return 0;
+                }
                 if (response) {
+                    // bracket and OTO legs are canceled with their entry
+                    s_exits.erase(nTradeID);
                     return nTradeID;
                 }
                 BrokerError(("Failed to close trade " + std::to_string(nTradeID) + " " + response.what()).c_str());
                 return 0;
             }
             else {
-                auto response = client->replaceOrder(order.id, iter->second.qty - nAmount, order.tif, (Limit ? std::to_string(Limit) : ""), "", iter->second.client_order_id);
+                auto id = s_orders.idOf(order);
+                if (orderPoller) {
+                    orderPoller->invalidate(id);
+                }
+                auto response = client->replaceOrder(id, order.qty - nAmount, order.tif, (Limit ? std::to_string(Limit) : ""), "", s_orders.clientOrderIdOf(order));
                 if (response) {
+                    invalidatePortfolio();
                     auto& replacedOrder = response.content();
+                    if (orderPoller) {
+                        orderPoller->put(replacedOrder);
+                    }
                     uint32_t orderId = replacedOrder.internal_id;
-                    s_mapOrderByClientOrderId.emplace(orderId, std::move(replacedOrder));
+                    s_orders.put(replacedOrder);
                     return orderId;
                 }
                 BrokerError(("Failed to modify trade " + std::to_string(nTradeID) + " " + response.what()).c_str());
@@ -447,18 +1129,13 @@ namespace alpaca
     }
 
     double getPosition(const std::string& asset) {
-        auto response = client->getPosition(asset);
-        if (!response) {
-            if (response.getCode() == 40410000) {
-                // no open position
-                return 0;
-            }
-
-            BrokerError(("Get position failed. " + response.what()).c_str());
+        takeFills();
+        int32_t qty;
+        if (!portfolio->position(asset, qty)) {
+            BrokerError("Get position failed.");
             return 0;
         }
-
-        return response.content().qty * (response.content().side == PositionSide::Long ? 1 : -1);
+        return qty;
     }
 
     constexpr int tifToZorroOrderType(TimeInForce tif) noexcept {
@@ -468,52 +1145,804 @@ namespace alpaca
     }
 
     void downloadAssets(char* symbols) {
+        std::vector<std::string> assets;
+        if (!symbols && !client->assets().empty()) {
+            assets = client->assets().tradableSymbols();
+        }
+        else if (!symbols) {
+            auto response = client->getAssets();
+            if (!response) {
+                BrokerError(("Failed to get assets. " + response.what()).c_str());
+                return;
+            }
+            for (auto& asset : response.content()) {
+                if (asset.tradable) {
+                    assets.push_back(asset.symbol);
+                }
+            }
+        }
+        else {
+            const char* delim = ",";
+            char* next_token;
+            char* token = strtok_s(symbols, delim, &next_token);
+            while (token != nullptr) {
+                assets.emplace_back(token);
+                token = strtok_s(nullptr, delim, &next_token);
+            }
+        }
+
         FILE* f;
         if (fopen_s(&f, "./Log/AssetsAlpaca.csv", "w+")) {
             s_logger->logError("Failed to open ./Log/AssetsAlpaca file\n");
             return;
         }
+        // a full universe is thousands of lines, they go out in 64 KB blocks
+        setvbuf(f, nullptr, _IOFBF, 1 << 16);
 
-        BrokerError("Generating Asset List...");
+        BrokerError(("Generating Asset List of " + std::to_string(assets.size()) + " assets...").c_str());
         fprintf(f, "Name,Price,Spread,RollLong,RollShort,PIP,PIPCost,MarginCost,Leverage,LotAmount,Commission\n");
 
-        auto getAsset = [f](const std::string& asset) {
-            BrokerError(("Asset " + asset).c_str());
-            BrokerProgress(1);
-            auto quote = pMarketData->getLastQuote(asset);
-            if (quote) {
-                auto& q = quote.content().quote;
-                fprintf(f, "%s,%f,%f,0.0,0.0,0.01,0.01,0.0,1,1,0.000,%s\n", asset.c_str(), q.ask_price, (q.ask_price - q.bid_price), asset.c_str());
+        // quotes of many assets per request, several requests in flight under the rate limiter
+        size_t written = 0;
+        auto total = std::max<size_t>(assets.size(), 1);
+        auto response = pMarketData->getLastQuotes(assets, [f, &written, total](const std::string& asset, const Quote& q) {
+            fprintf(f, "%s,%f,%f,0.0,0.0,0.01,0.01,0.0,1,1,0.000,%s\n", asset.c_str(), q.ask_price, (q.ask_price - q.bid_price), asset.c_str());
+            if (++written % 100 == 0) {
+                BrokerProgress((int)std::max<size_t>(1, written * 100 / total));
+            }
+        });
+        if (!response) {
+            BrokerError(response.what().c_str());
+        }
+
+        fclose(f);
+        BrokerError(("Asset list: " + std::to_string(written) + " of " + std::to_string(assets.size()) + " assets written to Log/AssetsAlpaca.csv").c_str());
+        s_logger->logDebug("close file\n");
+    }
+
+    __time32_t parseDay(const char* yyyymmdd) {
+        auto day = atoi(yyyymmdd);
+        auto ymd = date::year{ day / 10000 } / (day / 100 % 100) / (day % 100);
+        if (!ymd.ok()) {
+            return -1;
+        }
+        return (__time32_t)date::sys_seconds{ date::sys_days{ ymd } }.time_since_epoch().count();
+    }
+
+    /**
+     * Download trades into History/<symbol>_<year>.t1 and quotes into History/<symbol>_<year>.t2
+     * args: symbol,startDay[,endDay] with days as YYYYMMDD, endDay defaults to today.
+     */
+    double downloadTicks(char* args) {
+        if (!args) {
+            BrokerError("Usage: brokerCommand(2002, \"SYMBOL,YYYYMMDD[,YYYYMMDD]\")");
+            return 0;
+        }
+
+        const char* delim = ",";
+        char* next_token;
+        char* symbol = strtok_s(args, delim, &next_token);
+        char* sStart = strtok_s(nullptr, delim, &next_token);
+        char* sEnd = strtok_s(nullptr, delim, &next_token);
+        if (!symbol || !sStart) {
+            BrokerError("Usage: brokerCommand(2002, \"SYMBOL,YYYYMMDD[,YYYYMMDD]\")");
+            return 0;
+        }
+
+        auto start = parseDay(sStart);
+        auto end = sEnd ? parseDay(sEnd) : 0;
+        if (start < 0 || end < 0) {
+            BrokerError("Invalid day, use YYYYMMDD");
+            return 0;
+        }
+        if (end) {
+            end += 86399;   // include the whole end day
+        }
+
+        uint64_t records = 0;
+        for (auto type : { TickType::Trades, TickType::Quotes }) {
+            BrokerError((std::string("Downloading ") + symbol + (type == TickType::Quotes ? " quotes..." : " trades...")).c_str());
+            TickFileSink sink(symbol, type, start, end);
+            auto response = pMarketData->getTicks(symbol, start, end, type, sink);
+            sink.close();
+            records += sink.records();
+            if (!response) {
+                BrokerError(response.what().c_str());
+                break;
+            }
+            if (!sink.error().empty()) {
+                BrokerError(sink.error().c_str());
+                break;
+            }
+        }
+        return (double)records;
+    }
+    
+    /**
+     * Export bars into History/<symbol>_<year>.t6, or History/<symbol>.t6 for daily bars
+     * args: symbols;nTickMinutes;startDay[;endDay][;bars] with comma separated symbols and days as YYYYMMDD.
+     * "bars" writes compressed .bars files instead of .t6.
+     */
+    double exportHistory(char* args) {
+        const char* usage = "Usage: brokerCommand(2003, \"SYMBOL1,SYMBOL2;nTickMinutes;YYYYMMDD[;YYYYMMDD][;bars]\")";
+        if (!args) {
+            BrokerError(usage);
+            return 0;
+        }
+
+        char* next_token;
+        char* sSymbols = strtok_s(args, ";", &next_token);
+        char* sMinutes = strtok_s(nullptr, ";", &next_token);
+        char* sStart = strtok_s(nullptr, ";", &next_token);
+        char* sEnd = strtok_s(nullptr, ";", &next_token);
+        char* sFormat = strtok_s(nullptr, ";", &next_token);
+        if (!sSymbols || !sMinutes || !sStart) {
+            BrokerError(usage);
+            return 0;
+        }
+        if (sEnd && !sFormat && !isdigit((unsigned char)sEnd[0])) {
+            sFormat = sEnd;     // format without an end day
+            sEnd = nullptr;
+        }
+        if (sFormat && strcmp(sFormat, "bars")) {
+            BrokerError(usage);
+            return 0;
+        }
+
+        std::vector<std::string> symbols;
+        char* symbol_token;
+        for (char* symbol = strtok_s(sSymbols, ",", &symbol_token); symbol; symbol = strtok_s(nullptr, ",", &symbol_token)) {
+            symbols.emplace_back(symbol);
+        }
+
+        auto nTickMinutes = atoi(sMinutes);
+        auto start = parseDay(sStart);
+        auto end = sEnd ? parseDay(sEnd) : 0;
+        if (nTickMinutes <= 0 || start < 0 || end < 0 || symbols.empty()) {
+            BrokerError(usage);
+            return 0;
+        }
+        if (end) {
+            end += 86399;   // include the whole end day
+        }
+
+        HistoryExporter exporter(*pMarketData, *s_logger);
+        auto response = exporter.run(symbols, nTickMinutes, start, end, sFormat ? ExportFormat::Bars : ExportFormat::T6);
+        if (!response) {
+            BrokerError(response.what().c_str());
+        }
+        return response.content();
+    }
+
+    void switchMarketData(bool usePolygon) {
+        if (usePolygon) {
+            if (!polygon) {
+                BrokerError("Polygon ApiKey not provided");
+                return;
+            }
+
+            if (pMarketData == polygon.get()) {
+                return;
+            }
+            pMarketData = polygon.get();
+            BrokerError("Change to Polygon market data.");
+            s_logger->logInfo("Change to Polygon");
+        }
+        else {
+            if (!alpacaMD) {
+                alpacaMD = std::move(std::make_unique<AlpacaMarketData>(client->headers(), client->logger()));
+                alpacaMD->setCalendar(&client->calendar());
+            }
+            else if (pMarketData == alpacaMD.get()) {
+                return;
+            }
+            pMarketData = alpacaMD.get();
+            BrokerError("Change to Alpaca market data.");
+            s_logger->logInfo("Change to Alpaca market data");
+        }
+    }
+
+    /**
+     * Race quote and single page bar requests of the current market data source against the other one.
+     * percentile: hedge once the current source is slower than this percentile of its recent requests, 0 turns hedging off.
+     */
+    double hedgeMarketData(int percentile) {
+        unhedgeMarketData();
+        if (percentile <= 0) {
+            BrokerError("Market data hedging off.");
+            return 0;
+        }
+        if (!polygon) {
+            BrokerError("Polygon ApiKey not provided");
+            return 0;
+        }
+        if (!alpacaMD) {
+            alpacaMD = std::make_unique<AlpacaMarketData>(client->headers(), client->logger());
+            alpacaMD->setCalendar(&client->calendar());
+        }
+
+        MarketData* secondary = pMarketData == polygon.get() ? (MarketData*)alpacaMD.get() : (MarketData*)polygon.get();
+        s_hedgePercentile = std::min(percentile, 99);
+        hedgedMD = std::make_unique<HedgedMarketData>(*pMarketData, *secondary, client->logger(), s_hedgePercentile / 100.);
+        pMarketData = hedgedMD.get();
+        BrokerError(("Hedge market data after p" + std::to_string(s_hedgePercentile) + " latency.").c_str());
+        return 1;
+    }
+
+    /**
+     * Print the hedging metrics, returns the percentage of requests that were hedged.
+     */
+    double reportHedging() {
+        if (!hedgedMD) {
+            BrokerError("Market data hedging off.");
+            return 0;
+        }
+        auto& metrics = hedgedMD->metrics();
+        auto& latency = hedgedMD->latency();
+        char text[512];
+        sprintf_s(text, sizeof(text), "Hedged %u of %u requests (%.1f%%), secondary first %u times, saved at least %llu ms. "
+            "Primary latency p50 %u ms, p95 %u ms, p99 %u ms, hedge delay %u ms.",
+            metrics.hedged, metrics.requests, metrics.hedgeRate() * 100., metrics.secondaryWins, (unsigned long long)metrics.savedMs,
+            latency.percentile(0.5), latency.percentile(0.95), latency.percentile(0.99), hedgedMD->hedgeDelay());
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return metrics.hedgeRate() * 100.;
+    }
+
+    /**
+     * Print the negative cache metrics, returns the number of requests they saved.
+     */
+    double reportNegativeCache() {
+        auto& symbols = s_unknownSymbols.metrics();
+        char text[512];
+        sprintf_s(text, sizeof(text), "Unknown symbols: %zu cached, %llu of %llu quote requests avoided, %llu answered by the filter.",
+            s_unknownSymbols.size(), (unsigned long long)symbols.hits, (unsigned long long)symbols.lookups, (unsigned long long)symbols.filtered);
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return (double)symbols.hits;
+    }
+
+    /**
+     * Set the pre-trade check rules, "key=value,..." as in RiskLimits::parse, and print what it did.
+     * Returns the number of orders rejected.
+     */
+    double configureRiskCheck(const char* parameter) {
+        if (parameter && *parameter) {
+            auto limits = s_riskCheck.limits();
+            if (!limits.parse(parameter)) {
+                BrokerError(("Unknown pre-trade check setting in " + std::string(parameter)).c_str());
+            }
+            s_riskCheck.setLimits(limits);
+        }
+        auto& metrics = s_riskCheck.metrics();
+        char text[512];
+        sprintf_s(text, sizeof(text), "Pre-trade check %s: %llu orders checked, %llu rejected, %llu clipped, %.2f us per order.",
+            s_riskCheck.limits().to_string().c_str(), (unsigned long long)metrics.checks, (unsigned long long)metrics.rejected,
+            (unsigned long long)metrics.clipped, metrics.checks ? metrics.nanos / 1e3 / metrics.checks : 0.);
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return (double)metrics.rejected;
+    }
+
+    /**
+     * Set how the stops of BrokerBuy2 are sent, "key=value,..." as in ExitConfig::parse, and print what they did.
+     * Returns the number of trades closed at the venue.
+     */
+    double configureExits(const char* parameter) {
+        if (parameter && *parameter) {
+            auto config = s_exits.config();
+            if (!config.parse(parameter)) {
+                BrokerError(("Unknown exit setting or trailing stop with take profit in " + std::string(parameter)).c_str());
+            }
+            s_exits.setConfig(config);
+        }
+        auto& metrics = s_exits.metrics();
+        char text[512];
+        sprintf_s(text, sizeof(text), "Venue stops %s, %s: %llu attached to the entry, %llu sent after the fill, %llu failed. "
+            "%llu trades closed at the venue, %llu exits canceled by Zorro. Stop slippage %.4f per share.",
+            s_venueStops ? "on" : "off (SET_ORDERTYPE +8)", s_exits.config().to_string().c_str(),
+            (unsigned long long)metrics.attached, (unsigned long long)metrics.placed, (unsigned long long)metrics.failed,
+            (unsigned long long)metrics.triggered, (unsigned long long)metrics.canceled,
+            metrics.stopFills ? metrics.slippage / metrics.stopFills : 0.);
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return (double)metrics.triggered;
+    }
+
+    /**
+     * Read the open orders once, returns how many of ids are still open, their cancels are not confirmed yet.
+     */
+    size_t stillOpen(const std::unordered_set<std::string>& ids) {
+        if (ids.empty()) {
+            return 0;
+        }
+        if (!orderPoller->refresh()) {
+            return ids.size();
+        }
+        size_t open = 0;
+        orderPoller->forEach([&](const Order& order) {
+            open += ids.count(order.id);
+        });
+        return open;
+    }
+
+    /**
+     * Drop the exits of trades that lost an exit order to a bulk cancel, Zorro handles their stops from here on.
+     */
+    void dropCanceledExits(const std::unordered_set<std::string>& ids) {
+        s_exits.evict([&](int32_t, const Exit& exit) {
+            return std::none_of(exit.orders.begin(), exit.orders.end(), [&](const std::string& id) { return ids.count(id) != 0; });
+        });
+    }
+
+    /**
+     * Cancel all open orders with one request, or those of a symbol with concurrent requests, and confirm them with one
+     * sweep of the open orders. Returns the number of orders canceled.
+     */
+    double cancelAll(const char* symbol) {
+        if (!orderPoller) {
+            return 0;
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::unordered_set<std::string> canceled;
+        size_t failed = 0;
+        if (symbol && *symbol) {
+            // Alpaca has no bulk cancel by symbol
+            std::vector<std::string> ids;
+            if (orderPoller->refresh()) {
+                orderPoller->forEach([&](const Order& order) {
+                    if (order.symbol == symbol) {
+                        ids.push_back(order.id);
+                    }
+                });
+            }
+            auto responses = client->cancelOrders(ids);
+            for (size_t i = 0; i < ids.size(); ++i) {
+                if (responses[i]) {
+                    canceled.insert(ids[i]);
+                }
+                else {
+                    ++failed;
+                    s_logger->logWarning("Failed to cancel order %s. %s\n", ids[i].c_str(), responses[i].what().c_str());
+                }
+            }
+        }
+        else {
+            auto response = client->cancelAllOrders();
+            if (!response) {
+                BrokerError(("Failed to cancel all orders. " + response.what()).c_str());
+                return 0;
+            }
+            for (auto& result : response.content()) {
+                if (result.ok()) {
+                    canceled.insert(result.id);
+                }
+                else {
+                    ++failed;
+                    s_logger->logWarning("Failed to cancel order %s. status=%d\n", result.id.c_str(), result.status);
+                }
+            }
+        }
+        dropCanceledExits(canceled);
+        auto pending = stillOpen(canceled);
+        invalidatePortfolio();
+
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        char text[256];
+        sprintf_s(text, sizeof(text), "Canceled %zu orders%s%s, %zu failed, %zu not confirmed yet. %lld ms.", canceled.size(),
+            symbol && *symbol ? " of " : "", symbol && *symbol ? symbol : "", failed, pending, (long long)ms);
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return (double)canceled.size();
+    }
+
+    /**
+     * Close all positions of the account at market with one request, their open orders are canceled first. Zorro's trades
+     * of those symbols are reported closed by BrokerTrade. Returns the number of positions closed.
+     */
+    double closeAll() {
+        if (!portfolio) {
+            return 0;
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto response = client->closeAllPositions(true);
+        if (!response) {
+            BrokerError(("Failed to close all positions. " + response.what()).c_str());
+            return 0;
+        }
+        std::unordered_set<std::string> closed;
+        size_t failed = 0;
+        for (auto& result : response.content()) {
+            if (result.ok()) {
+                closed.insert(result.symbol);
             }
             else {
-                BrokerError(quote.what().c_str());
+                ++failed;
+                s_logger->logWarning("Failed to close the position of %s. status=%d\n", result.symbol.c_str(), result.status);
             }
-        };
+        }
+
+        std::vector<int32_t> trades;
+        for (auto& symbol : closed) {
+            s_orders.forEachOfSymbol(symbol, [&](const OrderRecord& record) {
+                if (record.filledQty && !record.closed) {
+                    trades.push_back(record.internalId);
+                }
+            });
+        }
+        for (auto tradeId : trades) {
+            s_orders.markClosed(tradeId);
+        }
+        // their exits were canceled with the other open orders
+        s_exits.evict([&](int32_t tradeId, const Exit&) {
+            return std::find(trades.begin(), trades.end(), tradeId) == trades.end();
+        });
+        if (orderPoller) {
+            orderPoller->expire();
+        }
+
+        // one sweep of the positions, the closing orders are market orders and usually filled by now
+        invalidatePortfolio();
+        size_t open = 0;
+        for (auto& symbol : closed) {
+            int32_t qty = 0;
+            open += portfolio->position(symbol, qty) && qty != 0;
+        }
+
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        char text[256];
+        sprintf_s(text, sizeof(text), "Closed %zu positions, %zu failed, %zu not flat yet, %zu trades closed. %lld ms.",
+            closed.size(), failed, open, trades.size(), (long long)ms);
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return (double)closed.size();
+    }
 
-        if (!symbols) {
-            auto assets = client->getAssets();
-            for (auto& asset : assets.content()) {
-                if (!asset.tradable) {
+    /**
+     * Send the orders of a batch concurrently, e.g. the legs of a rebalance, instead of a BrokerBuy2 round trip after the
+     * other. They take the order type and the order text of BrokerBuy2 but no stops. IOC/FOK orders are waited for once
+     * all were sent. Returns the number of orders accepted.
+     */
+    double submitBatch(BatchOrder* orders) {
+        if (!orders || !portfolio) {
+            return 0;
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::vector<BatchOrder*> sent;
+        std::vector<OrderRequest> requests;
+        // the orders are checked against what the ones before them leave of the buying power
+        auto* account = portfolio->account(true);
+        double buyingPower = account ? account->buying_power : 0.;
+        for (auto* batchOrder = orders; batchOrder->Asset[0]; ++batchOrder) {
+            batchOrder->nTradeID = 0;
+            batchOrder->nFill = 0;
+            batchOrder->dPrice = 0.;
+            batchOrder->Error[0] = 0;
+            auto nAmount = preTradeCheck(batchOrder->Asset, batchOrder->nAmount, batchOrder->dLimit, account ? &buyingPower : nullptr);
+            if (!nAmount) {
+                strcpy_s(batchOrder->Error, sizeof(batchOrder->Error), batchOrder->nAmount ? "Rejected by the pre-trade check." : "No amount.");
+                continue;
+            }
+            OrderRequest request;
+            request.symbol = batchOrder->Asset;
+            request.quantity = std::abs(nAmount);
+            request.side = nAmount > 0 ? OrderSide::Buy : OrderSide::Sell;
+            request.type = batchOrder->dLimit ? OrderType::Limit : OrderType::Market;
+            request.tif = s_tif;
+            if (batchOrder->dLimit) {
+                request.limit_price = std::to_string(batchOrder->dLimit);
+            }
+            request.client_order_id = s_nextOrderText;
+            requests.push_back(std::move(request));
+            sent.push_back(batchOrder);
+        }
+        if (requests.empty()) {
+            return 0;
+        }
+
+        auto responses = client->submitOrders(requests);
+        auto sentMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        // the orders may fill any moment, the positions have to be asked again
+        invalidatePortfolio();
+
+        size_t accepted = 0;
+        for (size_t i = 0; i < responses.size(); ++i) {
+            auto* batchOrder = sent[i];
+            if (!responses[i]) {
+                strcpy_s(batchOrder->Error, sizeof(batchOrder->Error), responses[i].what().substr(0, sizeof(batchOrder->Error) - 1).c_str());
+                BrokerError(("Order for " + std::string(batchOrder->Asset) + " failed: " + responses[i].what()).c_str());
+                continue;
+            }
+            auto& order = responses[i].content();
+            s_orders.put(order);
+            if (orderPoller) {
+                orderPoller->put(order);
+            }
+            batchOrder->nTradeID = order.internal_id;
+            batchOrder->nFill = (int)order.filled_qty;
+            batchOrder->dPrice = order.filled_avg_price;
+            ++accepted;
+        }
+
+        if (s_tif == TimeInForce::IOC || s_tif == TimeInForce::FOK) {
+            // they execute at the venue in parallel, all share one deadline. What is still open then is canceled as by BrokerBuy2.
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ORDER_WAIT_MS);
+            for (size_t i = 0; i < responses.size(); ++i) {
+                auto* batchOrder = sent[i];
+                if (!responses[i] || isFinal(responses[i].content().status)) {
                     continue;
                 }
-                getAsset(asset.symbol);
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                auto id = responses[i].content().id;
+                auto response = readOrder(id, (uint32_t)std::max<long long>(left, 1));
+                if (response) {
+                    auto& order = response.content();
+                    s_orders.put(order);
+                    batchOrder->nFill = (int)order.filled_qty;
+                    batchOrder->dPrice = order.filled_avg_price;
+                    if (isFinal(order.status)) {
+                        continue;
+                    }
+                }
+                auto canceled = cancelAsync(id, batchOrder->nTradeID);
+                if (!canceled) {
+                    BrokerError(("Failed to cancel unfilled FOK/IOC order " + id + " " + canceled.what()).c_str());
+                }
+                else if (canceled.content().filled_qty) {
+                    batchOrder->nFill = (int)canceled.content().filled_qty;
+                    batchOrder->dPrice = canceled.content().filled_avg_price;
+                }
+                if (!batchOrder->nFill) {
+                    // nothing to trade, as BrokerBuy2 returning 0
+                    batchOrder->nTradeID = 0;
+                    strcpy_s(batchOrder->Error, sizeof(batchOrder->Error), "Not filled in time, canceled.");
+                    --accepted;
+                }
             }
         }
-        else {
-            const char* delim = ",";
-            char* next_token;
-            char* token = strtok_s(symbols, delim, &next_token);
-            while (token != nullptr) {
-                getAsset(token);
-                token = strtok_s(nullptr, delim, &next_token);
+
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        char text[256];
+        sprintf_s(text, sizeof(text), "Batch of %zu orders, %zu accepted, %zu failed. Sent in %lld ms, done in %lld ms.",
+            requests.size(), accepted, requests.size() - accepted, (long long)sentMs, (long long)ms);
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return (double)accepted;
+    }
+
+    /**
+     * DO_CANCEL, cancel the order of a trade, or all orders for trade id 0.
+     */
+    int cancelTrade(int32_t tradeId) {
+        if (!client) {
+            return 0;
+        }
+        if (!tradeId) {
+            return cancelAll(nullptr) > 0 ? 1 : 0;
+        }
+        auto* known = s_orders.find(tradeId);
+        if (!known) {
+            BrokerError(("Order " + std::to_string(tradeId) + " not found.").c_str());
+            return 0;
+        }
+        auto response = cancelAsync(s_orders.idOf(*known), tradeId);
+        if (!response) {
+            BrokerError(("Failed to cancel order " + std::to_string(tradeId) + " " + response.what()).c_str());
+            return 0;
+        }
+        if (!response.content().filled_qty) {
+            // bracket and OTO legs are canceled with their entry
+            s_exits.erase(tradeId);
+        }
+        return 1;
+    }
+
+    /**
+     * Set the account and position ttl, "accountMs[,positionMs]", and print the requests the snapshots saved.
+     * Returns the number of requests saved.
+     */
+    double configurePortfolio(const char* parameter) {
+        if (!portfolio) {
+            return 0;
+        }
+        if (parameter && *parameter) {
+            std::string config(parameter);
+            auto pos = config.find(',');
+            auto accountMs = atoi(config.substr(0, pos).c_str());
+            auto positionMs = pos != std::string::npos ? atoi(config.substr(pos + 1).c_str()) : accountMs;
+            portfolio->setTtl((uint32_t)std::max(accountMs, 0), (uint32_t)std::max(positionMs, 0));
+        }
+        auto& metrics = portfolio->metrics();
+        auto reads = metrics.accountReads + metrics.positionReads;
+        auto requests = metrics.accountRequests + metrics.positionRequests;
+        auto hits = reads > requests ? reads - requests : 0;
+        char text[512];
+        sprintf_s(text, sizeof(text), "Account: %llu reads, %llu requests. Positions: %llu reads, %llu requests. %llu invalidated by fills. "
+            "Read from memory %.1f us, with a request %.1f ms on average. TTL %u/%u ms.",
+            (unsigned long long)metrics.accountReads, (unsigned long long)metrics.accountRequests,
+            (unsigned long long)metrics.positionReads, (unsigned long long)metrics.positionRequests, (unsigned long long)metrics.invalidations,
+            hits ? metrics.hitNanos / 1e3 / hits : 0., requests ? metrics.missNanos / 1e6 / requests : 0.,
+            portfolio->accountTtl(), portfolio->positionTtl());
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return (double)hits;
+    }
+
+    /**
+     * Print the trade stream metrics, returns the number of order requests it saved.
+     */
+    double reportTradeStream() {
+        if (!orderUpdates) {
+            BrokerError("Trade stream off.");
+            return 0;
+        }
+        auto metrics = orderUpdates->metrics();
+        auto latency = orderUpdates->latency();
+        char text[512];
+        sprintf_s(text, sizeof(text), "Trade stream %s, %u connects, %llu events, %llu fills. %llu of %llu order reads without a request. "
+            "Event to visible p50 %u ms, p99 %u ms.",
+            tradeStream && tradeStream->isConnected() ? "connected" : "disconnected", metrics.connects,
+            (unsigned long long)metrics.events, (unsigned long long)metrics.fills,
+            (unsigned long long)metrics.localReads, (unsigned long long)(metrics.localReads + metrics.restReads),
+            latency.percentile(0.5), latency.percentile(0.99));
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        sprintf_s(text, sizeof(text), "Cancels: %llu sent, %llu confirmed, %llu filled first, %llu overdue, %zu pending. Blocked %.1f ms per cancel.",
+            (unsigned long long)s_cancelMetrics.sent, (unsigned long long)s_cancelMetrics.confirmed, (unsigned long long)s_cancelMetrics.filledFirst,
+            (unsigned long long)s_cancelMetrics.overdue, s_pendingCancels.size(),
+            s_cancelMetrics.sent ? s_cancelMetrics.blockedNanos / 1e6 / s_cancelMetrics.sent : 0.);
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        if (orderPoller) {
+            auto& polls = orderPoller->metrics();
+            sprintf_s(text, sizeof(text), "Open order snapshots: %llu in %llu requests, %llu of %llu order reads answered.",
+                (unsigned long long)polls.polls, (unsigned long long)polls.pages,
+                (unsigned long long)polls.hits, (unsigned long long)(polls.hits + polls.misses));
+            BrokerError(text);
+            s_logger->logInfo("%s\n", text);
+        }
+        return (double)metrics.localReads;
+    }
+
+    /**
+     * Set how long final orders are kept, "minutes[,spill]". With spill the evicted orders are appended to Log/AlpacaOrders.csv.
+     * Returns the number of orders held.
+     */
+    double configureOrderStore(const char* parameter) {
+        if (parameter && *parameter) {
+            std::string config(parameter);
+            auto pos = config.find(',');
+            auto minutes = atoi(config.substr(0, pos).c_str());
+            if (minutes > 0) {
+                s_orders.setMaxAge((uint32_t)minutes * 60);
             }
+            bool spill = pos != std::string::npos && atoi(config.substr(pos + 1).c_str()) != 0;
+            s_orders.setSpillFile(spill ? "./Log/AlpacaOrders.csv" : "");
+            s_nextEviction = 0;
         }
-        
-        fflush(f);
-        fclose(f);
-        s_logger->logDebug("close file\n");
+        char text[256];
+        sprintf_s(text, sizeof(text), "%zu orders held in %zu KB, final orders kept %u minutes.",
+            s_orders.size(), s_orders.memoryUsage() / 1024, s_orders.maxAge() / 60);
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return (double)s_orders.size();
     }
-    
+
+    /**
+     * (Re)start the data stream for the live bars and the quote book, whichever is on.
+     */
+    void startStream() {
+        // the handlers point to the bars and the book, so the stream is rebuilt whenever one of them changes
+        dataStream.reset();
+        if (!liveBars && !quoteBook) {
+            return;
+        }
+
+        dataStream = std::make_unique<DataStream>(s_streamKey, s_streamSecret, s_streamFeed, client->logger());
+        auto* bars = liveBars.get();
+        auto* book = quoteBook.get();
+        if (bars) {
+            dataStream->onTrade([bars](const StreamTrade& trade) { bars->add(trade); });
+        }
+        if (book) {
+            dataStream->onQuote([book](const StreamQuote& quote) { book->update(quote); });
+        }
+        dataStream->onGap([bars, book]() {
+            if (bars) {
+                bars->gap();
+            }
+            if (book) {
+                book->clear();
+            }
+        });
+        for (auto& asset : s_assets) {
+            if (bars) {
+                bars->watch(asset);
+                dataStream->subscribeTrades(asset);
+            }
+            if (book) {
+                dataStream->subscribeQuotes(asset);
+            }
+        }
+        dataStream->start();
+    }
+
+    /**
+     * Build the newest bars of the subscribed assets out of the trade stream, BrokerHistory2 takes them from there.
+     * minutes: the bar period trades are aggregated to, 0 turns it off.
+     */
+    double streamLiveBars(int minutes) {
+        // the stream calls into the bars, so it goes first
+        dataStream.reset();
+        liveBars.reset();
+        if (minutes > 0) {
+            liveBars = std::make_unique<LiveBars>(minutes);
+        }
+        startStream();
+        if (!liveBars) {
+            BrokerError("Live bars off.");
+            return 0;
+        }
+        BrokerError(("Live " + std::to_string(minutes) + " minute bars from the " + s_streamFeed + " trade stream.").c_str());
+        return 1;
+    }
+
+    /**
+     * Print the live bar metrics, returns the percentage of history requests served without REST.
+     */
+    double reportLiveBars() {
+        if (!liveBars) {
+            BrokerError("Live bars off.");
+            return 0;
+        }
+        auto stream = dataStream->metrics();
+        auto metrics = liveBars->metrics();
+        auto latency = liveBars->latency();
+        auto served = metrics.reads ? metrics.fullyServed * 100. / metrics.reads : 0.;
+        char text[512];
+        sprintf_s(text, sizeof(text), "Stream %s, %u connects, %llu trades, %llu late. %u of %u history requests without REST (%.1f%%), %u bars served. "
+            "Bar final after boundary p50 %u ms, p95 %u ms, p99 %u ms.",
+            dataStream->isConnected() ? "connected" : "disconnected", stream.connects, (unsigned long long)stream.trades, (unsigned long long)metrics.lateTrades,
+            metrics.fullyServed, metrics.reads, served, metrics.barsServed,
+            latency.percentile(0.5), latency.percentile(0.95), latency.percentile(0.99));
+        BrokerError(text);
+        s_logger->logInfo("%s\n", text);
+        return served;
+    }
+
+    /**
+     * Fill the top of book of the SET_SYMBOL asset from the quote stream, ask positive and bid negative.
+     * No request is sent, the first call only starts the quote stream, the book is empty until quotes arrive.
+     */
+    int getBook(T2* book) {
+        if (!quoteBook) {
+            quoteBook = std::make_unique<QuoteBook>();
+            startStream();
+        }
+        // a symbol Zorro didn't subscribe is subscribed once here
+        dataStream->subscribeQuotes(s_asset);
+
+        Quote quote;
+        if (!book || !quoteBook->get(s_asset, quote)) {
+            return 0;
+        }
+        auto time = (DATE)(quote.timestamp / 1000000) / (24. * 60. * 60. * 1000.) + 25569.;
+        int n = 0;
+        if (quote.ask_price > 0.) {
+            book[n].time = time;
+            book[n].fVal = (float)quote.ask_price;
+            book[n].fVol = (float)quote.ask_size;
+            ++n;
+        }
+        if (quote.bid_price > 0.) {
+            book[n].time = time;
+            book[n].fVal = -(float)quote.bid_price;
+            book[n].fVol = (float)quote.bid_size;
+            ++n;
+        }
+        return n;
+    }
+
     DLLFUNC_C double BrokerCommand(int Command, DWORD dwParameter)
     {
         static int SetMultiplier;
@@ -546,6 +1975,12 @@ namespace alpaca
             client->logger().logDebug("SET_ORDERTEXT: %s\n", s_nextOrderText.c_str());
             return dwParameter;
 
+        case GET_BOOK:
+            return getBook((T2*)dwParameter);
+
+        case DO_CANCEL:
+            return cancelTrade((int32_t)dwParameter);
+
         case SET_SYMBOL:
             s_asset = (char*)dwParameter;
             return 1;
@@ -555,10 +1990,11 @@ namespace alpaca
             return 1;
 
         case SET_ORDERTYPE: {
-           
-            switch ((int)dwParameter) {
+            // +8 sends the stop of BrokerBuy2 to Alpaca with the order
+            s_venueStops = ((int)dwParameter & 8) != 0;
+            switch ((int)dwParameter & 7) {
             case 0:
-                return 0;
+                return s_venueStops ? 8 : 0;
             case 1:
                 s_tif = TimeInForce::IOC;
                 break;
@@ -579,12 +2015,8 @@ namespace alpaca
                 break;
             }
 
-            if ((int)dwParameter >= 8) {
-                return (int)dwParameter;
-            }
-
             s_logger->logDebug("SET_ORDERTYPE: %d s_tif=%s\n", (int)dwParameter, to_string(s_tif));
-            return tifToZorroOrderType(s_tif);
+            return tifToZorroOrderType(s_tif) + (s_venueStops ? 8 : 0);
         }
         case SET_PRICETYPE:
             s_priceType = (int)dwParameter;
@@ -603,38 +2035,66 @@ namespace alpaca
         case GET_CALLBACK:
             break;
 
-        case 2000:
-            if ((int)dwParameter != 0) {
-                if (!polygon) {
-                    BrokerError("Polygon ApiKey not provided");
-                    break;
-                }
-
-                if (pMarketData == polygon.get()) {
-                    break;
-                }
-                pMarketData = polygon.get();
-                BrokerError("Change to Polygon market data.");
-                s_logger->logInfo("Change to Polygon");
-            }
-            else {
-                if (!alpacaMD) {
-                    alpacaMD = std::move(std::make_unique<AlpacaMarketData>(client->headers(), client->logger()));
-                }
-                else if (pMarketData == alpacaMD.get()) {
-                    break;
-                }
-                pMarketData = alpacaMD.get();
-                BrokerError("Change to Alpaca market data.");
-                s_logger->logInfo("Change to Alpaca market data");
+        case 2000: {
+            bool hedge = hedgedMD != nullptr;
+            unhedgeMarketData();
+            switchMarketData((int)dwParameter != 0);
+            if (hedge) {
+                // keep hedging with the new source as primary
+                hedgeMarketData(s_hedgePercentile);
             }
             break;
+        }
 
         case 2001: {
             downloadAssets((char*)dwParameter);
             break;
         }
-            
+
+        case 2002:
+            return downloadTicks((char*)dwParameter);
+
+        case 2003:
+            return exportHistory((char*)dwParameter);
+
+        case 2004:
+            return hedgeMarketData((int)dwParameter);
+
+        case 2005:
+            return reportHedging();
+
+        case 2006:
+            return streamLiveBars((int)dwParameter);
+
+        case 2007:
+            return reportLiveBars();
+
+        case 2008:
+            return reportNegativeCache();
+
+        case 2009:
+            return reportTradeStream();
+
+        case 2010:
+            return configureOrderStore((const char*)dwParameter);
+
+        case 2011:
+            return configurePortfolio((const char*)dwParameter);
+
+        case 2012:
+            return configureRiskCheck((const char*)dwParameter);
+
+        case 2013:
+            return configureExits((const char*)dwParameter);
+
+        case 2014:
+            return cancelAll((const char*)dwParameter);
+
+        case 2015:
+            return closeAll();
+
+        case 2016:
+            return submitBatch((BatchOrder*)dwParameter);
 
         default:
             s_logger->logDebug("Unhandled command: %d %lu\n", Command, dwParameter);
@@ -23,6 +23,19 @@ namespace alpaca
     long(__cdecl* http_result)(int id, char* content, long size);
     void(__cdecl* http_free)(int id);
 
+    /**
+     * An order of brokerCommand(2016), the script passes an array of them that ends with an empty Asset.
+     */
+    struct BatchOrder {
+        char Asset[32];     // in
+        int nAmount;        // in, positive to buy, negative to sell
+        double dLimit;      // in, 0 for a market order
+        int nTradeID;       // out, the trade id as BrokerBuy2 returns it, 0 if the order failed
+        int nFill;          // out, the quantity filled so far
+        double dPrice;      // out, the average fill price
+        char Error[128];    // out, why the order failed
+    };
+
     // zorro functions
     DLLFUNC_C int BrokerOpen(char* Name, FARPROC fpError, FARPROC fpProgress);
     DLLFUNC_C void BrokerHTTP(FARPROC fpSend, FARPROC fpStatus, FARPROC fpResult, FARPROC fpFree);
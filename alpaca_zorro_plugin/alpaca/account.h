@@ -41,32 +41,32 @@ namespace alpaca {
 
         template<typename CallerT, typename parserT>
         std::pair<int, std::string> fromJSON(const parserT& parser) {
-            parser.get<bool>("account_blocked", account_blocked);
-            parser.get<std::string>("account_number", account_number);
-            parser.get<double>("buying_power", buying_power);
-            parser.get<double>("cash", cash);
-            parser.get<std::string>("created_at", created_at);
-            parser.get<std::string>("currency", currency);
-            parser.get<int32_t>("daytrade_count", daytrade_count);
-            parser.get<double>("daytrading_buying_power", daytrading_buying_power);
-            parser.get<double>("equity", equity);
-            parser.get<std::string>("id", id);
-            parser.get<double>("initial_margin", initial_margin);
-            parser.get<double>("last_equity", last_equity);
-            parser.get<double>("last_maintenance_margin", last_maintenance_margin);
-            parser.get<double>("long_market_value", long_market_value);
-            parser.get<double>("maintenance_margin", maintenance_margin);
-            parser.get<int32_t>("multiplier", multiplier);
-            parser.get<bool>("pattern_day_trader", pattern_day_trader);
-            parser.get<double>("portfolio_value", portfolio_value);
-            parser.get<double>("regt_buying_power", regt_buying_power);
-            parser.get<double>("short_market_value", short_market_value);
-            parser.get<bool>("shorting_enabled", shorting_enabled);
-            parser.get<std::string>("sma", sma);
-            parser.get<std::string>("status", status);
-            parser.get<bool>("trade_suspended_by_user", trade_suspended_by_user);
-            parser.get<bool>("trading_blocked", trading_blocked);
-            parser.get<bool>("transfers_blocked", transfers_blocked);
+            parser.template get<bool>("account_blocked", account_blocked);
+            parser.template get<std::string>("account_number", account_number);
+            parser.template get<double>("buying_power", buying_power);
+            parser.template get<double>("cash", cash);
+            parser.template get<std::string>("created_at", created_at);
+            parser.template get<std::string>("currency", currency);
+            parser.template get<int32_t>("daytrade_count", daytrade_count);
+            parser.template get<double>("daytrading_buying_power", daytrading_buying_power);
+            parser.template get<double>("equity", equity);
+            parser.template get<std::string>("id", id);
+            parser.template get<double>("initial_margin", initial_margin);
+            parser.template get<double>("last_equity", last_equity);
+            parser.template get<double>("last_maintenance_margin", last_maintenance_margin);
+            parser.template get<double>("long_market_value", long_market_value);
+            parser.template get<double>("maintenance_margin", maintenance_margin);
+            parser.template get<int32_t>("multiplier", multiplier);
+            parser.template get<bool>("pattern_day_trader", pattern_day_trader);
+            parser.template get<double>("portfolio_value", portfolio_value);
+            parser.template get<double>("regt_buying_power", regt_buying_power);
+            parser.template get<double>("short_market_value", short_market_value);
+            parser.template get<bool>("shorting_enabled", shorting_enabled);
+            parser.template get<std::string>("sma", sma);
+            parser.template get<std::string>("status", status);
+            parser.template get<bool>("trade_suspended_by_user", trade_suspended_by_user);
+            parser.template get<bool>("trading_blocked", trading_blocked);
+            parser.template get<bool>("transfers_blocked", transfers_blocked);
             return std::make_pair(0, "OK");
         }
     };
@@ -49,15 +49,15 @@ namespace alpaca {
 
 		template<typename CallerT, typename T>
 		std::pair<int, std::string> fromJSON(const T& parser) {
-			parser.get<std::string>("class", asset_class);
-			parser.get<bool>("easy_to_borrow", easy_to_borrow);
-			parser.get<std::string>("exchange", exchange);
-			parser.get<std::string>("id", id);
-			parser.get<bool>("marginable", marginable);
-			parser.get<bool>("shortable", shortable);
-			parser.get<std::string>("status", status);
-			parser.get<std::string>("symbol", symbol);
-			parser.get<bool>("tradable", tradable);
+			parser.template get<std::string>("class", asset_class);
+			parser.template get<bool>("easy_to_borrow", easy_to_borrow);
+			parser.template get<std::string>("exchange", exchange);
+			parser.template get<std::string>("id", id);
+			parser.template get<bool>("marginable", marginable);
+			parser.template get<bool>("shortable", shortable);
+			parser.template get<std::string>("status", status);
+			parser.template get<std::string>("symbol", symbol);
+			parser.template get<bool>("tradable", tradable);
 			return std::make_pair(0, "OK");
 		}
 	};
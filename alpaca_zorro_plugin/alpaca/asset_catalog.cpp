@@ -0,0 +1,320 @@
+#include "stdafx.h"
+#include "alpaca/asset_catalog.h"
+
+#include <ctime>
+#include <cstring>
+#include <unordered_map>
+#include "alpaca/client.h"
+#include "request.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr uint32_t MAGIC = 0x43415a41;      // "AZAC"
+        constexpr uint32_t VERSION = 1;
+
+        // Header | Record[count] | uint32_t slot[slots] | char strings[stringBytes]
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            int64_t fetched;
+            uint64_t hash;          // of the downloaded JSON
+            uint32_t count;
+            uint32_t slots;         // a power of two, at least twice count
+            uint32_t stringBytes;
+            uint32_t reserved;
+        };
+
+        struct Record {
+            uint32_t symbol;        // offsets into the string table
+            uint32_t exchange;
+            uint32_t flags;
+        };
+
+        enum : uint32_t {
+            TRADABLE = 1,
+            SHORTABLE = 2,
+            EASY_TO_BORROW = 4,
+            MARGINABLE = 8,
+            ACTIVE = 16,
+        };
+
+        uint32_t hashSymbol(const char* s) noexcept {
+            uint32_t h = 2166136261u;
+            for (; *s; ++s) {
+                h = (h ^ (uint8_t)*s) * 16777619u;
+            }
+            return h;
+        }
+
+        uint64_t hashContent(const std::string& s) noexcept {
+            uint64_t h = 14695981039346656037ull;
+            for (auto c : s) {
+                h = (h ^ (uint8_t)c) * 1099511628211ull;
+            }
+            return h;
+        }
+    }
+
+    AssetCatalog::~AssetCatalog() {
+        if (refreshId_) {
+            http_free(refreshId_);
+        }
+        unmap();
+    }
+
+    bool AssetCatalog::load(const Client& client, Logger& logger) {
+        url_ = client.baseUrl() + "/v2/assets";
+        headers_ = client.headers();
+        auto now = (__time32_t)std::time(nullptr);
+        if (map()) {
+            auto& header = *(const Header*)data_;
+            stale_ = header.fetched + REFRESH_AGE <= now;
+            logger.logDebug("Mapped %u assets from %s%s\n", header.count, path_.c_str(), stale_ ? ", revalidating" : "");
+            poll(logger);
+            return true;
+        }
+
+        logger.logDebug("--> %s\n", url_.c_str());
+        auto response = requestRaw<Client>(url_, headers_);
+        if (!response) {
+            logger.logWarning("Failed to download assets. %s\n", response.what().c_str());
+            return false;
+        }
+        return update(response.content(), logger);
+    }
+
+    void AssetCatalog::poll(Logger& logger) {
+        if (!refreshId_) {
+            // the revalidation waits for a free request slot rather than for the rate limiter
+            if (stale_ && rateLimiter<Client>().tryAcquire()) {
+                refreshId_ = http_send((char*)url_.c_str(), nullptr, (char*)headers_.c_str());
+                stale_ = false;
+            }
+            return;
+        }
+
+        auto n = http_status(refreshId_);
+        if (!n) {
+            return;
+        }
+        auto id = refreshId_;
+        refreshId_ = 0;
+        if (n < 0) {
+            http_free(id);
+            logger.logWarning("Failed to revalidate assets\n");
+            return;
+        }
+        update(readResult(id, n), logger);
+    }
+
+    bool AssetCatalog::update(const std::string& content, Logger& logger) {
+        auto now = (__time32_t)std::time(nullptr);
+        auto hash = hashContent(content);
+        if (data_ && ((const Header*)data_)->hash == hash) {
+            logger.logDebug("Assets unchanged\n");
+            return touch(now);
+        }
+
+        auto response = parseResponse<std::vector<Asset>, Client>(content);
+        if (!response || response.content().empty()) {
+            logger.logWarning("Failed to parse assets. %s\n", response.what().c_str());
+            return !empty();
+        }
+
+        // a mapped file can't be replaced
+        unmap();
+        if (!save(response.content(), hash, now)) {
+            logger.logWarning("Failed to write %s\n", path_.c_str());
+        }
+        if (!map()) {
+            return false;
+        }
+        logger.logDebug("Built catalog of %u assets\n", size());
+        return true;
+    }
+
+    bool AssetCatalog::save(const std::vector<Asset>& assets, uint64_t hash, __time32_t fetched) const {
+        Header header = {};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.fetched = fetched;
+        header.hash = hash;
+        header.count = (uint32_t)assets.size();
+        header.slots = 16;
+        while (header.slots < header.count * 2) {
+            header.slots *= 2;
+        }
+
+        std::string strings;
+        std::unordered_map<std::string, uint32_t> interned;
+        auto intern = [&strings, &interned](const std::string& s) {
+            auto it = interned.find(s);
+            if (it != interned.end()) {
+                return it->second;
+            }
+            auto offset = (uint32_t)strings.size();
+            strings.append(s.c_str(), s.size() + 1);
+            interned.emplace(s, offset);
+            return offset;
+        };
+
+        std::vector<Record> records;
+        records.reserve(assets.size());
+        std::vector<uint32_t> slots(header.slots, 0);
+        for (auto& asset : assets) {
+            Record record;
+            record.symbol = intern(asset.symbol);
+            record.exchange = intern(asset.exchange);
+            record.flags = (asset.tradable ? TRADABLE : 0) | (asset.shortable ? SHORTABLE : 0) | (asset.easy_to_borrow ? EASY_TO_BORROW : 0) |
+                (asset.marginable ? MARGINABLE : 0) | (asset.status == "active" ? ACTIVE : 0);
+            for (auto i = hashSymbol(asset.symbol.c_str()) & (header.slots - 1);; i = (i + 1) & (header.slots - 1)) {
+                if (!slots[i]) {
+                    slots[i] = (uint32_t)records.size() + 1;
+                    break;
+                }
+            }
+            records.push_back(record);
+        }
+        header.stringBytes = (uint32_t)strings.size();
+
+        auto tmp = path_ + ".tmp";
+        FILE* f;
+        if (fopen_s(&f, tmp.c_str(), "wb")) {
+            return false;
+        }
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(records.data(), sizeof(Record), records.size(), f) == records.size() &&
+            fwrite(slots.data(), sizeof(uint32_t), slots.size(), f) == slots.size() &&
+            fwrite(strings.data(), 1, strings.size(), f) == strings.size();
+        ok = fclose(f) == 0 && ok;
+        return ok && MoveFileExA(tmp.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING);
+    }
+
+    bool AssetCatalog::touch(__time32_t fetched) {
+        unmap();
+        FILE* f;
+        if (!fopen_s(&f, path_.c_str(), "r+b")) {
+            Header header;
+            if (fread(&header, sizeof(header), 1, f) == 1) {
+                header.fetched = fetched;
+                fseek(f, 0, SEEK_SET);
+                fwrite(&header, sizeof(header), 1, f);
+            }
+            fclose(f);
+        }
+        return map();
+    }
+
+    bool AssetCatalog::map() {
+        unmap();
+        file_ = CreateFileA(path_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            file_ = nullptr;
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || (uint64_t)size.QuadPart < sizeof(Header)) {
+            unmap();
+            return false;
+        }
+        size_ = (uint64_t)size.QuadPart;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_) {
+            data_ = (const uint8_t*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        }
+
+        // a file of another version or cut short is rebuilt from a download
+        auto header = (const Header*)data_;
+        if (!header || header->magic != MAGIC || header->version != VERSION || !header->count || (header->slots & (header->slots - 1)) ||
+            header->slots < header->count * 2 ||
+            size_ != sizeof(Header) + (uint64_t)header->count * sizeof(Record) + (uint64_t)header->slots * sizeof(uint32_t) + header->stringBytes) {
+            unmap();
+            return false;
+        }
+
+        // and so is one whose slots, string offsets or string table don't hold together, find() and
+        // tradableSymbols() index the mapped file with them unchecked
+        auto records = (const Record*)(data_ + sizeof(Header));
+        auto slots = (const uint32_t*)(records + header->count);
+        auto strings = (const char*)(slots + header->slots);
+        bool valid = header->stringBytes && !strings[header->stringBytes - 1];
+        uint32_t used = 0;
+        for (uint32_t i = 0; valid && i < header->slots; ++i) {
+            valid = slots[i] <= header->count;
+            used += slots[i] != 0;
+        }
+        // every record in the table once, so at least half the slots are empty and a probe ends
+        valid = valid && used == header->count;
+        for (uint32_t i = 0; valid && i < header->count; ++i) {
+            valid = records[i].symbol < header->stringBytes && records[i].exchange < header->stringBytes;
+        }
+        if (!valid) {
+            unmap();
+            return false;
+        }
+        return true;
+    }
+
+    void AssetCatalog::unmap() noexcept {
+        if (data_) {
+            UnmapViewOfFile(data_);
+            data_ = nullptr;
+        }
+        if (mapping_) {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+        if (file_) {
+            CloseHandle(file_);
+            file_ = nullptr;
+        }
+        size_ = 0;
+    }
+
+    uint32_t AssetCatalog::size() const noexcept {
+        return data_ ? ((const Header*)data_)->count : 0;
+    }
+
+    bool AssetCatalog::find(const char* symbol, AssetInfo& info) const noexcept {
+        if (!data_) {
+            return false;
+        }
+        auto& header = *(const Header*)data_;
+        auto records = (const Record*)(data_ + sizeof(Header));
+        auto slots = (const uint32_t*)(records + header.count);
+        auto strings = (const char*)(slots + header.slots);
+        for (auto i = hashSymbol(symbol) & (header.slots - 1); slots[i]; i = (i + 1) & (header.slots - 1)) {
+            auto& record = records[slots[i] - 1];
+            if (strcmp(strings + record.symbol, symbol) == 0) {
+                info.symbol = strings + record.symbol;
+                info.exchange = strings + record.exchange;
+                info.tradable = (record.flags & TRADABLE) != 0;
+                info.shortable = (record.flags & SHORTABLE) != 0;
+                info.easyToBorrow = (record.flags & EASY_TO_BORROW) != 0;
+                info.marginable = (record.flags & MARGINABLE) != 0;
+                info.active = (record.flags & ACTIVE) != 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::string> AssetCatalog::tradableSymbols() const {
+        std::vector<std::string> symbols;
+        if (!data_) {
+            return symbols;
+        }
+        auto& header = *(const Header*)data_;
+        auto records = (const Record*)(data_ + sizeof(Header));
+        auto strings = (const char*)((const uint32_t*)(records + header.count) + header.slots);
+        symbols.reserve(header.count);
+        for (uint32_t i = 0; i < header.count; ++i) {
+            if (records[i].flags & TRADABLE) {
+                symbols.emplace_back(strings + records[i].symbol);
+            }
+        }
+        return symbols;
+    }
+
+} // namespace alpaca
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "alpaca/asset.h"
+
+namespace alpaca {
+
+    class Client;
+    class Logger;
+
+    /**
+     * @brief What the catalog knows about an asset. The strings point into the mapped file and stay
+     * valid until the catalog is rebuilt.
+     */
+    struct AssetInfo {
+        const char* symbol = nullptr;
+        const char* exchange = nullptr;
+        bool tradable = false;
+        bool shortable = false;
+        bool easyToBorrow = false;
+        bool marginable = false;
+        bool active = false;
+    };
+
+    /**
+     * @brief The Alpaca asset list as a compact binary file that is mapped into memory at login.
+     *
+     * The file holds a header, a fixed size record per asset, an open addressing hash table over the
+     * symbols and a string table in which every symbol and exchange name is stored once. Nothing is
+     * parsed at load, a lookup hashes the symbol and probes the table in the mapped file.
+     *
+     * A file older than REFRESH_AGE is still used, and revalidated without blocking Zorro: the
+     * request is sent through http_send and poll() picks up the reply. A reply with the same content
+     * hash only renews the fetch time, a changed one rebuilds the file.
+     */
+    class AssetCatalog {
+    public:
+        static constexpr __time32_t REFRESH_AGE = 86400;
+
+        /**
+         * @param path of the catalog file, one per environment since paper and live accounts may not
+         * see the same assets.
+         */
+        explicit AssetCatalog(std::string path) : path_(std::move(path)) {}
+        ~AssetCatalog();
+
+        AssetCatalog(const AssetCatalog&) = delete;
+        AssetCatalog& operator=(const AssetCatalog&) = delete;
+
+        /**
+         * @brief Map the catalog file, or download the asset list and build it if there is none.
+         * @return false if there is no catalog.
+         */
+        bool load(const Client& client, Logger& logger);
+
+        /**
+         * @brief Send a pending revalidation or pick up its reply, cheap enough for every BrokerTime.
+         */
+        void poll(Logger& logger);
+
+        bool empty() const noexcept { return !data_; }
+        uint32_t size() const noexcept;
+
+        /**
+         * @brief Look up a symbol in O(1).
+         * @return false if the symbol is not in the catalog.
+         */
+        bool find(const char* symbol, AssetInfo& info) const noexcept;
+
+        std::vector<std::string> tradableSymbols() const;
+
+    private:
+        /**
+         * @brief Apply a downloaded asset list: renew the fetch time if unchanged, rebuild the file otherwise.
+         */
+        bool update(const std::string& content, Logger& logger);
+        bool save(const std::vector<Asset>& assets, uint64_t hash, __time32_t fetched) const;
+        bool touch(__time32_t fetched);
+        bool map();
+        void unmap() noexcept;
+
+    private:
+        const std::string path_;
+        std::string url_;
+        std::string headers_;
+        bool stale_ = false;
+        int refreshId_ = 0;         // http_send id of the running revalidation
+
+        void* file_ = nullptr;      // HANDLE
+        void* mapping_ = nullptr;   // HANDLE
+        const uint8_t* data_ = nullptr;
+        uint64_t size_ = 0;
+    };
+
+} // namespace alpaca
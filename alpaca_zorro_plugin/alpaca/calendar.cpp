@@ -0,0 +1,131 @@
+#include "stdafx.h"
+#include "alpaca/calendar.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include "date/date.h"
+#include "alpaca/client.h"
+#include "alpaca/clock.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr __time32_t FIRST_DAY = 946684800;             // 2000-01-01
+        constexpr __time32_t REFRESH_AGE = 7 * 86400;           // re-download a calendar file older than a week
+        constexpr __time32_t MIN_AHEAD = 30 * 86400;            // or one that ends within a month
+        constexpr __time32_t DOWNLOAD_AHEAD = 365 * 86400;
+
+        inline __time32_t floorDay(__time32_t t) noexcept {
+            return t - t % Calendar::DAY_IN_SEC;
+        }
+    }
+
+    bool Session::parse(const std::string& sDate, const std::string& sOpen, const std::string& sClose) {
+        int y, m, d, openH, openM, closeH, closeM;
+        if (sscanf_s(sDate.c_str(), "%d-%d-%d", &y, &m, &d) != 3 ||
+            sscanf_s(sOpen.c_str(), "%d:%d", &openH, &openM) != 2 ||
+            sscanf_s(sClose.c_str(), "%d:%d", &closeH, &closeM) != 2) {
+            return false;
+        }
+
+        auto ymd = date::year{ y } / m / d;
+        if (!ymd.ok()) {
+            return false;
+        }
+        day = (__time32_t)date::sys_seconds{ date::sys_days{ ymd } }.time_since_epoch().count();
+        // noon of the day is well clear of the 2:00 DST switch
+        auto offset = getNewYorkOffset(day + 43200);
+        open = day + openH * 3600 + openM * 60 - offset;
+        close = day + closeH * 3600 + closeM * 60 - offset;
+        return close > open;
+    }
+
+    bool Calendar::load(const Client& client, Logger& logger) {
+        auto now = (__time32_t)std::time(nullptr);
+        if (loadFile(now)) {
+            logger.logDebug("Loaded %d sessions from %s\n", sessions_.size(), path_.c_str());
+            return true;
+        }
+
+        auto response = client.getCalendar(FIRST_DAY, now + DOWNLOAD_AHEAD);
+        if (!response || response.content().empty()) {
+            logger.logWarning("Failed to download market calendar. %s\n", response.what().c_str());
+            // a stale calendar is still better than none
+            return !sessions_.empty();
+        }
+
+        sessions_ = std::move(response.content());
+        std::sort(sessions_.begin(), sessions_.end(), [](const Session& a, const Session& b) { return a.day < b.day; });
+        saveFile(now);
+        logger.logDebug("Downloaded %d sessions\n", sessions_.size());
+        return true;
+    }
+
+    bool Calendar::loadFile(__time32_t now) {
+        FILE* f;
+        if (fopen_s(&f, path_.c_str(), "r")) {
+            return false;
+        }
+
+        long long fetched = 0;
+        if (fscanf_s(f, "fetched,%lld\n", &fetched) != 1) {
+            fclose(f);
+            return false;
+        }
+
+        sessions_.clear();
+        sessions_.reserve(256 * 30);
+        long long day, open, close;
+        while (fscanf_s(f, "%lld,%lld,%lld\n", &day, &open, &close) == 3) {
+            sessions_.push_back(Session{ (__time32_t)day, (__time32_t)open, (__time32_t)close });
+        }
+        fclose(f);
+
+        return !sessions_.empty() && fetched + REFRESH_AGE > now && sessions_.back().day > now + MIN_AHEAD;
+    }
+
+    void Calendar::saveFile(__time32_t now) const {
+        FILE* f;
+        if (fopen_s(&f, path_.c_str(), "w")) {
+            return;
+        }
+        fprintf(f, "fetched,%lld\n", (long long)now);
+        for (auto& session : sessions_) {
+            fprintf(f, "%lld,%lld,%lld\n", (long long)session.day, (long long)session.open, (long long)session.close);
+        }
+        fclose(f);
+    }
+
+    bool Calendar::covers(__time32_t t) const noexcept {
+        return !sessions_.empty() && t >= sessions_.front().day && t < sessions_.back().day + DAY_IN_SEC;
+    }
+
+    const Session* Calendar::sessionOn(__time32_t day) const noexcept {
+        auto it = std::lower_bound(sessions_.begin(), sessions_.end(), day, [](const Session& s, __time32_t d) { return s.day < d; });
+        return (it != sessions_.end() && it->day == day) ? &*it : nullptr;
+    }
+
+    const Session* Calendar::session(__time32_t t) const noexcept {
+        return sessionOn(floorDay(t + getNewYorkOffset(t)));
+    }
+
+    const Session* Calendar::nextSession(__time32_t t) const noexcept {
+        // sessions are ordered by day, so their closes are ascending too
+        auto it = std::upper_bound(sessions_.begin(), sessions_.end(), t, [](__time32_t time, const Session& s) { return time < s.close; });
+        return it != sessions_.end() ? &*it : nullptr;
+    }
+
+    bool Calendar::isOpen(__time32_t t) const noexcept {
+        auto s = session(t);
+        return s && t >= s->open && t < s->close;
+    }
+
+    uint32_t Calendar::sessionsBetween(__time32_t from, __time32_t to) const noexcept {
+        auto less = [](const Session& s, __time32_t d) { return s.day < d; };
+        auto first = std::lower_bound(sessions_.begin(), sessions_.end(), floorDay(from), less);
+        auto last = std::lower_bound(sessions_.begin(), sessions_.end(), floorDay(to) + DAY_IN_SEC, less);
+        return last > first ? (uint32_t)(last - first) : 0;
+    }
+
+} // namespace alpaca
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace alpaca {
+
+    class Client;
+    class Logger;
+
+    /**
+     * @brief A trading session of the US equity market. All times are UTC.
+     */
+    struct Session {
+        __time32_t day;     // 00:00:00 UTC of the trading date
+        __time32_t open;    // regular session open
+        __time32_t close;   // regular session close, earlier on early close days
+
+        uint32_t minutes() const noexcept { return (uint32_t)(close - open) / 60; }
+
+    private:
+        template<typename> friend class Response;
+
+        template<typename CallerT, typename T>
+        std::pair<int, std::string> fromJSON(const T& parser) {
+            std::string sDate, open, close;
+            parser.template get<std::string>("date", sDate);
+            parser.template get<std::string>("open", open);
+            parser.template get<std::string>("close", close);
+            if (!parse(sDate, open, close)) {
+                return std::make_pair(1, "Invalid calendar day " + sDate + " " + open + "-" + close);
+            }
+            return std::make_pair(0, "OK");
+        }
+
+        /**
+         * @brief Set the session from a YYYY-MM-DD date and HH:MM New York open/close times.
+         */
+        bool parse(const std::string& sDate, const std::string& sOpen, const std::string& sClose);
+    };
+
+    /**
+     * @brief The exchange calendar, every trading session between 2000 and a year ahead.
+     *
+     * Loaded once per login from a local file and refreshed from /v2/calendar when the file is
+     * a week old or doesn't reach a month ahead. Lookups are binary searches over the sessions.
+     */
+    class Calendar {
+    public:
+        static constexpr __time32_t DAY_IN_SEC = 86400;
+
+        explicit Calendar(std::string path = "./Data/AlpacaCalendar.csv") : path_(std::move(path)) {}
+
+        /**
+         * @brief Load the sessions from the local file, or download and save them if the file is stale.
+         * @return false if no sessions could be loaded.
+         */
+        bool load(const Client& client, Logger& logger);
+
+        bool empty() const noexcept { return sessions_.empty(); }
+
+        const std::vector<Session>& sessions() const noexcept { return sessions_; }
+
+        /**
+         * @brief Whether t falls on a day within the loaded sessions, so a missing session means the market was closed.
+         */
+        bool covers(__time32_t t) const noexcept;
+
+        /**
+         * @brief The session on the given date, 00:00:00 UTC of the day. nullptr on weekends and holidays.
+         */
+        const Session* sessionOn(__time32_t day) const noexcept;
+
+        /**
+         * @brief The session on the New York trading date of t. nullptr on weekends and holidays.
+         */
+        const Session* session(__time32_t t) const noexcept;
+
+        /**
+         * @brief The first session closing after t, nullptr if beyond the loaded sessions.
+         */
+        const Session* nextSession(__time32_t t) const noexcept;
+
+        /**
+         * @brief Whether the regular session is open at t.
+         */
+        bool isOpen(__time32_t t) const noexcept;
+
+        /**
+         * @brief Number of sessions on the dates of [from, to].
+         */
+        uint32_t sessionsBetween(__time32_t from, __time32_t to) const noexcept;
+
+    private:
+        bool loadFile(__time32_t now);
+        void saveFile(__time32_t now) const;
+
+    private:
+        const std::string path_;
+        std::vector<Session> sessions_;
+    };
+
+} // namespace alpaca
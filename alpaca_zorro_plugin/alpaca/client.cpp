@@ -22,6 +22,22 @@ namespace {
 
     std::unique_ptr<alpaca::AlpacaMarketData> alpacaMarketData;
     std::unique_ptr<alpaca::Polygon> polygon;
+
+    std::string clientOrderId(const std::string& client_order_id, int32_t internalOrderId) {
+        std::stringstream clientOrderId;
+        clientOrderId << "ZORRO_";
+        if (!client_order_id.empty()) {
+            if (client_order_id.size() > 32) {  // Alpaca client order id max length is 48
+                clientOrderId << client_order_id.substr(0, 32);
+            }
+            else {
+                clientOrderId << client_order_id;
+            }
+            clientOrderId << "_";
+        }
+        clientOrderId << internalOrderId;
+        return clientOrderId.str();
+    }
 }
 
 namespace alpaca {
@@ -30,6 +46,7 @@ namespace alpaca {
         : baseUrl_(isPaperTrading ? s_APIBaseURLPaper : s_APIBaseURLLive)
         , apiKey_(std::move(key))
         , headers_("Content-Type:application/json\nAPCA-API-KEY-ID:" + apiKey_ + "\n" + "APCA-API-SECRET-KEY:" + std::move(secret))
+        , assets_(isPaperTrading ? "./Data/AlpacaAssetsPaper.bin" : "./Data/AlpacaAssets.bin")
         , isLiveMode_(!isPaperTrading)
     {
         s_orderIdGen = std::make_unique<ClientOrderIdGenerator>(*this);
@@ -40,9 +57,52 @@ namespace alpaca {
     }
 
     Response<Clock> Client::getClock() const {
-        auto rt = request<Clock, Client>(baseUrl_ + "/v2/clock", headers_);
-        is_open_ = rt.content().is_open;
-        return rt;
+        return request<Clock, Client>(baseUrl_ + "/v2/clock", headers_);
+    }
+
+    bool Client::serverTime(int64_t& nanos, bool& isOpen) const {
+        auto local = MarketClock::localNanos();
+        if (clock_.due(local)) {
+            auto response = getClock();
+            auto received = MarketClock::localNanos();
+            if (response) {
+                clock_.sync(local, received, response.content());
+            }
+            else {
+                clock_.failed(received);
+                logger_.logWarning("Failed to sync the clock. %s\n", response.what().c_str());
+            }
+            local = received;
+        }
+        if (!clock_.synced() || clock_.failing()) {
+            return false;
+        }
+        nanos = clock_.now(local);
+        isOpen = clock_.isOpen(local);
+        return true;
+    }
+
+    bool Client::sessionOpen() const {
+        auto local = MarketClock::localNanos();
+        // the server time of the clock model, a skewed PC clock would refuse orders near the open or close
+        auto now = clock_.synced() ? (__time32_t)(clock_.now(local) / 1000000000) : (__time32_t)std::time(nullptr);
+        // the calendar knows holidays and early closes without a round trip, the clock model is the fallback
+        return calendar_.covers(now) ? calendar_.isOpen(now) : clock_.isOpen(local);
+    }
+
+    Response<std::vector<Session>> Client::getCalendar(__time32_t start, __time32_t end) const {
+        std::string url;
+        try {
+            using namespace date;
+            url = baseUrl_ + "/v2/calendar?start=" + format("%F", date::sys_seconds{ std::chrono::seconds{ start } }) +
+                "&end=" + format("%F", date::sys_seconds{ std::chrono::seconds{ end } });
+        }
+        catch (const std::exception&) {
+            assert(false);
+            return Response<std::vector<Session>>(1, "invalid time");
+        }
+        logger_.logDebug("--> %s\n", url.c_str());
+        return request<std::vector<Session>, Client>(url, headers_);
     }
 
     Response<std::vector<Asset>> Client::getAssets() const {
@@ -124,10 +184,14 @@ namespace alpaca {
         const std::string& client_order_id,
         const OrderClass order_class,
         TakeProfitParams* take_profit_params,
-        StopLossParams* stop_loss_params) const {
+        StopLossParams* stop_loss_params,
+        TrailingStopParams* trailing_stop_params,
+        bool checkSession) const {
 
-        if (!is_open_ && !extended_hours) {
-            return Response<Order>(1, "Market Close.");
+        if (checkSession && !extended_hours) {
+            if (!sessionOpen()) {
+                return Response<Order>(1, "Market Close.");
+            }
         }
 
         Response<Order> response;
@@ -164,27 +228,25 @@ namespace alpaca {
                 writer.String(stop_price.c_str());
             }
 
+            if (trailing_stop_params != nullptr) {
+                if (!trailing_stop_params->trailPrice.empty()) {
+                    writer.Key("trail_price");
+                    writer.String(trailing_stop_params->trailPrice.c_str());
+                }
+                else if (!trailing_stop_params->trailPercent.empty()) {
+                    writer.Key("trail_percent");
+                    writer.String(trailing_stop_params->trailPercent.c_str());
+                }
+            }
+
             if (extended_hours) {
                 writer.Key("extended_hours");
                 writer.Bool(extended_hours);
             }
 
             internalOrderId = s_orderIdGen->nextOrderId();
-            std::stringstream clientOrderId;
-            clientOrderId << "ZORRO_";
-            if (!client_order_id.empty()) {
-                if (client_order_id.size() > 32) {  // Alpaca client order id max length is 48
-                    clientOrderId << client_order_id.substr(0, 32);
-                }
-                else {
-                    clientOrderId << client_order_id;
-                }
-                clientOrderId << "_";
-            }
-
-            clientOrderId << internalOrderId;
             writer.Key("client_order_id");
-            writer.String(clientOrderId.str().c_str());
+            writer.String(clientOrderId(client_order_id, internalOrderId).c_str());
 
             if (order_class != OrderClass::Simple) {
                 writer.Key("order_class");
@@ -234,6 +296,66 @@ namespace alpaca {
         return response;
     }
 
+    std::vector<Response<Order>> Client::submitOrders(const std::vector<OrderRequest>& orders, bool extended_hours, size_t maxInFlight) const {
+        if (!extended_hours) {
+            if (!sessionOpen()) {
+                return std::vector<Response<Order>>(orders.size(), Response<Order>(1, "Market Close."));
+            }
+        }
+
+        // everything is serialized first, the sends then follow each other as fast as the rate limit allows
+        std::vector<std::string> urls(orders.size(), baseUrl_ + "/v2/orders");
+        std::vector<std::string> bodies;
+        bodies.reserve(orders.size());
+        for (auto& order : orders) {
+            rapidjson::StringBuffer s;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+            writer.StartObject();
+            writer.Key("symbol");
+            writer.String(order.symbol.c_str());
+            writer.Key("qty");
+            writer.Int(order.quantity);
+            writer.Key("side");
+            writer.String(to_string(order.side));
+            writer.Key("type");
+            writer.String(to_string(order.type));
+            writer.Key("time_in_force");
+            writer.String(to_string(order.tif));
+            if (!order.limit_price.empty()) {
+                writer.Key("limit_price");
+                writer.String(order.limit_price.c_str());
+            }
+            if (extended_hours) {
+                writer.Key("extended_hours");
+                writer.Bool(extended_hours);
+            }
+            writer.Key("client_order_id");
+            writer.String(clientOrderId(order.client_order_id, s_orderIdGen->nextOrderId()).c_str());
+            writer.EndObject();
+            bodies.emplace_back(s.GetString());
+        }
+
+        logger_.logDebug("--> POST %s/v2/orders x%zu\n", baseUrl_.c_str(), orders.size());
+        auto raws = requestAllRaw<Client>(urls, headers_, &logger_, maxInFlight, nullptr, &bodies);
+
+        std::vector<Response<Order>> responses;
+        responses.reserve(raws.size());
+        for (size_t i = 0; i < raws.size(); ++i) {
+            if (!raws[i]) {
+                responses.emplace_back(raws[i].getCode(), raws[i].what());
+                continue;
+            }
+            responses.emplace_back(parseResponse<Order, Client>(raws[i].content()));
+            if (!responses.back() && responses.back().what() == "client_order_id must be unique") {
+                // the id was used before, send this one again with the next id
+                s_orderIdGen->onIdConflict();
+                auto& order = orders[i];
+                responses.back() = submitOrder(order.symbol, order.quantity, order.side, order.type, order.tif, order.limit_price, "", extended_hours, order.client_order_id);
+            }
+        }
+        return responses;
+    }
+
     Response<Order> Client::replaceOrder(
         const std::string& id,
         const int quantity,
@@ -264,21 +386,8 @@ namespace alpaca {
         }
 
         auto internalOrderId = s_orderIdGen->nextOrderId();
-        std::stringstream clientOrderId;
-        clientOrderId << "ZORRO_";
-        if (!client_order_id.empty()) {
-            if (client_order_id.size() > 32) {  // Alpaca client order id max length is 48
-                clientOrderId << client_order_id.substr(0, 32);
-            }
-            else {
-                clientOrderId << client_order_id;
-            }
-            clientOrderId << "_";
-        }
-
-        clientOrderId << internalOrderId;
         writer.Key("client_order_id");
-        writer.String(clientOrderId.str().c_str());
+        writer.String(clientOrderId(client_order_id, internalOrderId).c_str());
 
         writer.EndObject();
         std::string body("#PATCH ");
@@ -291,26 +400,80 @@ namespace alpaca {
 
     Response<Order> Client::cancelOrder(const std::string& id) const {
         logger_.logDebug("--> DELETE %s/v2/orders/%s\n", baseUrl_.c_str(), id.c_str());
-        auto response = request<Order, Client>(baseUrl_ + "/v2/orders/" + id, headers_, "#DELETE", &logger_);
+        auto raw = requestRaw<Client>(baseUrl_ + "/v2/orders/" + id, headers_, "#DELETE", &logger_);
+        if (!raw) {
+            // the cancel may or may not have arrived, only the order tells
+            auto current = getOrder(id, false, true);
+            if (current && (isFinal(current.content().status) || current.content().status == "pending_cancel")) {
+                return current;
+            }
+            logger_.logWarning("failed to cancel order %s. %s\n", id.c_str(), raw.what().c_str());
+            return Response<Order>(raw.getCode(), raw.what());
+        }
+        if (raw.content().empty()) {
+            // accepted, Alpaca doesn't return the order. The cancel is confirmed by the order updates or a later read.
+            Order order;
+            order.id = id;
+            order.status = "pending_cancel";
+            return Response<Order>(0, "OK", std::move(order));
+        }
+        auto response = parseResponse<Order, Client>(raw.content());
         if (!response) {
-            // Alpaca cancelOrder not return a object
-            Order* order;
-            do {
-                auto resp = getOrder(id, false, true);
-                if (resp) {
-                    order = &resp.content();
-                    if (order->status == "canceled" || order->status == "filled") {
-                        return resp;
-                    }
-                }
-            } while (order->status == "pending_cancel");
-            logger_.logWarning("failed to cancel order %s. order status=%s", id.c_str(), order->status.c_str());
-            return Response<Order>(1, "Failed to cancel order");
+            // not cancelable, most likely it is final already
+            auto current = getOrder(id, false, true);
+            if (current && isFinal(current.content().status)) {
+                return current;
+            }
+            logger_.logWarning("failed to cancel order %s. %s\n", id.c_str(), response.what().c_str());
         }
         return response;
     }
 
+    Response<std::vector<BulkOrderResult>> Client::cancelAllOrders() const {
+        logger_.logDebug("--> DELETE %s/v2/orders\n", baseUrl_.c_str());
+        return request<std::vector<BulkOrderResult>, Client>(baseUrl_ + "/v2/orders", headers_, "#DELETE", &logger_);
+    }
+
+    std::vector<Response<Order>> Client::cancelOrders(const std::vector<std::string>& ids, size_t maxInFlight) const {
+        std::vector<std::string> urls;
+        urls.reserve(ids.size());
+        for (auto& id : ids) {
+            urls.emplace_back(baseUrl_ + "/v2/orders/" + id);
+        }
+        logger_.logDebug("--> DELETE %s/v2/orders/<id> x%zu\n", baseUrl_.c_str(), ids.size());
+        auto raws = requestAllRaw<Client>(urls, headers_, &logger_, maxInFlight, "#DELETE");
+
+        std::vector<Response<Order>> responses;
+        responses.reserve(raws.size());
+        for (size_t i = 0; i < raws.size(); ++i) {
+            if (!raws[i]) {
+                responses.emplace_back(raws[i].getCode(), raws[i].what());
+                continue;
+            }
+            if (raws[i].content().empty()) {
+                // an empty reply to a completed transfer, accepted, the cancel is confirmed later
+                Order order;
+                order.id = ids[i];
+                order.status = "pending_cancel";
+                responses.emplace_back(0, "OK", std::move(order));
+                continue;
+            }
+            responses.emplace_back(parseResponse<Order, Client>(raws[i].content()));
+        }
+        return responses;
+    }
+
+    Response<std::vector<BulkOrderResult>> Client::closeAllPositions(bool cancelOrders) const {
+        auto url = baseUrl_ + "/v2/positions" + (cancelOrders ? "?cancel_orders=true" : "");
+        logger_.logDebug("--> DELETE %s\n", url.c_str());
+        return request<std::vector<BulkOrderResult>, Client>(url, headers_, "#DELETE", &logger_);
+    }
+
     Response<Position> Client::getPosition(const std::string& symbol) const {
         return request<Position, Client>(baseUrl_ + "/v2/positions/" + symbol, headers_);
     }
+
+    Response<std::vector<Position>> Client::getPositions() const {
+        return request<std::vector<Position>, Client>(baseUrl_ + "/v2/positions", headers_);
+    }
 } // namespace alpaca
\ No newline at end of file
@@ -10,7 +10,11 @@
 #include "market_data/bars.h"
 #include "market_data/quote.h"
 #include "alpaca/clock.h"
+#include "alpaca/asset_catalog.h"
+#include "alpaca/calendar.h"
+#include "alpaca/market_clock.h"
 #include "alpaca/order.h"
+#include "alpaca/order_updates.h"
 #include "alpaca/position.h"
 
 namespace alpaca {
@@ -29,10 +33,37 @@ namespace alpaca {
 
         const std::string& headers() const noexcept { return headers_;  }
 
+        const std::string& baseUrl() const noexcept { return baseUrl_; }
+
         Response<Account> getAccount() const;
 
         Response<Clock> getClock() const;
 
+        /**
+         * @brief Alpaca's time and market state from the local clock model, /v2/clock is only requested when a sync is due.
+         * @return false if the clock was never synced or the last sync failed, so a lost connection still shows.
+         */
+        bool serverTime(int64_t& nanos, bool& isOpen) const;
+        const MarketClock& marketClock() const noexcept { return clock_; }
+
+        /**
+         * @brief Download the trading sessions on the dates of [start, end].
+         */
+        Response<std::vector<Session>> getCalendar(__time32_t start, __time32_t end) const;
+
+        /**
+         * @brief Load the exchange calendar used for market hours and history planning.
+         */
+        bool loadCalendar() { return calendar_.load(*this, logger_); }
+        const Calendar& calendar() const noexcept { return calendar_; }
+
+        /**
+         * @brief Map the asset catalog used to validate symbols and orders without a request.
+         */
+        bool loadAssets() { return assets_.load(*this, logger_); }
+        void pollAssets() { assets_.poll(logger_); }
+        const AssetCatalog& assets() const noexcept { return assets_; }
+
         Response<std::vector<Asset>> getAssets() const;
         Response<Asset> getAsset(const std::string& symbol) const;
 
@@ -47,6 +78,10 @@ namespace alpaca {
         Response<Order> getOrder(const std::string& id, const bool nested = false, const bool logResponse = false) const;
         Response<Order> getOrderByClientOrderId(const std::string& clientOrderId) const;
 
+        /**
+         * @param checkSession refuse the order locally outside the regular session unless extended_hours, off for GTC
+         * orders Alpaca holds until the next session, e.g. the exits of a position
+         */
         Response<Order> submitOrder(
             const std::string& symbol,
             const int quantity,
@@ -59,7 +94,15 @@ namespace alpaca {
             const std::string& client_order_id = "",
             const OrderClass order_class = OrderClass::Simple,
             TakeProfitParams* take_profit_params = nullptr,
-            StopLossParams* stop_loss_params = nullptr) const;
+            StopLossParams* stop_loss_params = nullptr,
+            TrailingStopParams* trailing_stop_params = nullptr,
+            bool checkSession = true) const;
+
+        /**
+         * @brief Send several simple orders concurrently. All bodies and client order ids are built before the first is sent.
+         * @return a reply per order, in the same order
+         */
+        std::vector<Response<Order>> submitOrders(const std::vector<OrderRequest>& orders, bool extended_hours = false, size_t maxInFlight = 8) const;
 
         Response<Order> replaceOrder(
             const std::string& id,
@@ -69,15 +112,48 @@ namespace alpaca {
             const std::string& stop_price = "",
             const std::string& client_order_id = "") const;
 
+        /**
+         * @brief Send the cancel of an order without waiting for it to be confirmed.
+         * @return a pending_cancel order if the cancel was accepted, the final order if it was final already.
+         */
         Response<Order> cancelOrder(const std::string& id) const;
 
+        /**
+         * @brief Cancel all open orders with one request, the result of each comes back in the reply.
+         */
+        Response<std::vector<BulkOrderResult>> cancelAllOrders() const;
+
+        /**
+         * @brief Send the cancels of several orders concurrently, without waiting for them to be confirmed.
+         * @return a reply per id, in the same order
+         */
+        std::vector<Response<Order>> cancelOrders(const std::vector<std::string>& ids, size_t maxInFlight = 4) const;
+
+        /**
+         * @brief Close all positions at market with one request, with cancelOrders their open orders are canceled first.
+         */
+        Response<std::vector<BulkOrderResult>> closeAllPositions(bool cancelOrders = true) const;
+
         Response<Position> getPosition(const std::string& symbol) const;
 
+        /**
+         * @brief All open positions of the account in one request.
+         */
+        Response<std::vector<Position>> getPositions() const;
+
+    private:
+        /**
+         * @brief The regular session is open by the server time, without a request.
+         */
+        bool sessionOpen() const;
+
     private:
         const std::string baseUrl_;
         const std::string apiKey_;
         const std::string headers_;
-        mutable bool is_open_ = false;
+        mutable MarketClock clock_;
+        Calendar calendar_;
+        AssetCatalog assets_;
         const bool isLiveMode_;
         mutable Logger logger_;
     };
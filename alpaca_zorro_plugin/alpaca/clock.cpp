@@ -17,6 +17,34 @@ namespace alpaca{
         return tp.time_since_epoch().count();
     }
 
+    namespace {
+        uint32_t digits(const char* s, size_t n) noexcept {
+            uint32_t v = 0;
+            for (size_t i = 0; i < n; ++i) {
+                v = v * 10 + (uint32_t)(s[i] - '0');
+            }
+            return v;
+        }
+    }
+
+    int64_t parseNanos(const char* s, size_t length) noexcept {
+        if (length < 20) {
+            return 0;
+        }
+        using namespace date;
+        auto day = sys_days{ year{ (int)digits(s, 4) } / (int)digits(s + 5, 2) / (int)digits(s + 8, 2) };
+        int64_t seconds = day.time_since_epoch().count() * 86400ll + digits(s + 11, 2) * 3600 + digits(s + 14, 2) * 60 + digits(s + 17, 2);
+        int64_t nanos = 0;
+        size_t i = 19;
+        if (i < length && s[i] == '.') {
+            int64_t scale = 100000000;
+            for (++i; i < length && s[i] >= '0' && s[i] <= '9'; ++i, scale /= 10) {
+                nanos += (s[i] - '0') * scale;
+            }
+        }
+        return seconds * 1000000000ll + nanos;
+    }
+
     int32_t getTimeZoneOffset(const std::string& timestamp) {
         using namespace date;
         if (timestamp.size() > 19) {
@@ -35,6 +63,17 @@ namespace alpaca{
         return 0;
     }
 
+    int32_t getNewYorkOffset(__time32_t utc) {
+        using namespace date;
+        // US DST starts on the second Sunday of March at 2:00 EST (07:00 UTC)
+        // and ends on the first Sunday of November at 2:00 EDT (06:00 UTC).
+        auto tp = sys_seconds{ std::chrono::seconds{ utc } };
+        auto y = year_month_day{ floor<days>(tp) }.year();
+        auto dstStart = sys_days{ y / March / Sunday[2] } + std::chrono::hours{ 7 };
+        auto dstEnd = sys_days{ y / November / Sunday[1] } + std::chrono::hours{ 6 };
+        return (tp >= dstStart && tp < dstEnd) ? -14400 : -18000;
+    }
+
     std::string timeToString(__time32_t time) {
         using namespace date;
         return format("%FT%T", date::sys_seconds{ std::chrono::seconds{ time } });
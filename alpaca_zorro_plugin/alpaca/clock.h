@@ -7,10 +7,22 @@ namespace alpaca {
     __time32_t parseTimeStamp(std::string&& timestamp);
     int32_t getTimeZoneOffset(const std::string& timestamp);
 
+    /**
+     * @brief Nanoseconds since epoch of an RFC 3339 UTC time, e.g. 2021-02-22T15:51:44.208123456Z
+     */
+    int64_t parseNanos(const char* s, size_t length) noexcept;
+
+    /**
+     * @brief Offset in seconds of America/New_York from UTC at the given UTC time
+     * (-14400 during daylight saving time, -18000 otherwise).
+     */
+    int32_t getNewYorkOffset(__time32_t utc);
+
     struct Clock {
         __time32_t next_close;
         __time32_t next_open;
         __time32_t timestamp;
+        int64_t timestamp_ns;   // the same time in nanoseconds since epoch
         bool is_open;
 
     private:
@@ -18,10 +30,13 @@ namespace alpaca {
 
         template<typename CallerT, typename T>
         std::pair<int, std::string> fromJSON(const T& parser) {
-            parser.get<bool>("is_open", is_open);
-            next_close = parseTimeStamp(parser.get<std::string>("next_close"));
-            next_open = parseTimeStamp(parser.get<std::string>("next_open"));
-            timestamp = parseTimeStamp(std::move(parser.get<std::string>("timestamp")));
+            parser.template get<bool>("is_open", is_open);
+            next_close = parseTimeStamp(parser.template get<std::string>("next_close"));
+            next_open = parseTimeStamp(parser.template get<std::string>("next_open"));
+            auto ts = parser.template get<std::string>("timestamp");
+            // e.g. 2021-03-01T10:15:30.123456789-05:00, parseNanos reads the local time
+            timestamp_ns = parseNanos(ts.c_str(), ts.size()) - getTimeZoneOffset(ts) * 3600ll * 1000000000ll;
+            timestamp = parseTimeStamp(std::move(ts));
             return std::make_pair(0, "OK");
         }
     };
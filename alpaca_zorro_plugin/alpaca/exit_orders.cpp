@@ -0,0 +1,89 @@
+#include "stdafx.h"
+#include "alpaca/exit_orders.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace alpaca {
+
+    bool ExitConfig::parse(const std::string& config) {
+        bool known = true;
+        std::istringstream in(config);
+        std::string item;
+        while (std::getline(in, item, ',')) {
+            auto pos = item.find('=');
+            if (pos == std::string::npos) {
+                known = false;
+                continue;
+            }
+            auto key = item.substr(0, pos);
+            auto value = item.substr(pos + 1);
+            if (key == "stop") {
+                if (value == "fixed") {
+                    stop = StopType::Stop;
+                }
+                else if (value == "limit") {
+                    stop = StopType::StopLimit;
+                }
+                else if (value == "trail") {
+                    stop = StopType::TrailingStop;
+                }
+                else {
+                    known = false;
+                }
+            }
+            else if (key == "limit") {
+                limit = std::max(atof(value.c_str()), 0.);
+            }
+            else if (key == "tp") {
+                takeProfit = std::max(atof(value.c_str()), 0.);
+            }
+            else {
+                known = false;
+            }
+        }
+        // Alpaca has no bracket with a trailing stop, a trailing stop goes out alone
+        if (stop == StopType::TrailingStop && takeProfit > 0.) {
+            takeProfit = 0.;
+            known = false;
+        }
+        return known;
+    }
+
+    std::string ExitConfig::to_string() const {
+        constexpr const char* sStopType[] = { "fixed", "limit", "trail" };
+        std::ostringstream out;
+        out << "stop=" << sStopType[(int)stop] << ",limit=" << limit << ",tp=" << takeProfit;
+        return out.str();
+    }
+
+    ExitPrices exitPrices(const ExitConfig& config, OrderSide side, double price, double stopDist) noexcept {
+        ExitPrices prices;
+        if (price <= 0. || stopDist <= 0.) {
+            return prices;
+        }
+        // the exits of a long position are below the stop and above the take profit, of a short one the other way round
+        double sign = side == OrderSide::Buy ? 1. : -1.;
+        if (config.stop == StopType::TrailingStop) {
+            prices.trail = stopDist;
+        }
+        else {
+            prices.stop = std::max(price - sign * stopDist, 0.01);
+            if (config.stop == StopType::StopLimit) {
+                prices.stopLimit = std::max(prices.stop - sign * config.limit * stopDist, 0.01);
+            }
+        }
+        if (config.takeProfit > 0.) {
+            prices.takeProfit = price + sign * config.takeProfit * stopDist;
+        }
+        return prices;
+    }
+
+    std::string formatPrice(double price) {
+        char text[32];
+        sprintf_s(text, sizeof(text), price >= 1. ? "%.2f" : "%.4f", price);
+        return text;
+    }
+
+} // namespace alpaca
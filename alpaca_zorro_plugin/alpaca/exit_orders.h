@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "alpaca/order.h"
+
+namespace alpaca {
+
+    enum class StopType : uint8_t {
+        Stop,
+        StopLimit,
+        TrailingStop,
+    };
+
+    /**
+     * @brief How the exits of an entry with a stop distance are sent.
+     */
+    struct ExitConfig {
+        StopType stop = StopType::Stop;
+        double limit = 0.5;         // the limit of a stop limit, as a fraction of the stop distance past the stop
+        double takeProfit = 0.;     // a take profit at this multiple of the stop distance, 0 for none
+
+        /**
+         * @brief Parse "key=value,..." with the keys stop (fixed, limit or trail), limit and tp.
+         * @return false on an unknown key or value, the known ones are applied anyway, or on a trailing
+         * stop with a take profit, which is then dropped.
+         */
+        bool parse(const std::string& config);
+        std::string to_string() const;
+    };
+
+    /**
+     * @brief The exit prices of a position, 0 for an exit that isn't sent.
+     */
+    struct ExitPrices {
+        double stop = 0.;
+        double stopLimit = 0.;
+        double takeProfit = 0.;
+        double trail = 0.;
+    };
+
+    /**
+     * @brief The exits of a position entered at price on side with a stop distance.
+     */
+    ExitPrices exitPrices(const ExitConfig& config, OrderSide side, double price, double stopDist) noexcept;
+
+    /**
+     * @brief A price as Alpaca takes it, 2 decimals from $1 and 4 below.
+     */
+    std::string formatPrice(double price);
+
+    /**
+     * @brief The exit orders of one Zorro trade.
+     */
+    struct Exit {
+        std::vector<std::string> orders;    // the stop and take profit, in any order
+        double stopDist = 0.;
+        uint32_t qty = 0;                   // the quantity they cover
+        bool placed = false;                // false until sent, a standalone exit waits for the entry to fill
+        bool closed = false;                // an exit filled the whole quantity
+        double closePrice = 0.;
+    };
+
+    struct ExitMetrics {
+        uint64_t attached = 0;      // sent with the entry as bracket or OTO
+        uint64_t placed = 0;        // sent on their own after the entry filled
+        uint64_t failed = 0;
+        uint64_t triggered = 0;     // trades closed at the venue
+        uint64_t canceled = 0;      // exits canceled because Zorro closed the trade
+        double slippage = 0.;       // sum of the stop fills past the stop price, per share
+        uint64_t stopFills = 0;
+    };
+
+    /**
+     * @brief The exits of the open trades by Zorro trade id, and their outcome.
+     *
+     * Alpaca executes the stop at the venue, the stop loss and the take profit cancel each other
+     * there as well. Zorro only learns from BrokerTrade that its trade was closed. Used from
+     * Zorro's thread only.
+     */
+    class ExitBook {
+    public:
+        Exit* find(int32_t tradeId) noexcept {
+            auto it = exits_.find(tradeId);
+            return it != exits_.end() ? &it->second : nullptr;
+        }
+
+        Exit& add(int32_t tradeId) { return exits_[tradeId]; }
+        void erase(int32_t tradeId) { exits_.erase(tradeId); }
+
+        /**
+         * @brief Drop the exits keep(tradeId, exit) returns false for, e.g. of trades that aren't known any more.
+         */
+        template<typename Keep>
+        size_t evict(Keep keep) {
+            size_t evicted = 0;
+            for (auto it = exits_.begin(); it != exits_.end();) {
+                if (!keep(it->first, it->second)) {
+                    it = exits_.erase(it);
+                    ++evicted;
+                }
+                else {
+                    ++it;
+                }
+            }
+            return evicted;
+        }
+
+        const ExitConfig& config() const noexcept { return config_; }
+        void setConfig(const ExitConfig& config) noexcept { config_ = config; }
+
+        size_t size() const noexcept { return exits_.size(); }
+        ExitMetrics& metrics() noexcept { return metrics_; }
+
+    private:
+        std::unordered_map<int32_t, Exit> exits_;
+        ExitConfig config_;
+        ExitMetrics metrics_;
+    };
+
+} // namespace alpaca
@@ -1,3 +1,4 @@
+#pragma once
 #include "rapidjson/document.h"
 #include <vector>
 
@@ -10,10 +11,9 @@ namespace alpaca {
         Parser(const T& j) : json(j) {}
 
         template<typename U>
-        bool get(const char* name, U& value) const;
+        bool get(const char* name, U& value) const { return read(name, value); }
 
-        template<>
-        bool get<std::string>(const char* name, std::string& value) const {
+        bool read(const char* name, std::string& value) const {
             if (json.HasMember(name) && json[name].IsString()) {
                 value = json[name].GetString();
                 return true;
@@ -21,8 +21,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<int32_t>(const char* name, int32_t& value) const {
+        bool read(const char* name, int32_t& value) const {
             if (json.HasMember(name)) {
                 if (json[name].IsInt()) {
                     value = json[name].GetInt();
@@ -40,8 +39,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<uint32_t>(const char* name, uint32_t& value) const {
+        bool read(const char* name, uint32_t& value) const {
             if (json.HasMember(name)) {
                 if (json[name].IsUint()) {
                     value = json[name].GetUint();
@@ -58,8 +56,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<int64_t>(const char* name, int64_t& value) const {
+        bool read(const char* name, int64_t& value) const {
             if (json.HasMember(name)) {
                 if (json[name].IsInt64()) {
                     value = json[name].GetInt64();
@@ -77,8 +74,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<uint64_t>(const char* name, uint64_t& value) const {
+        bool read(const char* name, uint64_t& value) const {
             if (json.HasMember(name)) {
                 if (json[name].IsUint64()) {
                     value = json[name].GetUint64();
@@ -96,8 +92,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<bool>(const char* name, bool& value) const {
+        bool read(const char* name, bool& value) const {
             if (json.HasMember(name) && json[name].IsBool()) {
                 value = json[name].GetBool();
                 return true;
@@ -105,8 +100,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<double>(const char* name, double& value) const {
+        bool read(const char* name, double& value) const {
             if (json.HasMember(name)) {
                 if (json[name].IsNumber()) {
                     value = json[name].GetDouble();
@@ -120,8 +114,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<float>(const char* name, float& value) const {
+        bool read(const char* name, float& value) const {
             if (json.HasMember(name)) {
                 if (json[name].IsNumber()) {
                     value = json[name].GetFloat();
@@ -135,8 +128,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<std::vector<double>>(const char* name, std::vector<double>& value) const {
+        bool read(const char* name, std::vector<double>& value) const {
             if (json.HasMember(name) && json[name].IsArray()) {
                 for (auto& item : json[name].GetArray()) {
                     if (item.IsNumber()) {
@@ -148,8 +140,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<std::vector<float>>(const char* name, std::vector<float>& value) const {
+        bool read(const char* name, std::vector<float>& value) const {
             if (json.HasMember(name) && json[name].IsArray()) {
 
                 for (auto& item : json[name].GetArray()) {
@@ -162,8 +153,7 @@ namespace alpaca {
             return false;
         }
 
-        template<>
-        bool get<std::vector<uint64_t>>(const char* name, std::vector<uint64_t>& value) const {
+        bool read(const char* name, std::vector<uint64_t>& value) const {
             if (json.HasMember(name) && json[name].IsArray()) {
 
                 for (auto& item : json[name].GetArray()) {
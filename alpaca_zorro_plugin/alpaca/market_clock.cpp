@@ -0,0 +1,113 @@
+#include "stdafx.h"
+#include "alpaca/market_clock.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace alpaca {
+
+    namespace {
+        constexpr int64_t NANOS = 1000000000ll;
+        // samples further from the shortest round trip are too asymmetric to trust
+        constexpr int64_t RTT_SLACK = 1000000;
+        // a fit over a shorter span is mostly jitter
+        constexpr int64_t MIN_DRIFT_SPAN = 60ll * NANOS;
+        constexpr double MAX_DRIFT = 500e-6;
+    }
+
+    int64_t MarketClock::localNanos() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool MarketClock::due(int64_t local) const noexcept {
+        if (local - lastAttempt_ < RETRY_INTERVAL && lastAttempt_) {
+            return false;
+        }
+        if (!synced()) {
+            return true;
+        }
+        if (local - lastSync_ >= (count_ < MIN_SAMPLES ? FIRST_SYNC_INTERVAL : SYNC_INTERVAL)) {
+            return true;
+        }
+        // the next transition is only known once this one passed
+        return now(local) >= (isOpen_ ? nextClose_ : nextOpen_);
+    }
+
+    void MarketClock::sync(int64_t sent, int64_t received, const Clock& clock) noexcept {
+        auto& sample = samples_[next_];
+        sample.local = sent + (received - sent) / 2;
+        sample.offset = clock.timestamp_ns - sample.local;
+        sample.rtt = received - sent;
+        next_ = (next_ + 1) % MAX_SAMPLES;
+        count_ = std::min(count_ + 1, MAX_SAMPLES);
+
+        isOpen_ = clock.is_open;
+        nextOpen_ = clock.next_open * NANOS;
+        nextClose_ = clock.next_close * NANOS;
+        lastSync_ = lastAttempt_ = received;
+        ++metrics_.syncs;
+        metrics_.lastRtt = sample.rtt;
+        fit();
+    }
+
+    void MarketClock::failed(int64_t local) noexcept {
+        lastAttempt_ = local;
+        ++metrics_.failures;
+    }
+
+    void MarketClock::fit() noexcept {
+        int64_t minRtt = INT64_MAX;
+        for (uint32_t i = 0; i < count_; ++i) {
+            minRtt = std::min(minRtt, samples_[i].rtt);
+        }
+        metrics_.minRtt = minRtt;
+
+        // least squares of offset over local time, relative to the newest good sample
+        const Sample* newest = nullptr;
+        for (uint32_t i = 0; i < count_; ++i) {
+            auto& s = samples_[i];
+            if (s.rtt <= 2 * minRtt + RTT_SLACK && (!newest || s.local > newest->local)) {
+                newest = &s;
+            }
+        }
+        double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+        int64_t oldest = newest->local;
+        for (uint32_t i = 0; i < count_; ++i) {
+            auto& s = samples_[i];
+            if (s.rtt > 2 * minRtt + RTT_SLACK) {
+                continue;
+            }
+            double x = (double)(s.local - newest->local);
+            double y = (double)(s.offset - newest->offset);
+            n += 1;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+            oldest = std::min(oldest, s.local);
+        }
+
+        base_ = newest->local;
+        if (newest->local - oldest >= MIN_DRIFT_SPAN && n * sxx - sx * sx > 0) {
+            drift_ = std::max(-MAX_DRIFT, std::min(MAX_DRIFT, (n * sxy - sx * sy) / (n * sxx - sx * sx)));
+            offset_ = newest->offset + (int64_t)((sy - drift_ * sx) / n);
+        }
+        else {
+            drift_ = 0.;
+            offset_ = newest->offset;
+        }
+    }
+
+    int64_t MarketClock::now(int64_t local) const noexcept {
+        return local + offset_ + (int64_t)(drift_ * (double)(local - base_));
+    }
+
+    bool MarketClock::isOpen(int64_t local) const noexcept {
+        auto server = now(local);
+        if (isOpen_) {
+            return server < nextClose_;
+        }
+        return server >= nextOpen_ && server < nextClose_;
+    }
+
+} // namespace alpaca
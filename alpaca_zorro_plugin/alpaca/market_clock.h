@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include "alpaca/clock.h"
+
+namespace alpaca {
+
+    struct MarketClockMetrics {
+        uint32_t syncs = 0;
+        uint32_t failures = 0;
+        int64_t lastRtt = 0;        // nanoseconds
+        int64_t minRtt = 0;
+    };
+
+    /**
+     * @brief Alpaca's time and market state between /v2/clock requests.
+     *
+     * Every sync is a sample of the server time against the monotonic local clock, taken at the
+     * midpoint of the round trip as NTP does. The offset and drift are fit over the recent samples
+     * whose round trip is close to the shortest, so a slow reply doesn't move the clock. The market
+     * state follows next_open and next_close, a sync is due whenever one of them passed as well as
+     * every SYNC_INTERVAL.
+     */
+    class MarketClock {
+    public:
+        static constexpr int64_t SYNC_INTERVAL = 300ll * 1000000000;
+        static constexpr int64_t FIRST_SYNC_INTERVAL = 10ll * 1000000000;   // until MIN_SAMPLES are taken
+        static constexpr int64_t RETRY_INTERVAL = 1ll * 1000000000;
+        static constexpr uint32_t MIN_SAMPLES = 4;
+        static constexpr uint32_t MAX_SAMPLES = 16;
+
+        /**
+         * @brief Nanoseconds of the monotonic local clock.
+         */
+        static int64_t localNanos() noexcept;
+
+        bool synced() const noexcept { return count_ != 0; }
+
+        /**
+         * @brief The last sync failed, Alpaca is likely unreachable.
+         */
+        bool failing() const noexcept { return lastAttempt_ > lastSync_; }
+
+        bool due(int64_t local) const noexcept;
+
+        /**
+         * @brief Add a /v2/clock reply requested at sent and received at received local time.
+         */
+        void sync(int64_t sent, int64_t received, const Clock& clock) noexcept;
+        void failed(int64_t local) noexcept;
+
+        /**
+         * @brief Server time in nanoseconds since epoch at a local time.
+         */
+        int64_t now(int64_t local) const noexcept;
+        bool isOpen(int64_t local) const noexcept;
+
+        int64_t offset() const noexcept { return offset_; }
+        double drift() const noexcept { return drift_; }
+        const MarketClockMetrics& metrics() const noexcept { return metrics_; }
+
+    private:
+        struct Sample {
+            int64_t local;      // midpoint of the round trip
+            int64_t offset;     // server - local
+            int64_t rtt;
+        };
+
+        void fit() noexcept;
+
+    private:
+        Sample samples_[MAX_SAMPLES];
+        uint32_t count_ = 0;
+        uint32_t next_ = 0;
+
+        int64_t base_ = 0;          // local time the offset is for
+        int64_t offset_ = 0;
+        double drift_ = 0.;         // server nanoseconds gained per local nanosecond
+
+        int64_t lastSync_ = 0;
+        int64_t lastAttempt_ = 0;
+        int64_t nextOpen_ = 0;      // server nanoseconds since epoch
+        int64_t nextClose_ = 0;
+        bool isOpen_ = false;
+        MarketClockMetrics metrics_;
+    };
+
+} // namespace alpaca
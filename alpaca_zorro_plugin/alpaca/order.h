@@ -4,6 +4,8 @@
 #include <cassert>
 #include <unordered_map>
 #include "rapidjson/document.h"
+#include "alpaca/asset.h"
+#include "request.h"
 
 namespace alpaca {
 
@@ -65,7 +67,7 @@ namespace alpaca {
     inline constexpr const char* to_string(OrderType type)
     {
         constexpr const char* sOrderType[] = { "market", "limit", "stop", "stop_limit", "trailing_stop" };
-        assert(type >= OrderType::Market && type <= OrderType::StopLimit);
+        assert(type >= OrderType::Market && type <= OrderType::TrailingStop);
         return sOrderType[type];
     }
 
@@ -151,6 +153,67 @@ namespace alpaca {
         return orderClasses[order_class];
     }
 
+    /**
+     * @brief The status of an order.
+     *
+     * For the meaning of every status, see:
+     * https://alpaca.markets/docs/trading-on-alpaca/orders/#order-lifecycle
+     */
+    enum OrderStatus : uint8_t {
+        New,
+        PartiallyFilled,
+        Filled,
+        DoneForDay,
+        Canceled,
+        Expired,
+        Replaced,
+        PendingCancel,
+        PendingReplace,
+        Accepted,
+        PendingNew,
+        AcceptedForBidding,
+        Stopped,
+        Rejected,
+        Suspended,
+        Calculated,
+        Held,
+    };
+
+    /**
+     * @brief A helper to convert an OrderStatus to a string
+     */
+    inline constexpr const char* to_string(OrderStatus status) {
+        constexpr const char* sOrderStatus[] = { "new", "partially_filled", "filled", "done_for_day", "canceled", "expired", "replaced",
+            "pending_cancel", "pending_replace", "accepted", "pending_new", "accepted_for_bidding", "stopped", "rejected", "suspended",
+            "calculated", "held" };
+        assert(status >= OrderStatus::New && status <= OrderStatus::Held);
+        return sOrderStatus[status];
+    }
+
+    inline OrderStatus to_orderStatus(const std::string& status) {
+        static std::unordered_map<std::string, OrderStatus> orderStatuses = {
+            {"new", OrderStatus::New},
+            {"partially_filled", OrderStatus::PartiallyFilled},
+            {"filled", OrderStatus::Filled},
+            {"done_for_day", OrderStatus::DoneForDay},
+            {"canceled", OrderStatus::Canceled},
+            {"expired", OrderStatus::Expired},
+            {"replaced", OrderStatus::Replaced},
+            {"pending_cancel", OrderStatus::PendingCancel},
+            {"pending_replace", OrderStatus::PendingReplace},
+            {"accepted", OrderStatus::Accepted},
+            {"pending_new", OrderStatus::PendingNew},
+            {"accepted_for_bidding", OrderStatus::AcceptedForBidding},
+            {"stopped", OrderStatus::Stopped},
+            {"rejected", OrderStatus::Rejected},
+            {"suspended", OrderStatus::Suspended},
+            {"calculated", OrderStatus::Calculated},
+            {"held", OrderStatus::Held},
+        };
+        auto it = orderStatuses.find(status);
+        return it != orderStatuses.end() ? it->second : OrderStatus::New;
+    }
+
     /**
      * @brief Additional parameters for take-profit leg of advanced orders
      */
@@ -169,6 +232,29 @@ namespace alpaca {
         std::string limitPrice;
     };
 
+    /**
+     * @brief Additional parameters for trailing stop orders, one of them is required
+     */
+    struct TrailingStopParams {
+        /// The stop follows the high water mark at this distance
+        std::string trailPrice;
+        /// or at this percentage of it
+        std::string trailPercent;
+    };
+
+    /**
+     * @brief A simple order of a batch, see Client::submitOrders
+     */
+    struct OrderRequest {
+        std::string symbol;
+        int quantity = 0;
+        OrderSide side = OrderSide::Buy;
+        OrderType type = OrderType::Market;
+        TimeInForce tif = TimeInForce::Day;
+        std::string limit_price;
+        std::string client_order_id;
+    };
+
     /**
      * @brief A type representing an Alpaca order.
      */
@@ -176,6 +262,8 @@ namespace alpaca {
         double filled_avg_price = 0.;
         double limit_price = 0.;
         double stop_price = 0.;
+        double trail_price = 0.;
+        double trail_percent = 0.;
         uint32_t qty = 0;
         uint32_t filled_qty = 0;
         int32_t internal_id = 0;
@@ -183,6 +271,7 @@ namespace alpaca {
         OrderSide side;
         TimeInForce tif;
         OrderType type;
+        OrderClass order_class = OrderClass::Simple;
         bool extended_hours = false;
         std::vector<Order> legs;
 
@@ -201,31 +290,53 @@ namespace alpaca {
 
     private:
         template<typename> friend class Response;
+        friend class TradeStream;
+        friend struct BulkOrderResult;
 
         template<typename CallerT, typename T>
         std::pair<int, std::string> fromJSON(const T& parser) {
-            parser.get<std::string>("id", id);
-            parser.get<std::string>("client_order_id", client_order_id);
-            parser.get<std::string>("created_at", created_at);
-            parser.get<std::string>("updated_at", updated_at);
-            parser.get<std::string>("submitted_at", submitted_at);
-            parser.get<std::string>("filled_at", filled_at);
-            parser.get<std::string>("expired_at", expired_at);
-            parser.get<std::string>("canceled_at", canceled_at);
-            parser.get<std::string>("failed_at", failed_at);
-            parser.get<std::string>("asset_id", asset_id);
-            parser.get<std::string>("symbol", symbol);
-            asset_class = to_assetClass(parser.get<std::string>("asset_class"));
-            parser.get<uint32_t>("qty", qty);
-            parser.get<uint32_t>("filled_qty", filled_qty);
-            type = to_orderType(parser.get<std::string>("type"));
-            side = to_orderSide(parser.get<std::string>("side"));
-            tif = to_timeInForce(parser.get<std::string>("time_in_force"));
-            parser.get<double>("limit_price", limit_price);
-            parser.get<double>("stop_price", stop_price);
-            parser.get<double>("filled_avg_price", filled_avg_price);
-            parser.get<std::string>("status", status);
-            parser.get<bool>("extended_hours", extended_hours);
+            parser.template get<std::string>("id", id);
+            parser.template get<std::string>("client_order_id", client_order_id);
+            parser.template get<std::string>("created_at", created_at);
+            parser.template get<std::string>("updated_at", updated_at);
+            parser.template get<std::string>("submitted_at", submitted_at);
+            parser.template get<std::string>("filled_at", filled_at);
+            parser.template get<std::string>("expired_at", expired_at);
+            parser.template get<std::string>("canceled_at", canceled_at);
+            parser.template get<std::string>("failed_at", failed_at);
+            parser.template get<std::string>("asset_id", asset_id);
+            parser.template get<std::string>("symbol", symbol);
+            asset_class = to_assetClass(parser.template get<std::string>("asset_class"));
+            parser.template get<uint32_t>("qty", qty);
+            parser.template get<uint32_t>("filled_qty", filled_qty);
+            type = to_orderType(parser.template get<std::string>("type"));
+            side = to_orderSide(parser.template get<std::string>("side"));
+            tif = to_timeInForce(parser.template get<std::string>("time_in_force"));
+            parser.template get<double>("limit_price", limit_price);
+            parser.template get<double>("stop_price", stop_price);
+            parser.template get<double>("trail_price", trail_price);
+            parser.template get<double>("trail_percent", trail_percent);
+            parser.template get<double>("filled_avg_price", filled_avg_price);
+            parser.template get<std::string>("status", status);
+            parser.template get<bool>("extended_hours", extended_hours);
+            std::string orderClass;
+            if (parser.template get<std::string>("order_class", orderClass) && !orderClass.empty()) {
+                order_class = to_orderClass(orderClass);
+            }
+
+            // the take profit and stop loss of bracket, OCO and OTO orders
+            if (parser.json.HasMember("legs") && parser.json["legs"].IsArray()) {
+                for (auto& item : parser.json["legs"].GetArray()) {
+                    if (!item.IsObject()) {
+                        continue;
+                    }
+                    auto legJson = item.GetObject();
+                    Parser<decltype(item.GetObject())> legParser(legJson);
+                    Order leg;
+                    leg.fromJSON<CallerT>(legParser);
+                    legs.emplace_back(std::move(leg));
+                }
+            }
 
             if (client_order_id.substr(0, 6) == "ZORRO_") {
                 auto pos = client_order_id.rfind("_");
@@ -238,4 +349,32 @@ namespace alpaca {
             return std::make_pair(0, "OK");
         }
     };
+
+    /**
+     * @brief One item of a bulk cancel or close, the HTTP status of the order canceled or of the order closing a position.
+     */
+    struct BulkOrderResult {
+        std::string id;         // of the canceled order
+        std::string symbol;     // of the closed position
+        int status = 0;
+        Order order;            // the canceled or the closing order, empty on an error
+
+        bool ok() const noexcept { return status >= 200 && status < 300; }
+
+    private:
+        template<typename> friend class Response;
+
+        template<typename CallerT, typename T>
+        std::pair<int, std::string> fromJSON(const T& parser) {
+            parser.template get<std::string>("id", id);
+            parser.template get<std::string>("symbol", symbol);
+            parser.template get<int>("status", status);
+            if (parser.json.HasMember("body") && parser.json["body"].IsObject() && parser.json["body"].HasMember("id")) {
+                auto bodyJson = parser.json["body"].GetObject();
+                Parser<decltype(parser.json["body"].GetObject())> bodyParser(bodyJson);
+                order.fromJSON<CallerT>(bodyParser);
+            }
+            return std::make_pair(0, "OK");
+        }
+    };
 } // namespace alpaca
\ No newline at end of file
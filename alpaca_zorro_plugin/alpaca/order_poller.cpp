@@ -0,0 +1,75 @@
+#include "stdafx.h"
+#include "alpaca/order_poller.h"
+
+#include "alpaca/client.h"
+#include "alpaca/order_updates.h"
+#include "logger.h"
+
+namespace alpaca {
+
+    bool OrderPoller::get(const std::string& id, Order& order) {
+        auto now = Clock::now();
+        if (now - polled_ >= interval_) {
+            refresh();
+        }
+        auto it = orders_.find(id);
+        if (it == orders_.end() || now - it->second.fetched >= interval_) {
+            ++metrics_.misses;
+            return false;
+        }
+        ++metrics_.hits;
+        order = it->second.order;
+        return true;
+    }
+
+    void OrderPoller::put(const Order& order) {
+        if (isFinal(order.status)) {
+            orders_.erase(order.id);
+            return;
+        }
+        auto& entry = orders_[order.id];
+        entry.order = order;
+        entry.fetched = Clock::now();
+    }
+
+    bool OrderPoller::refresh() {
+        auto start = Clock::now();
+        // a failed poll isn't retried by every lookup, they fall back to REST until the next interval
+        polled_ = start;
+        ++metrics_.polls;
+
+        std::string after;
+        for (;;) {
+            auto response = client_.getOrders(ActionStatus::Open, PAGE_SIZE, after, "", OrderDirection::Ascending);
+            ++metrics_.pages;
+            if (!response) {
+                logger_.logWarning("Failed to poll open orders. %s\n", response.what().c_str());
+                return false;
+            }
+            auto& orders = response.content();
+            if (!orders.empty()) {
+                after = orders.back().submitted_at;
+            }
+            for (auto& order : orders) {
+                auto& entry = orders_[order.id];
+                entry.order = std::move(order);
+                entry.fetched = start;
+            }
+            if (orders.size() < PAGE_SIZE) {
+                break;
+            }
+        }
+
+        // open before but not any more, unless put in after the poll was sent
+        for (auto it = orders_.begin(); it != orders_.end();) {
+            if (it->second.fetched < start) {
+                it = orders_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        return true;
+    }
+
+} // namespace alpaca
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "alpaca/order.h"
+
+namespace alpaca {
+
+    class Client;
+    class Logger;
+
+    struct OrderPollerMetrics {
+        uint64_t polls = 0;         // snapshots taken
+        uint64_t pages = 0;         // requests the snapshots took
+        uint64_t hits = 0;          // lookups answered from the snapshot
+        uint64_t misses = 0;        // lookups left to a request of their own
+    };
+
+    /**
+     * @brief A snapshot of all open orders, taken with one paginated request per interval.
+     *
+     * Zorro asks for every open trade in each loop, the first lookup after the interval refreshes
+     * the snapshot and the others are answered from it. An order that was open and is missing from
+     * the new snapshot got final in between, it has to be read once on its own. Orders the plugin
+     * submitted, replaced or read itself are put in with their time, so they count as fresh even if
+     * the last snapshot was taken before them.
+     */
+    class OrderPoller {
+    public:
+        static constexpr uint32_t PAGE_SIZE = 500;   // the maximum Alpaca returns at once
+
+        OrderPoller(const Client& client, Logger& logger, uint32_t intervalMs = 1000)
+            : client_(client), logger_(logger), interval_(intervalMs) {}
+
+        /**
+         * @brief Copy the state of an open order, refreshing the snapshot first if it is too old.
+         * @return false if the order isn't open as of the snapshot, it has to be read from REST.
+         */
+        bool get(const std::string& id, Order& order);
+
+        /**
+         * @brief Keep an order read or returned by a request, a final one is dropped.
+         */
+        void put(const Order& order);
+
+        /**
+         * @brief Forget an order whose state is about to change, e.g. on cancel.
+         */
+        void invalidate(const std::string& id) { orders_.erase(id); }
+
+        /**
+         * @brief Take a new snapshot at the next lookup.
+         */
+        void expire() noexcept { polled_ = Clock::time_point(); }
+
+        /**
+         * @brief Take a new snapshot now.
+         * @return false if the open orders can't be read.
+         */
+        bool refresh();
+
+        /**
+         * @brief Call f with every order open as of the snapshot.
+         */
+        template<typename F>
+        void forEach(F f) const {
+            for (auto& entry : orders_) {
+                f(entry.second.order);
+            }
+        }
+
+        size_t size() const noexcept { return orders_.size(); }
+        const OrderPollerMetrics& metrics() const noexcept { return metrics_; }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry {
+            Order order;
+            Clock::time_point fetched;
+        };
+
+    private:
+        const Client& client_;
+        Logger& logger_;
+        std::chrono::milliseconds interval_;
+        Clock::time_point polled_;
+        std::unordered_map<std::string, Entry> orders_;
+        OrderPollerMetrics metrics_;
+    };
+
+} // namespace alpaca
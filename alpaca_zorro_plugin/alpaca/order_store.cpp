@@ -0,0 +1,344 @@
+#include "stdafx.h"
+#include "alpaca/order_store.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "alpaca/clock.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr uint32_t MIN_SLOTS = 64;
+
+        uint32_t mix(uint32_t h) noexcept {
+            // the murmur3 finalizer, trade ids are dense and would cluster otherwise
+            h ^= h >> 16;
+            h *= 0x85ebca6b;
+            h ^= h >> 13;
+            h *= 0xc2b2ae35;
+            h ^= h >> 16;
+            return h;
+        }
+
+        uint32_t hashInternalId(int32_t id) noexcept {
+            return mix((uint32_t)id);
+        }
+
+        uint32_t hashUuid(const uint8_t* uuid) noexcept {
+            uint32_t a, b;
+            memcpy(&a, uuid, 4);
+            memcpy(&b, uuid + 12, 4);
+            return mix(a ^ b);
+        }
+
+        int hexValue(char c) noexcept {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        /**
+         * @return false if id isn't a UUID, uuid is all zeros then
+         */
+        bool parseUuid(const std::string& id, uint8_t* uuid) noexcept {
+            memset(uuid, 0, 16);
+            uint32_t nibbles = 0;
+            for (auto c : id) {
+                if (c == '-') {
+                    continue;
+                }
+                auto v = hexValue(c);
+                if (v < 0 || nibbles == 32) {
+                    memset(uuid, 0, 16);
+                    return false;
+                }
+                uuid[nibbles / 2] |= (uint8_t)(nibbles % 2 ? v : v << 4);
+                ++nibbles;
+            }
+            return nibbles == 32;
+        }
+
+        int64_t nowNanos() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    template<typename Equal>
+    uint32_t OrderStore::probe(const std::vector<uint32_t>& table, uint32_t hash, Equal equal) const noexcept {
+        auto mask = (uint32_t)table.size() - 1;
+        auto i = hash & mask;
+        for (; table[i]; i = (i + 1) & mask) {
+            if (equal(records_[table[i] - 1])) {
+                break;
+            }
+        }
+        return i;
+    }
+
+    void OrderStore::insertIndex(std::vector<uint32_t>& table, uint32_t hash, uint32_t index) noexcept {
+        auto mask = (uint32_t)table.size() - 1;
+        auto i = hash & mask;
+        while (table[i]) {
+            i = (i + 1) & mask;
+        }
+        table[i] = index + 1;
+    }
+
+    void OrderStore::eraseSlot(std::vector<uint32_t>& table, uint32_t slot, bool byId) noexcept {
+        auto mask = (uint32_t)table.size() - 1;
+        auto i = slot;
+        table[i] = 0;
+        for (auto j = (i + 1) & mask; table[j]; j = (j + 1) & mask) {
+            auto& record = records_[table[j] - 1];
+            auto home = (byId ? hashUuid(record.uuid) : hashInternalId(record.internalId)) & mask;
+            // an entry stays unless the hole lies between its home slot and it
+            bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+            if (!stays) {
+                table[i] = table[j];
+                table[j] = 0;
+                i = j;
+            }
+        }
+    }
+
+    void OrderStore::grow() {
+        auto slots = std::max<size_t>(byInternalId_.size() * 2, MIN_SLOTS);
+        byInternalId_.assign(slots, 0);
+        byId_.assign(slots, 0);
+        for (uint32_t i = 0; i < records_.size(); ++i) {
+            if (records_[i].internalId) {
+                insertIndex(byInternalId_, hashInternalId(records_[i].internalId), i);
+                insertIndex(byId_, hashUuid(records_[i].uuid), i);
+            }
+        }
+    }
+
+    uint32_t OrderStore::intern(const std::string& s) {
+        auto it = stringIds_.find(s);
+        if (it != stringIds_.end()) {
+            return it->second;
+        }
+        auto id = (uint32_t)strings_.size();
+        strings_.push_back(s);
+        symbolHeads_.push_back(0);
+        stringIds_.emplace(s, id);
+        return id;
+    }
+
+    void OrderStore::link(uint32_t index) {
+        auto& record = records_[index];
+        auto& head = symbolHeads_[record.symbol];
+        record.prevOfSymbol = 0;
+        record.nextOfSymbol = head;
+        if (head) {
+            records_[head - 1].prevOfSymbol = index + 1;
+        }
+        head = index + 1;
+    }
+
+    void OrderStore::unlink(uint32_t index) {
+        auto& record = records_[index];
+        if (record.prevOfSymbol) {
+            records_[record.prevOfSymbol - 1].nextOfSymbol = record.nextOfSymbol;
+        }
+        else {
+            symbolHeads_[record.symbol] = record.nextOfSymbol;
+        }
+        if (record.nextOfSymbol) {
+            records_[record.nextOfSymbol - 1].prevOfSymbol = record.prevOfSymbol;
+        }
+    }
+
+    const OrderRecord* OrderStore::put(const Order& order) {
+        if (!order.internal_id) {
+            return nullptr;
+        }
+        auto updated = parseNanos(order.updated_at.c_str(), order.updated_at.size());
+        if (!updated) {
+            updated = nowNanos();
+        }
+        uint8_t uuid[16];
+        parseUuid(order.id, uuid);
+
+        auto internalId = order.internal_id;
+        uint32_t index;
+        if (!byInternalId_.empty()) {
+            auto slot = probe(byInternalId_, hashInternalId(internalId), [internalId](const OrderRecord& r) { return r.internalId == internalId; });
+            if (byInternalId_[slot]) {
+                index = byInternalId_[slot] - 1;
+                auto& record = records_[index];
+                if (updated < record.updated) {
+                    return &record;
+                }
+                if (memcmp(record.uuid, uuid, 16) != 0) {
+                    auto idSlot = probe(byId_, hashUuid(record.uuid), [&record](const OrderRecord& r) { return &r == &record; });
+                    eraseSlot(byId_, idSlot, true);
+                    memcpy(record.uuid, uuid, 16);
+                    insertIndex(byId_, hashUuid(uuid), index);
+                }
+                record.qty = order.qty;
+                record.filledQty = order.filled_qty;
+                record.filledAvgPrice = order.filled_avg_price;
+                record.limitPrice = order.limit_price;
+                record.stopPrice = order.stop_price;
+                record.updated = updated;
+                record.status = to_orderStatus(order.status);
+                return &record;
+            }
+        }
+
+        // at most half of the slots are used
+        if ((size_ + 1) * 2 > byInternalId_.size()) {
+            grow();
+        }
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        }
+        else {
+            index = (uint32_t)records_.size();
+            records_.emplace_back();
+        }
+
+        auto& record = records_[index];
+        memcpy(record.uuid, uuid, 16);
+        record.internalId = internalId;
+        record.symbol = intern(order.symbol);
+        auto pos = order.client_order_id.rfind('_');
+        record.prefix = intern(pos == std::string::npos ? std::string() : order.client_order_id.substr(0, pos));
+        record.qty = order.qty;
+        record.filledQty = order.filled_qty;
+        record.filledAvgPrice = order.filled_avg_price;
+        record.limitPrice = order.limit_price;
+        record.stopPrice = order.stop_price;
+        record.updated = updated;
+        record.side = order.side;
+        record.tif = order.tif;
+        record.type = order.type;
+        record.status = to_orderStatus(order.status);
+        link(index);
+        insertIndex(byInternalId_, hashInternalId(internalId), index);
+        insertIndex(byId_, hashUuid(uuid), index);
+        ++size_;
+        return &record;
+    }
+
+    const OrderRecord* OrderStore::find(int32_t internalId) const noexcept {
+        if (!internalId || byInternalId_.empty()) {
+            return nullptr;
+        }
+        auto slot = probe(byInternalId_, hashInternalId(internalId), [internalId](const OrderRecord& r) { return r.internalId == internalId; });
+        return byInternalId_[slot] ? &records_[byInternalId_[slot] - 1] : nullptr;
+    }
+
+    const OrderRecord* OrderStore::findById(const std::string& id) const noexcept {
+        uint8_t uuid[16];
+        if (!parseUuid(id, uuid) || byId_.empty()) {
+            return nullptr;
+        }
+        auto slot = probe(byId_, hashUuid(uuid), [&uuid](const OrderRecord& r) { return memcmp(r.uuid, uuid, 16) == 0; });
+        return byId_[slot] ? &records_[byId_[slot] - 1] : nullptr;
+    }
+
+    void OrderStore::markClosed(int32_t internalId) noexcept {
+        auto* record = find(internalId);
+        if (record) {
+            const_cast<OrderRecord*>(record)->closed = true;
+        }
+    }
+
+    void OrderStore::markPendingCancel(int32_t internalId) noexcept {
+        auto* record = find(internalId);
+        if (record && !record->isFinal()) {
+            const_cast<OrderRecord*>(record)->status = OrderStatus::PendingCancel;
+        }
+    }
+
+    void OrderStore::clearPendingCancel(int32_t internalId) noexcept {
+        auto* record = find(internalId);
+        if (record && record->status == OrderStatus::PendingCancel) {
+            const_cast<OrderRecord*>(record)->status = record->filledQty ? OrderStatus::PartiallyFilled : OrderStatus::New;
+        }
+    }
+
+    std::string OrderStore::idOf(const OrderRecord& record) const {
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string id;
+        id.reserve(36);
+        for (int i = 0; i < 16; ++i) {
+            if (i == 4 || i == 6 || i == 8 || i == 10) {
+                id += '-';
+            }
+            id += digits[record.uuid[i] >> 4];
+            id += digits[record.uuid[i] & 15];
+        }
+        return id;
+    }
+
+    std::string OrderStore::clientOrderIdOf(const OrderRecord& record) const {
+        auto& prefix = strings_[record.prefix];
+        return prefix.empty() ? std::to_string(record.internalId) : prefix + "_" + std::to_string(record.internalId);
+    }
+
+    size_t OrderStore::evict(int64_t now) {
+        auto before = now - (int64_t)maxAgeSeconds_ * 1000000000ll;
+        std::vector<uint32_t> evicted;
+        for (uint32_t i = 0; i < records_.size(); ++i) {
+            auto& record = records_[i];
+            if (record.internalId && record.isFinal() && (!record.filledQty || record.closed) && record.updated < before) {
+                evicted.push_back(i);
+            }
+        }
+        if (evicted.empty()) {
+            return 0;
+        }
+        if (!spillPath_.empty()) {
+            spill(evicted);
+        }
+
+        for (auto i : evicted) {
+            auto& record = records_[i];
+            auto internalId = record.internalId;
+            eraseSlot(byInternalId_, probe(byInternalId_, hashInternalId(internalId), [internalId](const OrderRecord& r) { return r.internalId == internalId; }), false);
+            eraseSlot(byId_, probe(byId_, hashUuid(record.uuid), [&record](const OrderRecord& r) { return &r == &record; }), true);
+            unlink(i);
+            record = OrderRecord();
+            free_.push_back(i);
+        }
+        size_ -= evicted.size();
+        return evicted.size();
+    }
+
+    bool OrderStore::spill(const std::vector<uint32_t>& indexes) const {
+        FILE* f;
+        if (fopen_s(&f, spillPath_.c_str(), "a")) {
+            return false;
+        }
+        fseek(f, 0, SEEK_END);
+        if (ftell(f) == 0) {
+            fprintf(f, "id,client_order_id,symbol,side,type,time_in_force,qty,filled_qty,filled_avg_price,limit_price,stop_price,status,updated_ns\n");
+        }
+        for (auto i : indexes) {
+            auto& record = records_[i];
+            fprintf(f, "%s,%s,%s,%s,%s,%s,%u,%u,%.6f,%.6f,%.6f,%s,%lld\n",
+                idOf(record).c_str(), clientOrderIdOf(record).c_str(), symbolOf(record).c_str(),
+                to_string(record.side), to_string(record.type), to_string(record.tif),
+                record.qty, record.filledQty, record.filledAvgPrice, record.limitPrice, record.stopPrice,
+                to_string(record.status), (long long)record.updated);
+        }
+        return fclose(f) == 0;
+    }
+
+    size_t OrderStore::memoryUsage() const noexcept {
+        auto bytes = records_.capacity() * sizeof(OrderRecord) + (byInternalId_.capacity() + byId_.capacity() + free_.capacity() + symbolHeads_.capacity()) * sizeof(uint32_t);
+        for (auto& s : strings_) {
+            // the copy in stringIds_ and its node
+            bytes += 2 * (sizeof(std::string) + s.capacity()) + 2 * sizeof(void*) + sizeof(uint32_t);
+        }
+        return bytes;
+    }
+
+} // namespace alpaca
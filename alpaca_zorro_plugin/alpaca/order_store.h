@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "alpaca/order.h"
+
+namespace alpaca {
+
+    /**
+     * @brief The part of an order the plugin works with, without any heap allocation.
+     */
+    struct OrderRecord {
+        uint8_t uuid[16];           // the Alpaca order id
+        int32_t internalId = 0;     // the Zorro trade id, 0 for a free record
+        uint32_t symbol = 0;        // into the string table
+        uint32_t prefix = 0;        // the client order id before "_<internalId>", into the string table
+        uint32_t qty = 0;
+        uint32_t filledQty = 0;
+        double filledAvgPrice = 0.;
+        double limitPrice = 0.;
+        double stopPrice = 0.;
+        int64_t updated = 0;        // nanoseconds since epoch of the order's updated_at
+        uint32_t nextOfSymbol = 0;  // record index + 1, 0 ends the list
+        uint32_t prevOfSymbol = 0;
+        OrderSide side = OrderSide::Buy;
+        TimeInForce tif = TimeInForce::Day;
+        OrderType type = OrderType::Market;
+        OrderStatus status = OrderStatus::New;
+        bool closed = false;        // the position it opened was closed by the plugin
+
+        bool isFinal() const noexcept {
+            return status == OrderStatus::Filled || status == OrderStatus::Canceled || status == OrderStatus::Expired ||
+                status == OrderStatus::Rejected || status == OrderStatus::Replaced || status == OrderStatus::DoneForDay;
+        }
+    };
+
+    /**
+     * @brief The orders of the session, by Zorro trade id, by Alpaca order id and by symbol.
+     *
+     * Records are kept in one array and indexed by two open addressing tables of record indexes
+     * with linear probing, the orders of a symbol are linked through their records. Symbols and
+     * client order id prefixes are stored once in a string table. Orders that are final for longer
+     * than the maximum age are evicted, and appended to a CSV file first if one is set. A filled
+     * order stays until it is marked closed, Zorro may still close its trade.
+     *
+     * Pointers to records are valid until the next put() or evict().
+     */
+    class OrderStore {
+    public:
+        explicit OrderStore(uint32_t maxAgeSeconds = 24 * 60 * 60) : maxAgeSeconds_(maxAgeSeconds) {}
+
+        /**
+         * @brief Insert or update an order of the plugin, a state older than the stored one is ignored.
+         * @return nullptr for an order without Zorro trade id.
+         */
+        const OrderRecord* put(const Order& order);
+
+        const OrderRecord* find(int32_t internalId) const noexcept;
+        const OrderRecord* findById(const std::string& id) const noexcept;
+
+        /**
+         * @brief Call f with every order of a symbol, newest first.
+         */
+        template<typename F>
+        void forEachOfSymbol(const std::string& symbol, F f) const {
+            auto it = stringIds_.find(symbol);
+            if (it == stringIds_.end()) {
+                return;
+            }
+            for (auto i = symbolHeads_[it->second]; i; i = records_[i - 1].nextOfSymbol) {
+                f(records_[i - 1]);
+            }
+        }
+
+        /**
+         * @brief The trade of an order was closed, a filled order can be evicted from now on.
+         */
+        void markClosed(int32_t internalId) noexcept;
+
+        /**
+         * @brief A cancel of an open order was sent, the next state read of it replaces this one.
+         */
+        void markPendingCancel(int32_t internalId) noexcept;
+
+        /**
+         * @brief The cancel was not confirmed and the order can't be read, it counts as open again so the cancel can be sent again.
+         */
+        void clearPendingCancel(int32_t internalId) noexcept;
+
+        std::string idOf(const OrderRecord& record) const;
+        const std::string& symbolOf(const OrderRecord& record) const noexcept { return strings_[record.symbol]; }
+        std::string clientOrderIdOf(const OrderRecord& record) const;
+
+        /**
+         * @brief Drop the orders that are final since before now - maximum age, filled ones only once closed.
+         * @return the number of orders evicted
+         */
+        size_t evict(int64_t nowNanos);
+
+        void setMaxAge(uint32_t seconds) noexcept { maxAgeSeconds_ = seconds; }
+        uint32_t maxAge() const noexcept { return maxAgeSeconds_; }
+
+        /**
+         * @brief Append evicted orders to a CSV file, empty to just drop them.
+         */
+        void setSpillFile(std::string path) { spillPath_ = std::move(path); }
+
+        size_t size() const noexcept { return size_; }
+
+        /**
+         * @brief Bytes held by the records, the tables and the string table.
+         */
+        size_t memoryUsage() const noexcept;
+
+    private:
+        uint32_t intern(const std::string& s);
+        void link(uint32_t index);
+        void unlink(uint32_t index);
+
+        /**
+         * @brief The slot of a key in a table, or of the empty slot it would go to.
+         */
+        template<typename Equal>
+        uint32_t probe(const std::vector<uint32_t>& table, uint32_t hash, Equal equal) const noexcept;
+
+        void insertIndex(std::vector<uint32_t>& table, uint32_t hash, uint32_t index) noexcept;
+
+        /**
+         * @brief Remove a slot with backward shift, so no tombstones are needed.
+         */
+        void eraseSlot(std::vector<uint32_t>& table, uint32_t slot, bool byId) noexcept;
+
+        void grow();
+        bool spill(const std::vector<uint32_t>& indexes) const;
+
+    private:
+        std::vector<OrderRecord> records_;
+        std::vector<uint32_t> free_;            // indexes of free records
+        std::vector<uint32_t> byInternalId_;    // record index + 1, 0 for an empty slot
+        std::vector<uint32_t> byId_;
+        size_t size_ = 0;
+
+        std::vector<std::string> strings_;
+        std::unordered_map<std::string, uint32_t> stringIds_;
+        std::vector<uint32_t> symbolHeads_;     // per string id, record index + 1 of the newest order of the symbol
+
+        uint32_t maxAgeSeconds_;
+        std::string spillPath_;
+    };
+
+} // namespace alpaca
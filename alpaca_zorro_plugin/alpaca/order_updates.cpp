@@ -0,0 +1,143 @@
+#include "stdafx.h"
+#include "alpaca/order_updates.h"
+
+#include <algorithm>
+#include <chrono>
+#include "alpaca/clock.h"
+
+namespace alpaca {
+
+    namespace {
+        int64_t updatedAt(const Order& order) noexcept {
+            return parseNanos(order.updated_at.c_str(), order.updated_at.size());
+        }
+    }
+
+    void OrderUpdates::store(const Order& order, uint32_t epoch) {
+        auto updated = updatedAt(order);
+        auto& entry = orders_[order.id];
+        if (entry.epoch == epoch && updated < entry.updated) {
+            // a REST reply that was overtaken by the stream
+            return;
+        }
+        entry.order = order;
+        entry.updated = updated;
+        entry.epoch = epoch;
+    }
+
+    void OrderUpdates::apply(const std::string& event, const Order& order, int64_t eventTime) {
+        auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++metrics_.events;
+            if (event == "fill" || event == "partial_fill") {
+                ++metrics_.fills;
+                if (std::find(filledSymbols_.begin(), filledSymbols_.end(), order.symbol) == filledSymbols_.end()) {
+                    filledSymbols_.push_back(order.symbol);
+                }
+            }
+            store(order, epoch_);
+            if (eventTime) {
+                latency_.add((uint32_t)std::max<int64_t>((now - eventTime) / 1000000, 0));
+            }
+        }
+        changed_.notify_all();
+    }
+
+    void OrderUpdates::connected() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++epoch_;
+            ++metrics_.connects;
+            live_ = true;
+        }
+        changed_.notify_all();
+    }
+
+    void OrderUpdates::disconnected() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            live_ = false;
+        }
+        // waiters fall back to REST
+        changed_.notify_all();
+    }
+
+    bool OrderUpdates::live() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return live_;
+    }
+
+    uint32_t OrderUpdates::epoch() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return epoch_;
+    }
+
+    void OrderUpdates::seed(const Order& order, uint32_t epoch) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (live_ && epoch == epoch_) {
+            store(order, epoch);
+        }
+    }
+
+    bool OrderUpdates::get(const std::string& id, Order& order) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = orders_.find(id);
+        if (it == orders_.end() || !isCurrent(it->second)) {
+            ++metrics_.restReads;
+            return false;
+        }
+        ++metrics_.localReads;
+        order = it->second.order;
+        return true;
+    }
+
+    bool OrderUpdates::wait(const std::string& id, uint32_t timeoutMs, Order& order) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // a new order is current once the stream pushed its "new" event
+        changed_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, &id]() {
+            if (!live_) {
+                return true;
+            }
+            auto it = orders_.find(id);
+            return it != orders_.end() && isCurrent(it->second) && isFinal(it->second.order.status);
+        });
+        auto it = orders_.find(id);
+        if (it == orders_.end() || !isCurrent(it->second)) {
+            ++metrics_.restReads;
+            return false;
+        }
+        ++metrics_.localReads;
+        order = it->second.order;
+        return true;
+    }
+
+    void OrderUpdates::takeFilledSymbols(std::vector<std::string>& symbols) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        symbols.insert(symbols.end(), filledSymbols_.begin(), filledSymbols_.end());
+        filledSymbols_.clear();
+    }
+
+    void OrderUpdates::evict(int64_t before) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = orders_.begin(); it != orders_.end();) {
+            if (it->second.updated < before && isFinal(it->second.order.status)) {
+                it = orders_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    OrderUpdateMetrics OrderUpdates::metrics() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return metrics_;
+    }
+
+    LatencyTracker OrderUpdates::latency() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return latency_;
+    }
+
+} // namespace alpaca
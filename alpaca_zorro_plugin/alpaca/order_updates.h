@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "alpaca/order.h"
+#include "market_data/latency_tracker.h"
+
+namespace alpaca {
+
+    /**
+     * @brief An order in this status doesn't change any more.
+     */
+    inline bool isFinal(const std::string& status) noexcept {
+        return status == "filled" || status == "canceled" || status == "expired" || status == "rejected" ||
+            status == "replaced" || status == "done_for_day";
+    }
+
+    struct OrderUpdateMetrics {
+        uint64_t events = 0;
+        uint64_t fills = 0;         // fill and partial_fill events
+        uint32_t connects = 0;
+        uint64_t localReads = 0;    // order lookups answered without a request
+        uint64_t restReads = 0;     // lookups that had to fall back to REST
+    };
+
+    /**
+     * @brief The latest state of every order as pushed by the trade_updates stream.
+     *
+     * An order is current while the stream has stayed connected since its last update, every
+     * (re)connect starts a new epoch and leaves the orders of the earlier ones to be read from
+     * REST again. A REST copy taken during the epoch makes an order current as well, so an order
+     * costs at most one request per connection. Updates come from the stream thread, lookups from
+     * Zorro's.
+     */
+    class OrderUpdates {
+    public:
+        /**
+         * @brief Apply an order pushed by the stream.
+         * @param eventTime nanoseconds since epoch of the event at Alpaca, 0 if unknown
+         */
+        void apply(const std::string& event, const Order& order, int64_t eventTime);
+
+        /**
+         * @brief The stream (re)connected, updates before it may be missing.
+         */
+        void connected();
+        void disconnected();
+
+        bool live() const;
+
+        /**
+         * @brief Take the epoch before sending a REST request whose reply is passed to seed().
+         */
+        uint32_t epoch() const;
+
+        /**
+         * @brief Keep a REST copy of an order, unless the stream reconnected since epoch or already has a newer one.
+         */
+        void seed(const Order& order, uint32_t epoch);
+
+        /**
+         * @brief Copy the current state of an order.
+         * @return false if the order isn't current, it has to be read from REST.
+         */
+        bool get(const std::string& id, Order& order);
+
+        /**
+         * @brief Wait up to timeoutMs for an order to reach a final status, e.g. the fill of an
+         * IOC order or the confirmation of a cancel.
+         * @return false if the order isn't current by then, order holds the latest state otherwise
+         * whether final or not.
+         */
+        bool wait(const std::string& id, uint32_t timeoutMs, Order& order);
+
+        /**
+         * @brief Move out the symbols that had fills since the last call.
+         */
+        void takeFilledSymbols(std::vector<std::string>& symbols);
+
+        /**
+         * @brief Forget the orders that are final and were last updated before the given time.
+         */
+        void evict(int64_t beforeNanos);
+
+        OrderUpdateMetrics metrics() const;
+
+        /**
+         * @brief Milliseconds from the event at Alpaca until its order was visible here, including clock skew.
+         */
+        LatencyTracker latency() const;
+
+    private:
+        struct Entry {
+            Order order;
+            int64_t updated = 0;    // nanoseconds since epoch of the order's updated_at
+            uint32_t epoch = 0;
+        };
+
+        /**
+         * @brief Store an order unless the entry already holds a newer state.
+         */
+        void store(const Order& order, uint32_t epoch);
+
+        bool isCurrent(const Entry& entry) const noexcept { return live_ && entry.epoch == epoch_; }
+
+    private:
+        mutable std::mutex mutex_;
+        std::condition_variable changed_;
+        std::unordered_map<std::string, Entry> orders_;
+        std::vector<std::string> filledSymbols_;
+        uint32_t epoch_ = 0;
+        bool live_ = false;
+        OrderUpdateMetrics metrics_;
+        LatencyTracker latency_;
+    };
+
+} // namespace alpaca
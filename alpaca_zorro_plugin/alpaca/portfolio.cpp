@@ -0,0 +1,80 @@
+#include "stdafx.h"
+#include "alpaca/portfolio.h"
+
+#include "alpaca/client.h"
+#include "logger.h"
+
+namespace alpaca {
+
+    const Account* Portfolio::account(bool stale) {
+        auto start = Clock::now();
+        ++metrics_.accountReads;
+        bool hit = hasAccount_ && (stale || !accountInvalid_) && start - accountFetched_ < accountTtl_;
+        if (!hit && !refreshAccount()) {
+            return nullptr;
+        }
+        count(start, hit);
+        return &account_;
+    }
+
+    bool Portfolio::position(const std::string& symbol, int32_t& qty, bool stale) {
+        auto start = Clock::now();
+        ++metrics_.positionReads;
+        bool hit = hasPositions_ && (stale || !positionsInvalid_) && start - positionsFetched_ < positionTtl_;
+        if (!hit && !refreshPositions()) {
+            return false;
+        }
+        count(start, hit);
+        auto it = positions_.find(symbol);
+        qty = it != positions_.end() ? it->second : 0;
+        return true;
+    }
+
+    void Portfolio::invalidate() noexcept {
+        if ((hasAccount_ && !accountInvalid_) || (hasPositions_ && !positionsInvalid_)) {
+            ++metrics_.invalidations;
+        }
+        // the snapshots are kept for stale reads
+        accountInvalid_ = true;
+        positionsInvalid_ = true;
+    }
+
+    bool Portfolio::refreshAccount() {
+        auto fetched = Clock::now();
+        ++metrics_.accountRequests;
+        auto response = client_.getAccount();
+        if (!response) {
+            logger_.logWarning("Failed to get the account. %s\n", response.what().c_str());
+            return false;
+        }
+        account_ = std::move(response.content());
+        accountFetched_ = fetched;
+        hasAccount_ = true;
+        accountInvalid_ = false;
+        return true;
+    }
+
+    bool Portfolio::refreshPositions() {
+        auto fetched = Clock::now();
+        ++metrics_.positionRequests;
+        auto response = client_.getPositions();
+        if (!response) {
+            logger_.logWarning("Failed to get the positions. %s\n", response.what().c_str());
+            return false;
+        }
+        positions_.clear();
+        for (auto& position : response.content()) {
+            positions_[position.symbol] = (int32_t)position.qty * (position.side == PositionSide::Long ? 1 : -1);
+        }
+        positionsFetched_ = fetched;
+        hasPositions_ = true;
+        positionsInvalid_ = false;
+        return true;
+    }
+
+    void Portfolio::count(Clock::time_point start, bool hit) noexcept {
+        auto nanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        (hit ? metrics_.hitNanos : metrics_.missNanos) += nanos;
+    }
+
+} // namespace alpaca
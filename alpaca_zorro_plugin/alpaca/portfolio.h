@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "alpaca/account.h"
+
+namespace alpaca {
+
+    class Client;
+    class Logger;
+
+    struct PortfolioMetrics {
+        uint64_t accountReads = 0;
+        uint64_t accountRequests = 0;
+        uint64_t positionReads = 0;
+        uint64_t positionRequests = 0;  // each one for all positions
+        uint64_t invalidations = 0;
+        uint64_t hitNanos = 0;          // time spent in reads answered from memory
+        uint64_t missNanos = 0;         // and in reads that sent a request
+    };
+
+    /**
+     * @brief The account and all positions, each read with one request and kept for a ttl.
+     *
+     * Positions come from /v2/positions at once, a symbol missing from it has no position. A fill
+     * of the plugin's orders or one pushed by the trade stream invalidates both snapshots right
+     * away, the ttl only bounds how late a change made elsewhere, or a price move in the account
+     * values, shows up. Used from Zorro's thread only.
+     */
+    class Portfolio {
+    public:
+        Portfolio(const Client& client, Logger& logger, uint32_t accountTtlMs = 5000, uint32_t positionTtlMs = 10000)
+            : client_(client), logger_(logger), accountTtl_(accountTtlMs), positionTtl_(positionTtlMs) {}
+
+        /**
+         * @param stale answer from the last snapshot within the ttl even if it was invalidated since
+         * @return nullptr if the account can't be read.
+         */
+        const Account* account(bool stale = false);
+
+        /**
+         * @brief The signed quantity held of a symbol, 0 without a position.
+         * @param stale answer from the last snapshot within the ttl even if it was invalidated since
+         * @return false if the positions can't be read.
+         */
+        bool position(const std::string& symbol, int32_t& qty, bool stale = false);
+
+        /**
+         * @brief The next read asks again, e.g. after a fill, unless it takes a stale snapshot.
+         */
+        void invalidate() noexcept;
+
+        void setTtl(uint32_t accountMs, uint32_t positionMs) noexcept {
+            accountTtl_ = std::chrono::milliseconds(accountMs);
+            positionTtl_ = std::chrono::milliseconds(positionMs);
+        }
+        uint32_t accountTtl() const noexcept { return (uint32_t)accountTtl_.count(); }
+        uint32_t positionTtl() const noexcept { return (uint32_t)positionTtl_.count(); }
+
+        const PortfolioMetrics& metrics() const noexcept { return metrics_; }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        bool refreshAccount();
+        bool refreshPositions();
+        void count(Clock::time_point start, bool hit) noexcept;
+
+    private:
+        const Client& client_;
+        Logger& logger_;
+        std::chrono::milliseconds accountTtl_;
+        std::chrono::milliseconds positionTtl_;
+
+        Account account_;
+        Clock::time_point accountFetched_;
+        bool hasAccount_ = false;
+        bool accountInvalid_ = false;
+
+        std::unordered_map<std::string, int32_t> positions_;
+        Clock::time_point positionsFetched_;
+        bool hasPositions_ = false;
+        bool positionsInvalid_ = false;
+
+        PortfolioMetrics metrics_;
+    };
+
+} // namespace alpaca
@@ -47,22 +47,22 @@ namespace alpaca {
 
 		template<typename CallerT, typename T>
 		std::pair<int, std::string> fromJSON(const T& parser) {
-			parser.get<double>("avg_entry_price", avg_entry_price);
-			parser.get<double>("change_today", change_today);
-			parser.get<double>("cost_basis", cost_basis);
-			parser.get<double>("current_price", current_price);
-			parser.get<double>("lastday_price", lastday_price);
-			parser.get<double>("market_value", market_value);
-			parser.get<double>("unrealized_intraday_pl", unrealized_intraday_pl);
-			parser.get<double>("unrealized_intraday_plpc", unrealized_intraday_plpc);
-			parser.get<double>("unrealized_pl", unrealized_pl);
-			parser.get<double>("unrealized_pl", unrealized_plpc);
-			parser.get<uint32_t>("qty", qty);
-			asset_class = to_assetClass(parser.get<std::string>("asset_class"));
-			side = to_positionSide(parser.get<std::string>("side"));
-			parser.get<std::string>("asset_id", asset_id);
-			parser.get<std::string>("exchange", exchange);
-			parser.get<std::string>("symbol", symbol);
+			parser.template get<double>("avg_entry_price", avg_entry_price);
+			parser.template get<double>("change_today", change_today);
+			parser.template get<double>("cost_basis", cost_basis);
+			parser.template get<double>("current_price", current_price);
+			parser.template get<double>("lastday_price", lastday_price);
+			parser.template get<double>("market_value", market_value);
+			parser.template get<double>("unrealized_intraday_pl", unrealized_intraday_pl);
+			parser.template get<double>("unrealized_intraday_plpc", unrealized_intraday_plpc);
+			parser.template get<double>("unrealized_pl", unrealized_pl);
+			parser.template get<double>("unrealized_pl", unrealized_plpc);
+			parser.template get<uint32_t>("qty", qty);
+			asset_class = to_assetClass(parser.template get<std::string>("asset_class"));
+			side = to_positionSide(parser.template get<std::string>("side"));
+			parser.template get<std::string>("asset_id", asset_id);
+			parser.template get<std::string>("exchange", exchange);
+			parser.template get<std::string>("symbol", symbol);
 			return std::make_pair(0, "OK");
 		}
 	};
@@ -0,0 +1,140 @@
+#include "stdafx.h"
+#include "alpaca/risk_check.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+namespace alpaca {
+
+    bool RiskLimits::parse(const std::string& config) {
+        bool known = true;
+        std::istringstream in(config);
+        std::string item;
+        while (std::getline(in, item, ',')) {
+            auto pos = item.find('=');
+            if (pos == std::string::npos) {
+                known = false;
+                continue;
+            }
+            auto key = item.substr(0, pos);
+            auto value = item.substr(pos + 1);
+            if (key == "qty") {
+                maxOrderQty = (uint32_t)std::max(atoi(value.c_str()), 0);
+            }
+            else if (key == "value") {
+                maxOrderValue = std::max(atof(value.c_str()), 0.);
+            }
+            else if (key == "position") {
+                maxPositionQty = (uint32_t)std::max(atoi(value.c_str()), 0);
+            }
+            else if (key == "clip") {
+                clip = atoi(value.c_str()) != 0;
+            }
+            else if (key == "bp") {
+                buyingPower = atoi(value.c_str()) != 0;
+            }
+            else if (key == "short") {
+                shorting = atoi(value.c_str()) != 0;
+            }
+            else if (key == "pdt") {
+                dayTrades = atoi(value.c_str()) != 0;
+            }
+            else {
+                known = false;
+            }
+        }
+        return known;
+    }
+
+    std::string RiskLimits::to_string() const {
+        std::ostringstream out;
+        out << "qty=" << maxOrderQty << ",value=" << maxOrderValue << ",position=" << maxPositionQty << ",clip=" << clip
+            << ",bp=" << buyingPower << ",short=" << shorting << ",pdt=" << dayTrades;
+        return out.str();
+    }
+
+    int32_t RiskCheck::check(const RiskOrder& order, const Account* account, const AssetInfo* asset, std::string& reason) {
+        auto start = std::chrono::steady_clock::now();
+        reason.clear();
+        auto qty = apply(order, account, asset, reason);
+        ++metrics_.checks;
+        if (!qty) {
+            ++metrics_.rejected;
+        }
+        else if (qty != order.qty) {
+            ++metrics_.clipped;
+        }
+        metrics_.nanos += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return qty;
+    }
+
+    int32_t RiskCheck::apply(const RiskOrder& order, const Account* account, const AssetInfo* asset, std::string& reason) const {
+        if (!order.qty) {
+            return 0;
+        }
+        if (account && (account->account_blocked || account->trading_blocked)) {
+            reason = "trading is blocked on the account";
+            return 0;
+        }
+        if (asset && !asset->tradable) {
+            reason = "the asset is not tradable";
+            return 0;
+        }
+
+        uint32_t n = (uint32_t)std::abs(order.qty);
+        bool sameSide = order.position == 0 || (order.position > 0) == (order.qty > 0);
+        uint32_t held = (uint32_t)std::abs(order.position);
+        // the part that closes the position and the part that opens or adds to one
+        auto closing = [&]() { return sameSide ? 0u : std::min(n, held); };
+        auto opening = [&]() { return n - closing(); };
+        auto clip = [&](uint32_t allowed, const char* why) {
+            if (allowed >= n) {
+                return true;
+            }
+            reason = why;
+            if (!limits_.clip || !allowed) {
+                return false;
+            }
+            n = allowed;
+            return true;
+        };
+
+        // the order limits bound what opens a position, a close always passes them
+        if (limits_.maxOrderQty && !clip(closing() + limits_.maxOrderQty, "over the maximum order quantity")) {
+            return 0;
+        }
+        if (limits_.maxPositionQty && opening()) {
+            uint32_t room = sameSide ? (held < limits_.maxPositionQty ? limits_.maxPositionQty - held : 0) : limits_.maxPositionQty;
+            if (!clip(closing() + std::min(opening(), room), "over the maximum position")) {
+                return 0;
+            }
+        }
+        if (limits_.shorting && order.qty < 0 && opening() && ((account && !account->shorting_enabled) || (asset && !asset->shortable))) {
+            if (!clip(closing(), "the asset can't be sold short")) {
+                return 0;
+            }
+        }
+        if (limits_.dayTrades && account && closing() && order.openedToday &&
+            account->equity < PDT_EQUITY && account->daytrade_count >= PDT_MAX_DAY_TRADES) {
+            reason = "the day trade would exceed the pattern day trader limit";
+            return 0;
+        }
+        if (order.price > 0.) {
+            if (limits_.buyingPower && account && opening() && opening() * order.price > account->buying_power) {
+                auto affordable = (uint32_t)std::max(std::floor(account->buying_power / order.price), 0.);
+                if (!clip(closing() + affordable, "insufficient buying power")) {
+                    return 0;
+                }
+            }
+            if (limits_.maxOrderValue && opening() * order.price > limits_.maxOrderValue) {
+                if (!clip(closing() + (uint32_t)std::floor(limits_.maxOrderValue / order.price), "over the maximum order value")) {
+                    return 0;
+                }
+            }
+        }
+        return order.qty > 0 ? (int32_t)n : -(int32_t)n;
+    }
+
+} // namespace alpaca
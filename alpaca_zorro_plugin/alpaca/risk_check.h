@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "alpaca/account.h"
+#include "alpaca/asset_catalog.h"
+
+namespace alpaca {
+
+    /**
+     * @brief The rules and thresholds of the pre-trade check, a 0 limit is off. The order quantity and value
+     * limits apply to the part of an order that opens or adds to a position.
+     */
+    struct RiskLimits {
+        uint32_t maxOrderQty = 0;
+        double maxOrderValue = 0.;
+        uint32_t maxPositionQty = 0;    // per symbol, long or short
+        bool clip = false;              // reduce an order to what passes instead of rejecting it
+        bool buyingPower = true;
+        bool shorting = true;
+        bool dayTrades = true;          // pattern day trader protection
+
+        /**
+         * @brief Parse "key=value,..." with the keys qty, value, position, clip, bp, short and pdt.
+         * @return false on an unknown key, the known ones are applied anyway.
+         */
+        bool parse(const std::string& config);
+        std::string to_string() const;
+    };
+
+    /**
+     * @brief An order as the check sees it.
+     */
+    struct RiskOrder {
+        int32_t qty = 0;            // positive to buy, negative to sell
+        double price = 0.;          // the limit or the last quote, 0 if unknown
+        int32_t position = 0;       // signed quantity held
+        bool openedToday = false;   // the position was opened today, reducing it is a day trade
+    };
+
+    struct RiskMetrics {
+        uint64_t checks = 0;
+        uint64_t rejected = 0;      // each one a round trip that wasn't sent
+        uint64_t clipped = 0;
+        uint64_t nanos = 0;
+    };
+
+    /**
+     * @brief Rejects or clips orders Alpaca would reject, from the cached account, asset and position.
+     *
+     * Whatever isn't known is not checked: without an account only the asset and the quantity
+     * limits apply, without a price the buying power and the order value are not checked. Alpaca
+     * keeps the final say, the check only saves the round trip of an obvious rejection. Used from
+     * Zorro's thread only.
+     */
+    class RiskCheck {
+    public:
+        /**
+         * @brief Pattern day trader protection applies below this equity.
+         */
+        static constexpr double PDT_EQUITY = 25000.;
+        static constexpr int32_t PDT_MAX_DAY_TRADES = 3;
+
+        explicit RiskCheck(RiskLimits limits = RiskLimits()) : limits_(limits) {}
+
+        /**
+         * @return the quantity that may be sent with the sign of order.qty, 0 if the order is
+         * rejected and reason tells why.
+         */
+        int32_t check(const RiskOrder& order, const Account* account, const AssetInfo* asset, std::string& reason);
+
+        const RiskLimits& limits() const noexcept { return limits_; }
+        void setLimits(const RiskLimits& limits) noexcept { limits_ = limits; }
+        const RiskMetrics& metrics() const noexcept { return metrics_; }
+
+    private:
+        int32_t apply(const RiskOrder& order, const Account* account, const AssetInfo* asset, std::string& reason) const;
+
+    private:
+        RiskLimits limits_;
+        RiskMetrics metrics_;
+    };
+
+} // namespace alpaca
@@ -0,0 +1,147 @@
+#include "stdafx.h"
+#include "alpaca/trade_stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include "rapidjson/document.h"
+#include "request.h"
+#include "alpaca/clock.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr uint32_t MIN_RECONNECT_MS = 1000;
+        constexpr uint32_t MAX_RECONNECT_MS = 30000;
+
+        bool isStream(const rapidjson::Document& d, const char* stream) {
+            return d.IsObject() && d.HasMember("stream") && d["stream"].IsString() && strcmp(d["stream"].GetString(), stream) == 0 &&
+                d.HasMember("data") && d["data"].IsObject();
+        }
+
+        std::string toWebSocketUrl(const std::string& baseUrl) {
+            // https://paper-api.alpaca.markets -> wss://paper-api.alpaca.markets/stream
+            auto pos = baseUrl.find("://");
+            return "wss" + baseUrl.substr(pos == std::string::npos ? 0 : pos) + "/stream";
+        }
+    }
+
+    TradeStream::TradeStream(const std::string& baseUrl, std::string key, std::string secret, OrderUpdates& updates, Logger& logger)
+        : url_(toWebSocketUrl(baseUrl))
+        , key_(std::move(key))
+        , secret_(std::move(secret))
+        , updates_(updates)
+        , logger_(logger) {
+    }
+
+    TradeStream::~TradeStream() {
+        stop();
+    }
+
+    void TradeStream::start() {
+        if (thread_.joinable()) {
+            return;
+        }
+        stop_ = false;
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    void TradeStream::stop() {
+        stop_ = true;
+        socket_.interrupt();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        socket_.close();
+    }
+
+    bool TradeStream::authenticate(std::string& reply) {
+        // the server answers the authenticate message with "authorized" and the listen message with "listening"
+        if (!socket_.send("{\"action\":\"authenticate\",\"data\":{\"key_id\":\"" + key_ + "\",\"secret_key\":\"" + secret_ + "\"}}")) {
+            reply = socket_.error();
+            return false;
+        }
+        while (socket_.receive(reply)) {
+            rapidjson::Document d;
+            if (d.Parse(reply.c_str()).HasParseError()) {
+                continue;
+            }
+            if (isStream(d, "authorization")) {
+                auto& data = d["data"];
+                if (!data.HasMember("status") || !data["status"].IsString() || strcmp(data["status"].GetString(), "authorized") != 0) {
+                    reply = "not authorized";
+                    return false;
+                }
+                if (!socket_.send("{\"action\":\"listen\",\"data\":{\"streams\":[\"trade_updates\"]}}")) {
+                    reply = socket_.error();
+                    return false;
+                }
+            }
+            else if (isStream(d, "listening")) {
+                return true;
+            }
+        }
+        reply = socket_.error();
+        return false;
+    }
+
+    void TradeStream::run() {
+        auto delay = MIN_RECONNECT_MS;
+        std::string message;
+        while (!stop_) {
+            if (socket_.connect(url_)) {
+                if (authenticate(message)) {
+                    listening_ = true;
+                    // updates before the listen confirmation were missed
+                    updates_.connected();
+                    logger_.logInfo("Trade stream connected to %s\n", url_.c_str());
+                    delay = MIN_RECONNECT_MS;
+
+                    while (!stop_ && socket_.receive(message)) {
+                        dispatch(message);
+                    }
+                    listening_ = false;
+                    updates_.disconnected();
+                    message = socket_.error();
+                }
+            }
+            else {
+                message = socket_.error();
+            }
+            socket_.close();
+            if (stop_) {
+                break;
+            }
+
+            logger_.logWarning("Trade stream disconnected: %s. Reconnect in %u ms\n", message.c_str(), delay);
+            for (uint32_t waited = 0; waited < delay && !stop_; waited += 100) {
+                Sleep(100);
+            }
+            delay = std::min(delay * 2, MAX_RECONNECT_MS);
+        }
+    }
+
+    void TradeStream::dispatch(const std::string& message) {
+        rapidjson::Document d;
+        if (d.Parse(message.c_str()).HasParseError() || !isStream(d, "trade_updates")) {
+            logger_.logDebug("Trade stream: %s\n", message.c_str());
+            return;
+        }
+
+        auto& data = d["data"];
+        if (!data.HasMember("event") || !data["event"].IsString() || !data.HasMember("order") || !data["order"].IsObject()) {
+            return;
+        }
+        auto obj = data["order"].GetObject();
+        Parser<decltype(data["order"].GetObject())> parser(obj);
+        Order order;
+        order.fromJSON<TradeStream>(parser);
+
+        int64_t eventTime = 0;
+        if (data.HasMember("timestamp") && data["timestamp"].IsString()) {
+            eventTime = parseNanos(data["timestamp"].GetString(), data["timestamp"].GetStringLength());
+        }
+        logger_.logTrace("Trade stream: %s\n", message.c_str());
+        updates_.apply(data["event"].GetString(), order, eventTime);
+    }
+
+} // namespace alpaca
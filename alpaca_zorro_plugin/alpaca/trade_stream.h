@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include "logger.h"
+#include "websocket.h"
+#include "alpaca/order_updates.h"
+
+namespace alpaca {
+
+    /**
+     * @brief The trade_updates stream of the trading API (wss://<paper-api|api>.alpaca.markets/stream).
+     *
+     * A background thread connects, authenticates, listens to trade_updates and applies every
+     * order event to the OrderUpdates. It reconnects with a growing delay when the connection
+     * drops, every connect starts a new epoch of the OrderUpdates.
+     */
+    class TradeStream {
+    public:
+        /**
+         * @param baseUrl the https url of the trading API
+         */
+        TradeStream(const std::string& baseUrl, std::string key, std::string secret, OrderUpdates& updates, Logger& logger);
+        ~TradeStream();
+
+        TradeStream(const TradeStream&) = delete;
+        TradeStream& operator=(const TradeStream&) = delete;
+
+        void start();
+        void stop();
+
+        bool isConnected() const noexcept { return listening_; }
+
+    private:
+        void run();
+        bool authenticate(std::string& message);
+        void dispatch(const std::string& message);
+
+    private:
+        const std::string url_;
+        const std::string key_;
+        const std::string secret_;
+        OrderUpdates& updates_;
+        Logger& logger_;
+
+        WebSocket socket_;
+        std::thread thread_;
+        std::atomic<bool> stop_{ false };
+        std::atomic<bool> listening_{ false };
+    };
+
+} // namespace alpaca
@@ -1,24 +1,183 @@
 #include "stdafx.h"
 #include "market_data/alpaca_market_data.h"
+#include "market_data/bar_parser.h"
+#include "alpaca/clock.h"
 #include "date/date.h"
 
 using namespace alpaca;
 
-Response<std::vector<Bar>> AlpacaMarketData::getBars(
+namespace {
+    constexpr uint32_t MAX_BARS_PER_REQUEST = 1000;    // Alpaca bars endpoint page limit
+    constexpr int SESSION_OPEN_MINUTES = 570;           // 9:30 New York time
+    constexpr size_t QUOTE_SYMBOLS_PER_REQUEST = 200;   // keeps the url well below common length limits
+    constexpr size_t MAX_CONCURRENT_REQUESTS = 4;
+    constexpr size_t REQUESTS_PER_WAVE = 16;            // replies are handed out after every wave
+
+    int exchangeCode(const rapidjson::Value& quote, const char* name) {
+        return quote.HasMember(name) && quote[name].IsString() ? (unsigned char)quote[name].GetString()[0] : 0;
+    }
+}
+
+Response<uint32_t> AlpacaMarketData::getLastQuotes(const std::vector<std::string>& symbols, const QuoteHandler& handler) const {
+    std::vector<std::string> urls;
+    for (size_t i = 0; i < symbols.size(); i += QUOTE_SYMBOLS_PER_REQUEST) {
+        std::string url = std::string(baseUrl_) + "/v2/stocks/quotes/latest?symbols=";
+        for (size_t j = i; j < std::min(symbols.size(), i + QUOTE_SYMBOLS_PER_REQUEST); ++j) {
+            if (j > i) {
+                url += ',';
+            }
+            url += symbols[j];
+        }
+        logger_.logDebug("--> %s\n", url.c_str());
+        urls.emplace_back(std::move(url));
+    }
+
+    uint32_t quoted = 0;
+    Response<uint32_t> result;
+    for (size_t first = 0; first < urls.size(); first += REQUESTS_PER_WAVE) {
+        std::vector<std::string> wave(urls.begin() + first, urls.begin() + std::min(urls.size(), first + REQUESTS_PER_WAVE));
+        auto responses = requestAllRaw<AlpacaMarketData>(wave, headers_, nullptr, MAX_CONCURRENT_REQUESTS);
+        for (auto& response : responses) {
+            rapidjson::Document d;
+            if (response && (d.Parse(response.content().c_str()).HasParseError() || !d.IsObject() || !d.HasMember("quotes") || !d["quotes"].IsObject())) {
+                response = Response<std::string>(1, "Unexpected latest quotes reply " + response.content());
+            }
+            if (!response) {
+                if (result) {
+                    result = Response<uint32_t>(response.getCode(), response.what());
+                }
+                continue;
+            }
+
+            auto& quotes = d["quotes"];
+            for (auto member = quotes.MemberBegin(); member != quotes.MemberEnd(); ++member) {
+                auto& q = member->value;
+                Parser<rapidjson::Value> parser(q);
+                Quote quote = {};
+                parser.template get<double>("ap", quote.ask_price);
+                parser.template get<int>("as", quote.ask_size);
+                parser.template get<double>("bp", quote.bid_price);
+                parser.template get<int>("bs", quote.bid_size);
+                quote.ask_exchange = exchangeCode(q, "ax");
+                quote.bid_exchange = exchangeCode(q, "bx");
+                if (q.HasMember("t") && q["t"].IsString()) {
+                    quote.timestamp = (uint64_t)parseNanos(q["t"].GetString(), q["t"].GetStringLength());
+                }
+                handler(member->name.GetString(), quote);
+                ++quoted;
+            }
+        }
+        if (!BrokerProgress(1)) {
+            return Response<uint32_t>(1, "Brokerprogress returned zero. Aborting...", quoted);
+        }
+    }
+    return Response<uint32_t>(result.getCode(), result.what(), quoted);
+}
+
+Response<uint32_t> AlpacaMarketData::getBars(
     const std::string& symbol,
     const __time32_t start,
     const __time32_t end,
     const int nTickMinutes,
+    BarSink& sink) const {
+
+    // Alpaca only provides 1Min, 5Min, 15Min and 1D bars, any other timeframe is built
+    // locally from the coarsest of them that evenly divides nTickMinutes.
+    auto baseMinutes = BarAggregator::baseTimeframe(nTickMinutes);
+    if (baseMinutes == nTickMinutes) {
+        BarColumns bars;
+        auto response = downloadBars(symbol, start, end, baseMinutes, std::min(sink.limit(), MAX_BARS_PER_REQUEST), bars);
+        if (!response) {
+            return response;
+        }
+        writeDescending(bars, sink);
+        return Response<uint32_t>(0, "OK", sink.count());
+    }
+
+    BarAggregator aggregator(nTickMinutes, baseMinutes, baseMinutes < 1440 ? SESSION_OPEN_MINUTES : 0, calendar_);
+    auto baseLimit = (uint32_t)std::min<uint64_t>((uint64_t)sink.limit() * aggregator.ratio(), MAX_BARS_PER_REQUEST);
+    BarColumns in;
+    auto response = downloadBars(symbol, start, end, baseMinutes, baseLimit, in);
+    if (!response) {
+        return response;
+    }
+
+    BarColumns out;
+    aggregator.aggregate(in, out);
+
+    // A full page means older base bars exist, so the oldest bucket may have been cut short.
+    size_t begin = (in.size() == baseLimit && out.size() > 1) ? 1 : 0;
+
+    logger_.logDebug("aggregated %d %dMin bars into %d %dMin bars\n", in.size(), baseMinutes, out.size() - begin, nTickMinutes);
+    writeDescending(out, sink, begin);
+    return Response<uint32_t>(0, "OK", sink.count());
+}
+
+Response<uint32_t> AlpacaMarketData::downloadBars(
+    const std::string& symbol,
+    const __time32_t start,
+    const __time32_t end,
+    const int baseMinutes,
+    const uint32_t limit,
+    BarColumns& bars) const {
+
+    auto url = barsUrl(symbol, start, end, baseMinutes, limit);
+    logger_.logDebug("--> %s\n", url.c_str());
+    auto response = requestRaw<AlpacaMarketData>(url, headers_, nullptr);
+    if (!response) {
+        return Response<uint32_t>(response.getCode(), response.what());
+    }
+
+    bars.reserve(limit);
+    return readBars(response.content(), bars);
+}
+
+bool AlpacaMarketData::barsRequest(
+    const std::string& symbol,
+    const __time32_t start,
+    const __time32_t end,
+    const int nTickMinutes,
+    const uint32_t limit,
+    HttpGet& get) const {
+
+    // other timeframes are aggregated locally from a larger page
+    if (BarAggregator::baseTimeframe(nTickMinutes) != nTickMinutes || limit > MAX_BARS_PER_REQUEST) {
+        return false;
+    }
+    get.url = barsUrl(symbol, start, end, nTickMinutes, limit);
+    get.headers = headers_;
+    get.limiter = &rateLimiter<AlpacaMarketData>();
+    return true;
+}
+
+Response<uint32_t> AlpacaMarketData::readBars(const std::string& content, BarColumns& bars) const {
+    auto flush = [&bars](const BarChunk& chunk) {
+        bars.append(chunk);
+        return true;
+    };
+    std::string nextUrl;
+    std::string error;
+    if (!parseBars(content, 1, flush, nextUrl, error)) {
+        return Response<uint32_t>(1, error);
+    }
+    return Response<uint32_t>(0, "OK", (uint32_t)bars.size());
+}
+
+std::string AlpacaMarketData::barsUrl(
+    const std::string& symbol,
+    const __time32_t start,
+    const __time32_t end,
+    const int baseMinutes,
     const uint32_t limit) const {
 
     std::string timeframe = "1Min";
-    if (nTickMinutes >= 5 && nTickMinutes < 15) {
+    if (baseMinutes == 5) {
         timeframe = "5Min";
     }
-    else if (nTickMinutes >= 15 && nTickMinutes < 1440) {
+    else if (baseMinutes == 15) {
         timeframe = "15Min";
     }
-    else if (nTickMinutes >= 1440) {
+    else if (baseMinutes == 1440) {
         timeframe = "1D";
     }
 
@@ -46,6 +205,5 @@ Response<std::vector<Bar>> AlpacaMarketData::getBars(
     url << baseUrl_ << "/v1/bars/" << timeframe << "?symbols=" << symbol << "&limit=" << limit
         << (sStart.empty() ? "" : "&start=" + sStart) << (sEnd.empty() ? "" : "&end=" + sEnd);
 
-    logger_.logDebug("--> %s\n", url.str().c_str());
-    return request<std::vector<Bar>, AlpacaMarketData>(url.str(), headers_, nullptr);
+    return url.str();
 }
\ No newline at end of file
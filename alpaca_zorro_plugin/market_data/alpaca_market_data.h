@@ -3,6 +3,7 @@
 #include <string>
 #include "request.h"
 #include "market_data/market_data_base.h"
+#include "market_data/bar_aggregator.h"
 
 namespace alpaca {
 
@@ -17,12 +18,54 @@ namespace alpaca {
             return request<LastQuote, AlpacaMarketData>(std::string(baseUrl_) + "/v1/last_quote/stocks/" + symbol, headers_);
         }
 
-        Response<std::vector<Bar>> getBars(
+        bool lastQuoteRequest(const std::string& symbol, HttpGet& get) const override {
+            get.url = std::string(baseUrl_) + "/v1/last_quote/stocks/" + symbol;
+            get.headers = headers_;
+            get.limiter = &rateLimiter<AlpacaMarketData>();
+            return true;
+        }
+
+        Response<LastQuote> readLastQuote(const std::string& content) const override {
+            return parseResponse<LastQuote, AlpacaMarketData>(content);
+        }
+
+        Response<uint32_t> getLastQuotes(const std::vector<std::string>& symbols, const QuoteHandler& handler) const override;
+
+        Response<uint32_t> getBars(
+            const std::string& symbol,
+            const __time32_t start,
+            const __time32_t end,
+            const int nTickMinutes,
+            BarSink& sink) const override;
+
+        bool barsRequest(
+            const std::string& symbol,
+            const __time32_t start,
+            const __time32_t end,
+            const int nTickMinutes,
+            const uint32_t limit,
+            HttpGet& get) const override;
+
+        Response<uint32_t> readBars(const std::string& content, BarColumns& bars) const override;
+
+    private:
+        /**
+         * @brief Download up to limit bars of a native Alpaca timeframe into columns, in ascending order.
+         */
+        Response<uint32_t> downloadBars(
+            const std::string& symbol,
+            const __time32_t start,
+            const __time32_t end,
+            const int baseMinutes,
+            const uint32_t limit,
+            BarColumns& bars) const;
+
+        std::string barsUrl(
             const std::string& symbol,
             const __time32_t start,
             const __time32_t end,
-            const int nTickMinutes = 1,
-            const uint32_t limit = 100) const override;
+            const int baseMinutes,
+            const uint32_t limit) const;
 
     private:
         std::string headers_;
@@ -0,0 +1,263 @@
+#include "stdafx.h"
+#include "market_data/bar_aggregator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include "alpaca/calendar.h"
+#include "alpaca/clock.h"
+#include "simd.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr int32_t DAY_IN_SEC = 86400;
+        constexpr int32_t MONDAY = 4;   // 1970-01-05, the first Monday after the epoch, is day 4
+
+        inline int32_t floorDiv(int32_t a, int32_t b) noexcept {
+            auto q = a / b;
+            return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+        }
+    }
+
+    void BarColumns::reserve(size_t n) {
+        time.reserve(n);
+        open.reserve(n);
+        high.reserve(n);
+        low.reserve(n);
+        close.reserve(n);
+        volume.reserve(n);
+    }
+
+    void BarColumns::clear() noexcept {
+        time.clear();
+        open.clear();
+        high.clear();
+        low.clear();
+        close.clear();
+        volume.clear();
+    }
+
+    void BarColumns::push_back(const Bar& bar) {
+        time.push_back(bar.time);
+        open.push_back(bar.open_price);
+        high.push_back(bar.high_price);
+        low.push_back(bar.low_price);
+        close.push_back(bar.close_price);
+        volume.push_back(bar.volume);
+    }
+
+    void BarColumns::append(const BarChunk& chunk) {
+        time.insert(time.end(), chunk.time, chunk.time + chunk.size);
+        open.insert(open.end(), chunk.open, chunk.open + chunk.size);
+        high.insert(high.end(), chunk.high, chunk.high + chunk.size);
+        low.insert(low.end(), chunk.low, chunk.low + chunk.size);
+        close.insert(close.end(), chunk.close, chunk.close + chunk.size);
+        volume.insert(volume.end(), chunk.volume, chunk.volume + chunk.size);
+    }
+
+    Bar BarColumns::at(size_t i) const noexcept {
+        Bar bar;
+        bar.time = time[i];
+        bar.open_price = open[i];
+        bar.high_price = high[i];
+        bar.low_price = low[i];
+        bar.close_price = close[i];
+        bar.volume = volume[i];
+        return bar;
+    }
+
+    void BarColumns::toBars(std::vector<Bar>& bars) const {
+        bars.reserve(bars.size() + size());
+        for (size_t i = 0; i < size(); ++i) {
+            bars.emplace_back(at(i));
+        }
+    }
+
+    void BarColumns::eraseFront(size_t n) {
+        n = std::min(n, size());
+        time.erase(time.begin(), time.begin() + n);
+        open.erase(open.begin(), open.begin() + n);
+        high.erase(high.begin(), high.begin() + n);
+        low.erase(low.begin(), low.begin() + n);
+        close.erase(close.begin(), close.begin() + n);
+        volume.erase(volume.begin(), volume.begin() + n);
+    }
+
+    void BarColumns::reverse() {
+        std::reverse(time.begin(), time.end());
+        std::reverse(open.begin(), open.end());
+        std::reverse(high.begin(), high.end());
+        std::reverse(low.begin(), low.end());
+        std::reverse(close.begin(), close.end());
+        std::reverse(volume.begin(), volume.end());
+    }
+
+    double columnMax(const double* values, size_t n) noexcept {
+        assert(n);
+        size_t i = 0;
+        double result = values[0];
+#ifdef ALPACA_SSE2
+        if (n >= 4) {
+            __m128d m0 = _mm_loadu_pd(values);
+            __m128d m1 = _mm_loadu_pd(values + 2);
+            for (i = 4; i + 4 <= n; i += 4) {
+                m0 = _mm_max_pd(m0, _mm_loadu_pd(values + i));
+                m1 = _mm_max_pd(m1, _mm_loadu_pd(values + i + 2));
+            }
+            m0 = _mm_max_pd(m0, m1);
+            m0 = _mm_max_sd(m0, _mm_unpackhi_pd(m0, m0));
+            result = _mm_cvtsd_f64(m0);
+        }
+#endif
+        for (; i < n; ++i) {
+            result = values[i] > result ? values[i] : result;
+        }
+        return result;
+    }
+
+    double columnMin(const double* values, size_t n) noexcept {
+        assert(n);
+        size_t i = 0;
+        double result = values[0];
+#ifdef ALPACA_SSE2
+        if (n >= 4) {
+            __m128d m0 = _mm_loadu_pd(values);
+            __m128d m1 = _mm_loadu_pd(values + 2);
+            for (i = 4; i + 4 <= n; i += 4) {
+                m0 = _mm_min_pd(m0, _mm_loadu_pd(values + i));
+                m1 = _mm_min_pd(m1, _mm_loadu_pd(values + i + 2));
+            }
+            m0 = _mm_min_pd(m0, m1);
+            m0 = _mm_min_sd(m0, _mm_unpackhi_pd(m0, m0));
+            result = _mm_cvtsd_f64(m0);
+        }
+#endif
+        for (; i < n; ++i) {
+            result = values[i] < result ? values[i] : result;
+        }
+        return result;
+    }
+
+    uint64_t columnSum(const uint32_t* values, size_t n) noexcept {
+        size_t i = 0;
+        uint64_t result = 0;
+#ifdef ALPACA_SSE2
+        if (n >= 4) {
+            // widen each 32 bit lane to 64 bit before adding so the sum can't overflow
+            const __m128i zero = _mm_setzero_si128();
+            __m128i acc = _mm_setzero_si128();
+            for (; i + 4 <= n; i += 4) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+                acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+                acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+            }
+            alignas(16) uint64_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+            result = lanes[0] + lanes[1];
+        }
+#endif
+        for (; i < n; ++i) {
+            result += values[i];
+        }
+        return result;
+    }
+
+    BarAggregator::BarAggregator(int nTickMinutes, int baseMinutes, int anchorMinutes, const Calendar* calendar) noexcept
+        : nTickMinutes_(nTickMinutes)
+        , baseMinutes_(baseMinutes)
+        , anchorMinutes_(anchorMinutes)
+        , calendar_(calendar) {
+        assert(nTickMinutes_ > 0 && baseMinutes_ > 0 && nTickMinutes_ % baseMinutes_ == 0);
+    }
+
+    int BarAggregator::baseTimeframe(int nTickMinutes) noexcept {
+        if (nTickMinutes >= 1440 && nTickMinutes % 1440 == 0) {
+            return 1440;
+        }
+        if (nTickMinutes % 15 == 0) {
+            return 15;
+        }
+        if (nTickMinutes % 5 == 0) {
+            return 5;
+        }
+        return 1;
+    }
+
+    void BarAggregator::bucket(uint32_t t, uint32_t& start, uint32_t& end) const noexcept {
+        auto offset = getNewYorkOffset((__time32_t)t);
+        int32_t local = (int32_t)t + offset;
+        auto toUtc = [offset](int32_t localTime) {
+            // a bucket boundary can fall on the other side of a DST switch
+            return (uint32_t)(localTime - getNewYorkOffset((__time32_t)(localTime - offset)));
+        };
+
+        if (nTickMinutes_ >= 1440) {
+            // multi-day buckets are counted in New York calendar days from a Monday
+            auto day = floorDiv(local, DAY_IN_SEC);
+            auto periodDays = nTickMinutes_ / 1440;
+            auto startDay = MONDAY + floorDiv(day - MONDAY, periodDays) * periodDays;
+            start = toUtc(startDay * DAY_IN_SEC);
+            end = toUtc((startDay + periodDays) * DAY_IN_SEC);
+            return;
+        }
+
+        int32_t period = nTickMinutes_ * 60;
+        int32_t dayStart = floorDiv(local, DAY_IN_SEC) * DAY_IN_SEC;
+        int32_t anchor = dayStart + anchorMinutes_ * 60;
+        // the local day start is the UTC midnight of the same date, which is how sessions are keyed
+        auto session = calendar_ ? calendar_->sessionOn((__time32_t)dayStart) : nullptr;
+        if (session && anchorMinutes_) {
+            anchor = session->open + offset;
+        }
+        int32_t localStart = anchor + floorDiv(local - anchor, period) * period;
+        // buckets never span two days, the pre-anchor bucket starts at midnight
+        int32_t localEnd = std::min(localStart + period, dayStart + DAY_IN_SEC);
+        localStart = std::max(localStart, dayStart);
+        if (session) {
+            // nor the session close, after hours buckets start at the close
+            int32_t close = session->close + offset;
+            if (local < close) {
+                localEnd = std::min(localEnd, close);
+            }
+            else {
+                localStart = std::max(localStart, close);
+            }
+        }
+        start = (uint32_t)(localStart - offset);
+        end = (uint32_t)(localEnd - offset);
+    }
+
+    uint32_t BarAggregator::bucketStart(uint32_t t) const noexcept {
+        uint32_t start, end;
+        bucket(t, start, end);
+        return start;
+    }
+
+    void BarAggregator::aggregate(const BarColumns& in, BarColumns& out) const {
+        const auto n = in.size();
+        out.reserve(out.size() + n / ratio() + 1);
+
+        size_t begin = 0;
+        while (begin < n) {
+            uint32_t start, next;
+            bucket(in.time[begin], start, next);
+            size_t end = begin + 1;
+            // base bars are ascending, so the bucket ends at the first bar past it
+            while (end < n && in.time[end] < next) {
+                ++end;
+            }
+
+            auto count = end - begin;
+            auto volume = columnSum(&in.volume[begin], count);
+            out.time.push_back(start);
+            out.open.push_back(in.open[begin]);
+            out.high.push_back(columnMax(&in.high[begin], count));
+            out.low.push_back(columnMin(&in.low[begin], count));
+            out.close.push_back(in.close[end - 1]);
+            out.volume.push_back(volume > std::numeric_limits<uint32_t>::max() ? std::numeric_limits<uint32_t>::max() : (uint32_t)volume);
+            begin = end;
+        }
+    }
+
+} // namespace alpaca
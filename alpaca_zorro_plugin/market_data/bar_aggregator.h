@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "market_data/bars.h"
+#include "market_data/bar_sink.h"
+
+namespace alpaca {
+
+    class Calendar;
+
+    /**
+     * @brief Bars stored column by column.
+     *
+     * Keeping each field in its own contiguous array lets the aggregation kernels reduce
+     * a run of bars with SIMD min/max/sum instead of walking an array of Bar structs.
+     */
+    struct BarColumns {
+        std::vector<uint32_t> time;
+        std::vector<double> open;
+        std::vector<double> high;
+        std::vector<double> low;
+        std::vector<double> close;
+        std::vector<uint32_t> volume;
+
+        size_t size() const noexcept { return time.size(); }
+        bool empty() const noexcept { return time.empty(); }
+
+        void reserve(size_t n);
+        void clear() noexcept;
+        void push_back(const Bar& bar);
+        void append(const BarChunk& chunk);
+        Bar at(size_t i) const noexcept;
+        void toBars(std::vector<Bar>& bars) const;
+
+        /// Drop the first n bars
+        void eraseFront(size_t n);
+
+        /// Reverse the order of the bars, e.g. to turn a descending page ascending
+        void reverse();
+    };
+
+    /**
+     * @brief Build nTickMinutes OHLCV bars from finer base bars.
+     *
+     * Intraday buckets are aligned to the New York trading day, optionally shifted by an
+     * anchor (570 minutes aligns the buckets to the 9:30 session open), and never span two
+     * days. Daily and longer buckets are aligned to Monday so weekly bars start on a Monday.
+     * Buckets without any base bar are skipped, gaps are not filled with synthetic bars.
+     * With a calendar, intraday buckets also break at the session close, and the anchor is
+     * taken from the actual open, so early closes don't merge regular and after hours bars.
+     */
+    class BarAggregator {
+    public:
+        BarAggregator(int nTickMinutes, int baseMinutes, int anchorMinutes = 0, const Calendar* calendar = nullptr) noexcept;
+
+        /**
+         * @brief Pick the coarsest Alpaca timeframe (1, 5, 15 or 1440 minutes) that evenly divides nTickMinutes.
+         */
+        static int baseTimeframe(int nTickMinutes) noexcept;
+
+        /**
+         * @brief Number of base bars that make up one output bar.
+         */
+        uint32_t ratio() const noexcept { return (uint32_t)(nTickMinutes_ / baseMinutes_); }
+
+        /**
+         * @brief The start time of the bucket a bar starting at t belongs to.
+         */
+        uint32_t bucketStart(uint32_t t) const noexcept;
+
+        /**
+         * @brief Aggregate base bars, in ascending time order, into output bars. Output is appended to out.
+         */
+        void aggregate(const BarColumns& in, BarColumns& out) const;
+
+    private:
+        void bucket(uint32_t t, uint32_t& start, uint32_t& end) const noexcept;
+
+    private:
+        const int nTickMinutes_;
+        const int baseMinutes_;
+        const int anchorMinutes_;
+        const Calendar* calendar_;
+    };
+
+    // Reduction kernels over a contiguous column, SSE2 when available with a scalar fallback.
+    double columnMax(const double* values, size_t n) noexcept;
+    double columnMin(const double* values, size_t n) noexcept;
+    uint64_t columnSum(const uint32_t* values, size_t n) noexcept;
+
+} // namespace alpaca
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "rapidjson/reader.h"
+#include "market_data/bar_sink.h"
+
+namespace alpaca {
+
+    /**
+     * @brief SAX handler that streams bars out of an Alpaca or Polygon bars response.
+     *
+     * Every object directly inside an array is taken as a bar with the keys t, o, h, l, c and v.
+     * Bars are collected into a BarChunk and handed to flush(chunk) whenever it fills up, flush
+     * returns false to stop parsing. Top level next_url and error/message strings are captured.
+     */
+    template<typename FlushT>
+    class BarHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, BarHandler<FlushT>> {
+    public:
+        /**
+         * @param timeDivisor converts t to seconds, 1 for Alpaca and 1000 for Polygon's milliseconds
+         */
+        BarHandler(uint32_t timeDivisor, FlushT& flush) noexcept : timeDivisor_(timeDivisor), flush_(flush) {}
+
+        bool Default() { return true; }
+
+        bool Int(int i) { return number((double)i, (uint64_t)(int64_t)i); }
+        bool Uint(unsigned u) { return number((double)u, u); }
+        bool Int64(int64_t i) { return number((double)i, (uint64_t)i); }
+        bool Uint64(uint64_t u) { return number((double)u, u); }
+        bool Double(double d) { return number(d, (uint64_t)d); }
+
+        bool String(const char* str, rapidjson::SizeType length, bool) {
+            if (depth_ == 1) {
+                if (isKey("next_url")) {
+                    nextUrl.assign(str, length);
+                }
+                else if (isKey("error") || isKey("message")) {
+                    error.assign(str, length);
+                }
+            }
+            return true;
+        }
+
+        bool Key(const char* str, rapidjson::SizeType length, bool) {
+            keyLength_ = length < sizeof(key_) ? length : sizeof(key_) - 1;
+            memcpy(key_, str, keyLength_);
+            key_[keyLength_] = 0;
+            return true;
+        }
+
+        bool StartObject() {
+            push(false);
+            if (depth_ >= 2 && isArray(depth_ - 1)) {
+                inBar_ = true;
+                time_ = 0;
+                open_ = high_ = low_ = close_ = 0.;
+                volume_ = 0;
+            }
+            return true;
+        }
+
+        bool EndObject(rapidjson::SizeType) {
+            if (inBar_ && depth_ >= 2 && isArray(depth_ - 1)) {
+                inBar_ = false;
+                ++count;
+                chunk_.push(time_, open_, high_, low_, close_, volume_);
+                if (chunk_.full() && !flush()) {
+                    return false;
+                }
+            }
+            --depth_;
+            return true;
+        }
+
+        bool StartArray() {
+            push(true);
+            return true;
+        }
+
+        bool EndArray(rapidjson::SizeType) {
+            --depth_;
+            return true;
+        }
+
+        /**
+         * @brief Hand the last partial chunk to flush.
+         */
+        bool finish() {
+            return chunk_.size ? flush() : true;
+        }
+
+        bool stopped() const noexcept { return stopped_; }
+
+        std::string nextUrl;
+        std::string error;
+        uint32_t count = 0;
+
+    private:
+        bool number(double d, uint64_t u) {
+            if (!inBar_ || keyLength_ != 1) {
+                return true;
+            }
+            switch (key_[0]) {
+            case 't':
+                time_ = (uint32_t)(u / timeDivisor_);
+                break;
+            case 'o':
+                open_ = d;
+                break;
+            case 'h':
+                high_ = d;
+                break;
+            case 'l':
+                low_ = d;
+                break;
+            case 'c':
+                close_ = d;
+                break;
+            case 'v':
+                volume_ = (uint32_t)d;
+                break;
+            }
+            return true;
+        }
+
+        bool flush() {
+            bool more = flush_(chunk_);
+            chunk_.clear();
+            stopped_ = !more;
+            return more;
+        }
+
+        void push(bool array) noexcept {
+            ++depth_;
+            if (depth_ < 64) {
+                arrays_ = array ? (arrays_ | (1ull << depth_)) : (arrays_ & ~(1ull << depth_));
+            }
+        }
+
+        bool isArray(uint32_t depth) const noexcept { return depth < 64 && (arrays_ & (1ull << depth)); }
+        bool isKey(const char* key) const noexcept { return strcmp(key_, key) == 0; }
+
+    private:
+        const uint32_t timeDivisor_;
+        FlushT& flush_;
+        BarChunk chunk_;
+        uint64_t arrays_ = 0;   // bit n is set when the container at depth n is an array
+        uint32_t depth_ = 0;
+        char key_[16] = { 0 };
+        size_t keyLength_ = 0;
+        bool inBar_ = false;
+        bool stopped_ = false;
+
+        uint32_t time_ = 0;
+        double open_ = 0.;
+        double high_ = 0.;
+        double low_ = 0.;
+        double close_ = 0.;
+        uint32_t volume_ = 0;
+    };
+
+    /**
+     * @brief Stream the bars of a JSON response into flush.
+     * @return false with error set when the response could not be parsed or reported an error.
+     */
+    template<typename FlushT>
+    inline bool parseBars(const std::string& content, uint32_t timeDivisor, FlushT& flush, std::string& nextUrl, std::string& error) {
+        BarHandler<FlushT> handler(timeDivisor, flush);
+        rapidjson::Reader reader;
+        rapidjson::StringStream ss(content.c_str());
+        auto result = reader.Parse<rapidjson::kParseDefaultFlags>(ss, handler);
+        if (result.IsError() && !handler.stopped()) {
+            error = "Received parse error when deserializing bars JSON. err=" + std::to_string(result.Code()) + "\n" + content;
+            return false;
+        }
+        if (!handler.stopped()) {
+            handler.finish();
+        }
+        nextUrl = std::move(handler.nextUrl);
+        if (!handler.error.empty() && !handler.count) {
+            error = std::move(handler.error);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace alpaca
@@ -0,0 +1,63 @@
+#include "stdafx.h"
+#include "market_data/bar_sink.h"
+#include "market_data/bar_aggregator.h"
+
+namespace alpaca {
+
+    bool BarSink::write(const BarChunk& chunk) {
+        size_t i = 0;
+        while (i < chunk.size && wantsMore()) {
+            // skip bars newer than end or already written
+            while (i < chunk.size && (chunk.time[i] > end_ || chunk.time[i] >= last_)) {
+                ++i;
+            }
+
+            // take the run of bars that are all accepted and convert it in one go
+            auto j = i;
+            auto last = last_;
+            while (j < chunk.size && j - i < limit_ - count_ && chunk.time[j] < last && chunk.time[j] <= end_) {
+                if (chunk.time[j] < start_) {
+                    // bars are descending, everything after this is older than start
+                    pastStart_ = true;
+                    break;
+                }
+                last = chunk.time[j];
+                ++j;
+            }
+
+            if (j > i) {
+                append(chunk, i, j - i);
+                count_ += (uint32_t)(j - i);
+                last_ = last;
+            }
+            i = j;
+        }
+        return wantsMore();
+    }
+
+    void VectorBarSink::append(const BarChunk& chunk, size_t from, size_t n) {
+        for (auto i = from; i < from + n; ++i) {
+            Bar bar;
+            bar.time = chunk.time[i];
+            bar.open_price = chunk.open[i];
+            bar.high_price = chunk.high[i];
+            bar.low_price = chunk.low[i];
+            bar.close_price = chunk.close[i];
+            bar.volume = chunk.volume[i];
+            bars.emplace_back(bar);
+        }
+    }
+
+    void writeDescending(const BarColumns& columns, BarSink& sink, size_t begin) {
+        BarChunk chunk;
+        for (auto i = columns.size(); i > begin && sink.wantsMore();) {
+            --i;
+            chunk.push(columns.time[i], columns.open[i], columns.high[i], columns.low[i], columns.close[i], columns.volume[i]);
+            if (chunk.full() || i == begin) {
+                sink.write(chunk);
+                chunk.clear();
+            }
+        }
+    }
+
+} // namespace alpaca
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "market_data/bars.h"
+
+namespace alpaca {
+
+    struct BarColumns;
+
+    /**
+     * @brief A fixed size batch of bars in columnar layout.
+     *
+     * Parsers fill a chunk and hand it to a BarSink once it is full, so converting bars to their
+     * output format runs over a whole batch at a time without an intermediate vector of all bars.
+     */
+    struct BarChunk {
+        static constexpr size_t CAPACITY = 256;
+
+        uint32_t time[CAPACITY];
+        double open[CAPACITY];
+        double high[CAPACITY];
+        double low[CAPACITY];
+        double close[CAPACITY];
+        uint32_t volume[CAPACITY];
+        size_t size = 0;
+
+        bool full() const noexcept { return size == CAPACITY; }
+        void clear() noexcept { size = 0; }
+
+        void push(uint32_t t, double o, double h, double l, double c, uint32_t v) noexcept {
+            time[size] = t;
+            open[size] = o;
+            high[size] = h;
+            low[size] = l;
+            close[size] = c;
+            volume[size] = v;
+            ++size;
+        }
+    };
+
+    /**
+     * @brief Receives bars newest first.
+     *
+     * The sink keeps only bars starting within [start, end], drops duplicates and stops accepting
+     * once limit bars were written. Derived sinks only implement the output format.
+     */
+    class BarSink {
+    public:
+        BarSink(__time32_t start, __time32_t end, uint32_t limit) noexcept
+            : start_((uint32_t)start)
+            , end_(end ? (uint32_t)end : std::numeric_limits<uint32_t>::max())
+            , limit_(limit) {}
+        virtual ~BarSink() = default;
+
+        /**
+         * @brief Write a chunk of bars in descending time order.
+         * @return false when the sink doesn't want any more bars.
+         */
+        bool write(const BarChunk& chunk);
+
+        bool wantsMore() const noexcept { return count_ < limit_ && !pastStart_; }
+        uint32_t count() const noexcept { return count_; }
+        uint32_t limit() const noexcept { return limit_; }
+
+        /**
+         * @brief Start time of the oldest bar written, UINT32_MAX if none.
+         */
+        uint32_t oldest() const noexcept { return last_; }
+
+    protected:
+        /**
+         * @brief Output n accepted bars of the chunk starting at index from. They become bars [count(), count() + n).
+         */
+        virtual void append(const BarChunk& chunk, size_t from, size_t n) = 0;
+
+    private:
+        const uint32_t start_;
+        const uint32_t end_;
+        const uint32_t limit_;
+        uint32_t count_ = 0;
+        uint32_t last_ = std::numeric_limits<uint32_t>::max();
+        bool pastStart_ = false;
+    };
+
+    /**
+     * @brief Collect bars into a vector, newest first.
+     */
+    class VectorBarSink : public BarSink {
+    public:
+        VectorBarSink(__time32_t start, __time32_t end, uint32_t limit) : BarSink(start, end, limit) {}
+
+        std::vector<Bar> bars;
+
+    protected:
+        void append(const BarChunk& chunk, size_t from, size_t n) override;
+    };
+
+    /**
+     * @brief Write bars [begin, columns.size()), held in ascending order, into a sink newest first.
+     */
+    void writeDescending(const BarColumns& columns, BarSink& sink, size_t begin = 0);
+
+} // namespace alpaca
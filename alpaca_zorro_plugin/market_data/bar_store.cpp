@@ -0,0 +1,410 @@
+#include "stdafx.h"
+#include "market_data/bar_store.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include "market_data/column_codec.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr char MAGIC[4] = { 'A', 'B', 'S', '1' };
+        constexpr uint32_t VERSION = 2;
+        constexpr size_t BUFFER_SIZE = 1 << 20;
+        constexpr size_t STREAMS = 6;   // time, open, high, low, close, volume
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            int32_t nTickMinutes;
+            uint32_t reserved;
+            uint32_t from;      // all bars starting within [from, until] are in the file, 0 if not known
+            uint32_t until;
+        };
+
+        struct FileFooter {
+            uint64_t indexOffset;
+            uint32_t blocks;
+            char magic[4];
+        };
+
+        enum Stream { TIME, OPEN, HIGH, LOW, CLOSE, VOLUME };
+
+        struct BlockHeader {
+            uint32_t sizes[STREAMS];    // of the streams following the header
+            uint32_t decimals;          // prices are stored as integer units of 10^-decimals
+        };
+
+        constexpr uint32_t XOR_PRICES = 0xffffffff;    // prices are stored as Gorilla XORs
+        constexpr uint32_t MAX_DECIMALS = 6;
+        constexpr int64_t MAX_UNITS = 1ll << 30;    // so differences of units fit the 32 bit prefix code
+        const double SCALES[MAX_DECIMALS + 1] = { 1., 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+
+        inline bool toUnits(double price, double scale, int64_t& units) noexcept {
+            auto scaled = price * scale;
+            if (!(std::abs(scaled) < MAX_UNITS)) {
+                return false;
+            }
+            units = std::llround(scaled);
+            return (double)units / scale == price;
+        }
+
+        /**
+         * @brief The fewest decimals all prices of the block are exact in, XOR_PRICES if there are none.
+         *
+         * Prices quoted in cents or ticks are doubles with a long repeating mantissa, their XORs
+         * have 40 and more meaningful bits. As integer units the difference to a predicting
+         * price mostly fits in 9 bits.
+         */
+        uint32_t blockDecimals(const BarColumns& bars, size_t begin, size_t n) {
+            uint32_t decimals = 0;
+            int64_t units;
+            for (auto column : { &bars.open, &bars.high, &bars.low, &bars.close }) {
+                for (size_t i = begin; i < begin + n; ++i) {
+                    while (!toUnits((*column)[i], SCALES[decimals], units)) {
+                        if (++decimals > MAX_DECIMALS) {
+                            return XOR_PRICES;
+                        }
+                    }
+                }
+            }
+            // more decimals keep earlier prices exact in practice, but check rather than assume it
+            for (auto column : { &bars.open, &bars.high, &bars.low, &bars.close }) {
+                for (size_t i = begin; i < begin + n; ++i) {
+                    if (!toUnits((*column)[i], SCALES[decimals], units)) {
+                        return XOR_PRICES;
+                    }
+                }
+            }
+            return decimals;
+        }
+    }
+
+    BarStoreWriter::BarStoreWriter(const std::string& path, int nTickMinutes, uint32_t from, uint32_t until) {
+        if (fopen_s(&file_, path.c_str(), "wb")) {
+            file_ = nullptr;
+            error_ = "Failed to open " + path;
+            return;
+        }
+        buffer_ = (char*)malloc(BUFFER_SIZE);
+        if (buffer_) {
+            setvbuf(file_, buffer_, _IOFBF, BUFFER_SIZE);
+        }
+
+        FileHeader header = { { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] }, VERSION, nTickMinutes, 0, from, until };
+        if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+            error_ = "Failed to write " + path;
+        }
+        offset_ = sizeof(header);
+    }
+
+    BarStoreWriter::~BarStoreWriter() {
+        close();
+    }
+
+    void BarStoreWriter::encode(const BarColumns& bars, size_t begin, size_t n, std::vector<uint8_t>& out) {
+        // stream sizes up front so a reader can find any column without decoding the others
+        BlockHeader header;
+        header.decimals = blockDecimals(bars, begin, n);
+        out.assign(sizeof(header), 0);
+        auto stream = 0;
+        auto mark = out.size();
+        auto endStream = [&]() {
+            header.sizes[stream++] = (uint32_t)(out.size() - mark);
+            mark = out.size();
+        };
+
+        {
+            BitWriter bits(out);
+            TimeEncoder times(bits);
+            for (size_t i = begin; i < begin + n; ++i) {
+                times.add(bars.time[i]);
+            }
+        }
+        endStream();
+
+        // the open is predicted by the previous close, high, low and close by the open
+        if (header.decimals != XOR_PRICES) {
+            auto scale = SCALES[header.decimals];
+            auto units = [scale](double price) {
+                int64_t u;
+                toUnits(price, scale, u);
+                return u;
+            };
+            {
+                BitWriter bits(out);
+                bits.write((uint32_t)(int32_t)units(bars.open[begin]), 32);
+                for (size_t i = begin + 1; i < begin + n; ++i) {
+                    writeSigned(bits, units(bars.open[i]) - units(bars.close[i - 1]));
+                }
+            }
+            endStream();
+            for (auto column : { &bars.high, &bars.low, &bars.close }) {
+                {
+                    BitWriter bits(out);
+                    for (size_t i = begin; i < begin + n; ++i) {
+                        writeSigned(bits, units((*column)[i]) - units(bars.open[i]));
+                    }
+                }
+                endStream();
+            }
+        }
+        else {
+            {
+                BitWriter bits(out);
+                XorEncoder opens(bits);
+                opens.add(bars.open[begin]);
+                for (size_t i = begin + 1; i < begin + n; ++i) {
+                    opens.add(bars.open[i], bars.close[i - 1]);
+                }
+            }
+            endStream();
+            for (auto column : { &bars.high, &bars.low, &bars.close }) {
+                {
+                    BitWriter bits(out);
+                    XorEncoder prices(bits);
+                    for (size_t i = begin; i < begin + n; ++i) {
+                        prices.add((*column)[i], bars.open[i]);
+                    }
+                }
+                endStream();
+            }
+        }
+
+        for (size_t i = begin; i < begin + n; ++i) {
+            writeVarint(out, bars.volume[i]);
+        }
+        endStream();
+        memcpy(out.data(), &header, sizeof(header));
+    }
+
+    void BarStoreWriter::writeBlock(const BarColumns& bars, size_t begin, size_t n) {
+        if (!file_ || !error_.empty() || !n) {
+            return;
+        }
+        assert(n <= BLOCK_BARS && begin + n <= bars.size());
+
+        encode(bars, begin, n, block_);
+        BarBlockIndex entry;
+        entry.offset = offset_;
+        entry.bytes = (uint32_t)block_.size();
+        entry.count = (uint32_t)n;
+        entry.minTime = bars.time[begin];
+        entry.maxTime = bars.time[begin + n - 1];
+        entry.minLow = columnMin(&bars.low[begin], n);
+        entry.maxHigh = columnMax(&bars.high[begin], n);
+
+        if (fwrite(block_.data(), 1, block_.size(), file_) != block_.size()) {
+            error_ = "Failed to write bar block";
+            return;
+        }
+        offset_ += block_.size();
+        index_.push_back(entry);
+    }
+
+    void BarStoreWriter::append(const BarColumns& bars) {
+        for (size_t begin = 0; begin < bars.size(); begin += BLOCK_BARS) {
+            writeBlock(bars, begin, std::min(BLOCK_BARS, bars.size() - begin));
+        }
+    }
+
+    void BarStoreWriter::close() {
+        if (!file_) {
+            return;
+        }
+
+        if (error_.empty()) {
+            std::sort(index_.begin(), index_.end(), [](const BarBlockIndex& a, const BarBlockIndex& b) { return a.minTime < b.minTime; });
+            FileFooter footer = { offset_, (uint32_t)index_.size(), { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] } };
+            if ((!index_.empty() && fwrite(index_.data(), sizeof(BarBlockIndex), index_.size(), file_) != index_.size()) ||
+                fwrite(&footer, sizeof(footer), 1, file_) != 1) {
+                error_ = "Failed to write bar index";
+            }
+        }
+        if (fclose(file_) && error_.empty()) {
+            error_ = "Failed to write bar file";
+        }
+        file_ = nullptr;
+        free(buffer_);
+        buffer_ = nullptr;
+    }
+
+    BarStoreReader::BarStoreReader(const std::string& path) {
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            file_ = nullptr;
+            error_ = "Failed to open " + path;
+            return;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || (uint64_t)size.QuadPart < sizeof(FileHeader) + sizeof(FileFooter)) {
+            error_ = path + " is not a bar file";
+            close();
+            return;
+        }
+        size_ = (uint64_t)size.QuadPart;
+
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_) {
+            data_ = (const uint8_t*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        }
+        if (!data_) {
+            error_ = "Failed to map " + path;
+            close();
+            return;
+        }
+
+        FileHeader header;
+        FileFooter footer;
+        memcpy(&header, data_, sizeof(header));
+        memcpy(&footer, data_ + size_ - sizeof(footer), sizeof(footer));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) || memcmp(footer.magic, MAGIC, sizeof(MAGIC)) || header.version != VERSION ||
+            footer.indexOffset + (uint64_t)footer.blocks * sizeof(BarBlockIndex) + sizeof(footer) != size_) {
+            error_ = path + " is not a bar file or was not closed";
+            close();
+            return;
+        }
+
+        nTickMinutes_ = header.nTickMinutes;
+        from_ = header.from;
+        until_ = header.until;
+        index_.resize(footer.blocks);
+        if (footer.blocks) {
+            memcpy(index_.data(), data_ + footer.indexOffset, footer.blocks * sizeof(BarBlockIndex));
+        }
+    }
+
+    BarStoreReader::~BarStoreReader() {
+        close();
+    }
+
+    void BarStoreReader::close() noexcept {
+        if (data_) {
+            UnmapViewOfFile(data_);
+            data_ = nullptr;
+        }
+        if (mapping_) {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+        if (file_) {
+            CloseHandle(file_);
+            file_ = nullptr;
+        }
+    }
+
+    void BarStoreReader::decode(const uint8_t* data, size_t bytes, uint32_t count, BarColumns& out) {
+        BlockHeader header;
+        if (bytes < sizeof(header) || !count) {
+            return;
+        }
+        memcpy(&header, data, sizeof(header));
+        out.reserve(out.size() + count);
+
+        // one reader per stream, decoded bar by bar since the prices refer to each other
+        const uint8_t* streams[STREAMS];
+        size_t lengths[STREAMS];
+        size_t offset = sizeof(header);
+        for (size_t i = 0; i < STREAMS; ++i) {
+            streams[i] = data + std::min(offset, bytes);
+            lengths[i] = std::min<size_t>(header.sizes[i], bytes - std::min(offset, bytes));
+            offset += header.sizes[i];
+        }
+        BitReader timeBits(streams[TIME], lengths[TIME]);
+        BitReader openBits(streams[OPEN], lengths[OPEN]);
+        BitReader highBits(streams[HIGH], lengths[HIGH]);
+        BitReader lowBits(streams[LOW], lengths[LOW]);
+        BitReader closeBits(streams[CLOSE], lengths[CLOSE]);
+        TimeDecoder times(timeBits);
+        auto volume = streams[VOLUME];
+        auto volumeEnd = volume + lengths[VOLUME];
+
+        if (header.decimals != XOR_PRICES) {
+            auto scale = SCALES[std::min(header.decimals, MAX_DECIMALS)];
+            int64_t close = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                auto open = i ? close + readSigned(openBits) : (int64_t)(int32_t)(uint32_t)openBits.read(32);
+                auto high = open + readSigned(highBits);
+                auto low = open + readSigned(lowBits);
+                close = open + readSigned(closeBits);
+                out.time.push_back(times.next());
+                out.open.push_back((double)open / scale);
+                out.high.push_back((double)high / scale);
+                out.low.push_back((double)low / scale);
+                out.close.push_back((double)close / scale);
+                out.volume.push_back((uint32_t)readVarint(volume, volumeEnd));
+            }
+            return;
+        }
+
+        XorDecoder opens(openBits), highs(highBits), lows(lowBits), closes(closeBits);
+        for (uint32_t i = 0; i < count; ++i) {
+            auto open = i ? opens.next(out.close.back()) : opens.next();
+            out.time.push_back(times.next());
+            out.open.push_back(open);
+            out.high.push_back(highs.next(open));
+            out.low.push_back(lows.next(open));
+            out.close.push_back(closes.next(open));
+            out.volume.push_back((uint32_t)readVarint(volume, volumeEnd));
+        }
+    }
+
+    void BarStoreReader::decode(size_t i, BarColumns& out) const {
+        auto& block = index_[i];
+        if (block.offset + block.bytes > size_) {
+            return;
+        }
+        decode(data_ + block.offset, block.bytes, block.count, out);
+    }
+
+    uint32_t BarStoreReader::read(__time32_t start, __time32_t end, BarSink& sink) const {
+        auto first = sink.count();
+        auto to = (uint32_t)(end ? end : std::numeric_limits<__time32_t>::max());
+
+        // the newest block starting within the range, then walk back until the blocks end before start
+        auto it = std::upper_bound(index_.begin(), index_.end(), to, [](uint32_t t, const BarBlockIndex& b) { return t < b.minTime; });
+        BarColumns bars;
+        while (it != index_.begin() && sink.wantsMore()) {
+            --it;
+            if (it->maxTime < (uint32_t)start) {
+                break;
+            }
+            bars.clear();
+            decode(it - index_.begin(), bars);
+            writeDescending(bars, sink);
+        }
+        return sink.count() - first;
+    }
+
+    void BarStoreSink::append(const BarChunk& chunk, size_t from, size_t n) {
+        for (size_t i = from; i < from + n; ++i) {
+            pending_.time.push_back(chunk.time[i]);
+            pending_.open.push_back(chunk.open[i]);
+            pending_.high.push_back(chunk.high[i]);
+            pending_.low.push_back(chunk.low[i]);
+            pending_.close.push_back(chunk.close[i]);
+            pending_.volume.push_back(chunk.volume[i]);
+            if (pending_.size() == BarStoreWriter::BLOCK_BARS) {
+                flush();
+            }
+        }
+    }
+
+    void BarStoreSink::flush() {
+        // bars arrive newest first, a block is stored ascending
+        pending_.reverse();
+        writer_.append(pending_);
+        pending_.clear();
+    }
+
+    void BarStoreSink::close() {
+        if (!pending_.empty()) {
+            flush();
+        }
+        writer_.close();
+    }
+
+} // namespace alpaca
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "market_data/bar_aggregator.h"
+#include "market_data/bar_sink.h"
+
+namespace alpaca {
+
+    /**
+     * @brief Index entry of a compressed block of bars.
+     *
+     * The index is kept at the end of the file sorted by time, a range read only decodes the
+     * blocks whose [minTime, maxTime] overlaps it.
+     */
+    struct BarBlockIndex {
+        uint64_t offset;    // of the block in the file
+        uint32_t bytes;
+        uint32_t count;     // bars in the block
+        uint32_t minTime;
+        uint32_t maxTime;
+        double minLow;
+        double maxHigh;
+    };
+
+    /**
+     * @brief Writes bars into a compressed columnar file, e.g. History/AAPL_2020.bars.
+     *
+     * Bars are stored in blocks of up to BLOCK_BARS bars in ascending time order. Within a block
+     * every column is a separate stream: delta-of-delta times, open, high, low and close, and
+     * varint volumes. Prices are differences of integer units when all prices of the block are
+     * exact decimals with up to 6 places, Gorilla XORs otherwise. Blocks may be written in any
+     * order as long as they don't overlap.
+     */
+    class BarStoreWriter {
+    public:
+        static constexpr size_t BLOCK_BARS = 4096;
+
+        /**
+         * @param from, until all bars starting within [from, until] are written, a reader may serve the range from the
+         * file alone. 0 if not known.
+         */
+        BarStoreWriter(const std::string& path, int nTickMinutes, uint32_t from = 0, uint32_t until = 0);
+        ~BarStoreWriter();
+
+        bool isOpen() const noexcept { return file_ != nullptr; }
+
+        /**
+         * @brief Error opening or writing the file, empty if none.
+         */
+        const std::string& error() const noexcept { return error_; }
+
+        /**
+         * @brief Write bars [begin, begin + n) of ascending columns as one block, n <= BLOCK_BARS.
+         */
+        void writeBlock(const BarColumns& bars, size_t begin, size_t n);
+
+        /**
+         * @brief Write ascending bars, cut into blocks of BLOCK_BARS bars.
+         */
+        void append(const BarColumns& bars);
+
+        /**
+         * @brief Write the index and close the file.
+         */
+        void close();
+
+        /**
+         * @brief Compress a block into out, exposed for measuring the codecs.
+         */
+        static void encode(const BarColumns& bars, size_t begin, size_t n, std::vector<uint8_t>& out);
+
+    private:
+        FILE* file_ = nullptr;
+        char* buffer_ = nullptr;
+        uint64_t offset_ = 0;
+        std::vector<BarBlockIndex> index_;
+        std::vector<uint8_t> block_;
+        std::string error_;
+    };
+
+    /**
+     * @brief Reads a compressed bar file through a read only memory mapping.
+     */
+    class BarStoreReader {
+    public:
+        explicit BarStoreReader(const std::string& path);
+        ~BarStoreReader();
+
+        BarStoreReader(const BarStoreReader&) = delete;
+        BarStoreReader& operator=(const BarStoreReader&) = delete;
+
+        bool isOpen() const noexcept { return data_ != nullptr; }
+        const std::string& error() const noexcept { return error_; }
+
+        int nTickMinutes() const noexcept { return nTickMinutes_; }
+        const std::vector<BarBlockIndex>& blocks() const noexcept { return index_; }
+
+        /**
+         * @brief The file holds every bar starting within [start, end].
+         */
+        bool covers(__time32_t start, __time32_t end) const noexcept {
+            return until_ && from_ <= (uint32_t)start && (uint32_t)end <= until_;
+        }
+
+        /**
+         * @brief Decode block i and append its bars to out in ascending order.
+         */
+        void decode(size_t i, BarColumns& out) const;
+
+        /**
+         * @brief Write bars starting within [start, end] into sink, newest first.
+         * @return the number of bars written into the sink.
+         */
+        uint32_t read(__time32_t start, __time32_t end, BarSink& sink) const;
+
+        /**
+         * @brief Decompress a block of count bars, exposed for measuring the codecs.
+         */
+        static void decode(const uint8_t* data, size_t bytes, uint32_t count, BarColumns& out);
+
+    private:
+        void close() noexcept;
+
+    private:
+        void* file_ = nullptr;      // HANDLE
+        void* mapping_ = nullptr;   // HANDLE
+        const uint8_t* data_ = nullptr;
+        uint64_t size_ = 0;
+        int nTickMinutes_ = 0;
+        uint32_t from_ = 0;
+        uint32_t until_ = 0;
+        std::vector<BarBlockIndex> index_;
+        std::string error_;
+    };
+
+    /**
+     * @brief Receives bars newest first and writes them into a compressed bar file.
+     */
+    class BarStoreSink : public BarSink {
+    public:
+        /**
+         * @param until the bars up to here are complete, see BarStoreWriter
+         */
+        BarStoreSink(const std::string& path, __time32_t start, __time32_t end, int nTickMinutes, __time32_t until = 0)
+            : BarSink(start, end, std::numeric_limits<uint32_t>::max())
+            , writer_(path, nTickMinutes, until ? (uint32_t)start : 0, (uint32_t)until) {}
+        ~BarStoreSink() override { close(); }
+
+        bool isOpen() const noexcept { return writer_.isOpen(); }
+
+        /**
+         * @brief Write the last block and the index.
+         */
+        void close();
+
+        const std::string& error() const noexcept { return writer_.error(); }
+
+    protected:
+        void append(const BarChunk& chunk, size_t from, size_t n) override;
+
+    private:
+        void flush();
+
+    private:
+        BarStoreWriter writer_;
+        BarColumns pending_;    // newest first
+    };
+
+} // namespace alpaca
@@ -3,6 +3,7 @@
 #include <map>
 #include <string>
 #include <vector>
+#include "alpaca/json.h"
 
 namespace alpaca {
 	std::string timeToString(__time32_t time);
@@ -21,25 +22,25 @@ namespace alpaca {
 
 		template<typename CallerT, typename T>
 		std::pair<int, std::string> fromJSON(const T& parser, typename std::enable_if<std::is_same<CallerT, class AlpacaMarketData>::value>::type* = 0) {
-			parser.get<uint32_t>("t", time);
-			parser.get<double>("o", open_price);
-			parser.get<double>("h", high_price);
-			parser.get<double>("l", low_price);
-			parser.get<double>("c", close_price);
-			parser.get<uint32_t>("v", volume);
+			parser.template get<uint32_t>("t", time);
+			parser.template get<double>("o", open_price);
+			parser.template get<double>("h", high_price);
+			parser.template get<double>("l", low_price);
+			parser.template get<double>("c", close_price);
+			parser.template get<uint32_t>("v", volume);
 			return std::make_pair(0, "OK");
 		}
 
 		template<typename CallerT, typename T>
 		std::pair<int, std::string> fromJSON(const T& parser, typename std::enable_if<std::is_same<CallerT, class Polygon>::value>::type* = 0) {
 			uint64_t t;
-			parser.get<uint64_t>("t", t);
+			parser.template get<uint64_t>("t", t);
 			time = t / 1000;
-			parser.get<double>("o", open_price);
-			parser.get<double>("h", high_price);
-			parser.get<double>("l", low_price);
-			parser.get<double>("c", close_price);
-			parser.get<uint32_t>("v", volume);
+			parser.template get<double>("o", open_price);
+			parser.template get<double>("h", high_price);
+			parser.template get<double>("l", low_price);
+			parser.template get<double>("c", close_price);
+			parser.template get<uint32_t>("v", volume);
 			return std::make_pair(0, "OK");
 		}
 	};
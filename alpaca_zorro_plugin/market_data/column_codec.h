@@ -0,0 +1,317 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace alpaca {
+
+    /**
+     * @brief Appends bit fields, most significant bit first, to a byte buffer.
+     */
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) noexcept : out_(out) {}
+
+        /**
+         * @brief Write the low n bits of value, n <= 64.
+         */
+        void write(uint64_t value, uint32_t n) {
+            while (n) {
+                auto take = n < 8 - used_ ? n : 8 - used_;
+                auto bits = (uint8_t)((value >> (n - take)) & ((1u << take) - 1));
+                if (!used_) {
+                    out_.push_back(0);
+                }
+                out_.back() |= (uint8_t)(bits << (8 - used_ - take));
+                used_ = (used_ + take) & 7;
+                n -= take;
+            }
+        }
+
+        void bit(bool set) { write(set ? 1 : 0, 1); }
+
+    private:
+        std::vector<uint8_t>& out_;
+        uint32_t used_ = 0;     // bits used in the last byte
+    };
+
+    /**
+     * @brief Reads bit fields written by BitWriter.
+     *
+     * Keeps up to 64 bits in a register so most reads are a shift and a mask. Reading past the
+     * end returns zero bits, the caller knows the number of values in the stream.
+     */
+    class BitReader {
+    public:
+        BitReader(const uint8_t* data, size_t size) noexcept : data_(data), end_(data + size) {}
+
+        uint64_t read(uint32_t n) {
+            if (!n) {
+                return 0;
+            }
+            if (n > 56) {
+                auto high = read(n - 32);
+                return (high << 32) | read(32);
+            }
+            if (n > count_) {
+                refill();
+            }
+            auto value = buffer_ >> (64 - n);
+            buffer_ <<= n;
+            count_ -= n;
+            return value;
+        }
+
+        bool bit() { return read(1) != 0; }
+
+    private:
+        void refill() {
+            while (count_ <= 56) {
+                uint64_t byte = data_ < end_ ? *data_++ : 0;
+                buffer_ |= byte << (56 - count_);
+                count_ += 8;
+            }
+        }
+
+        const uint8_t* data_;
+        const uint8_t* end_;
+        uint64_t buffer_ = 0;   // next bits, left aligned
+        uint32_t count_ = 0;
+    };
+
+    inline void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back((uint8_t)value);
+    }
+
+    inline uint64_t readVarint(const uint8_t*& p, const uint8_t* end) noexcept {
+        uint64_t value = 0;
+        for (uint32_t shift = 0; p < end && shift < 64; shift += 7) {
+            auto byte = *p++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        return value;
+    }
+
+    inline uint64_t zigzag(int64_t v) noexcept { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+    inline int64_t unzigzag(uint64_t v) noexcept { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+    /**
+     * @brief Write a signed value with a prefix code favouring small magnitudes: 0 costs one bit,
+     * [-63, 64] 9 bits, [-255, 256] 12 bits, [-2047, 2048] 16 bits and any other int32 36 bits.
+     */
+    inline void writeSigned(BitWriter& out, int64_t v) {
+        if (v == 0) {
+            out.bit(false);
+        }
+        else if (v >= -63 && v <= 64) {
+            out.write(0x2, 2);
+            out.write((uint64_t)(v + 63), 7);
+        }
+        else if (v >= -255 && v <= 256) {
+            out.write(0x6, 3);
+            out.write((uint64_t)(v + 255), 9);
+        }
+        else if (v >= -2047 && v <= 2048) {
+            out.write(0xe, 4);
+            out.write((uint64_t)(v + 2047), 12);
+        }
+        else {
+            out.write(0xf, 4);
+            out.write((uint32_t)(int32_t)v, 32);
+        }
+    }
+
+    inline int64_t readSigned(BitReader& in) {
+        if (!in.bit()) {
+            return 0;
+        }
+        if (!in.bit()) {
+            return (int64_t)in.read(7) - 63;
+        }
+        if (!in.bit()) {
+            return (int64_t)in.read(9) - 255;
+        }
+        if (!in.bit()) {
+            return (int64_t)in.read(12) - 2047;
+        }
+        return (int32_t)(uint32_t)in.read(32);
+    }
+
+    /**
+     * @brief Delta-of-delta timestamp encoding as in Facebook's Gorilla.
+     *
+     * Evenly spaced timestamps cost one bit each. Other changes of the spacing cost 9, 12 or 16
+     * bits when small and 36 bits otherwise, e.g. across a night or a weekend.
+     */
+    class TimeEncoder {
+    public:
+        explicit TimeEncoder(BitWriter& out) noexcept : out_(out) {}
+
+        void add(uint32_t t) {
+            if (!count_++) {
+                out_.write(t, 32);
+            }
+            else {
+                int64_t delta = (int64_t)t - prev_;
+                writeSigned(out_, delta - prevDelta_);
+                prevDelta_ = delta;
+            }
+            prev_ = t;
+        }
+
+    private:
+        BitWriter& out_;
+        uint32_t count_ = 0;
+        int64_t prev_ = 0;
+        int64_t prevDelta_ = 0;
+    };
+
+    class TimeDecoder {
+    public:
+        explicit TimeDecoder(BitReader& in) noexcept : in_(in) {}
+
+        uint32_t next() {
+            if (!count_++) {
+                prev_ = (int64_t)in_.read(32);
+                return (uint32_t)prev_;
+            }
+            prevDelta_ += readSigned(in_);
+            prev_ += prevDelta_;
+            return (uint32_t)prev_;
+        }
+
+    private:
+        BitReader& in_;
+        uint32_t count_ = 0;
+        int64_t prev_ = 0;
+        int64_t prevDelta_ = 0;
+    };
+
+    /**
+     * @brief XOR float encoding as in Facebook's Gorilla.
+     *
+     * A value equal to its reference costs one bit. Otherwise the XOR with the reference is stored
+     * as its meaningful bits, reusing the leading/trailing zero window of the last XOR when it
+     * fits. The reference is the previous value unless the caller passes a better predictor both
+     * sides know, e.g. the open of the same bar for its close.
+     */
+    class XorEncoder {
+    public:
+        explicit XorEncoder(BitWriter& out) noexcept : out_(out) {}
+
+        void add(double value) { put(bitsOf(value), prev_); }
+        void add(double value, double reference) { put(bitsOf(value), bitsOf(reference)); }
+
+        static uint64_t bitsOf(double value) noexcept {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        static uint32_t leadingZeros(uint64_t x) noexcept {
+            uint32_t n = 0;
+            for (uint64_t mask = 1ull << 63; mask && !(x & mask); mask >>= 1) {
+                ++n;
+            }
+            return n;
+        }
+
+        static uint32_t trailingZeros(uint64_t x) noexcept {
+            uint32_t n = 0;
+            for (; n < 64 && !(x & 1); x >>= 1) {
+                ++n;
+            }
+            return n;
+        }
+
+    private:
+        void put(uint64_t bits, uint64_t reference) {
+            if (!count_++) {
+                out_.write(bits, 64);
+                prev_ = bits;
+                return;
+            }
+
+            auto x = bits ^ reference;
+            prev_ = bits;
+            if (!x) {
+                out_.bit(false);
+                return;
+            }
+            out_.bit(true);
+
+            auto leading = leadingZeros(x);
+            auto trailing = trailingZeros(x);
+            if (leading > 31) {
+                leading = 31;   // 5 bits
+            }
+            if (window_ && leading >= leading_ && trailing >= trailing_) {
+                out_.bit(false);
+                out_.write(x >> trailing_, 64 - leading_ - trailing_);
+                return;
+            }
+
+            auto meaningful = 64 - leading - trailing;
+            out_.bit(true);
+            out_.write(leading, 5);
+            out_.write(meaningful - 1, 6);  // 1 - 64 meaningful bits in 6 bits
+            out_.write(x >> trailing, meaningful);
+            leading_ = leading;
+            trailing_ = trailing;
+            window_ = true;
+        }
+
+    private:
+        BitWriter& out_;
+        uint32_t count_ = 0;
+        uint64_t prev_ = 0;
+        uint32_t leading_ = 0;
+        uint32_t trailing_ = 0;
+        bool window_ = false;
+    };
+
+    class XorDecoder {
+    public:
+        explicit XorDecoder(BitReader& in) noexcept : in_(in) {}
+
+        double next() { return take(prev_); }
+        double next(double reference) { return take(XorEncoder::bitsOf(reference)); }
+
+    private:
+        double take(uint64_t reference) {
+            if (!count_++) {
+                prev_ = in_.read(64);
+            }
+            else if (in_.bit()) {
+                if (in_.bit()) {
+                    leading_ = (uint32_t)in_.read(5);
+                    auto meaningful = (uint32_t)in_.read(6) + 1;
+                    trailing_ = 64 - leading_ - meaningful;
+                }
+                prev_ = reference ^ (in_.read(64 - leading_ - trailing_) << trailing_);
+            }
+            else {
+                prev_ = reference;
+            }
+            double value;
+            memcpy(&value, &prev_, sizeof(value));
+            return value;
+        }
+
+    private:
+        BitReader& in_;
+        uint32_t count_ = 0;
+        uint64_t prev_ = 0;
+        uint32_t leading_ = 0;
+        uint32_t trailing_ = 0;
+    };
+
+} // namespace alpaca
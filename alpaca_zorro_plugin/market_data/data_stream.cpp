@@ -0,0 +1,261 @@
+#include "stdafx.h"
+#include "market_data/data_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "alpaca/clock.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr const char* STREAM_URL = "wss://stream.data.alpaca.markets/v2/";
+        constexpr uint32_t MIN_RECONNECT_MS = 1000;
+        constexpr uint32_t MAX_RECONNECT_MS = 30000;
+
+        bool isType(const rapidjson::Value& item, const char* type) {
+            return item.HasMember("T") && item["T"].IsString() && strcmp(item["T"].GetString(), type) == 0;
+        }
+
+        double number(const rapidjson::Value& item, const char* name) {
+            auto it = item.FindMember(name);
+            return it != item.MemberEnd() && it->value.IsNumber() ? it->value.GetDouble() : 0.;
+        }
+
+        int exchange(const rapidjson::Value& item, const char* name) {
+            auto it = item.FindMember(name);
+            return it != item.MemberEnd() && it->value.IsString() ? (unsigned char)it->value.GetString()[0] : 0;
+        }
+
+        std::string message(const rapidjson::Value& item) {
+            return item.HasMember("msg") && item["msg"].IsString() ? item["msg"].GetString() : "";
+        }
+    }
+
+    DataStream::DataStream(std::string key, std::string secret, std::string feed, Logger& logger)
+        : url_(STREAM_URL + feed)
+        , key_(std::move(key))
+        , secret_(std::move(secret))
+        , logger_(logger) {
+    }
+
+    DataStream::~DataStream() {
+        stop();
+    }
+
+    void DataStream::start() {
+        if (thread_.joinable()) {
+            return;
+        }
+        stop_ = false;
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    void DataStream::stop() {
+        stop_ = true;
+        socket_.interrupt();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        socket_.close();
+    }
+
+    void DataStream::subscribeTrades(const std::string& symbol) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!trades_.insert(symbol).second) {
+            return;
+        }
+        if (authenticated_) {
+            sendSubscription({ symbol }, {});
+        }
+    }
+
+    void DataStream::subscribeQuotes(const std::string& symbol) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!quotes_.insert(symbol).second) {
+            return;
+        }
+        if (authenticated_) {
+            sendSubscription({}, { symbol });
+        }
+    }
+
+    StreamMetrics DataStream::metrics() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return metrics_;
+    }
+
+    void DataStream::sendSubscription(const std::set<std::string>& trades, const std::set<std::string>& quotes) {
+        // called with mutex_ held, which also keeps sends of different threads apart
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        auto list = [&writer](const char* channel, const std::set<std::string>& symbols) {
+            if (symbols.empty()) {
+                return;
+            }
+            writer.Key(channel);
+            writer.StartArray();
+            for (auto& symbol : symbols) {
+                writer.String(symbol.c_str());
+            }
+            writer.EndArray();
+        };
+        writer.StartObject();
+        writer.Key("action");
+        writer.String("subscribe");
+        list("trades", trades);
+        list("quotes", quotes);
+        writer.EndObject();
+        if (!socket_.send(buffer.GetString())) {
+            logger_.logWarning("Data stream: %s\n", socket_.error().c_str());
+        }
+    }
+
+    bool DataStream::authenticate(std::string& reply) {
+        // the server greets with "connected" and answers the auth message with "authenticated"
+        std::string auth = "{\"action\":\"auth\",\"key\":\"" + key_ + "\",\"secret\":\"" + secret_ + "\"}";
+        bool sent = false;
+        while (socket_.receive(reply)) {
+            rapidjson::Document d;
+            if (d.Parse(reply.c_str()).HasParseError() || !d.IsArray()) {
+                continue;
+            }
+            for (auto& item : d.GetArray()) {
+                if (isType(item, "error")) {
+                    reply = message(item);
+                    return false;
+                }
+                if (!isType(item, "success")) {
+                    continue;
+                }
+                auto msg = message(item);
+                if (msg == "connected" && !sent) {
+                    if (!socket_.send(auth)) {
+                        reply = socket_.error();
+                        return false;
+                    }
+                    sent = true;
+                }
+                else if (msg == "authenticated") {
+                    return true;
+                }
+            }
+        }
+        reply = socket_.error();
+        return false;
+    }
+
+    void DataStream::run() {
+        auto delay = MIN_RECONNECT_MS;
+        std::string message;
+        while (!stop_) {
+            if (socket_.connect(url_)) {
+                if (authenticate(message)) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        ++metrics_.connects;
+                        authenticated_ = true;
+                        if (!trades_.empty() || !quotes_.empty()) {
+                            sendSubscription(trades_, quotes_);
+                        }
+                    }
+                    logger_.logInfo("Data stream connected to %s\n", url_.c_str());
+                    if (onGap_) {
+                        // trades and quotes before the subscription were missed
+                        onGap_();
+                    }
+                    delay = MIN_RECONNECT_MS;
+
+                    while (!stop_ && socket_.receive(message)) {
+                        dispatch(message);
+                    }
+                    authenticated_ = false;
+                    if (onGap_) {
+                        // trades after the last one received are missing until the next connect
+                        onGap_();
+                    }
+                    message = socket_.error();
+                }
+            }
+            else {
+                message = socket_.error();
+            }
+            socket_.close();
+            if (stop_) {
+                break;
+            }
+
+            logger_.logWarning("Data stream disconnected: %s. Reconnect in %u ms\n", message.c_str(), delay);
+            for (uint32_t waited = 0; waited < delay && !stop_; waited += 100) {
+                Sleep(100);
+            }
+            delay = std::min(delay * 2, MAX_RECONNECT_MS);
+        }
+    }
+
+    void DataStream::dispatch(const std::string& message) {
+        rapidjson::Document d;
+        if (d.Parse(message.c_str()).HasParseError() || !d.IsArray()) {
+            logger_.logWarning("Data stream: unexpected message %s\n", message.c_str());
+            return;
+        }
+
+        uint64_t trades = 0;
+        uint64_t quotes = 0;
+        for (auto& item : d.GetArray()) {
+            if (!item.IsObject() || !item.HasMember("T") || !item["T"].IsString()) {
+                continue;
+            }
+            auto type = item["T"].GetString();
+            if (type[0] == 't' && !type[1]) {
+                if (!item.HasMember("S") || !item.HasMember("p") || !item.HasMember("t") || !item["S"].IsString() || !item["p"].IsNumber() || !item["t"].IsString()) {
+                    continue;
+                }
+                auto& t = item["t"];
+                StreamTrade trade;
+                trade.symbol = item["S"].GetString();
+                trade.time = parseNanos(t.GetString(), t.GetStringLength());
+                trade.price = item["p"].GetDouble();
+                trade.size = item.HasMember("s") && item["s"].IsUint() ? item["s"].GetUint() : 0;
+                ++trades;
+                if (onTrade_) {
+                    onTrade_(trade);
+                }
+            }
+            else if (type[0] == 'q' && !type[1]) {
+                if (!item.HasMember("S") || !item.HasMember("t") || !item["S"].IsString() || !item["t"].IsString()) {
+                    continue;
+                }
+                auto& t = item["t"];
+                StreamQuote quote;
+                quote.symbol = item["S"].GetString();
+                quote.quote.bid_price = number(item, "bp");
+                quote.quote.bid_size = (int)number(item, "bs");
+                quote.quote.bid_exchange = exchange(item, "bx");
+                quote.quote.ask_price = number(item, "ap");
+                quote.quote.ask_size = (int)number(item, "as");
+                quote.quote.ask_exchange = exchange(item, "ax");
+                quote.quote.timestamp = (uint64_t)parseNanos(t.GetString(), t.GetStringLength());
+                ++quotes;
+                if (onQuote_) {
+                    onQuote_(quote);
+                }
+            }
+            else if (isType(item, "error")) {
+                logger_.logError("Data stream error: %s\n", message.c_str());
+            }
+            else if (isType(item, "subscription")) {
+                logger_.logDebug("Data stream: %s\n", message.c_str());
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++metrics_.messages;
+        metrics_.trades += trades;
+        metrics_.quotes += quotes;
+    }
+
+} // namespace alpaca
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include "logger.h"
+#include "websocket.h"
+#include "market_data/quote.h"
+
+namespace alpaca {
+
+    struct StreamTrade {
+        const char* symbol;
+        int64_t time;       // nanoseconds since epoch
+        double price;
+        uint32_t size;
+    };
+
+    struct StreamQuote {
+        const char* symbol;
+        Quote quote;        // exchanges are the ASCII codes of the exchange letters, timestamp in nanoseconds since epoch
+    };
+
+    struct StreamMetrics {
+        uint64_t messages = 0;
+        uint64_t trades = 0;
+        uint64_t quotes = 0;
+        uint32_t connects = 0;
+    };
+
+    /**
+     * @brief Alpaca real time market data over a WebSocket (wss://stream.data.alpaca.markets/v2/<feed>).
+     *
+     * A background thread connects, authenticates, subscribes and hands every trade and quote to
+     * the trade and quote handlers. It reconnects with a growing delay when the connection drops and subscribes again.
+     * The gap handler is called on every connect and disconnect, trades and quotes before it may be missing.
+     * Handlers run on the stream thread and must not call into Zorro.
+     */
+    class DataStream {
+    public:
+        using TradeHandler = std::function<void(const StreamTrade&)>;
+        using QuoteHandler = std::function<void(const StreamQuote&)>;
+        using GapHandler = std::function<void()>;
+
+        /**
+         * @param feed "iex" with a free data plan, "sip" with an unlimited one
+         */
+        DataStream(std::string key, std::string secret, std::string feed, Logger& logger);
+        ~DataStream();
+
+        DataStream(const DataStream&) = delete;
+        DataStream& operator=(const DataStream&) = delete;
+
+        /**
+         * @brief Set the handlers before start().
+         */
+        void onTrade(TradeHandler handler) { onTrade_ = std::move(handler); }
+        void onQuote(QuoteHandler handler) { onQuote_ = std::move(handler); }
+        void onGap(GapHandler handler) { onGap_ = std::move(handler); }
+
+        void start();
+        void stop();
+
+        /**
+         * @brief Subscribe the trades of a symbol, now if connected and after every reconnect.
+         */
+        void subscribeTrades(const std::string& symbol);
+
+        /**
+         * @brief Subscribe the quotes of a symbol, now if connected and after every reconnect.
+         */
+        void subscribeQuotes(const std::string& symbol);
+
+        bool isConnected() const noexcept { return authenticated_; }
+        StreamMetrics metrics() const;
+
+    private:
+        void run();
+        bool authenticate(std::string& message);
+        void sendSubscription(const std::set<std::string>& trades, const std::set<std::string>& quotes);
+        void dispatch(const std::string& message);
+
+    private:
+        const std::string url_;
+        const std::string key_;
+        const std::string secret_;
+        Logger& logger_;
+        TradeHandler onTrade_;
+        QuoteHandler onQuote_;
+        GapHandler onGap_;
+
+        WebSocket socket_;
+        std::thread thread_;
+        std::atomic<bool> stop_{ false };
+        std::atomic<bool> authenticated_{ false };
+
+        mutable std::mutex mutex_;          // guards the members below
+        std::set<std::string> trades_;      // subscribed symbols
+        std::set<std::string> quotes_;
+        StreamMetrics metrics_;
+    };
+
+} // namespace alpaca
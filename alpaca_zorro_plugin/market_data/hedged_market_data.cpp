@@ -0,0 +1,190 @@
+#include "stdafx.h"
+#include "market_data/hedged_market_data.h"
+
+#include <algorithm>
+#include "market_data/bar_aggregator.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr size_t MAX_LOSERS = 4;                // primary requests kept running after losing
+        constexpr uint32_t LOSER_TIMEOUT_MS = 30000;
+        constexpr size_t MIN_SAMPLES = 16;              // below this the default delay is used
+        constexpr uint32_t DEFAULT_DELAY_MS = 500;
+        constexpr uint32_t MIN_DELAY_MS = 20;
+    }
+
+    HedgedMarketData::HedgedMarketData(const MarketData& primary, const MarketData& secondary, Logger& logger, double percentile)
+        : primary_(primary)
+        , secondary_(secondary)
+        , logger_(logger)
+        , percentile_(percentile) {
+    }
+
+    HedgedMarketData::~HedgedMarketData() {
+        drain(true);
+    }
+
+    uint32_t HedgedMarketData::hedgeDelay() const {
+        if (latency_.samples() < MIN_SAMPLES) {
+            return DEFAULT_DELAY_MS;
+        }
+        return std::max(latency_.percentile(percentile_), MIN_DELAY_MS);
+    }
+
+    Response<LastQuote> HedgedMarketData::getLastQuote(const std::string& symbol) const {
+        HttpGet primary, secondary;
+        if (!primary_.lastQuoteRequest(symbol, primary) || !secondary_.lastQuoteRequest(symbol, secondary)) {
+            return primary_.getLastQuote(symbol);
+        }
+
+        int winner;
+        auto raw = race(primary, secondary, winner);
+        if (!raw) {
+            return Response<LastQuote>(raw.getCode(), raw.what());
+        }
+        return (winner ? secondary_ : primary_).readLastQuote(raw.content());
+    }
+
+    Response<uint32_t> HedgedMarketData::getBars(
+        const std::string& symbol,
+        const __time32_t start,
+        const __time32_t end,
+        const int nTickMinutes,
+        BarSink& sink) const {
+
+        HttpGet primary, secondary;
+        if (!primary_.barsRequest(symbol, start, end, nTickMinutes, sink.limit(), primary) ||
+            !secondary_.barsRequest(symbol, start, end, nTickMinutes, sink.limit(), secondary)) {
+            return primary_.getBars(symbol, start, end, nTickMinutes, sink);
+        }
+
+        int winner;
+        auto raw = race(primary, secondary, winner);
+        if (!raw) {
+            return Response<uint32_t>(raw.getCode(), raw.what());
+        }
+
+        BarColumns bars;
+        auto response = (winner ? secondary_ : primary_).readBars(raw.content(), bars);
+        if (!response) {
+            return response;
+        }
+        writeDescending(bars, sink);
+        return Response<uint32_t>(0, "OK", sink.count());
+    }
+
+    Response<std::string> HedgedMarketData::race(const HttpGet& primary, const HttpGet& secondary, int& winner) const {
+        drain();
+        auto delay = std::chrono::milliseconds(hedgeDelay());
+
+        if (!primary.limiter->acquire()) {
+            return Response<std::string>(1, "Brokerprogress returned zero. Aborting...");
+        }
+        ++metrics_.requests;
+        const HttpGet* gets[2] = { &primary, &secondary };
+        auto send = [&gets](int i) {
+            auto& get = *gets[i];
+            return http_send((char*)get.url.c_str(), nullptr, (char*)(get.headers.empty() ? nullptr : get.headers.c_str()));
+        };
+
+        auto sent = Clock::now();
+        int ids[2] = { send(0), 0 };
+        bool failed[2] = { !ids[0], false };
+        bool hedged = false;
+        uint32_t polls = 0;
+        while (true) {
+            auto now = Clock::now();
+            if (!hedged && (failed[0] || now - sent >= delay)) {
+                // a failed primary waits for a slot, a slow one only hedges if a slot is free right away
+                if (failed[0] ? secondary.limiter->acquire() : secondary.limiter->tryAcquire()) {
+                    hedged = true;
+                    ++metrics_.hedged;
+                    ids[1] = send(1);
+                    failed[1] = !ids[1];
+                }
+                else if (failed[0]) {
+                    return Response<std::string>(1, "Brokerprogress returned zero. Aborting...");
+                }
+            }
+
+            for (int i = 0; i < 2; ++i) {
+                if (!ids[i]) {
+                    continue;
+                }
+                long n = http_status(ids[i]);
+                if (!n) {
+                    continue;
+                }
+                if (n < 0) {
+                    http_free(ids[i]);
+                    ids[i] = 0;
+                    failed[i] = true;
+                    continue;
+                }
+
+                winner = i;
+                now = Clock::now();
+                Response<std::string> response;
+                response.content() = readResult(ids[i], n);
+                auto other = ids[1 - i];
+                if (i == 0) {
+                    latency_.add(elapsedMs(sent, now));
+                    if (other) {
+                        http_free(other);
+                    }
+                }
+                else {
+                    ++metrics_.secondaryWins;
+                    if (other) {
+                        if (losers_.size() == MAX_LOSERS) {
+                            drain(true);
+                        }
+                        losers_.push_back(Loser{ other, sent, now, now });
+                    }
+                }
+                logger_.logTrace("<-- %s %s\n", i ? "secondary" : "primary", response.content().c_str());
+                return response;
+            }
+
+            if (failed[0] && hedged && failed[1]) {
+                return Response<std::string>(1, "Cannot connect to server");
+            }
+
+            Sleep(10);
+            if (++polls % 10 == 0) {
+                drain();
+                if (!BrokerProgress(1)) {
+                    for (auto id : ids) {
+                        if (id) {
+                            http_free(id);
+                        }
+                    }
+                    return Response<std::string>(1, "Brokerprogress returned zero. Aborting...");
+                }
+            }
+        }
+    }
+
+    void HedgedMarketData::drain(bool all) const {
+        auto now = Clock::now();
+        for (auto it = losers_.begin(); it != losers_.end();) {
+            long n = http_status(it->id);
+            if (!n && !all && elapsedMs(it->sent, now) < LOSER_TIMEOUT_MS) {
+                it->lastPending = now;
+                ++it;
+                continue;
+            }
+
+            // an answer came after the last poll that saw it pending, so that poll gives lower bounds
+            if (n >= 0) {
+                auto bound = n ? it->lastPending : now;
+                latency_.add(elapsedMs(it->sent, bound));
+                metrics_.savedMs += elapsedMs(it->answered, bound);
+            }
+            http_free(it->id);
+            it = losers_.erase(it);
+        }
+    }
+
+} // namespace alpaca
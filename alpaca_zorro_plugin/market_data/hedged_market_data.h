@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "request.h"
+#include "market_data/latency_tracker.h"
+#include "market_data/market_data_base.h"
+
+namespace alpaca {
+
+    struct HedgeMetrics {
+        uint32_t requests = 0;      // requests raced between the providers
+        uint32_t hedged = 0;        // of them sent to the secondary too
+        uint32_t secondaryWins = 0; // of them answered by the secondary first
+        uint64_t savedMs = 0;       // lower bound of the time saved by the secondary wins
+
+        double hedgeRate() const noexcept { return requests ? (double)hedged / requests : 0.; }
+    };
+
+    /**
+     * @brief Sends quote and single page bar requests to a primary provider, and the same query to
+     * a secondary provider when the primary has not answered within a latency percentile of its
+     * recent requests. The first answer is taken.
+     *
+     * Both providers deserialize into the same LastQuote and ascending Bar columns, so the caller
+     * can't tell which one answered. Downloads taking more than one request go to the primary only.
+     */
+    class HedgedMarketData : public MarketData {
+    public:
+        /**
+         * @param percentile hedge once the primary is slower than this share (0 - 1) of its recent requests
+         */
+        HedgedMarketData(const MarketData& primary, const MarketData& secondary, Logger& logger, double percentile = 0.95);
+        ~HedgedMarketData() override;
+
+        Response<LastQuote> getLastQuote(const std::string& symbol) const override;
+
+        Response<uint32_t> getBars(
+            const std::string& symbol,
+            const __time32_t start,
+            const __time32_t end,
+            const int nTickMinutes,
+            BarSink& sink) const override;
+
+        Response<uint32_t> getLastQuotes(const std::vector<std::string>& symbols, const QuoteHandler& handler) const override {
+            // a bulk download isn't latency critical, it goes to the current source only
+            return primary_.getLastQuotes(symbols, handler);
+        }
+
+        Response<uint32_t> getTicks(
+            const std::string& symbol,
+            const __time32_t start,
+            const __time32_t end,
+            TickType type,
+            TickSink& sink) const override {
+            return primary_.getTicks(symbol, start, end, type, sink);
+        }
+
+        const MarketData& primary() const noexcept { return primary_; }
+        const HedgeMetrics& metrics() const noexcept { return metrics_; }
+        const LatencyTracker& latency() const noexcept { return latency_; }
+
+        /**
+         * @brief The current hedge delay in milliseconds.
+         */
+        uint32_t hedgeDelay() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief A primary request that lost the race, kept until it answers to learn its latency.
+         */
+        struct Loser {
+            int id;
+            Clock::time_point sent;
+            Clock::time_point answered;     // when the secondary answered
+            Clock::time_point lastPending;  // the last poll that found it still running
+        };
+
+        /**
+         * @brief Send primary, and secondary after the hedge delay. winner is 0 or 1 for the request that answered first.
+         */
+        Response<std::string> race(const HttpGet& primary, const HttpGet& secondary, int& winner) const;
+
+        /**
+         * @brief Poll the losers, record the latency of those that answered in the meantime.
+         */
+        void drain(bool all = false) const;
+
+        uint32_t elapsedMs(Clock::time_point from, Clock::time_point to) const noexcept {
+            return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+        }
+
+    private:
+        const MarketData& primary_;
+        const MarketData& secondary_;
+        Logger& logger_;
+        const double percentile_;
+        mutable LatencyTracker latency_;    // of the primary
+        mutable HedgeMetrics metrics_;
+        mutable std::vector<Loser> losers_;
+    };
+
+} // namespace alpaca
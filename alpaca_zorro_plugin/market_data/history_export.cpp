@@ -0,0 +1,210 @@
+#include "stdafx.h"
+#include "market_data/history_export.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include "date/date.h"
+#include "market_data/bar_store.h"
+#include "market_data/t6_sink.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr __time32_t DAY_IN_SEC = 86400;
+
+        int yearOf(__time32_t t) {
+            return (int)date::year_month_day{ date::floor<date::days>(date::sys_seconds{ std::chrono::seconds{ t } }) }.year();
+        }
+
+        __time32_t yearStart(int year) {
+            return (__time32_t)date::sys_seconds{ date::sys_days{ date::year{ year } / 1 / 1 } }.time_since_epoch().count();
+        }
+
+        /**
+         * @brief The file of a year of intraday bars, or of all daily bars for year 0.
+         */
+        std::string historyPath(const std::string& symbol, int year, const std::string& extension) {
+            return "./History/" + symbol + (year ? "_" + std::to_string(year) : "") + extension;
+        }
+    }
+
+    __time32_t readCachedBars(const std::string& symbol, __time32_t start, __time32_t end, int nTickMinutes, BarSink& sink) {
+        // newest file first, as the sink takes the bars
+        while (end && end >= start && sink.wantsMore()) {
+            bool daily = nTickMinutes >= 1440;
+            auto year = daily ? 0 : yearOf(end);
+            auto from = daily ? start : std::max(start, yearStart(year));
+            BarStoreReader reader(historyPath(symbol, year, ".bars"));
+            if (!reader.isOpen() || reader.nTickMinutes() != nTickMinutes || !reader.covers(from, end)) {
+                break;
+            }
+            reader.read(from, end, sink);
+            end = from - 1;
+        }
+        return end;
+    }
+
+    HistoryExporter::HistoryExporter(const MarketData& marketData, Logger& logger, std::string checkpointPath)
+        : marketData_(marketData)
+        , logger_(logger)
+        , checkpointPath_(std::move(checkpointPath)) {
+        loadCheckpoint();
+    }
+
+    Response<uint32_t> HistoryExporter::run(const std::vector<std::string>& symbols, int nTickMinutes, __time32_t start, __time32_t end, ExportFormat format) {
+        if (!end) {
+            // end of today rather than now, so the chunk keys stay the same when resuming today
+            auto now = (__time32_t)std::time(nullptr);
+            end = now - now % DAY_IN_SEC + DAY_IN_SEC - 1;
+        }
+
+        auto chunks = plan(symbols, nTickMinutes, start, end, format);
+        uint32_t exported = 0;
+        uint32_t skipped = 0;
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            auto& chunk = chunks[i];
+            auto key = checkpointKey(chunk, nTickMinutes);
+            if (completed_.count(key)) {
+                ++skipped;
+                continue;
+            }
+
+            BrokerError(("Exporting " + chunk.path + " (" + std::to_string(i + 1) + "/" + std::to_string(chunks.size()) + ")").c_str());
+            auto response = exportChunk(chunk, nTickMinutes);
+            if (!response) {
+                return Response<uint32_t>(response.getCode(), chunk.path + ": " + response.what(), exported);
+            }
+            saveCheckpoint(key);
+            ++exported;
+
+            if (!BrokerProgress((int)std::max<size_t>(1, (i + 1) * 100 / chunks.size()))) {
+                return Response<uint32_t>(1, "Export aborted, run it again to resume.", exported);
+            }
+        }
+
+        logger_.logInfo("History export: %d chunks exported, %d already done\n", exported, skipped);
+        return Response<uint32_t>(0, "OK", exported);
+    }
+
+    std::vector<HistoryExporter::Chunk> HistoryExporter::plan(const std::vector<std::string>& symbols, int nTickMinutes, __time32_t start, __time32_t end, ExportFormat format) const {
+        std::string extension = format == ExportFormat::Bars ? ".bars" : ".t6";
+        std::vector<Chunk> chunks;
+        for (auto& symbol : symbols) {
+            if (nTickMinutes >= 1440) {
+                chunks.push_back(Chunk{ symbol, start, end, historyPath(symbol, 0, extension), format });
+                continue;
+            }
+
+            for (auto year = yearOf(end); year >= yearOf(start); --year) {
+                chunks.push_back(Chunk{ symbol, std::max(start, yearStart(year)), std::min(end, yearStart(year + 1) - 1), historyPath(symbol, year, extension), format });
+            }
+        }
+        return chunks;
+    }
+
+    template<typename SinkT>
+    Response<uint32_t> HistoryExporter::download(const Chunk& chunk, int nTickMinutes, SinkT& sink) const {
+        // A provider may return fewer bars than asked for (Alpaca pages hold 1000 bars),
+        // keep asking for the bars before the oldest one received until nothing new arrives.
+        Response<uint32_t> response;
+        while (sink.wantsMore() && sink.error().empty()) {
+            auto count = sink.count();
+            auto end = count ? (__time32_t)sink.oldest() - 1 : chunk.end;
+            response = marketData_.getBars(chunk.symbol, chunk.start, end, nTickMinutes, sink);
+            if (!response || sink.count() == count) {
+                break;
+            }
+        }
+        sink.close();
+
+        if (!response) {
+            return response;
+        }
+        if (!sink.error().empty()) {
+            return Response<uint32_t>(1, sink.error());
+        }
+        return Response<uint32_t>(0, "OK", sink.count());
+    }
+
+    Response<uint32_t> HistoryExporter::exportChunk(const Chunk& chunk, int nTickMinutes) const {
+        auto partPath = chunk.path + ".part";
+        Response<uint32_t> response;
+        if (chunk.format == ExportFormat::Bars) {
+            // BrokerHistory2 may serve the bars from the file up to where they are complete, the last hour before the download
+            // is left out, providers hold back the newest bars (Alpaca's free plan the last 15 minutes)
+            auto now = (__time32_t)std::time(nullptr);
+            auto until = std::min(chunk.end, now - nTickMinutes * 60 - 3600);
+            BarStoreSink sink(partPath, chunk.start, chunk.end, nTickMinutes, until);
+            if (!sink.isOpen()) {
+                return Response<uint32_t>(1, sink.error());
+            }
+            response = download(chunk, nTickMinutes, sink);
+        }
+        else {
+            T6FileSink sink(partPath, chunk.start, chunk.end, nTickMinutes);
+            if (!sink.isOpen()) {
+                return Response<uint32_t>(1, sink.error());
+            }
+            response = download(chunk, nTickMinutes, sink);
+
+            auto& check = sink.check();
+            if (response && check.invalid) {
+                logger_.logWarning("%s: %d invalid bars. high < low: %d, NaN price: %d, time out of order: %d\n",
+                    chunk.path.c_str(), check.invalid, check.highBelowLow, check.nan, check.timeOrder);
+            }
+        }
+
+        if (!response) {
+            remove(partPath.c_str());
+            return response;
+        }
+
+        if (!response.content()) {
+            // no data for this period, e.g. before the symbol was listed
+            remove(partPath.c_str());
+            return Response<uint32_t>(0, "OK", 0);
+        }
+
+        if (!MoveFileExA(partPath.c_str(), chunk.path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            remove(partPath.c_str());
+            return Response<uint32_t>(1, "Failed to write " + chunk.path);
+        }
+        logger_.logDebug("%s: %d bars\n", chunk.path.c_str(), response.content());
+        return Response<uint32_t>(0, "OK", response.content());
+    }
+
+    std::string HistoryExporter::checkpointKey(const Chunk& chunk, int nTickMinutes) const {
+        auto key = chunk.symbol + "," + std::to_string(nTickMinutes) + "," + std::to_string(chunk.start) + "," + std::to_string(chunk.end);
+        return chunk.format == ExportFormat::Bars ? key + ",bars" : key;
+    }
+
+    void HistoryExporter::loadCheckpoint() {
+        FILE* f;
+        if (fopen_s(&f, checkpointPath_.c_str(), "r")) {
+            return;
+        }
+
+        char line[256];
+        while (fgets(line, sizeof(line), f)) {
+            line[strcspn(line, "\r\n")] = 0;
+            if (line[0]) {
+                completed_.emplace(line);
+            }
+        }
+        fclose(f);
+    }
+
+    void HistoryExporter::saveCheckpoint(const std::string& key) {
+        completed_.emplace(key);
+
+        FILE* f;
+        if (fopen_s(&f, checkpointPath_.c_str(), "a")) {
+            logger_.logError("Failed to open %s\n", checkpointPath_.c_str());
+            return;
+        }
+        fprintf(f, "%s\n", key.c_str());
+        fclose(f);
+    }
+
+} // namespace alpaca
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "request.h"
+#include "market_data/market_data_base.h"
+
+namespace alpaca {
+
+    enum class ExportFormat {
+        T6,     // Zorro .t6 files
+        Bars,   // compressed .bars files, see BarStoreWriter
+    };
+
+    class BarSink;
+
+    /**
+     * @brief Write the bars of [start, end] from the .bars files of an export into sink, newest first, as far back as
+     * the files hold every bar of the range.
+     * @return the end of the range left to request, before start if the files held all of it.
+     */
+    __time32_t readCachedBars(const std::string& symbol, __time32_t start, __time32_t end, int nTickMinutes, BarSink& sink);
+
+    /**
+     * @brief Exports bars of many symbols into Zorro .t6 files, or compressed .bars files, in the History folder.
+     *
+     * The export is split into chunks, one file each: a year per symbol for intraday bars
+     * (History/AAPL_2020.t6) and the whole range per symbol for daily bars (History/AAPL.t6).
+     * A chunk is written into a .part file and renamed once complete, then recorded in a
+     * checkpoint file. Running the same export again skips every recorded chunk, so an
+     * interrupted export resumes where it stopped.
+     */
+    class HistoryExporter {
+    public:
+        HistoryExporter(const MarketData& marketData, Logger& logger, std::string checkpointPath = "./Log/HistoryExport.chk");
+
+        /**
+         * @param end 0 means up to today
+         * @return the number of chunks exported, chunks skipped by the checkpoint not included.
+         */
+        Response<uint32_t> run(const std::vector<std::string>& symbols, int nTickMinutes, __time32_t start, __time32_t end, ExportFormat format = ExportFormat::T6);
+
+    private:
+        struct Chunk {
+            std::string symbol;
+            __time32_t start;
+            __time32_t end;
+            std::string path;
+            ExportFormat format;
+        };
+
+        std::vector<Chunk> plan(const std::vector<std::string>& symbols, int nTickMinutes, __time32_t start, __time32_t end, ExportFormat format) const;
+        Response<uint32_t> exportChunk(const Chunk& chunk, int nTickMinutes) const;
+
+        /**
+         * @brief Download the bars of a chunk into sink and close it.
+         * @return the number of bars written.
+         */
+        template<typename SinkT>
+        Response<uint32_t> download(const Chunk& chunk, int nTickMinutes, SinkT& sink) const;
+
+        std::string checkpointKey(const Chunk& chunk, int nTickMinutes) const;
+        void loadCheckpoint();
+        void saveCheckpoint(const std::string& key);
+
+    private:
+        const MarketData& marketData_;
+        Logger& logger_;
+        const std::string checkpointPath_;
+        std::unordered_set<std::string> completed_;
+    };
+
+} // namespace alpaca
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "alpaca/calendar.h"
+
+namespace alpaca {
+
+    /**
+     * @brief A range of whole UTC days, both ends inclusive.
+     */
+    struct DayRange {
+        __time32_t from;    // 00:00:00 of the first day
+        __time32_t to;      // 00:00:00 of the last day
+    };
+
+    /**
+     * @brief Splits a history request into independent day ranges that can be downloaded concurrently.
+     *
+     * The caller sizes the ranges so the bars expected in one range fit into one response page. Ranges
+     * are handed out newest first, walking backward from end toward start, and never overlap.
+     * Given the exchange sessions, ranges are counted in trading days and begin and end on one,
+     * so no request is spent on a weekend or holiday.
+     */
+    class HistoryPlanner {
+        static constexpr __time32_t DAY_IN_SEC = 86400;
+
+    public:
+        /**
+         * @param daysPerRange number of calendar days in one range
+         * @param barsPerDay expected number of bars per calendar day, used to plan no more ranges than needed
+         */
+        HistoryPlanner(__time32_t start, __time32_t end, __time32_t daysPerRange, double barsPerDay) noexcept
+            : start_(start - start % DAY_IN_SEC)
+            , next_(end - end % DAY_IN_SEC)
+            , daysPerRange_(std::max<__time32_t>(daysPerRange, 1))
+            , barsPerDay_(barsPerDay) {
+        }
+
+        /**
+         * @param sessions the exchange sessions in ascending order, they must cover [start, end]
+         * @param sessionsPerRange number of trading days in one range
+         * @param barsPerSession expected number of bars per trading day
+         */
+        HistoryPlanner(__time32_t start, __time32_t end, const std::vector<Session>& sessions, __time32_t sessionsPerRange, double barsPerSession) noexcept
+            : HistoryPlanner(start, end, sessionsPerRange, barsPerSession) {
+            sessions_ = &sessions;
+            auto less = [](const Session& s, __time32_t day) { return s.day < day; };
+            firstSession_ = std::lower_bound(sessions.begin(), sessions.end(), start_, less) - sessions.begin();
+            nextSession_ = std::lower_bound(sessions.begin(), sessions.end(), next_ + DAY_IN_SEC, less) - sessions.begin() - 1;
+        }
+
+        bool done() const noexcept { return sessions_ ? nextSession_ < firstSession_ : next_ < start_; }
+
+        /**
+         * @brief Plan the next batch of ranges.
+         * @param maxRanges the number of ranges that may be downloaded concurrently
+         * @param barsWanted the number of bars still missing, no more ranges are planned than needed to cover them
+         */
+        std::vector<DayRange> next(size_t maxRanges, uint32_t barsWanted) {
+            std::vector<DayRange> ranges;
+            double expected = 0.;
+            while (!done() && ranges.size() < maxRanges && (ranges.empty() || expected < barsWanted)) {
+                if (sessions_) {
+                    auto from = std::max(nextSession_ - (ptrdiff_t)daysPerRange_ + 1, firstSession_);
+                    ranges.push_back(DayRange{ (*sessions_)[from].day, (*sessions_)[nextSession_].day });
+                    expected += barsPerDay_ * (nextSession_ - from + 1);
+                    nextSession_ = from - 1;
+                    continue;
+                }
+
+                DayRange range;
+                range.to = next_;
+                range.from = std::max(next_ - (daysPerRange_ - 1) * DAY_IN_SEC, start_);
+                expected += barsPerDay_ * ((range.to - range.from) / DAY_IN_SEC + 1);
+                ranges.push_back(range);
+                next_ = range.from - DAY_IN_SEC;
+            }
+            return ranges;
+        }
+
+        __time32_t daysPerRange() const noexcept { return daysPerRange_; }
+
+    private:
+        const __time32_t start_;
+        __time32_t next_;
+        const __time32_t daysPerRange_;
+        const double barsPerDay_;
+
+        const std::vector<Session>* sessions_ = nullptr;
+        ptrdiff_t firstSession_ = 0;    // the oldest session to download
+        ptrdiff_t nextSession_ = -1;    // the newest session not planned yet
+    };
+
+} // namespace alpaca
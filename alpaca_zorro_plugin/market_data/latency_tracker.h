@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace alpaca {
+
+    /**
+     * @brief The latencies of the last requests of a provider.
+     */
+    class LatencyTracker {
+    public:
+        static constexpr size_t WINDOW = 256;
+
+        void add(uint32_t ms) {
+            if (samples_.size() < WINDOW) {
+                samples_.push_back(ms);
+                return;
+            }
+            samples_[next_] = ms;
+            next_ = (next_ + 1) % WINDOW;
+        }
+
+        size_t samples() const noexcept { return samples_.size(); }
+
+        /**
+         * @brief The latency in milliseconds below which p (0 - 1) of the samples fall, 0 without samples.
+         */
+        uint32_t percentile(double p) const {
+            if (samples_.empty()) {
+                return 0;
+            }
+            auto sorted = samples_;
+            auto nth = sorted.begin() + std::min(sorted.size() - 1, (size_t)(p * sorted.size()));
+            std::nth_element(sorted.begin(), nth, sorted.end());
+            return *nth;
+        }
+
+    private:
+        std::vector<uint32_t> samples_;
+        size_t next_ = 0;
+    };
+
+} // namespace alpaca
@@ -0,0 +1,221 @@
+#include "stdafx.h"
+#include "market_data/live_bars.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace alpaca {
+
+    namespace {
+        int64_t nowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    LiveBars::LiveBars(int baseMinutes, size_t capacity)
+        : baseSeconds_((uint32_t)std::max(baseMinutes, 1) * 60)
+        , capacity_(std::max<size_t>(capacity, 2)) {
+    }
+
+    uint32_t LiveBars::nextBoundary(int64_t ms) const noexcept {
+        auto baseMs = (int64_t)baseSeconds_ * 1000;
+        return (uint32_t)((ms + baseMs - 1) / baseMs * baseSeconds_);
+    }
+
+    void LiveBars::watch(const std::string& symbol) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (series_.count(symbol)) {
+            return;
+        }
+        auto& series = series_[symbol];
+        series.ring.resize(capacity_);
+        series.coveredFrom = nextBoundary(nowMs());
+    }
+
+    void LiveBars::gap() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto from = nextBoundary(nowMs());
+        for (auto& entry : series_) {
+            auto& series = entry.second;
+            series.head = 0;
+            series.size = 0;
+            series.coveredFrom = from;
+        }
+    }
+
+    void LiveBars::push(Series& series, const LiveBar& bar) {
+        if (series.size == series.ring.size()) {
+            // the oldest bar drops out, the ring is complete only after it
+            series.coveredFrom = std::max(series.coveredFrom, series.at(0).time + baseSeconds_);
+            series.head = (series.head + 1) % series.ring.size();
+            --series.size;
+        }
+        ++series.size;
+        series.newest() = bar;
+    }
+
+    void LiveBars::insert(Series& series, const LiveBar& bar) {
+        auto newest = series.newest();
+        push(series, newest);
+        auto i = series.size - 2;
+        for (; i > 0 && series.at(i - 1).time > bar.time; --i) {
+            series.at(i) = series.at(i - 1);
+        }
+        series.at(i) = bar;
+    }
+
+    void LiveBars::close(Series& series, uint32_t boundary, int64_t finalMs) {
+        if (boundary <= series.closedUntil) {
+            return;
+        }
+        // the newest bar ending by the boundary just became final, unless it was before
+        for (size_t k = 0; k < series.size; ++k) {
+            auto end = series.at(series.size - 1 - k).time + baseSeconds_;
+            if (end <= boundary) {
+                if (end > series.closedUntil) {
+                    auto latency = std::min<int64_t>(finalMs - (int64_t)end * 1000, CLOSE_GRACE_MS);
+                    latency_.add((uint32_t)std::max<int64_t>(latency, 0));
+                }
+                break;
+            }
+        }
+        series.closedUntil = boundary;
+    }
+
+    void LiveBars::settle(Series& series, int64_t ms) {
+        auto graceSeconds = (uint32_t)((ms - CLOSE_GRACE_MS) / 1000);
+        auto graceBoundary = graceSeconds - graceSeconds % baseSeconds_;
+        if (series.size && ms >= series.newestSinceMs + REORDER_MS) {
+            close(series, series.newest().time, series.newestSinceMs + REORDER_MS);
+        }
+        close(series, graceBoundary, (int64_t)graceBoundary * 1000 + CLOSE_GRACE_MS);
+    }
+
+    void LiveBars::add(const StreamTrade& trade) {
+        auto time = (uint32_t)(trade.time / 1000000000);
+        auto barTime = time - time % baseSeconds_;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = series_.find(trade.symbol);
+        if (it == series_.end()) {
+            return;
+        }
+        auto& series = it->second;
+        auto ms = nowMs();
+        settle(series, ms);
+        if (barTime < series.closedUntil) {
+            ++metrics_.lateTrades;
+            return;
+        }
+
+        ++metrics_.trades;
+        if (!series.size || barTime > series.newest().time) {
+            push(series, LiveBar{ barTime, trade.price, trade.price, trade.price, trade.price, trade.size, trade.time, trade.time });
+            series.newestSinceMs = ms;
+            return;
+        }
+        // the newest bar or one before it that isn't final yet
+        for (auto i = series.size; i > 0; --i) {
+            auto& bar = series.at(i - 1);
+            if (bar.time == barTime) {
+                bar.high = std::max(bar.high, trade.price);
+                bar.low = std::min(bar.low, trade.price);
+                if (trade.time < bar.openTime) {
+                    bar.open = trade.price;
+                    bar.openTime = trade.time;
+                }
+                if (trade.time >= bar.closeTime) {
+                    bar.close = trade.price;
+                    bar.closeTime = trade.time;
+                }
+                bar.volume += trade.size;
+                return;
+            }
+            if (bar.time < barTime) {
+                break;
+            }
+        }
+        insert(series, LiveBar{ barTime, trade.price, trade.price, trade.price, trade.price, trade.size, trade.time, trade.time });
+    }
+
+    uint32_t LiveBars::read(const std::string& symbol, __time32_t start, __time32_t end, int nTickMinutes, BarSink& sink) {
+        auto bucket = (uint32_t)nTickMinutes * 60;
+        // buckets dividing half an hour are aligned to the 9:30 session open like the REST bars
+        if (nTickMinutes <= 0 || bucket % baseSeconds_ || 1800 % bucket) {
+            return std::numeric_limits<uint32_t>::max();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = series_.find(symbol);
+        if (it == series_.end()) {
+            return std::numeric_limits<uint32_t>::max();
+        }
+        auto& series = it->second;
+        ++metrics_.reads;
+
+        settle(series, nowMs());
+
+        // only whole buckets the ring is complete for, and only final ones
+        auto firstBucket = (series.coveredFrom + bucket - 1) / bucket * bucket;
+        auto first = sink.count();
+        BarChunk chunk;
+        LiveBar current = {};
+        bool hasCurrent = false;
+        auto emit = [&]() {
+            chunk.push(current.time, current.open, current.high, current.low, current.close, current.volume);
+            if (chunk.full()) {
+                sink.write(chunk);
+                chunk.clear();
+            }
+        };
+
+        for (auto i = series.size; i > 0 && sink.wantsMore();) {
+            auto& bar = series.at(--i);
+            if (bar.time < firstBucket) {
+                break;
+            }
+            auto bucketTime = bar.time - bar.time % bucket;
+            if (bucketTime + bucket > series.closedUntil) {
+                continue;
+            }
+            if (hasCurrent && bucketTime == current.time) {
+                // going back in time, so this bar opens the bucket
+                current.open = bar.open;
+                current.high = std::max(current.high, bar.high);
+                current.low = std::min(current.low, bar.low);
+                current.volume += bar.volume;
+                continue;
+            }
+            if (hasCurrent) {
+                emit();
+            }
+            current = bar;
+            current.time = bucketTime;
+            hasCurrent = true;
+        }
+        if (hasCurrent) {
+            emit();
+        }
+        if (chunk.size && sink.wantsMore()) {
+            sink.write(chunk);
+        }
+
+        metrics_.barsServed += sink.count() - first;
+        if (!sink.wantsMore() || (uint32_t)start >= firstBucket) {
+            ++metrics_.fullyServed;
+        }
+        return firstBucket;
+    }
+
+    LiveBarMetrics LiveBars::metrics() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return metrics_;
+    }
+
+    LatencyTracker LiveBars::latency() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return latency_;
+    }
+
+} // namespace alpaca
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "market_data/bar_sink.h"
+#include "market_data/data_stream.h"
+#include "market_data/latency_tracker.h"
+
+namespace alpaca {
+
+    struct LiveBarMetrics {
+        uint64_t trades = 0;        // applied to a bar
+        uint64_t lateTrades = 0;    // older than the bar being built, dropped
+        uint32_t reads = 0;         // history requests that asked the ring
+        uint32_t barsServed = 0;
+        uint32_t fullyServed = 0;   // history requests that needed no REST request
+    };
+
+    /**
+     * @brief Builds bars of base minutes out of streamed trades, per symbol in a ring of the most
+     * recent bars, so the tail of a history request doesn't wait for the REST bars endpoint to
+     * include the bar that just closed.
+     *
+     * A bar is final REORDER_MS after the first trade of a later bar arrived, trades of a symbol can
+     * arrive slightly out of order, or once the wall clock is CLOSE_GRACE_MS past its end. A symbol's ring is complete from the first bar boundary after it was watched or the
+     * stream (re)connected, older bars have to come from REST. Like REST, minutes without trades
+     * have no bar. Trades come from the stream thread, reads from Zorro's.
+     */
+    class LiveBars {
+    public:
+        static constexpr uint32_t REORDER_MS = 100;
+        static constexpr uint32_t CLOSE_GRACE_MS = 1000;
+
+        /**
+         * @param capacity bars kept per symbol, the default holds a day of minute bars
+         */
+        explicit LiveBars(int baseMinutes = 1, size_t capacity = 1440);
+
+        int baseMinutes() const noexcept { return (int)(baseSeconds_ / 60); }
+
+        /**
+         * @brief Start building bars of a symbol, complete from the next bar boundary after now.
+         */
+        void watch(const std::string& symbol);
+
+        void add(const StreamTrade& trade);
+
+        /**
+         * @brief Trades may have been missed, every ring is complete again only from the next bar boundary.
+         */
+        void gap();
+
+        /**
+         * @brief Write the final bars of nTickMinutes starting within [start, end] into sink, newest first.
+         *
+         * nTickMinutes must be a multiple of the base minutes that divides 30, so the buckets are
+         * aligned to the 9:30 session open like the REST bars. end = 0 means up to now.
+         * @return the start of the oldest bar the ring is complete for, bars before it have to come
+         * from REST. UINT32_MAX if the ring can't serve the request at all.
+         */
+        uint32_t read(const std::string& symbol, __time32_t start, __time32_t end, int nTickMinutes, BarSink& sink);
+
+        LiveBarMetrics metrics() const;
+
+        /**
+         * @brief Milliseconds from a bar boundary until the bar before it was final.
+         */
+        LatencyTracker latency() const;
+
+    private:
+        struct LiveBar {
+            uint32_t time;
+            double open;
+            double high;
+            double low;
+            double close;
+            uint32_t volume;
+            int64_t openTime;   // of the trades that set open and close, they may arrive out of order
+            int64_t closeTime;
+        };
+
+        struct Series {
+            std::vector<LiveBar> ring;
+            size_t head = 0;            // of the oldest bar
+            size_t size = 0;
+            uint32_t coveredFrom = 0;   // bars starting at or after are complete
+            uint32_t closedUntil = 0;   // bars ending at or before are final
+            int64_t newestSinceMs = 0;  // arrival of the first trade of the newest bar
+
+            LiveBar& at(size_t i) { return ring[(head + i) % ring.size()]; }
+            LiveBar& newest() { return at(size - 1); }
+        };
+
+        void push(Series& series, const LiveBar& bar);
+
+        /**
+         * @brief Insert a bar older than the newest one, after the newest bar older than it.
+         */
+        void insert(Series& series, const LiveBar& bar);
+
+        /**
+         * @brief Close the bars that are final at nowMs.
+         */
+        void settle(Series& series, int64_t nowMs);
+
+        /**
+         * @brief Move closedUntil to boundary, which became final at finalMs.
+         */
+        void close(Series& series, uint32_t boundary, int64_t finalMs);
+
+        uint32_t nextBoundary(int64_t nowMs) const noexcept;
+
+    private:
+        const uint32_t baseSeconds_;
+        const size_t capacity_;
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, Series> series_;
+        LiveBarMetrics metrics_;
+        LatencyTracker latency_;
+    };
+
+} // namespace alpaca
@@ -1,21 +1,120 @@
 #pragma once
 
+#include <functional>
 #include <string>
+#include <vector>
 #include "quote.h"
 #include "bars.h"
+#include "bar_sink.h"
+#include "tick_sink.h"
 
 namespace alpaca {
 
+    class Calendar;
+    class RateLimiter;
+    struct BarColumns;
+
+    /**
+     * @brief A single HTTP GET of a provider, so the same query can be sent to two providers.
+     */
+    struct HttpGet {
+        std::string url;
+        std::string headers;
+        RateLimiter* limiter = nullptr;
+    };
+
+    using QuoteHandler = std::function<void(const std::string& symbol, const Quote& quote)>;
+
     class MarketData {
     public:
         virtual ~MarketData() = default;
 
+        /**
+         * @brief Use the exchange calendar to skip weekends and holidays when planning downloads.
+         */
+        void setCalendar(const Calendar* calendar) noexcept { calendar_ = calendar; }
+
         virtual Response<LastQuote> getLastQuote(const std::string& symbol) const = 0;
-        virtual Response<std::vector<Bar>> getBars(
+
+        /**
+         * @brief Latest quotes of many symbols, in as few requests as the provider allows.
+         *
+         * The handler is called on the calling thread as the replies arrive, symbols without a
+         * quote are skipped.
+         * @return the number of quoted symbols, with the first error if a request failed
+         */
+        virtual Response<uint32_t> getLastQuotes(const std::vector<std::string>& symbols, const QuoteHandler& handler) const {
+            uint32_t quoted = 0;
+            for (auto& symbol : symbols) {
+                auto response = getLastQuote(symbol);
+                if (response) {
+                    handler(symbol, response.content().quote);
+                    ++quoted;
+                }
+            }
+            return Response<uint32_t>(0, "OK", quoted);
+        }
+
+        /**
+         * @brief Download bars starting within [start, end] into sink, newest first.
+         *
+         * Stops as soon as the sink doesn't want any more bars. end = 0 means up to now.
+         * @return the number of bars written into the sink.
+         */
+        virtual Response<uint32_t> getBars(
             const std::string& symbol,
             const __time32_t start,
             const __time32_t end,
-            const int nTickMinutes = 1,
-            const uint32_t limit = 100) const = 0;
+            const int nTickMinutes,
+            BarSink& sink) const = 0;
+
+        /**
+         * @brief Download trades or quotes within [start, end] into sink, newest first.
+         */
+        virtual Response<uint32_t> getTicks(
+            const std::string& symbol,
+            const __time32_t start,
+            const __time32_t end,
+            TickType type,
+            TickSink& sink) const {
+            return Response<uint32_t>(1, "Tick data download is not supported by Alpaca.");
+        }
+
+        /**
+         * @brief Describe getLastQuote as a single request.
+         * @return false if the provider can't serve it with one request.
+         */
+        virtual bool lastQuoteRequest(const std::string& symbol, HttpGet& get) const { return false; }
+
+        /**
+         * @brief Deserialize the reply of a lastQuoteRequest.
+         */
+        virtual Response<LastQuote> readLastQuote(const std::string& content) const {
+            return Response<LastQuote>(1, "Not supported");
+        }
+
+        /**
+         * @brief Describe getBars with at most limit bars as a single request.
+         * @return false if the provider needs more than one request or local aggregation for it.
+         */
+        virtual bool barsRequest(
+            const std::string& symbol,
+            const __time32_t start,
+            const __time32_t end,
+            const int nTickMinutes,
+            const uint32_t limit,
+            HttpGet& get) const {
+            return false;
+        }
+
+        /**
+         * @brief Deserialize the reply of a barsRequest into bars in ascending time order.
+         */
+        virtual Response<uint32_t> readBars(const std::string& content, BarColumns& bars) const {
+            return Response<uint32_t>(1, "Not supported");
+        }
+
+    protected:
+        const Calendar* calendar_ = nullptr;
     };
-}
\ No newline at end of file
+}
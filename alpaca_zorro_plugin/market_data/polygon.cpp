@@ -1,119 +1,425 @@
 #include "stdafx.h"
 #include "market_data/polygon.h"
+#include "market_data/bar_aggregator.h"
+#include "market_data/history_planner.h"
+#include "alpaca/calendar.h"
+#include "alpaca/clock.h"
+#include "market_data/bar_parser.h"
+#include "market_data/tick_parser.h"
 #include "date/date.h"
 
 using namespace alpaca;
 
-#define TWO_DAYS_IN_SEC 172800  // Assume 8 hour an day
-#define DAY_IN_SEC 86400
+namespace {
+    constexpr uint32_t MAX_BASE_BARS_PER_REQUEST = 50000;   // Polygon aggregates page size limit
+    constexpr size_t MAX_CONCURRENT_REQUESTS = 8;
+    constexpr uint32_t MAX_TICKS_PER_REQUEST = 50000;       // Polygon ticks page size limit
+    constexpr int64_t NS_PER_SEC = 1000000000;
+    constexpr size_t QUOTE_SYMBOLS_PER_REQUEST = 200;       // keeps the url well below common length limits
+    constexpr size_t REQUESTS_PER_WAVE = 32;                // replies are handed out after every wave
 
-Response<std::vector<Bar>> Polygon::getBars(
+    /**
+     * Pick the coarsest native Polygon timespan that evenly divides nTickMinutes.
+     * Polygon builds multiplied aggregates from bars of that timespan and the page limit counts those.
+     */
+    void toTimespan(int nTickMinutes, const char*& timespan, int& multiplier, double& basePerTradingDay) {
+        if (nTickMinutes % 10080 == 0) {
+            timespan = "week";
+            multiplier = nTickMinutes / 10080;
+            basePerTradingDay = 0.2;
+        }
+        else if (nTickMinutes % 1440 == 0) {
+            timespan = "day";
+            multiplier = nTickMinutes / 1440;
+            basePerTradingDay = 1.;
+        }
+        else if (nTickMinutes % 60 == 0) {
+            timespan = "hour";
+            multiplier = nTickMinutes / 60;
+            basePerTradingDay = 16.;    // 4:00 - 20:00 including extended hours
+        }
+        else {
+            timespan = "minute";
+            multiplier = nTickMinutes;
+            basePerTradingDay = 960.;
+        }
+    }
+
+    /**
+     * Find the top level next_url of an aggregates page without parsing the whole page.
+     * It follows the results array, so search from the back.
+     */
+    std::string extractNextUrl(const std::string& content) {
+        static const std::string key = "\"next_url\"";
+        auto pos = content.rfind(key);
+        if (pos == std::string::npos) {
+            return "";
+        }
+        auto begin = content.find('"', content.find(':', pos + key.size()));
+        if (begin == std::string::npos) {
+            return "";
+        }
+        auto end = content.find('"', begin + 1);
+        if (end == std::string::npos) {
+            return "";
+        }
+        return content.substr(begin + 1, end - begin - 1);
+    }
+}
+
+Response<uint32_t> Polygon::getBars(
     const std::string& symbol,
     __time32_t start,
     __time32_t end,
     const int nTickMinutes,
-    const uint32_t limit) const {
+    BarSink& sink) const {
 
     if (end == 0) {
         end = std::time(nullptr);
     }
 
-    __time32_t t_start;
-    auto t_end = end;
-    Response<std::vector<Bar>> result;
-    auto& rtBars = result.content();
-    rtBars.reserve(limit);
-    __time32_t upperBound = t_end;
+    const char* timespan;
+    int multiplier;
+    double basePerTradingDay;
+    toTimespan(nTickMinutes, timespan, multiplier, basePerTradingDay);
 
-    do {
-        std::stringstream url;
+    // Polygon reads the dates of a range in New York time, and after hours bars of the day before
+    // start already fall on the UTC date of start. So the ranges are planned on New York dates.
+    auto localStart = start + getNewYorkOffset(start);
+    auto localEnd = end + getNewYorkOffset(end);
 
-        url << baseUrl_ << "/v2/aggs/ticker/" << symbol << "/range/" << nTickMinutes << "/minute";
-        try {
-            using namespace date;
-            t_start = t_end - TWO_DAYS_IN_SEC;
-            url << "/" << format("%F", date::sys_seconds{ std::chrono::seconds{ t_start } });
-            if (t_start < start) {
-                t_start = start;
-            }
+    // Size the ranges so the trading days in them fit into one page, and a short history into
+    // about as many days as it needs, the transfer of a full page would take longer than the
+    // extra requests. Without a calendar 5 out of 7 calendar days are assumed to trade. next_url
+    // is still followed in case a range holds more bars than expected.
+    auto tradingDays = std::min((double)MAX_BASE_BARS_PER_REQUEST, (double)sink.limit() * multiplier) / basePerTradingDay;
+    auto planner = (calendar_ && calendar_->covers(localStart) && calendar_->covers(localEnd))
+        ? HistoryPlanner(localStart, localEnd, calendar_->sessions(), (__time32_t)tradingDays, basePerTradingDay / multiplier)
+        : HistoryPlanner(localStart, localEnd, (__time32_t)(tradingDays * 7. / 5.), basePerTradingDay / multiplier * 5. / 7.);
+
+    uint32_t nRequests = 0;
+    bool cutoff = false;    // a failed page ends the download to keep the history contiguous
+    std::string nextUrl;
+    std::string error;
+    auto flush = [&sink](const BarChunk& chunk) { return sink.write(chunk); };
 
-            url << "/" << format("%F", date::sys_seconds{ std::chrono::seconds{ t_end } });
+    while (sink.wantsMore() && !planner.done() && !cutoff) {
+        auto ranges = planner.next(MAX_CONCURRENT_REQUESTS, sink.limit() - sink.count());
+        std::vector<std::string> urls;
+        urls.reserve(ranges.size());
+        for (auto& range : ranges) {
+            std::stringstream url;
+            url << baseUrl_ << "/v2/aggs/ticker/" << symbol << "/range/" << multiplier << "/" << timespan;
+            try {
+                using namespace date;
+                url << "/" << format("%F", date::sys_seconds{ std::chrono::seconds{ range.from } });
+                url << "/" << format("%F", date::sys_seconds{ std::chrono::seconds{ range.to } });
+            }
+            catch (const std::exception&) {
+                assert(false);
+                return Response<uint32_t>(1, "invalid time");
+            }
+            url << "?sort=desc&limit=" << MAX_BASE_BARS_PER_REQUEST;    // in desending order
+            logger_.logDebug("--> %s\n", url.str().c_str());
+            url << "&" << apiKey_;
+            urls.emplace_back(url.str());
         }
-        catch (const std::exception& e) {
-            assert(false);
-            return Response<std::vector<Bar>>(1, "invalid time");
+
+        // Ranges are newest first, so bars of the head range are written into the sink as soon as
+        // they arrive. Pages of the ranges behind it are held as raw JSON until the head is complete.
+        std::vector<std::vector<std::string>> pages(ranges.size());
+        std::vector<bool> complete(ranges.size(), false);
+        std::vector<size_t> rangeOfUrl(ranges.size());
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            rangeOfUrl[i] = i;
         }
-        url << "?sort=desc";    // in desending order
-        logger_.logDebug("--> %s\n", url.str().c_str());
-        url << "&" << apiKey_;
+        size_t head = 0;
+        size_t lastRange = ranges.size() - 1;   // ranges after a failed one are dropped
+        auto countBefore = sink.count();
 
-        auto response = request<std::vector<Bar>, Polygon>(url.str());
+        while (!urls.empty()) {
+            auto responses = requestAllRaw<Polygon>(urls, "", nullptr, MAX_CONCURRENT_REQUESTS);
+            nRequests += (uint32_t)urls.size();
 
-        if (!response) {
-            BrokerError(response.what().c_str());
-            break;
-        }
+            std::vector<std::string> nextUrls;
+            std::vector<size_t> nextRangeOfUrl;
+            for (size_t i = 0; i < responses.size(); ++i) {
+                auto& response = responses[i];
+                auto range = rangeOfUrl[i];
+                if (!response) {
+                    BrokerError(response.what().c_str());
+                    complete[range] = true;
+                    lastRange = std::min(lastRange, range);
+                    cutoff = true;
+                    continue;
+                }
 
-        auto& bars = response.content();
-        size_t nExclude = 0;
-        logger_.logDebug("%d bars downloaded.\n", bars.size());
-        if (!bars.empty()) {
-            using namespace date;
-            auto from = bars.front().time;
-            auto to = bars.back().time;
-            logger_.logDebug("%s(%d) - %s(%d)\n", format("%F %T", date::sys_seconds{ std::chrono::seconds{ from } }).c_str(), from,
-                format("%F %T", date::sys_seconds{ std::chrono::seconds{ to } }).c_str(), to);
-        }
-        else {
-            // no more data
-            break;
-        }
+                auto url = extractNextUrl(response.content());
+                pages[range].emplace_back(std::move(response.content()));
+                if (url.empty() || range > lastRange || !sink.wantsMore()) {
+                    complete[range] = true;
+                }
+                else {
+                    logger_.logDebug("--> %s\n", url.c_str());
+                    nextUrls.emplace_back(url + (url.find('?') == std::string::npos ? "?" : "&") + apiKey_);
+                    nextRangeOfUrl.push_back(range);
+                }
+            }
 
-        // remove record passed end time
-        auto it = bars.begin();
-        for (; it != bars.cend();) {
-            if ((__time32_t)(*it).time <= upperBound) {
+            // write out pages of the head range and of every range behind it that completed
+            while (head <= lastRange && head < ranges.size()) {
+                for (auto& page : pages[head]) {
+                    if (!sink.wantsMore()) {
+                        break;
+                    }
+                    if (!parseBars(page, 1000, flush, nextUrl, error)) {
+                        BrokerError(error.c_str());
+                        lastRange = head;
+                        cutoff = true;
+                        break;
+                    }
+                }
+                pages[head].clear();
+                pages[head].shrink_to_fit();
+                if (!complete[head] || (cutoff && head == lastRange)) {
+                    break;
+                }
+                ++head;
+            }
+
+            if (!sink.wantsMore() || head > lastRange) {
                 break;
             }
-            ++it;
+
+            // stop following cursors of ranges which will never be written
+            urls.clear();
+            rangeOfUrl.clear();
+            for (size_t i = 0; i < nextUrls.size(); ++i) {
+                if (nextRangeOfUrl[i] <= lastRange) {
+                    urls.emplace_back(std::move(nextUrls[i]));
+                    rangeOfUrl.push_back(nextRangeOfUrl[i]);
+                }
+            }
         }
 
-        if (it != bars.cbegin()) {
-            bars.erase(bars.cbegin(), it);
+        if (sink.count() == countBefore) {
+            // no more data available for this symbol
+            break;
         }
+    }
+
+    logger_.logDebug("%d %d/%s requests\n", nRequests, multiplier, timespan);
+    logger_.logDebug("return %d bars.\n", sink.count());
+    return Response<uint32_t>(0, "OK", sink.count());
+}
+
+bool Polygon::barsRequest(
+    const std::string& symbol,
+    __time32_t start,
+    __time32_t end,
+    const int nTickMinutes,
+    const uint32_t limit,
+    HttpGet& get) const {
+
+    const char* timespan;
+    int multiplier;
+    double basePerTradingDay;
+    toTimespan(nTickMinutes, timespan, multiplier, basePerTradingDay);
+
+    // the page is newest first, the bars of the end day after end count against its limit too
+    auto baseLimit = (uint64_t)limit * multiplier + (uint64_t)basePerTradingDay;
+    if (baseLimit > MAX_BASE_BARS_PER_REQUEST) {
+        return false;
+    }
+
+    if (end == 0) {
+        end = std::time(nullptr);
+    }
+    if (start == 0) {
+        // enough calendar days for limit bars plus a long weekend
+        start = end - (__time32_t)(baseLimit / basePerTradingDay * 7. / 5. + 4.) * 86400;
+    }
+
+    std::stringstream url;
+    url << baseUrl_ << "/v2/aggs/ticker/" << symbol << "/range/" << multiplier << "/" << timespan;
+    try {
+        // New York dates, like the ranges of getBars
+        using namespace date;
+        url << "/" << format("%F", date::sys_seconds{ std::chrono::seconds{ start + getNewYorkOffset(start) } });
+        url << "/" << format("%F", date::sys_seconds{ std::chrono::seconds{ end + getNewYorkOffset(end) } });
+    }
+    catch (const std::exception&) {
+        assert(false);
+        return false;
+    }
+    url << "?sort=desc&limit=" << baseLimit << "&" << apiKey_;
+    get.url = url.str();
+    get.limiter = &rateLimiter<Polygon>();
+    return true;
+}
+
+Response<uint32_t> Polygon::readBars(const std::string& content, BarColumns& bars) const {
+    auto flush = [&bars](const BarChunk& chunk) {
+        bars.append(chunk);
+        return true;
+    };
+    std::string nextUrl;
+    std::string error;
+    if (!parseBars(content, 1000, flush, nextUrl, error)) {
+        return Response<uint32_t>(1, error);
+    }
+    bars.reverse();
+    return Response<uint32_t>(0, "OK", (uint32_t)bars.size());
+}
+
+Response<uint32_t> Polygon::getTicks(
+    const std::string& symbol,
+    __time32_t start,
+    __time32_t end,
+    TickType type,
+    TickSink& sink) const {
 
-        rtBars.insert(rtBars.end(), bars.begin(), bars.end());
-        if (!rtBars.empty()) {
-            upperBound = rtBars.back().time - 1;
+    constexpr __time32_t DAY_IN_SEC = 86400;
+    if (end == 0) {
+        end = std::time(nullptr);
+    }
+
+    uint32_t nRequests = 0;
+    std::string error;
+    auto endNs = ((int64_t)end + 1) * NS_PER_SEC;
+
+    // Walk the days from end back to start. Each day is paged newest first with reverse=true,
+    // using the time of the oldest tick received as the offset of the next page.
+    for (auto day = end - end % DAY_IN_SEC; day >= start - start % DAY_IN_SEC && sink.wantsMore(); day -= DAY_IN_SEC) {
+        if (calendar_ && calendar_->covers(day)) {
+            if (!calendar_->sessionOn(day)) {
+                continue;   // weekend or holiday
+            }
         }
         else {
-            upperBound = t_start;
+            auto weekday = (day / DAY_IN_SEC + 4) % 7;  // 1.1.1970 was a Thursday
+            if (weekday == 0 || weekday == 6) {
+                continue;
+            }
         }
-        t_end = t_start - DAY_IN_SEC;
-    } while (rtBars.size() < limit && t_start > start);
 
-    // remove order older than start
-    auto it = rtBars.end();
-    while (it != rtBars.begin()) {
-        --it;
-        if ((*it).time >= start) {
-            break;
+        std::string sDay;
+        try {
+            sDay = date::format("%F", date::sys_seconds{ std::chrono::seconds{ day } });
+        }
+        catch (const std::exception&) {
+            assert(false);
+            return Response<uint32_t>(1, "invalid time");
         }
 
-        it = rtBars.erase(it);
+        auto offset = std::min(endNs, ((int64_t)day + DAY_IN_SEC) * NS_PER_SEC);
+        uint32_t skip = 0;  // ticks at the offset time already written with the previous page
+        uint32_t ticks = 0;
+        while (sink.wantsMore()) {
+            std::stringstream url;
+            url << baseUrl_ << "/v2/ticks/stocks/" << (type == TickType::Quotes ? "nbbo" : "trades") << "/" << symbol << "/" << sDay
+                << "?reverse=true&limit=" << MAX_TICKS_PER_REQUEST;
+            if (offset < ((int64_t)day + DAY_IN_SEC) * NS_PER_SEC) {
+                url << "&timestamp=" << offset;
+            }
+            logger_.logDebug("--> %s\n", url.str().c_str());
+            url << "&" << apiKey_;
+
+            auto response = requestRaw<Polygon>(url.str(), "", nullptr, nullptr);
+            ++nRequests;
+            if (!response) {
+                return Response<uint32_t>(response.getCode(), response.what(), sink.count());
+            }
+
+            auto toSkip = skip;
+            auto flush = [&sink, &toSkip, offset](const TickChunk& chunk) {
+                size_t from = 0;
+                while (toSkip && from < chunk.count && chunk.time[from] == offset) {
+                    ++from;
+                    --toSkip;
+                }
+                toSkip = 0;
+                return sink.write(chunk, from);
+            };
+
+            TickPage page;
+            if (!parseTicks(response.content(), flush, page, error)) {
+                return Response<uint32_t>(1, error, sink.count());
+            }
+            ticks += page.count;
+            if (page.count < MAX_TICKS_PER_REQUEST) {
+                break;
+            }
+
+            if (page.lastTime == offset) {
+                // a whole page of ticks with the same time, give up on the rest of them
+                logger_.logWarning("%s %s: more than %u %s at %lld ns, the rest of them at that time are missing.\n", symbol.c_str(), sDay.c_str(),
+                    MAX_TICKS_PER_REQUEST, type == TickType::Quotes ? "quotes" : "trades", (long long)offset);
+                offset -= 1;
+                skip = 0;
+            }
+            else {
+                offset = page.lastTime;
+                skip = page.lastTimeCount;
+            }
+        }
+        logger_.logDebug("%s %s: %d %s\n", symbol.c_str(), sDay.c_str(), ticks, type == TickType::Quotes ? "quotes" : "trades");
     }
 
-    // keep number of records up to limit
-    if (rtBars.size() > limit) {
-        rtBars.resize(limit);
+    logger_.logDebug("%d tick requests, return %d ticks.\n", nRequests, sink.count());
+    return Response<uint32_t>(0, "OK", sink.count());
+}
+
+Response<uint32_t> Polygon::getLastQuotes(const std::vector<std::string>& symbols, const QuoteHandler& handler) const {
+    // the snapshot endpoint returns the last quote of every listed ticker
+    std::vector<std::string> urls;
+    for (size_t i = 0; i < symbols.size(); i += QUOTE_SYMBOLS_PER_REQUEST) {
+        std::string url = std::string(baseUrl_) + "/v2/snapshot/locale/us/markets/stocks/tickers?tickers=";
+        for (size_t j = i; j < std::min(symbols.size(), i + QUOTE_SYMBOLS_PER_REQUEST); ++j) {
+            if (j > i) {
+                url += ',';
+            }
+            url += symbols[j];
+        }
+        logger_.logDebug("--> %s\n", url.c_str());
+        urls.emplace_back(url + "&" + apiKey_);
     }
-    logger_.logDebug("return %d bars.\n", rtBars.size());
-    if (!rtBars.empty()) {
-        using namespace date;
-        logger_.logDebug("%s(%d) - %s(%d)\n", format("%F %T", date::sys_seconds{ std::chrono::seconds{ rtBars.front().time } }).c_str(), rtBars.front().time,
-            format("%F %T", date::sys_seconds{ std::chrono::seconds{ rtBars.back().time } }).c_str(), rtBars.back().time);
+
+    uint32_t quoted = 0;
+    Response<uint32_t> result;
+    for (size_t first = 0; first < urls.size(); first += REQUESTS_PER_WAVE) {
+        std::vector<std::string> wave(urls.begin() + first, urls.begin() + std::min(urls.size(), first + REQUESTS_PER_WAVE));
+        auto responses = requestAllRaw<Polygon>(wave, "", nullptr, MAX_CONCURRENT_REQUESTS);
+        for (auto& response : responses) {
+            rapidjson::Document d;
+            if (response && (d.Parse(response.content().c_str()).HasParseError() || !d.IsObject() || !d.HasMember("tickers") || !d["tickers"].IsArray())) {
+                response = Response<std::string>(1, "Unexpected snapshot reply " + response.content());
+            }
+            if (!response) {
+                if (result) {
+                    result = Response<uint32_t>(response.getCode(), response.what());
+                }
+                continue;
+            }
+
+            for (auto& ticker : d["tickers"].GetArray()) {
+                if (!ticker.IsObject() || !ticker.HasMember("ticker") || !ticker["ticker"].IsString() || !ticker.HasMember("lastQuote") || !ticker["lastQuote"].IsObject()) {
+                    continue;
+                }
+                Parser<rapidjson::Value> parser(ticker["lastQuote"]);
+                Quote quote = {};
+                parser.template get<double>("P", quote.ask_price);
+                parser.template get<int>("S", quote.ask_size);
+                parser.template get<double>("p", quote.bid_price);
+                parser.template get<int>("s", quote.bid_size);
+                parser.template get<uint64_t>("t", quote.timestamp);
+                handler(ticker["ticker"].GetString(), quote);
+                ++quoted;
+            }
+        }
+        if (!BrokerProgress(1)) {
+            return Response<uint32_t>(1, "Brokerprogress returned zero. Aborting...", quoted);
+        }
     }
-    // change to asending order, BrokerHistory2 handles asending order
-    std::reverse(rtBars.begin(), rtBars.end());
-    return result;
-}
\ No newline at end of file
+    return Response<uint32_t>(result.getCode(), result.what(), quoted);
+}
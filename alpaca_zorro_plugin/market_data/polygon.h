@@ -20,12 +20,41 @@ namespace alpaca {
             return request<LastQuote, Polygon>(url.str(), "", nullptr, &logger_);
         }
 
-        Response<std::vector<Bar>> getBars(
+        bool lastQuoteRequest(const std::string& symbol, HttpGet& get) const override {
+            get.url = std::string(baseUrl_) + "/v1/last_quote/stocks/" + symbol + "?" + apiKey_;
+            get.limiter = &rateLimiter<Polygon>();
+            return true;
+        }
+
+        Response<LastQuote> readLastQuote(const std::string& content) const override {
+            return parseResponse<LastQuote, Polygon>(content);
+        }
+
+        Response<uint32_t> getLastQuotes(const std::vector<std::string>& symbols, const QuoteHandler& handler) const override;
+
+        bool barsRequest(
+            const std::string& symbol,
+            const __time32_t start,
+            const __time32_t end,
+            const int nTickMinutes,
+            const uint32_t limit,
+            HttpGet& get) const override;
+
+        Response<uint32_t> readBars(const std::string& content, BarColumns& bars) const override;
+
+        Response<uint32_t> getBars(
+            const std::string& symbol,
+            __time32_t start,
+            __time32_t end,
+            const int nTickMinutes,
+            BarSink& sink) const override;
+
+        Response<uint32_t> getTicks(
             const std::string& symbol,
             __time32_t start,
             __time32_t end,
-            const int nTickMinutes = 1,
-            const uint32_t limit = 100) const override;
+            TickType type,
+            TickSink& sink) const override;
 
     private:
         std::string apiKey_;
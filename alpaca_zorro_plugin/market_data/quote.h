@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include "alpaca/json.h"
 
 namespace alpaca {
 
@@ -19,13 +20,13 @@ namespace alpaca {
 
 		template<typename T>
 		std::pair<int, std::string> fromJSON(const T& parser) {
-			parser.get<double>("askprice", ask_price);
-			parser.get<int>("asksize", ask_size);
-			parser.get<int>("askexchange", ask_exchange);
-			parser.get<double>("bidprice", bid_price);
-			parser.get<int>("bidsize", bid_size);
-			parser.get<int>("bidexchange", bid_exchange);
-			parser.get<uint64_t>("timestamp", timestamp);
+			parser.template get<double>("askprice", ask_price);
+			parser.template get<int>("asksize", ask_size);
+			parser.template get<int>("askexchange", ask_exchange);
+			parser.template get<double>("bidprice", bid_price);
+			parser.template get<int>("bidsize", bid_size);
+			parser.template get<int>("bidexchange", bid_exchange);
+			parser.template get<uint64_t>("timestamp", timestamp);
 			return std::make_pair(0, "OK");
 		}
 	};
@@ -40,8 +41,8 @@ namespace alpaca {
 		
 		template<typename CallerT, typename T> 
 		std::pair<int, std::string> fromJSON(const T& parser/*, typename std::enable_if<std::is_same<CallerT, class AlpacaMarketData>::value>::type* = 0*/) {
-			parser.get<std::string>("status", status);
-			parser.get<std::string>("symbol", symbol);
+			parser.template get<std::string>("status", status);
+			parser.template get<std::string>("symbol", symbol);
 
 			if (status != "success") {
 				return std::make_pair(1, symbol + " " + status);
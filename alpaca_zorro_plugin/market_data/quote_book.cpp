@@ -0,0 +1,35 @@
+#include "stdafx.h"
+#include "market_data/quote_book.h"
+
+namespace alpaca {
+
+    void QuoteBook::update(const StreamQuote& quote) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quotes_[quote.symbol] = quote.quote;
+        ++updates_;
+    }
+
+    bool QuoteBook::get(const std::string& symbol, Quote& quote) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = quotes_.find(symbol);
+        if (it == quotes_.end() || !it->second.timestamp) {
+            return false;
+        }
+        quote = it->second;
+        return true;
+    }
+
+    void QuoteBook::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // a zero timestamp marks a quote as stale, keeping the entries saves rehashing the same symbols
+        for (auto& entry : quotes_) {
+            entry.second.timestamp = 0;
+        }
+    }
+
+    uint64_t QuoteBook::updates() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return updates_;
+    }
+
+} // namespace alpaca
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "market_data/data_stream.h"
+#include "market_data/quote.h"
+
+namespace alpaca {
+
+    /**
+     * @brief Top of book per symbol, kept up to date from streamed quotes so a book request is
+     * answered from memory. Quotes come from the stream thread, lookups from Zorro's.
+     */
+    class QuoteBook {
+    public:
+        void update(const StreamQuote& quote);
+
+        /**
+         * @brief Copy the latest quote of a symbol.
+         * @return false if no quote arrived since the stream (re)connected
+         */
+        bool get(const std::string& symbol, Quote& quote) const;
+
+        /**
+         * @brief Quotes may have been missed, forget them all so no stale book is served.
+         */
+        void clear();
+
+        uint64_t updates() const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, Quote> quotes_;
+        uint64_t updates_ = 0;
+    };
+
+} // namespace alpaca
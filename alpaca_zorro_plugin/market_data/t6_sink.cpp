@@ -0,0 +1,230 @@
+#include "stdafx.h"
+#include "market_data/t6_sink.h"
+
+#include <cmath>
+#include <cstdlib>
+#include "simd.h"
+
+namespace alpaca {
+
+    namespace {
+        constexpr double SEC_PER_DAY = 24. * 60. * 60.;
+        constexpr double EPOCH = 25569.;    // DATE(1.1.1970 00:00)
+
+        // number of set bits in a 4 bit lane mask
+        constexpr uint32_t BITS[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+        inline void count(int highBelowLow, int nan, int timeOrder, BarCheck& check) noexcept {
+            check.highBelowLow += BITS[highBelowLow];
+            check.nan += BITS[nan];
+            check.timeOrder += BITS[timeOrder];
+            check.invalid += BITS[highBelowLow | nan | timeOrder];
+        }
+
+#if defined(ALPACA_SSE2) || defined(ALPACA_AVX2)
+        /**
+         * Store 4 converted bars. h, l, o and c hold one price of 4 bars each and get transposed
+         * into the fHigh, fLow, fOpen, fClose quadruple of every record.
+         */
+        inline void store4(__m128d date01, __m128d date23, __m128 h, __m128 l, __m128 o, __m128 c, __m128 v, T6* out) noexcept {
+            _MM_TRANSPOSE4_PS(h, l, o, c);
+            const __m128 zero = _mm_setzero_ps();
+            __m128i vol01 = _mm_castps_si128(_mm_unpacklo_ps(zero, v));  // fVal = 0, fVol
+            __m128i vol23 = _mm_castps_si128(_mm_unpackhi_ps(zero, v));
+
+            _mm_storel_pd(&out[0].time, date01);
+            _mm_storeu_ps(&out[0].fHigh, h);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[0].fVal), vol01);
+
+            _mm_storeh_pd(&out[1].time, date01);
+            _mm_storeu_ps(&out[1].fHigh, l);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[1].fVal), _mm_srli_si128(vol01, 8));
+
+            _mm_storel_pd(&out[2].time, date23);
+            _mm_storeu_ps(&out[2].fHigh, o);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[2].fVal), vol23);
+
+            _mm_storeh_pd(&out[3].time, date23);
+            _mm_storeu_ps(&out[3].fHigh, c);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[3].fVal), _mm_srli_si128(vol23, 8));
+        }
+
+        /**
+         * Mask of the 4 lanes whose time is not below the one before it. Times are compared
+         * unsigned by flipping the sign bit.
+         */
+        inline int timeOrderMask(__m128i t, uint32_t prevTime) noexcept {
+            const __m128i sign = _mm_set1_epi32((int)0x80000000);
+            __m128i prev = _mm_or_si128(_mm_slli_si128(t, 4), _mm_cvtsi32_si128((int)prevTime));
+            __m128i below = _mm_cmpgt_epi32(_mm_xor_si128(prev, sign), _mm_xor_si128(t, sign));
+            return ~_mm_movemask_ps(_mm_castsi128_ps(below)) & 0xF;
+        }
+#endif
+
+#ifdef ALPACA_SSE2
+        /// Convert the low 2 unsigned 32 bit lanes to double, exact for the whole uint32 range
+        inline __m128d toDouble(__m128i u) noexcept {
+            const __m128i sign = _mm_set1_epi32((int)0x80000000);
+            return _mm_add_pd(_mm_cvtepi32_pd(_mm_xor_si128(u, sign)), _mm_set1_pd(2147483648.));
+        }
+
+        inline __m128 toFloat(const double* values) noexcept {
+            return _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(values)), _mm_cvtpd_ps(_mm_loadu_pd(values + 2)));
+        }
+
+        inline __m128 toFloat(__m128i u) noexcept {
+            return _mm_movelh_ps(_mm_cvtpd_ps(toDouble(u)), _mm_cvtpd_ps(toDouble(_mm_srli_si128(u, 8))));
+        }
+#endif
+
+#ifdef ALPACA_AVX2
+        inline __m256d toDouble4(__m128i u) noexcept {
+            const __m128i sign = _mm_set1_epi32((int)0x80000000);
+            return _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(u, sign)), _mm256_set1_pd(2147483648.));
+        }
+#endif
+    }
+
+    void toT6Scalar(const BarArrays& bars, size_t n, uint32_t timeOffset, uint32_t& prevTime, T6* out, BarCheck& check) noexcept {
+        for (size_t i = 0; i < n; ++i) {
+            auto& tick = out[i];
+            tick.time = (double)(uint32_t)(bars.time[i] + timeOffset) / SEC_PER_DAY + EPOCH;
+            tick.fOpen = (float)bars.open[i];
+            tick.fHigh = (float)bars.high[i];
+            tick.fLow = (float)bars.low[i];
+            tick.fClose = (float)bars.close[i];
+            tick.fVal = 0.f;
+            tick.fVol = (float)bars.volume[i];
+
+            int highBelowLow = bars.high[i] < bars.low[i];
+            int nan = std::isnan(bars.open[i]) || std::isnan(bars.high[i]) || std::isnan(bars.low[i]) || std::isnan(bars.close[i]);
+            int timeOrder = bars.time[i] >= prevTime;
+            count(highBelowLow, nan, timeOrder, check);
+            prevTime = bars.time[i];
+        }
+    }
+
+    void toT6Sse2(const BarArrays& bars, size_t n, uint32_t timeOffset, uint32_t& prevTime, T6* out, BarCheck& check) noexcept {
+        size_t i = 0;
+#ifdef ALPACA_SSE2
+        const __m128i offset = _mm_set1_epi32((int)timeOffset);
+        const __m128d secPerDay = _mm_set1_pd(SEC_PER_DAY);
+        const __m128d epoch = _mm_set1_pd(EPOCH);
+        for (; i + 4 <= n; i += 4) {
+            __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bars.time + i));
+            __m128i closeTime = _mm_add_epi32(t, offset);
+            __m128d date01 = _mm_add_pd(_mm_div_pd(toDouble(closeTime), secPerDay), epoch);
+            __m128d date23 = _mm_add_pd(_mm_div_pd(toDouble(_mm_srli_si128(closeTime, 8)), secPerDay), epoch);
+
+            __m128d o01 = _mm_loadu_pd(bars.open + i), o23 = _mm_loadu_pd(bars.open + i + 2);
+            __m128d h01 = _mm_loadu_pd(bars.high + i), h23 = _mm_loadu_pd(bars.high + i + 2);
+            __m128d l01 = _mm_loadu_pd(bars.low + i), l23 = _mm_loadu_pd(bars.low + i + 2);
+            __m128d c01 = _mm_loadu_pd(bars.close + i), c23 = _mm_loadu_pd(bars.close + i + 2);
+
+            int highBelowLow = _mm_movemask_pd(_mm_cmplt_pd(h01, l01)) | (_mm_movemask_pd(_mm_cmplt_pd(h23, l23)) << 2);
+            int nan = _mm_movemask_pd(_mm_or_pd(_mm_cmpunord_pd(o01, h01), _mm_cmpunord_pd(l01, c01)))
+                | (_mm_movemask_pd(_mm_or_pd(_mm_cmpunord_pd(o23, h23), _mm_cmpunord_pd(l23, c23))) << 2);
+            count(highBelowLow, nan, timeOrderMask(t, prevTime), check);
+            prevTime = bars.time[i + 3];
+
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bars.volume + i));
+            store4(date01, date23, toFloat(bars.high + i), toFloat(bars.low + i), toFloat(bars.open + i), toFloat(bars.close + i), toFloat(v), out + i);
+        }
+#endif
+        BarArrays tail = { bars.time + i, bars.open + i, bars.high + i, bars.low + i, bars.close + i, bars.volume + i };
+        toT6Scalar(tail, n - i, timeOffset, prevTime, out + i, check);
+    }
+
+    void toT6Avx2(const BarArrays& bars, size_t n, uint32_t timeOffset, uint32_t& prevTime, T6* out, BarCheck& check) noexcept {
+        size_t i = 0;
+#ifdef ALPACA_AVX2
+        const __m128i offset = _mm_set1_epi32((int)timeOffset);
+        const __m256d secPerDay = _mm256_set1_pd(SEC_PER_DAY);
+        const __m256d epoch = _mm256_set1_pd(EPOCH);
+        for (; i + 4 <= n; i += 4) {
+            __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bars.time + i));
+            __m256d date = _mm256_add_pd(_mm256_div_pd(toDouble4(_mm_add_epi32(t, offset)), secPerDay), epoch);
+
+            __m256d o = _mm256_loadu_pd(bars.open + i);
+            __m256d h = _mm256_loadu_pd(bars.high + i);
+            __m256d l = _mm256_loadu_pd(bars.low + i);
+            __m256d c = _mm256_loadu_pd(bars.close + i);
+
+            int highBelowLow = _mm256_movemask_pd(_mm256_cmp_pd(h, l, _CMP_LT_OQ));
+            int nan = _mm256_movemask_pd(_mm256_or_pd(_mm256_cmp_pd(o, h, _CMP_UNORD_Q), _mm256_cmp_pd(l, c, _CMP_UNORD_Q)));
+            count(highBelowLow, nan, timeOrderMask(t, prevTime), check);
+            prevTime = bars.time[i + 3];
+
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bars.volume + i));
+            store4(_mm256_castpd256_pd128(date), _mm256_extractf128_pd(date, 1),
+                _mm256_cvtpd_ps(h), _mm256_cvtpd_ps(l), _mm256_cvtpd_ps(o), _mm256_cvtpd_ps(c), _mm256_cvtpd_ps(toDouble4(v)), out + i);
+        }
+        _mm256_zeroupper();
+#endif
+        BarArrays tail = { bars.time + i, bars.open + i, bars.high + i, bars.low + i, bars.close + i, bars.volume + i };
+        toT6Scalar(tail, n - i, timeOffset, prevTime, out + i, check);
+    }
+
+    void toT6(const BarArrays& bars, size_t n, uint32_t timeOffset, uint32_t& prevTime, T6* out, BarCheck& check) noexcept {
+        if (hasAvx2()) {
+            toT6Avx2(bars, n, timeOffset, prevTime, out, check);
+        }
+        else {
+            toT6Sse2(bars, n, timeOffset, prevTime, out, check);
+        }
+    }
+
+    T6FileSink::T6FileSink(const std::string& path, __time32_t start, __time32_t end, int nTickMinutes)
+        : BarSink(start, end, std::numeric_limits<uint32_t>::max())
+        , timeOffset_((uint32_t)nTickMinutes * 60) {
+        if (fopen_s(&file_, path.c_str(), "wb")) {
+            file_ = nullptr;
+            error_ = "Failed to open " + path;
+            return;
+        }
+        buffer_ = (char*)malloc(BUFFER_SIZE);
+        if (buffer_) {
+            setvbuf(file_, buffer_, _IOFBF, BUFFER_SIZE);
+        }
+    }
+
+    T6FileSink::~T6FileSink() {
+        close();
+    }
+
+    void T6FileSink::close() {
+        if (file_) {
+            fflush(file_);
+            fclose(file_);
+            file_ = nullptr;
+        }
+        free(buffer_);
+        buffer_ = nullptr;
+    }
+
+    void T6FileSink::append(const BarChunk& chunk, size_t from, size_t n) {
+        if (!file_ || !error_.empty()) {
+            return;
+        }
+
+        T6 ticks[BarChunk::CAPACITY];
+        BarArrays bars = { chunk.time + from, chunk.open + from, chunk.high + from, chunk.low + from, chunk.close + from, chunk.volume + from };
+        toT6(bars, n, timeOffset_, prevTime_, ticks, check_);
+        if (fwrite(ticks, sizeof(T6), n, file_) != n) {
+            error_ = "Failed to write history file";
+        }
+    }
+
+    void T6TickSink::append(const TickChunk& chunk, size_t from, size_t n) {
+        T6* out = ticks_ + count();
+        for (size_t i = 0; i < n; ++i) {
+            auto& tick = out[i];
+            auto price = (float)chunk.price[from + i];
+            tick.time = toDate(chunk.time[from + i]);
+            tick.fOpen = tick.fHigh = tick.fLow = tick.fClose = price;
+            tick.fVal = 0.f;
+            tick.fVol = (float)chunk.size[from + i];
+        }
+    }
+
+} // namespace alpaca
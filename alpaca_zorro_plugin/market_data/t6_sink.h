@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdio>
+#include <limits>
+#include <string>
+#include "market_data/bar_sink.h"
+#include "market_data/tick_sink.h"
+
+typedef double DATE;			//prerequisite for using trading.h
+#include "include/trading.h"
+
+namespace alpaca {
+
+    /**
+     * @brief Convert a tick time in nanoseconds since epoch to DATE.
+     */
+    inline DATE toDate(int64_t ns) noexcept {
+        // microsecond resolution is all a DATE can hold
+        return (double)(ns / 1000) / (24. * 60. * 60. * 1000000.) + 25569.;
+    }
+
+    /**
+     * @brief Counts of inconsistent bars found while converting.
+     */
+    struct BarCheck {
+        uint32_t highBelowLow = 0;
+        uint32_t nan = 0;           // open, high, low or close is NaN
+        uint32_t timeOrder = 0;     // not strictly descending
+        uint32_t invalid = 0;       // bars with any of the above
+
+        void add(const BarCheck& other) noexcept {
+            highBelowLow += other.highBelowLow;
+            nan += other.nan;
+            timeOrder += other.timeOrder;
+            invalid += other.invalid;
+        }
+    };
+
+    /**
+     * @brief Columnar bars, as held by BarChunk or BarColumns.
+     */
+    struct BarArrays {
+        const uint32_t* time;
+        const double* open;
+        const double* high;
+        const double* low;
+        const double* close;
+        const uint32_t* volume;
+    };
+
+    /**
+     * @brief Convert n bars, newest first, into T6 records and check them in the same pass.
+     *
+     * Bar start times are shifted by timeOffset seconds (Zorro stamps a bar with its close time),
+     * converted to DATE and prices and volume are narrowed to float. Invalid bars are counted in
+     * check but still converted. prevTime is the start time of the bar before the first one and is
+     * updated to the last one, so the time order check carries over between calls.
+     * Dispatches to an AVX2 or SSE2 kernel when available, results are identical to the scalar one.
+     */
+    void toT6(const BarArrays& bars, size_t n, uint32_t timeOffset, uint32_t& prevTime, T6* out, BarCheck& check) noexcept;
+
+    // The individual kernels, exposed to compare them against each other.
+    void toT6Scalar(const BarArrays& bars, size_t n, uint32_t timeOffset, uint32_t& prevTime, T6* out, BarCheck& check) noexcept;
+    void toT6Sse2(const BarArrays& bars, size_t n, uint32_t timeOffset, uint32_t& prevTime, T6* out, BarCheck& check) noexcept;
+    void toT6Avx2(const BarArrays& bars, size_t n, uint32_t timeOffset, uint32_t& prevTime, T6* out, BarCheck& check) noexcept;
+
+    /**
+     * @brief Writes bars straight into the T6 buffer passed to BrokerHistory2.
+     *
+     * Zorro expects ticks[0] to be the newest bar, which is the order bars are written into a sink,
+     * so every accepted run of a chunk is converted in place without any intermediate storage.
+     */
+    class T6Sink : public BarSink {
+    public:
+        T6Sink(__time32_t start, __time32_t end, uint32_t nTicks, int nTickMinutes, T6* ticks) noexcept
+            : BarSink(start, end, nTicks), timeOffset_((uint32_t)nTickMinutes * 60), ticks_(ticks) {}
+
+        const BarCheck& check() const noexcept { return check_; }
+
+    protected:
+        void append(const BarChunk& chunk, size_t from, size_t n) override {
+            BarArrays bars = { chunk.time + from, chunk.open + from, chunk.high + from, chunk.low + from, chunk.close + from, chunk.volume + from };
+            toT6(bars, n, timeOffset_, prevTime_, ticks_ + count(), check_);
+        }
+
+    private:
+        const uint32_t timeOffset_;
+        T6* ticks_;
+        uint32_t prevTime_ = std::numeric_limits<uint32_t>::max();
+        BarCheck check_;
+    };
+
+    /**
+     * @brief Writes bars into a Zorro .t6 history file, newest first as Zorro keeps them.
+     */
+    class T6FileSink : public BarSink {
+    public:
+        T6FileSink(const std::string& path, __time32_t start, __time32_t end, int nTickMinutes);
+        ~T6FileSink() override;
+
+        bool isOpen() const noexcept { return file_ != nullptr; }
+
+        /**
+         * @brief Flush and close the file.
+         */
+        void close();
+
+        /**
+         * @brief Error opening or writing the file, empty if none.
+         */
+        const std::string& error() const noexcept { return error_; }
+        const BarCheck& check() const noexcept { return check_; }
+
+    protected:
+        void append(const BarChunk& chunk, size_t from, size_t n) override;
+
+    private:
+        static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+        const uint32_t timeOffset_;
+        FILE* file_ = nullptr;
+        char* buffer_ = nullptr;
+        uint32_t prevTime_ = std::numeric_limits<uint32_t>::max();
+        BarCheck check_;
+        std::string error_;
+    };
+
+    /**
+     * @brief Writes trades into the T6 buffer of BrokerHistory2 when nTickMinutes is 0.
+     */
+    class T6TickSink : public TickSink {
+    public:
+        T6TickSink(__time32_t start, __time32_t end, uint32_t nTicks, T6* ticks) noexcept
+            : TickSink(start, end, nTicks), ticks_(ticks) {}
+
+    protected:
+        void append(const TickChunk& chunk, size_t from, size_t n) override;
+
+    private:
+        T6* ticks_;
+    };
+
+} // namespace alpaca
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "rapidjson/reader.h"
+#include "market_data/tick_sink.h"
+
+namespace alpaca {
+
+    /**
+     * @brief SAX handler that streams trades or quotes out of a Polygon v2 ticks response.
+     *
+     * Every object directly inside the results array is taken as a tick. Trades use the keys t
+     * (nanoseconds), p and s, quotes use p/s for the bid and P/S for the ask. Ticks are collected
+     * into a TickChunk and handed to flush(chunk) whenever it fills up, flush returns false to
+     * stop parsing. The time of the last tick and how many ticks share it are tracked for paging.
+     */
+    template<typename FlushT>
+    class TickHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, TickHandler<FlushT>> {
+    public:
+        explicit TickHandler(FlushT& flush) noexcept : flush_(flush) {}
+
+        bool Default() { return true; }
+
+        bool Int(int i) { return number((double)i, (int64_t)i); }
+        bool Uint(unsigned u) { return number((double)u, (int64_t)u); }
+        bool Int64(int64_t i) { return number((double)i, i); }
+        bool Uint64(uint64_t u) { return number((double)u, (int64_t)u); }
+        bool Double(double d) { return number(d, (int64_t)d); }
+
+        bool String(const char* str, rapidjson::SizeType length, bool) {
+            if (depth_ == 1 && (isKey("error") || isKey("message"))) {
+                error.assign(str, length);
+            }
+            return true;
+        }
+
+        bool Key(const char* str, rapidjson::SizeType length, bool) {
+            if (depth_ == 1) {
+                inResults_ = length == 7 && memcmp(str, "results", 7) == 0;
+            }
+            keyLength_ = length < sizeof(key_) ? length : sizeof(key_) - 1;
+            memcpy(key_, str, keyLength_);
+            key_[keyLength_] = 0;
+            return true;
+        }
+
+        bool StartObject() {
+            ++depth_;
+            if (inResults_ && depth_ == 3) {
+                time_ = 0;
+                price_ = askPrice_ = 0.;
+                size_ = askSize_ = 0;
+            }
+            return true;
+        }
+
+        bool EndObject(rapidjson::SizeType) {
+            if (inResults_ && depth_ == 3) {
+                auto i = chunk_.count++;
+                chunk_.time[i] = time_;
+                chunk_.price[i] = price_;
+                chunk_.size[i] = size_;
+                chunk_.askPrice[i] = askPrice_;
+                chunk_.askSize[i] = askSize_;
+
+                ++count;
+                if (time_ == lastTime) {
+                    ++lastTimeCount;
+                }
+                else {
+                    lastTime = time_;
+                    lastTimeCount = 1;
+                }
+
+                if (chunk_.full() && !flush()) {
+                    return false;
+                }
+            }
+            --depth_;
+            return true;
+        }
+
+        bool StartArray() {
+            ++depth_;
+            return true;
+        }
+
+        bool EndArray(rapidjson::SizeType) {
+            --depth_;
+            return true;
+        }
+
+        /**
+         * @brief Hand the last partial chunk to flush.
+         */
+        bool finish() {
+            return chunk_.count ? flush() : true;
+        }
+
+        bool stopped() const noexcept { return stopped_; }
+
+        std::string error;
+        uint32_t count = 0;
+        int64_t lastTime = 0;
+        uint32_t lastTimeCount = 0;
+
+    private:
+        bool number(double d, int64_t i) {
+            // fields of a tick, not the condition codes inside it
+            if (!inResults_ || depth_ != 3 || keyLength_ != 1) {
+                return true;
+            }
+            switch (key_[0]) {
+            case 't':
+                time_ = i;
+                break;
+            case 'p':
+                price_ = d;
+                break;
+            case 's':
+                size_ = (uint32_t)d;
+                break;
+            case 'P':
+                askPrice_ = d;
+                break;
+            case 'S':
+                askSize_ = (uint32_t)d;
+                break;
+            }
+            return true;
+        }
+
+        bool flush() {
+            bool more = flush_(chunk_);
+            chunk_.clear();
+            stopped_ = !more;
+            return more;
+        }
+
+        bool isKey(const char* key) const noexcept { return strcmp(key_, key) == 0; }
+
+    private:
+        FlushT& flush_;
+        TickChunk chunk_;
+        uint32_t depth_ = 0;
+        char key_[16] = { 0 };
+        size_t keyLength_ = 0;
+        bool inResults_ = false;
+        bool stopped_ = false;
+
+        int64_t time_ = 0;
+        double price_ = 0.;
+        uint32_t size_ = 0;
+        double askPrice_ = 0.;
+        uint32_t askSize_ = 0;
+    };
+
+    /**
+     * @brief Paging state of a parsed ticks response.
+     */
+    struct TickPage {
+        uint32_t count = 0;         // ticks in the page
+        int64_t lastTime = 0;       // time of the last, oldest, tick
+        uint32_t lastTimeCount = 0; // ticks at the end of the page sharing lastTime
+    };
+
+    /**
+     * @brief Stream the ticks of a JSON response into flush.
+     * @return false with error set when the response could not be parsed or reported an error.
+     */
+    template<typename FlushT>
+    inline bool parseTicks(const std::string& content, FlushT& flush, TickPage& page, std::string& error) {
+        TickHandler<FlushT> handler(flush);
+        rapidjson::Reader reader;
+        rapidjson::StringStream ss(content.c_str());
+        auto result = reader.Parse<rapidjson::kParseDefaultFlags>(ss, handler);
+        if (result.IsError() && !handler.stopped()) {
+            error = "Received parse error when deserializing ticks JSON. err=" + std::to_string(result.Code()) + "\n" + content;
+            return false;
+        }
+        if (!handler.stopped()) {
+            handler.finish();
+        }
+        page.count = handler.count;
+        page.lastTime = handler.lastTime;
+        page.lastTimeCount = handler.lastTimeCount;
+        if (!handler.error.empty() && !handler.count) {
+            error = std::move(handler.error);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace alpaca
@@ -0,0 +1,140 @@
+#include "stdafx.h"
+#include "market_data/tick_sink.h"
+
+#include <cstdlib>
+#include "date/date.h"
+#include "market_data/t6_sink.h"    // T1, T2 and toDate
+
+namespace alpaca {
+
+    namespace {
+        constexpr int64_t NS_PER_SEC = 1000000000;
+    }
+
+    bool TickSink::write(const TickChunk& chunk, size_t from) {
+        size_t i = from;
+        while (i < chunk.count && wantsMore()) {
+            // skip ticks newer than end
+            while (i < chunk.count && chunk.time[i] > end_) {
+                ++i;
+            }
+
+            auto j = i;
+            while (j < chunk.count && j - i < limit_ - count_ && chunk.time[j] <= end_) {
+                if (chunk.time[j] < start_) {
+                    // ticks are descending, everything after this is older than start
+                    pastStart_ = true;
+                    break;
+                }
+                ++j;
+            }
+
+            if (j > i) {
+                append(chunk, i, j - i);
+                count_ += (uint32_t)(j - i);
+            }
+            i = j;
+        }
+        return wantsMore();
+    }
+
+    TickFileSink::TickFileSink(const std::string& symbol, TickType type, __time32_t start, __time32_t end)
+        : TickSink(start, end, std::numeric_limits<uint32_t>::max())
+        , symbol_(symbol)
+        , type_(type) {
+    }
+
+    TickFileSink::~TickFileSink() {
+        close();
+    }
+
+    void TickFileSink::close() {
+        if (file_) {
+            fflush(file_);
+            fclose(file_);
+            file_ = nullptr;
+        }
+        free(buffer_);
+        buffer_ = nullptr;
+    }
+
+    bool TickFileSink::open(int64_t time) {
+        close();
+
+        using namespace date;
+        auto day = date::floor<date::days>(date::sys_seconds{ std::chrono::seconds{ time / NS_PER_SEC } });
+        auto year = date::year_month_day{ day }.year();
+        yearBegin_ = date::sys_seconds{ date::sys_days{ year / 1 / 1 } }.time_since_epoch().count() * NS_PER_SEC;
+        yearEnd_ = date::sys_seconds{ date::sys_days{ (year + date::years{ 1 }) / 1 / 1 } }.time_since_epoch().count() * NS_PER_SEC;
+
+        auto path = "./History/" + symbol_ + "_" + std::to_string((int)year) + (type_ == TickType::Quotes ? ".t2" : ".t1");
+        if (fopen_s(&file_, path.c_str(), "wb")) {
+            file_ = nullptr;
+            error_ = "Failed to open " + path;
+            return false;
+        }
+        buffer_ = (char*)malloc(BUFFER_SIZE);
+        if (buffer_) {
+            setvbuf(file_, buffer_, _IOFBF, BUFFER_SIZE);
+        }
+        return true;
+    }
+
+    void TickFileSink::append(const TickChunk& chunk, size_t from, size_t n) {
+        if (!error_.empty()) {
+            return;
+        }
+
+        // converted in small batches so every fwrite moves a block of records
+        constexpr size_t BATCH = 256;
+        T1 trades[BATCH];
+        T2 quotes[BATCH * 2];
+        for (size_t begin = from; begin < from + n;) {
+            if (!file_ || chunk.time[begin] < yearBegin_ || chunk.time[begin] >= yearEnd_) {
+                if (!open(chunk.time[begin])) {
+                    return;
+                }
+            }
+
+            // ticks are descending, the batch ends at the first tick of the previous year
+            size_t end = begin;
+            while (end < from + n && end - begin < BATCH && chunk.time[end] >= yearBegin_) {
+                ++end;
+            }
+
+            size_t written;
+            size_t records = 0;
+            if (type_ == TickType::Quotes) {
+                for (auto i = begin; i < end; ++i) {
+                    auto time = toDate(chunk.time[i]);
+                    if (chunk.askPrice[i] > 0.) {
+                        quotes[records].time = time;
+                        quotes[records].fVal = (float)chunk.askPrice[i];
+                        quotes[records++].fVol = (float)chunk.askSize[i];
+                    }
+                    if (chunk.price[i] > 0.) {
+                        quotes[records].time = time;
+                        quotes[records].fVal = -(float)chunk.price[i];
+                        quotes[records++].fVol = (float)chunk.size[i];
+                    }
+                }
+                written = fwrite(quotes, sizeof(T2), records, file_);
+            }
+            else {
+                for (auto i = begin; i < end; ++i) {
+                    trades[records].time = toDate(chunk.time[i]);
+                    trades[records++].fVal = (float)chunk.price[i];
+                }
+                written = fwrite(trades, sizeof(T1), records, file_);
+            }
+
+            records_ += written;
+            if (written != records) {
+                error_ = "Failed to write " + symbol_ + " ticks";
+                return;
+            }
+            begin = end;
+        }
+    }
+
+} // namespace alpaca
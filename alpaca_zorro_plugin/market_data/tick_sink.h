@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+namespace alpaca {
+
+    enum class TickType : uint8_t {
+        Trades,
+        Quotes,
+    };
+
+    /**
+     * @brief A fixed size batch of trades or quotes in columnar layout.
+     *
+     * For trades price and size hold the trade, for quotes they hold the bid.
+     */
+    struct TickChunk {
+        static constexpr size_t CAPACITY = 1024;
+
+        int64_t time[CAPACITY];     // nanoseconds since epoch
+        double price[CAPACITY];
+        uint32_t size[CAPACITY];
+        double askPrice[CAPACITY];
+        uint32_t askSize[CAPACITY];
+        size_t count = 0;
+
+        bool full() const noexcept { return count == CAPACITY; }
+        void clear() noexcept { count = 0; }
+    };
+
+    /**
+     * @brief Receives ticks newest first.
+     *
+     * Keeps only ticks within [start, end] and stops accepting once limit ticks were written.
+     * Derived sinks only implement the output format.
+     */
+    class TickSink {
+    public:
+        TickSink(__time32_t start, __time32_t end, uint32_t limit) noexcept
+            : start_((int64_t)start * 1000000000)
+            , end_(end ? ((int64_t)end + 1) * 1000000000 - 1 : std::numeric_limits<int64_t>::max())
+            , limit_(limit) {}
+        virtual ~TickSink() = default;
+
+        /**
+         * @brief Write ticks [from, chunk.count) in descending time order.
+         * @return false when the sink doesn't want any more ticks.
+         */
+        bool write(const TickChunk& chunk, size_t from = 0);
+
+        bool wantsMore() const noexcept { return count_ < limit_ && !pastStart_; }
+        uint32_t count() const noexcept { return count_; }
+
+    protected:
+        /**
+         * @brief Output n accepted ticks of the chunk starting at index from. They become ticks [count(), count() + n).
+         */
+        virtual void append(const TickChunk& chunk, size_t from, size_t n) = 0;
+
+    private:
+        const int64_t start_;
+        const int64_t end_;
+        const uint32_t limit_;
+        uint32_t count_ = 0;
+        bool pastStart_ = false;
+    };
+
+    /**
+     * @brief Writes ticks into Zorro history files, one file per year, e.g. History/AAPL_2020.t1.
+     *
+     * Trades are written as T1 price records into .t1 files. Quotes are written as T2 records into
+     * .t2 files, ask positive and bid negative with their sizes. Records are appended newest first,
+     * the order Zorro keeps them in.
+     */
+    class TickFileSink : public TickSink {
+    public:
+        TickFileSink(const std::string& symbol, TickType type, __time32_t start, __time32_t end);
+        ~TickFileSink() override;
+
+        /**
+         * @brief Flush and close the current file.
+         */
+        void close();
+
+        /**
+         * @brief Error opening or writing a file, empty if none.
+         */
+        const std::string& error() const noexcept { return error_; }
+
+        /**
+         * @brief Number of records written, a quote turns into an ask and a bid T2 record.
+         */
+        uint64_t records() const noexcept { return records_; }
+
+    protected:
+        void append(const TickChunk& chunk, size_t from, size_t n) override;
+
+    private:
+        bool open(int64_t time);
+
+    private:
+        static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+        const std::string symbol_;
+        const TickType type_;
+        FILE* file_ = nullptr;
+        char* buffer_ = nullptr;
+        int64_t yearBegin_ = 0;     // the year of the open file in nanoseconds, [yearBegin_, yearEnd_)
+        int64_t yearEnd_ = 0;
+        uint64_t records_ = 0;
+        std::string error_;
+    };
+
+} // namespace alpaca
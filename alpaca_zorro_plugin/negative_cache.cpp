@@ -0,0 +1,100 @@
+#include "stdafx.h"
+#include "negative_cache.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace alpaca {
+
+    namespace {
+        constexpr uint32_t FILTER_PROBES = 3;
+
+        int64_t nowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        uint64_t hashKey(const std::string& key) noexcept {
+            uint64_t h = 14695981039346656037ull;
+            for (auto c : key) {
+                h = (h ^ (uint8_t)c) * 1099511628211ull;
+            }
+            return h;
+        }
+    }
+
+    NegativeCache::NegativeCache(uint32_t ttlMs)
+        : ttlMs_(ttlMs)
+        , filter_(FILTER_BITS / 64, 0) {
+    }
+
+    void NegativeCache::setBits(uint64_t hash) noexcept {
+        // double hashing, the probes are h1 + i * h2
+        auto h1 = (uint32_t)hash;
+        auto h2 = (uint32_t)(hash >> 32) | 1;
+        for (uint32_t i = 0; i < FILTER_PROBES; ++i) {
+            auto bit = (h1 + i * h2) & (FILTER_BITS - 1);
+            filter_[bit / 64] |= 1ull << (bit % 64);
+        }
+    }
+
+    bool NegativeCache::testBits(uint64_t hash) const noexcept {
+        auto h1 = (uint32_t)hash;
+        auto h2 = (uint32_t)(hash >> 32) | 1;
+        for (uint32_t i = 0; i < FILTER_PROBES; ++i) {
+            auto bit = (h1 + i * h2) & (FILTER_BITS - 1);
+            if (!(filter_[bit / 64] & (1ull << (bit % 64)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool NegativeCache::contains(const std::string& key) {
+        ++metrics_.lookups;
+        if (!testBits(hashKey(key))) {
+            ++metrics_.filtered;
+            return false;
+        }
+        auto it = expires_.find(key);
+        if (it == expires_.end()) {
+            return false;
+        }
+        if (it->second <= nowMs()) {
+            expires_.erase(it);
+            return false;
+        }
+        ++metrics_.hits;
+        return true;
+    }
+
+    void NegativeCache::add(const std::string& key) {
+        auto now = nowMs();
+        ++metrics_.stored;
+        expires_[key] = now + ttlMs_;
+        setBits(hashKey(key));
+        // past an eighth of the bits the filter lets too many keys through, dropping the dead ones helps once they are half of them
+        if (++filterKeys_ > FILTER_BITS / 8 && filterKeys_ > 2 * expires_.size()) {
+            rebuild(now);
+        }
+    }
+
+    void NegativeCache::clear() {
+        expires_.clear();
+        std::fill(filter_.begin(), filter_.end(), 0);
+        filterKeys_ = 0;
+    }
+
+    void NegativeCache::rebuild(int64_t now) {
+        std::fill(filter_.begin(), filter_.end(), 0);
+        for (auto it = expires_.begin(); it != expires_.end();) {
+            if (it->second <= now) {
+                it = expires_.erase(it);
+                continue;
+            }
+            setBits(hashKey(it->first));
+            ++it;
+        }
+        filterKeys_ = (uint32_t)expires_.size();
+    }
+
+} // namespace alpaca
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace alpaca {
+
+    struct NegativeCacheMetrics {
+        uint64_t lookups = 0;
+        uint64_t hits = 0;          // each one a request that wasn't sent
+        uint64_t filtered = 0;      // answered by the filter alone
+        uint64_t stored = 0;
+    };
+
+    /**
+     * @brief Remembers for ttl milliseconds that asking for a key failed with "not found", so the
+     * same question isn't sent again right away.
+     *
+     * A small Bloom filter over the stored keys answers most lookups of keys that were never
+     * stored without touching the map, which keeps the cache free for the common case of a symbol
+     * that exists. Expired keys stay in the filter until it is rebuilt. Used from
+     * Zorro's thread only.
+     */
+    class NegativeCache {
+    public:
+        static constexpr uint32_t FILTER_BITS = 1 << 14;
+
+        explicit NegativeCache(uint32_t ttlMs);
+
+        /**
+         * @return true if key failed within the ttl.
+         */
+        bool contains(const std::string& key);
+
+        void add(const std::string& key);
+
+        void clear();
+
+        uint32_t ttlMs() const noexcept { return ttlMs_; }
+        size_t size() const noexcept { return expires_.size(); }
+        const NegativeCacheMetrics& metrics() const noexcept { return metrics_; }
+
+    private:
+        void setBits(uint64_t hash) noexcept;
+        bool testBits(uint64_t hash) const noexcept;
+
+        /**
+         * @brief Drop expired keys and set the filter from the remaining ones.
+         */
+        void rebuild(int64_t nowMs);
+
+    private:
+        const uint32_t ttlMs_;
+        std::unordered_map<std::string, int64_t> expires_;
+        std::vector<uint64_t> filter_;
+        uint32_t filterKeys_ = 0;   // added since the filter was rebuilt
+        NegativeCacheMetrics metrics_;
+    };
+
+} // namespace alpaca
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+namespace alpaca {
+
+    extern int(__cdecl* BrokerProgress)(const int percent);
+
+    /**
+     * @brief Sliding window request limiter.
+     *
+     * Alpaca allows 200 requests per minute per account, a burst of concurrent requests
+     * must not push the plugin over that. acquire() blocks until a request slot is free.
+     */
+    class RateLimiter {
+    public:
+        RateLimiter(uint32_t maxRequests, std::chrono::milliseconds window) noexcept
+            : maxRequests_(maxRequests), window_(window) {}
+
+        /**
+         * @brief Take a request slot without waiting.
+         * @return false when the window is exhausted.
+         */
+        bool tryAcquire() {
+            auto now = std::chrono::steady_clock::now();
+            while (!sent_.empty() && now - sent_.front() >= window_) {
+                sent_.pop_front();
+            }
+            if (sent_.size() >= maxRequests_) {
+                return false;
+            }
+            sent_.push_back(now);
+            return true;
+        }
+
+        /**
+         * @brief Wait for a request slot.
+         * @return false when the user aborted while waiting.
+         */
+        bool acquire() {
+            while (!tryAcquire()) {
+                Sleep(100);
+                if (!BrokerProgress(1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        uint32_t maxRequests() const noexcept { return maxRequests_; }
+
+    private:
+        const uint32_t maxRequests_;
+        const std::chrono::milliseconds window_;
+        std::deque<std::chrono::steady_clock::time_point> sent_;
+    };
+
+    /// Shared by the trading API and Alpaca market data, both count against the same account limit
+    inline RateLimiter& alpacaRateLimiter() {
+        static RateLimiter limiter(200, std::chrono::minutes(1));
+        return limiter;
+    }
+
+    /// Polygon has no hard limit for paid plans but asks clients to stay below 100 requests per second
+    inline RateLimiter& polygonRateLimiter() {
+        static RateLimiter limiter(100, std::chrono::seconds(1));
+        return limiter;
+    }
+
+} // namespace alpaca
@@ -4,8 +4,10 @@
 #include <string>
 #include <cassert>
 #include <type_traits>
+#include <vector>
 #include "alpaca/json.h"
 #include "logger.h"
+#include "rate_limiter.h"
 
 namespace alpaca {
 
@@ -37,11 +39,28 @@ namespace alpaca {
         return sActionStatus[status];
     }
 
+    template<typename T>
+    class Response;
+
+    // at namespace scope, so rateLimiter() doesn't declare a class local to itself
+    class Polygon;
+
+    // declared ahead of Response so its friend declarations below don't drop the default arguments
+    template<typename T, typename CallerT>
+    Response<T> request(const std::string& url, std::string headers = "", const char* data = nullptr, Logger* Logger = nullptr);
+
+    template<typename T, typename CallerT>
+    std::vector<Response<T>> requestAll(const std::vector<std::string>& urls, std::string headers = "", Logger* Logger = nullptr, size_t maxInFlight = 4);
+
+    template<typename T, typename CallerT>
+    Response<T> parseResponse(const std::string& content);
+
     template<typename T>
     class Response {
     public:
         explicit Response(int c = 0) noexcept : code_(c), message_("OK") {}
         Response(int c, std::string m) noexcept : code_(c), message_(std::move(m)) {}
+        Response(int c, std::string m, T content) noexcept : code_(c), message_(std::move(m)), content_(std::move(content)) {}
 
     public:
         int getCode() const noexcept {
@@ -61,8 +80,14 @@ namespace alpaca {
         }
 
     private:
-        template<typename T, typename CallerT>
-        friend Response<T> request(const std::string&, std::string, const char*, Logger* Logger);
+        template<typename U, typename CallerT>
+        friend Response<U> request(const std::string&, std::string, const char*, Logger* Logger);
+
+        template<typename U, typename CallerT>
+        friend std::vector<Response<U>> requestAll(const std::vector<std::string>&, std::string, Logger*, size_t);
+
+        template<typename U, typename CallerT>
+        friend Response<U> parseResponse(const std::string&);
 
         template<typename CallerT>
         void parseContent(const std::string& content) {
@@ -87,7 +112,7 @@ namespace alpaca {
                     return;
                 }
             }
-            else if (!std::is_same<CallerT, class Polygon>::value) {
+            else if (!std::is_same<CallerT, Polygon>::value) {
                 if (d.HasMember("code") && d.HasMember("message")) {
                     message_ = d["message"].GetString();
                     code_ = d["code"].GetInt();
@@ -122,7 +147,7 @@ namespace alpaca {
         
         template<typename U, typename CallerT>
         std::pair<int, std::string> parse(Parser<rapidjson::Document>& parser, U& content, typename std::enable_if<!is_vector<U>::value>::type* = 0) {
-            return content.fromJSON<CallerT>(parser);
+            return content.template fromJSON<CallerT>(parser);
         }
 
         template<typename U, typename CallerT>
@@ -135,8 +160,8 @@ namespace alpaca {
                     }
                     auto objJson = item.GetObject();
                     Parser<decltype(item.GetObject())> itemParser(objJson);
-                    U::value_type obj;
-                    obj.fromJSON<CallerT>(itemParser);
+                    typename U::value_type obj;
+                    obj.template fromJSON<CallerT>(itemParser);
                     content.emplace_back(std::move(obj));
                 }
                 return std::make_pair(0, "OK");
@@ -169,46 +194,178 @@ namespace alpaca {
     };
 
 
+    template<typename CallerT>
+    inline RateLimiter& rateLimiter() {
+        return std::is_same<CallerT, Polygon>::value ? polygonRateLimiter() : alpacaRateLimiter();
+    }
+
     /**
-    * Helper function - Send requst
+    * Helper function - Read the reply of a finished request and release the request id
+    */
+    inline std::string readResult(int id, long n) {
+        std::string content;
+        if (n > 0) {
+            char* buffer = (char*)malloc(n + 1);
+            buffer[n] = 0;
+            http_result(id, buffer, n);
+            content = buffer;
+            free(buffer); //free up memory allocation
+        }
+        http_free(id); //always clean up the id!
+        return content;
+    }
+
+    /**
+    * Helper function - Send requst and return the raw reply
     * 
     * unfortunately need to make a copy of headers for every request. Otherwise only the first request has headers.
     * 
     */
-    template<typename T, typename CallerT>
-    inline Response<T> request(const std::string& url, std::string headers = "", const char* data = nullptr, Logger* Logger = nullptr) {
+    template<typename CallerT>
+    inline Response<std::string> requestRaw(const std::string& url, std::string headers = "", const char* data = nullptr, Logger* Logger = nullptr) {
+        if (!rateLimiter<CallerT>().acquire()) {
+            return Response<std::string>(1, "Brokerprogress returned zero. Aborting...");
+        }
+
         int id = http_send((char*)url.c_str(), (char*)data, (char*)(headers.empty() ? nullptr : headers.c_str()));
 
         if (!id) {
-            return Response<T>(1, "Cannot connect to server");
+            return Response<std::string>(1, "Cannot connect to server");
         }
 
         long n = 0;
-        std::stringstream ss;
         while (!(n = http_status(id))) {
             Sleep(100); // wait for the server to reply
             if (!BrokerProgress(1)) {
                 http_free(id);
-                return Response<T>(1, "Brokerprogress returned zero. Aborting...");
+                return Response<std::string>(1, "Brokerprogress returned zero. Aborting...");
             }
             // print dots, abort if returns zero.
         }
-
-        if (n > 0) {
-            char* buffer = (char*)malloc(n + 1);
-            auto received = http_result(id, buffer, n);
-            ss << buffer;
-            free(buffer); //free up memory allocation
+        if (n < 0) {
+            // the transfer failed, there is no reply to read
+            http_free(id);
+            return Response<std::string>(1, "Request failed");
         }
-        http_free(id); //always clean up the id!
 
+        Response<std::string> response;
+        response.content() = readResult(id, n);
         if (Logger) {
-            Logger->logTrace("<-- %s\n", ss.str().c_str());
+            Logger->logTrace("<-- %s\n", response.content().c_str());
         }
+        return response;
+    }
 
+    /**
+    * Helper function - Deserialize a raw reply of CallerT
+    */
+    template<typename T, typename CallerT>
+    inline Response<T> parseResponse(const std::string& content) {
         Response<T> response;
-        response.parseContent<CallerT>(ss.str());
+        response.template parseContent<CallerT>(content);
         return response;
     }
 
+    /**
+    * Helper function - Send requst
+    */
+    template<typename T, typename CallerT>
+    inline Response<T> request(const std::string& url, std::string headers, const char* data, Logger* Logger) {
+        auto raw = requestRaw<CallerT>(url, std::move(headers), data, Logger);
+        if (!raw) {
+            return Response<T>(raw.getCode(), raw.what());
+        }
+        return parseResponse<T, CallerT>(raw.content());
+    }
+
+    /**
+    * Helper function - Send requests concurrently and return the raw replies
+    *
+    * Up to maxInFlight requests are outstanding at any time, each send still takes a slot from the rate limiter.
+    * Responses are returned in the same order as urls. All requests are GETs, or take the same data, e.g. "#DELETE", or
+    * each takes its own from bodies, e.g. a POST body per url.
+    */
+    template<typename CallerT>
+    inline std::vector<Response<std::string>> requestAllRaw(const std::vector<std::string>& urls, std::string headers = "", Logger* Logger = nullptr, size_t maxInFlight = 4,
+        const char* data = nullptr, const std::vector<std::string>* bodies = nullptr) {
+        assert(!bodies || bodies->size() == urls.size());
+        std::vector<Response<std::string>> responses(urls.size());
+        std::vector<std::pair<int, size_t>> inFlight;   // (request id, index in urls)
+        inFlight.reserve(maxInFlight);
+
+        size_t next = 0;
+        uint32_t polls = 0;
+        while (next < urls.size() || !inFlight.empty()) {
+            while (next < urls.size() && inFlight.size() < maxInFlight && rateLimiter<CallerT>().tryAcquire()) {
+                auto* body = bodies ? (*bodies)[next].c_str() : data;
+                int id = http_send((char*)urls[next].c_str(), (char*)body, (char*)(headers.empty() ? nullptr : headers.c_str()));
+                if (!id) {
+                    responses[next] = Response<std::string>(1, "Cannot connect to server");
+                }
+                else {
+                    inFlight.emplace_back(id, next);
+                }
+                ++next;
+            }
+
+            for (auto it = inFlight.begin(); it != inFlight.end();) {
+                long n = http_status(it->first);
+                if (!n) {
+                    ++it;
+                    continue;
+                }
+                if (n < 0) {
+                    // the transfer failed, there is no reply to read
+                    http_free(it->first);
+                    responses[it->second] = Response<std::string>(1, "Request failed");
+                    it = inFlight.erase(it);
+                    continue;
+                }
+
+                auto& content = responses[it->second].content();
+                content = readResult(it->first, n);
+                if (Logger) {
+                    Logger->logTrace("<-- %s\n", content.c_str());
+                }
+                it = inFlight.erase(it);
+            }
+
+            if (inFlight.empty() && next == urls.size()) {
+                break;
+            }
+
+            Sleep(10);
+            if (++polls % 10 == 0 && !BrokerProgress(1)) {
+                for (auto& req : inFlight) {
+                    http_free(req.first);
+                    responses[req.second] = Response<std::string>(1, "Brokerprogress returned zero. Aborting...");
+                }
+                for (; next < urls.size(); ++next) {
+                    responses[next] = Response<std::string>(1, "Brokerprogress returned zero. Aborting...");
+                }
+                break;
+            }
+        }
+        return responses;
+    }
+
+    /**
+    * Helper function - Send GET requests concurrently
+    */
+    template<typename T, typename CallerT>
+    inline std::vector<Response<T>> requestAll(const std::vector<std::string>& urls, std::string headers, Logger* Logger, size_t maxInFlight) {
+        auto raws = requestAllRaw<CallerT>(urls, std::move(headers), Logger, maxInFlight);
+        std::vector<Response<T>> responses;
+        responses.reserve(raws.size());
+        for (auto& raw : raws) {
+            if (!raw) {
+                responses.emplace_back(raw.getCode(), raw.what());
+                continue;
+            }
+            responses.emplace_back();
+            responses.back().template parseContent<CallerT>(raw.content());
+        }
+        return responses;
+    }
+
 } // namespace alpaca
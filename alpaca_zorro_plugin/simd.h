@@ -0,0 +1,49 @@
+#pragma once
+
+// SSE2 is the baseline on x64 and enabled by /arch:SSE2 on x86
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define ALPACA_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 kernels are compiled in regardless of /arch and only called when the CPU supports them, GCC needs -mavx2
+#if defined(_M_X64) || defined(_M_IX86) || defined(__AVX2__)
+#define ALPACA_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace alpaca {
+
+#ifdef ALPACA_AVX2
+    namespace detail {
+        inline bool detectAvx2() noexcept {
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+
+            // the OS has to save the YMM registers on context switches
+            __cpuid(info, 1);
+            constexpr int OSXSAVE = 1 << 27;
+            constexpr int AVX = 1 << 28;
+            if ((info[2] & (OSXSAVE | AVX)) != (OSXSAVE | AVX) || (_xgetbv(0) & 6) != 6) {
+                return false;
+            }
+
+            __cpuidex(info, 7, 0);
+            constexpr int AVX2 = 1 << 5;
+            return (info[1] & AVX2) != 0;
+        }
+    }
+
+    inline bool hasAvx2() noexcept {
+        static const bool avx2 = detail::detectAvx2();
+        return avx2;
+    }
+#else
+    inline bool hasAvx2() noexcept { return false; }
+#endif
+
+} // namespace alpaca
@@ -0,0 +1,156 @@
+#include "stdafx.h"
+#include "websocket.h"
+
+#include <winhttp.h>
+
+namespace alpaca {
+
+    namespace {
+        constexpr int HANDSHAKE_TIMEOUT_MS = 10000;
+
+        std::wstring widen(const std::string& s) {
+            // urls are ASCII
+            return std::wstring(s.begin(), s.end());
+        }
+    }
+
+    WebSocket::~WebSocket() {
+        close();
+    }
+
+    bool WebSocket::fail(const char* what) {
+        error_ = std::string(what) + " failed, error " + std::to_string(GetLastError());
+        close();
+        return false;
+    }
+
+    bool WebSocket::connect(const std::string& url) {
+        close();
+        error_.clear();
+
+        auto wurl = widen(url);
+        wchar_t host[256];
+        wchar_t path[2048];
+        URL_COMPONENTS parts = { sizeof(parts) };
+        parts.lpszHostName = host;
+        parts.dwHostNameLength = sizeof(host) / sizeof(host[0]);
+        parts.lpszUrlPath = path;
+        parts.dwUrlPathLength = sizeof(path) / sizeof(path[0]);
+        // WinHttpCrackUrl doesn't know the ws schemes
+        auto httpUrl = wurl.compare(0, 6, L"wss://") == 0 ? L"https://" + wurl.substr(6) :
+            wurl.compare(0, 5, L"ws://") == 0 ? L"http://" + wurl.substr(5) : wurl;
+        if (!WinHttpCrackUrl(httpUrl.c_str(), 0, 0, &parts)) {
+            return fail("Parsing url");
+        }
+
+        session_ = WinHttpOpen(L"AlpacaZorroPlugin", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+        if (!session_) {
+            return fail("WinHttpOpen");
+        }
+        connection_ = WinHttpConnect(session_, host, parts.nPort, 0);
+        if (!connection_) {
+            return fail("WinHttpConnect");
+        }
+
+        auto request = WinHttpOpenRequest(connection_, L"GET", path, nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES,
+            parts.nScheme == INTERNET_SCHEME_HTTPS ? WINHTTP_FLAG_SECURE : 0);
+        if (!request) {
+            return fail("WinHttpOpenRequest");
+        }
+
+        DWORD status = 0;
+        DWORD size = sizeof(status);
+        WinHttpSetTimeouts(request, HANDSHAKE_TIMEOUT_MS, HANDSHAKE_TIMEOUT_MS, HANDSHAKE_TIMEOUT_MS, HANDSHAKE_TIMEOUT_MS);
+        if (!WinHttpSetOption(request, WINHTTP_OPTION_UPGRADE_TO_WEB_SOCKET, nullptr, 0) ||
+            !WinHttpSendRequest(request, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0) ||
+            !WinHttpReceiveResponse(request, nullptr) ||
+            !WinHttpQueryHeaders(request, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &status, &size, WINHTTP_NO_HEADER_INDEX)) {
+            WinHttpCloseHandle(request);
+            return fail("WebSocket handshake");
+        }
+        if (status != 101) {
+            WinHttpCloseHandle(request);
+            error_ = "WebSocket handshake rejected with HTTP status " + std::to_string(status);
+            close();
+            return false;
+        }
+
+        socket_ = WinHttpWebSocketCompleteUpgrade(request, 0);
+        WinHttpCloseHandle(request);
+        if (!socket_.load()) {
+            return fail("WinHttpWebSocketCompleteUpgrade");
+        }
+        // a quiet market sends nothing for a long time, that is no reason to drop the connection
+        DWORD infinite = 0;
+        WinHttpSetOption(socket_.load(), WINHTTP_OPTION_RECEIVE_TIMEOUT, &infinite, sizeof(infinite));
+        return true;
+    }
+
+    bool WebSocket::send(const std::string& text) {
+        auto socket = socket_.load();
+        if (!socket) {
+            return false;
+        }
+        auto rt = WinHttpWebSocketSend(socket, WINHTTP_WEB_SOCKET_UTF8_MESSAGE_BUFFER_TYPE, (PVOID)text.data(), (DWORD)text.size());
+        if (rt != NO_ERROR) {
+            error_ = "WebSocket send failed, error " + std::to_string(rt);
+            return false;
+        }
+        return true;
+    }
+
+    bool WebSocket::receive(std::string& message) {
+        message.clear();
+        char buffer[8192];
+        while (true) {
+            auto socket = socket_.load();
+            if (!socket) {
+                return false;
+            }
+
+            DWORD read = 0;
+            WINHTTP_WEB_SOCKET_BUFFER_TYPE type;
+            auto rt = WinHttpWebSocketReceive(socket, buffer, sizeof(buffer), &read, &type);
+            if (rt != NO_ERROR) {
+                if (socket_.load()) {
+                    error_ = "WebSocket receive failed, error " + std::to_string(rt);
+                }
+                return false;
+            }
+            if (type == WINHTTP_WEB_SOCKET_CLOSE_BUFFER_TYPE) {
+                USHORT status = 0;
+                DWORD reasonLength = 0;
+                WinHttpWebSocketQueryCloseStatus(socket, &status, buffer, sizeof(buffer), &reasonLength);
+                error_ = "WebSocket closed by server, status " + std::to_string(status) + " " + std::string(buffer, reasonLength);
+                return false;
+            }
+
+            message.append(buffer, read);
+            if (type == WINHTTP_WEB_SOCKET_UTF8_MESSAGE_BUFFER_TYPE || type == WINHTTP_WEB_SOCKET_BINARY_MESSAGE_BUFFER_TYPE) {
+                return true;
+            }
+            // a fragment, the rest of the message follows
+        }
+    }
+
+    void WebSocket::interrupt() noexcept {
+        // closing the handle cancels a receive blocked on another thread
+        auto socket = socket_.exchange(nullptr);
+        if (socket) {
+            WinHttpCloseHandle(socket);
+        }
+    }
+
+    void WebSocket::close() noexcept {
+        interrupt();
+        if (connection_) {
+            WinHttpCloseHandle(connection_);
+            connection_ = nullptr;
+        }
+        if (session_) {
+            WinHttpCloseHandle(session_);
+            session_ = nullptr;
+        }
+    }
+
+} // namespace alpaca
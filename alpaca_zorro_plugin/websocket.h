@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace alpaca {
+
+    /**
+     * @brief A blocking WebSocket client on top of WinHTTP, which answers the server pings itself.
+     *
+     * Zorro's http_send only does request/reply, streams need their own connection. One thread
+     * connects, receives and closes, any thread may send() or interrupt().
+     */
+    class WebSocket {
+    public:
+        WebSocket() = default;
+        ~WebSocket();
+
+        WebSocket(const WebSocket&) = delete;
+        WebSocket& operator=(const WebSocket&) = delete;
+
+        /**
+         * @brief Connect to a wss:// or ws:// url, closes the current connection first.
+         */
+        bool connect(const std::string& url);
+
+        /**
+         * @brief Send a text message.
+         */
+        bool send(const std::string& text);
+
+        /**
+         * @brief Wait for the next complete message, text and binary messages alike.
+         * @return false once the connection is closed or broken.
+         */
+        bool receive(std::string& message);
+
+        void close() noexcept;
+
+        /**
+         * @brief Drop the connection from another thread, a blocked receive() returns false.
+         */
+        void interrupt() noexcept;
+
+        bool isOpen() const noexcept { return socket_.load() != nullptr; }
+
+        /**
+         * @brief The last error, empty if none.
+         */
+        const std::string& error() const noexcept { return error_; }
+
+    private:
+        bool fail(const char* what);
+
+    private:
+        void* session_ = nullptr;       // HINTERNET
+        void* connection_ = nullptr;    // HINTERNET
+        std::atomic<void*> socket_{ nullptr };
+        std::string error_;
+    };
+
+} // namespace alpaca
@@ -0,0 +1,214 @@
+// AssetCatalog (alpaca/asset_catalog.cpp) at login: mapping the catalog file against parsing the
+// downloaded asset list, find() per symbol, and the file size against the JSON it is built from.
+//
+// The asset list is 11,000 generated assets in the layout of /v2/assets, served through fake_http.h.
+// The first load downloads and builds the file, every later one maps it. Then the file is damaged in
+// the ways map() checks, a slot past the records, a string offset past the string table and a string
+// table without its last NUL, and each load has to throw it away and build it again from a download.
+//
+// The catalog file is written to the working directory.
+//
+// usage: asset_catalog [assets]
+
+#include "stdafx.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "alpaca/client.h"
+#include "fake_http.h"
+
+using namespace alpaca;
+
+namespace alpaca {
+
+    // Stand-in for the constructor in alpaca/client.cpp, which would link most of the plugin. The
+    // catalog needs only the base url and the headers.
+    Client::Client(std::string key, std::string secret, bool isPaperTrading)
+        : baseUrl_(isPaperTrading ? "https://paper-api.alpaca.markets" : "https://api.alpaca.markets")
+        , apiKey_(std::move(key))
+        , headers_("APCA-API-KEY-ID:" + apiKey_ + "\nAPCA-API-SECRET-KEY:" + std::move(secret))
+        , assets_("AlpacaAssetsPaper.bin")
+        , isLiveMode_(!isPaperTrading)
+    {}
+}
+
+namespace {
+
+    const char* PATH = "AlpacaAssetsPaper.bin";
+
+    // A, B, ..., Z, AA, AB, ...
+    std::string symbolOf(size_t i) {
+        std::string symbol(1, (char)('A' + i % 26));
+        for (i /= 26; i; i = (i - 1) / 26) {
+            symbol.insert(symbol.begin(), (char)('A' + (i - 1) % 26));
+        }
+        return symbol;
+    }
+
+    std::string assetList(size_t count, std::vector<std::string>& symbols) {
+        const char* exchanges[] = { "NASDAQ", "NYSE", "ARCA", "AMEX", "BATS", "OTC" };
+        std::string json = "[";
+        for (size_t i = 0; i < count; ++i) {
+            symbols.push_back(symbolOf(i));
+            char asset[512];
+            sprintf_s(asset, sizeof(asset),
+                "%s{\"id\":\"%08zx-8b9b-48a9-ba46-%012zx\",\"class\":\"us_equity\",\"exchange\":\"%s\",\"symbol\":\"%s\","
+                "\"name\":\"%s Holdings Inc. Common Stock\",\"status\":\"%s\",\"tradable\":%s,\"marginable\":%s,"
+                "\"maintenance_margin_requirement\":30,\"shortable\":%s,\"easy_to_borrow\":%s,\"fractionable\":%s,\"attributes\":[]}",
+                i ? "," : "", i * 2654435761u % 0xffffffffu, i * 40503, exchanges[i % 6], symbols.back().c_str(), symbols.back().c_str(),
+                i % 10 ? "active" : "inactive", i % 10 ? "true" : "false", i % 3 ? "true" : "false",
+                i % 4 ? "true" : "false", i % 5 ? "true" : "false", i % 2 ? "true" : "false");
+            json += asset;
+        }
+        return json + "]";
+    }
+
+    double us(bench::Clock::time_point from) {
+        return std::chrono::duration<double, std::micro>(bench::Clock::now() - from).count();
+    }
+
+    // overwrites bytes of the catalog file at an offset from its start or, if negative, its end
+    void damage(long offset, const void* bytes, size_t n) {
+        FILE* f = fopen(PATH, "r+b");
+        fseek(f, offset, offset < 0 ? SEEK_END : SEEK_SET);
+        fwrite(bytes, 1, n, f);
+        fclose(f);
+    }
+
+    uint32_t headerField(long offset) {
+        uint32_t value = 0;
+        FILE* f = fopen(PATH, "rb");
+        fseek(f, offset, SEEK_SET);
+        fread(&value, sizeof(value), 1, f);
+        fclose(f);
+        return value;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? (size_t)atoi(argv[1]) : 11000;
+    std::vector<std::string> symbols;
+    auto json = assetList(count, symbols);
+    bench::server = [&json](const std::string&, const char*) {
+        bench::Reply reply;
+        reply.body = json;
+        return reply;
+    };
+    Client client("key", "secret", true);
+    auto& logger = client.logger();
+    remove(PATH);
+
+    // what the login did before the catalog: parse the list and index it by symbol
+    auto t0 = bench::Clock::now();
+    const int PARSES = 5;
+    size_t indexed = 0;
+    for (int r = 0; r < PARSES; ++r) {
+        auto response = parseResponse<std::vector<Asset>, Client>(json);
+        std::unordered_map<std::string, Asset> bySymbol;
+        for (auto& asset : response.content()) {
+            bySymbol.emplace(asset.symbol, asset);
+        }
+        indexed = bySymbol.size();
+    }
+    auto parse = us(t0) / PARSES;
+
+    {
+        AssetCatalog catalog(PATH);
+        t0 = bench::Clock::now();
+        if (!catalog.load(client, logger)) {
+            printf("failed to build the catalog\n");
+            return 1;
+        }
+        printf("%zu assets, %.1f MB JSON, built in %.0f ms with %d request\n", count, json.size() / 1e6, us(t0) / 1000., bench::requests);
+    }
+
+    std::ifstream file(PATH, std::ios::binary | std::ios::ate);
+    printf("catalog file %.0f KB\n\n", file.tellg() / 1e3);
+
+    const int LOADS = 1000;
+    t0 = bench::Clock::now();
+    for (int r = 0; r < LOADS; ++r) {
+        AssetCatalog catalog(PATH);
+        catalog.load(client, logger);
+    }
+    auto map = us(t0) / LOADS;
+    printf("login, mapped          %8.1f us\n", map);
+    printf("login, parsed JSON     %8.1f us   %zu assets indexed\n", parse, indexed);
+
+    {
+        AssetCatalog catalog(PATH);
+        catalog.load(client, logger);
+        AssetInfo info;
+        size_t found = 0;
+        const int ROUNDS = 100;
+        t0 = bench::Clock::now();
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (auto& symbol : symbols) {
+                found += catalog.find(symbol.c_str(), info);
+            }
+        }
+        auto hit = us(t0) * 1000. / (ROUNDS * symbols.size());
+        std::vector<std::string> unknown;
+        for (auto& symbol : symbols) {
+            unknown.push_back(symbol + "X1");
+        }
+        t0 = bench::Clock::now();
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (auto& symbol : unknown) {
+                found += catalog.find(symbol.c_str(), info);
+            }
+        }
+        auto miss = us(t0) * 1000. / (ROUNDS * unknown.size());
+        printf("find, known symbol     %8.1f ns   %zu of %zu found\n", hit, found, ROUNDS * symbols.size());
+        printf("find, unknown symbol   %8.1f ns\n\n", miss);
+    }
+
+    // Header is 40 bytes, count at 24, slots at 28, Record is 12 bytes
+    const long HEADER = 40;
+    uint32_t assets = headerField(24);
+    uint32_t slots = headerField(28);
+    auto slotsAt = HEADER + (long)assets * 12;
+    uint32_t firstSlot = 0;
+    {
+        FILE* f = fopen(PATH, "rb");
+        for (uint32_t i = 0; i < slots; ++i) {
+            uint32_t slot;
+            fseek(f, slotsAt + (long)i * 4, SEEK_SET);
+            fread(&slot, 4, 1, f);
+            if (slot) {
+                firstSlot = i;
+                break;
+            }
+        }
+        fclose(f);
+    }
+
+    struct Damage {
+        const char* what;
+        long offset;
+        uint32_t value;
+        size_t bytes;
+    };
+    Damage damages[] = {
+        { "slot past the records", slotsAt + (long)firstSlot * 4, assets + 1, 4 },
+        { "symbol offset past the strings", HEADER, 0x7fffffff, 4 },
+        { "exchange offset past the strings", HEADER + 4, 0x7fffffff, 4 },
+        { "string table without its NUL", -1, 'Z', 1 },
+    };
+    for (auto& d : damages) {
+        damage(d.offset, &d.value, d.bytes);
+        auto before = bench::requests;
+        AssetCatalog damaged(PATH);
+        bool loaded = damaged.load(client, logger);
+        printf("%-34s %s, %d download, %u assets\n", d.what,
+            loaded && bench::requests == before + 1 ? "rebuilt" : "NOT REBUILT", bench::requests - before, damaged.size());
+    }
+    return 0;
+}
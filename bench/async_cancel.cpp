@@ -0,0 +1,93 @@
+// Wall time BrokerSell2 blocks per cancel of a working order, before and after cancels were confirmed
+// in the background from BrokerTime.
+//
+// The stand-in server answers after a fixed round trip and confirms a cancel CONFIRM ms after it
+// arrived. Before, cancelOrder sent the DELETE and then waited: with the trade stream down it read
+// the order until it was no longer pending_cancel, with the stream up it waited for the canceled
+// event. After, it only sends the DELETE.
+//
+// usage: async_cancel [rtt_ms] [confirm_ms]
+
+#include "stdafx.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "logger.h"
+#include "request.h"
+#include "alpaca/order.h"
+#include "fake_http.h"
+
+using namespace alpaca;
+
+namespace alpaca {
+    class Client;
+}
+
+namespace {
+
+    const int CANCELS = 20;
+    int s_rtt = 40;
+    int s_confirm = 30;
+    std::map<std::string, bench::Clock::time_point> s_canceledAt;
+
+    const char* statusOf(const std::string& id) {
+        auto it = s_canceledAt.find(id);
+        if (it == s_canceledAt.end()) {
+            return "new";
+        }
+        return bench::Clock::now() >= it->second + std::chrono::milliseconds(s_confirm) ? "canceled" : "pending_cancel";
+    }
+
+    bench::Reply answer(const std::string& url, const char* data) {
+        auto id = url.substr(url.rfind('/') + 1);
+        bench::Reply reply;
+        reply.latencyMs = s_rtt;
+        if (data && std::string(data) == "#DELETE") {
+            s_canceledAt.emplace(id, bench::Clock::now());
+            return reply;
+        }
+        reply.body = "{\"id\":\"" + id + "\",\"client_order_id\":\"ZORRO_" + id.substr(1) + "\",\"symbol\":\"AAPL\","
+            "\"asset_class\":\"us_equity\",\"qty\":\"1\",\"filled_qty\":\"0\",\"type\":\"limit\",\"side\":\"buy\","
+            "\"time_in_force\":\"gtc\",\"status\":\"" + statusOf(id) + "\"}";
+        return reply;
+    }
+
+    // wall time per cancel of CANCELS cancels of orders prefix0, prefix1, ...
+    template<typename Wait>
+    double blocked(const char* prefix, Wait wait) {
+        auto start = bench::Clock::now();
+        for (int i = 0; i < CANCELS; ++i) {
+            auto url = "/v2/orders/" + (prefix + std::to_string(i));
+            requestRaw<Client>(url, "", "#DELETE");
+            wait(url);
+        }
+        return bench::ms(start) / CANCELS;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    s_rtt = argc > 1 ? atoi(argv[1]) : 40;
+    s_confirm = argc > 2 ? atoi(argv[2]) : 30;
+    bench::server = answer;
+
+    auto streamDown = blocked("o", [](const std::string& url) {
+        Order order;
+        do {
+            order = request<Order, Client>(url, "", nullptr, nullptr).content();
+        } while (order.status == "pending_cancel");
+    });
+    auto streamUp = blocked("p", [](const std::string& url) {
+        while (strcmp(statusOf(url.substr(url.rfind('/') + 1)), "canceled")) {
+            Sleep(1);
+        }
+    });
+    auto after = blocked("q", [](const std::string&) {});
+
+    printf("rtt %d ms, confirmed %d ms after the DELETE: blocked per cancel before %.0f ms (stream down), %.0f ms (stream up), after %.0f ms\n",
+        s_rtt, s_confirm, streamDown, streamUp, after);
+    return 0;
+}
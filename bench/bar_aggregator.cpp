@@ -0,0 +1,161 @@
+// Throughput of BarAggregator::aggregate and the columnMax/columnMin/columnSum kernels
+// (market_data/bar_aggregator.cpp).
+//
+// The input is a synthetic random walk: one year of 1-minute bars with extended hours, 4:00-20:00
+// New York, 2% of the minutes missing. Each bar period is aggregated from the 1-minute bars and
+// checked against a reference that walks an array of Bar structs and asks bucketStart for every bar.
+// The kernels are checked against scalar loops on runs of the lengths the aggregation sees.
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "market_data/bar_aggregator.h"
+#include "alpaca/clock.h"
+
+using namespace alpaca;
+
+namespace {
+
+    std::vector<Bar> randomWalk() {
+        std::mt19937 rng(42);
+        std::normal_distribution<double> move(0, 0.0006);
+
+        std::vector<Bar> bars;
+        double price = 300.;
+        uint32_t day = 1609459200;  // 2021-01-01 00:00 UTC
+        for (int d = 0; d < 365; ++d, day += 86400) {
+            auto weekday = (day / 86400 + 4) % 7;
+            if (weekday == 0 || weekday == 6) {
+                continue;
+            }
+            // 4:00 New York, the offset of noon is clear of the 2:00 DST switch
+            uint32_t open = day + 4 * 3600 - getNewYorkOffset((__time32_t)(day + 43200));
+            for (int m = 0; m < 960; ++m) {
+                if (rng() % 50 == 0) {
+                    continue;
+                }
+                Bar bar;
+                bar.time = open + m * 60;
+                bar.open_price = price;
+                bar.close_price = price * (1 + move(rng));
+                bar.high_price = std::max(bar.open_price, bar.close_price) + (rng() % 4) * 0.01;
+                bar.low_price = std::min(bar.open_price, bar.close_price) - (rng() % 4) * 0.01;
+                bar.volume = 100 * (1 + rng() % 3000);
+                bars.push_back(bar);
+                price = bar.close_price;
+            }
+        }
+        return bars;
+    }
+
+    // one bucketStart per bar over an array of Bar structs, the loop the columns replaced
+    void reference(const BarAggregator& aggregator, const std::vector<Bar>& in, std::vector<Bar>& out) {
+        uint32_t current = 0;
+        for (auto& bar : in) {
+            auto start = aggregator.bucketStart(bar.time);
+            if (out.empty() || start != current) {
+                current = start;
+                out.push_back(bar);
+                out.back().time = start;
+                continue;
+            }
+            auto& last = out.back();
+            last.high_price = std::max(last.high_price, bar.high_price);
+            last.low_price = std::min(last.low_price, bar.low_price);
+            last.close_price = bar.close_price;
+            last.volume += bar.volume;
+        }
+    }
+
+    template<typename F>
+    double nanosPer(size_t items, int repeat, F&& f) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; ++r) {
+            f();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / ((double)items * repeat);
+    }
+
+    volatile double s_sinkDouble;
+    volatile uint64_t s_sinkSum;
+}
+
+int main() {
+    auto bars = randomWalk();
+    BarColumns columns;
+    columns.reserve(bars.size());
+    for (auto& bar : bars) {
+        columns.push_back(bar);
+    }
+    printf("%zu 1-minute bars\n\n", bars.size());
+
+    printf("       n   max         min         sum         scalar max / sum\n");
+    for (size_t n : { 5, 15, 60, 240, 960, 1 << 20 }) {
+        std::vector<double> highs(columns.high.begin(), columns.high.begin() + std::min(n, columns.size()));
+        std::vector<uint32_t> volumes(columns.volume.begin(), columns.volume.begin() + std::min(n, columns.size()));
+        highs.resize(n, 1.);
+        volumes.resize(n, 1);
+        // so many runs that every length reduces the same number of values
+        int repeat = (int)std::max<size_t>(1, 50000000 / n);
+
+        bool ok = columnMax(highs.data(), n) == *std::max_element(highs.begin(), highs.end()) &&
+            columnMin(highs.data(), n) == *std::min_element(highs.begin(), highs.end());
+        uint64_t sum = 0;
+        for (auto v : volumes) {
+            sum += v;
+        }
+        ok &= columnSum(volumes.data(), n) == sum;
+
+        auto max = nanosPer(n, repeat, [&]() { s_sinkDouble = columnMax(highs.data(), n); });
+        auto min = nanosPer(n, repeat, [&]() { s_sinkDouble = columnMin(highs.data(), n); });
+        auto sumNs = nanosPer(n, repeat, [&]() { s_sinkSum = columnSum(volumes.data(), n); });
+        auto scalarMax = nanosPer(n, repeat, [&]() {
+            double m = highs[0];
+            for (size_t i = 1; i < n; ++i) {
+                m = highs[i] > m ? highs[i] : m;
+            }
+            s_sinkDouble = m;
+        });
+        auto scalarSum = nanosPer(n, repeat, [&]() {
+            uint64_t s = 0;
+            for (size_t i = 0; i < n; ++i) {
+                s += volumes[i];
+            }
+            s_sinkSum = s;
+        });
+        printf("%8zu   %6.3f ns   %6.3f ns   %6.3f ns   %6.3f / %6.3f ns per value   %s\n",
+            n, max, min, sumNs, scalarMax, scalarSum, ok ? "ok" : "MISMATCH");
+    }
+
+    printf("\nperiod     bars out   aggregate          Bar structs + bucketStart\n");
+    for (int minutes : { 5, 15, 60, 240, 1440, 7200 }) {
+        BarAggregator aggregator(minutes, 1, minutes < 1440 ? 570 : 0);
+
+        BarColumns out;
+        auto aggregate = nanosPer(bars.size(), 5, [&]() {
+            out.clear();
+            aggregator.aggregate(columns, out);
+        });
+        std::vector<Bar> expected;
+        auto naive = nanosPer(bars.size(), 5, [&]() {
+            expected.clear();
+            reference(aggregator, bars, expected);
+        });
+
+        bool ok = out.size() == expected.size();
+        for (size_t i = 0; ok && i < out.size(); ++i) {
+            auto bar = out.at(i);
+            ok = bar.time == expected[i].time && bar.open_price == expected[i].open_price &&
+                bar.high_price == expected[i].high_price && bar.low_price == expected[i].low_price &&
+                bar.close_price == expected[i].close_price && bar.volume == expected[i].volume;
+        }
+        printf("%5d min   %8zu   %6.1f M bars/s   %6.1f M bars/s   %s\n",
+            minutes, out.size(), 1e3 / aggregate, 1e3 / naive, ok ? "ok" : "MISMATCH");
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Size and decode speed of the .bars block format (market_data/bar_store.cpp) against T6 and Bar.
+//
+// No captured market data ships with the repo, so the input is a synthetic random walk: one year of
+// 1-minute stock bars, 390 a day, 2% of the minutes missing, random volumes. With cent prices every
+// block takes the decimal mode; with unrounded prices it falls back to XOR.
+//
+// usage: bar_store [file]    file is the .bars file of the round trip, bench.bars by default
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "market_data/bar_store.h"
+#include "market_data/t6_sink.h"
+#include "fake_http.h"     // the other plugin sources link against the Zorro functions
+
+using namespace alpaca;
+
+namespace {
+
+    class CountSink : public BarSink {
+    public:
+        CountSink(__time32_t start, __time32_t end) : BarSink(start, end, 100000000) {}
+
+    protected:
+        void append(const BarChunk&, size_t, size_t) override {}
+    };
+
+    BarColumns randomWalk(bool cents) {
+        std::mt19937 rng(42);
+        std::normal_distribution<double> move(0, 0.0006);
+        auto round = [cents](double price) { return cents ? std::round(price * 100) / 100 : price; };
+
+        BarColumns bars;
+        double price = 300.;
+        uint32_t day = 1577975400;  // 2020-01-02 14:30 UTC
+        for (int d = 0; d < 252; ++d) {
+            for (int m = 0; m < 390; ++m) {
+                if (rng() % 50 == 0) {
+                    continue;
+                }
+                Bar bar;
+                bar.time = day + m * 60;
+                bar.open_price = price;
+                bar.close_price = round(price * (1 + move(rng)));
+                bar.high_price = round(std::max(bar.open_price, bar.close_price) + (rng() % 4) * 0.01);
+                bar.low_price = round(std::min(bar.open_price, bar.close_price) - (rng() % 4) * 0.01);
+                bar.volume = 100 * (1 + rng() % 3000);
+                bars.push_back(bar);
+                price = bar.close_price;
+            }
+            day += 86400 * (d % 5 == 4 ? 3 : 1);
+        }
+        return bars;
+    }
+
+    bool same(const BarColumns& a, size_t i, const BarColumns& b, size_t j) {
+        return a.time[i] == b.time[j] && a.open[i] == b.open[j] && a.high[i] == b.high[j] &&
+            a.low[i] == b.low[j] && a.close[i] == b.close[j] && a.volume[i] == b.volume[j];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : "bench.bars";
+    const size_t BLOCK = 4096;
+
+    for (bool cents : { true, false }) {
+        auto bars = randomWalk(cents);
+        auto n = bars.size();
+
+        std::vector<std::vector<uint8_t>> blocks;
+        std::vector<uint32_t> counts;
+        size_t bytes = 0;
+        for (size_t begin = 0; begin < n; begin += BLOCK) {
+            auto count = std::min(BLOCK, n - begin);
+            blocks.emplace_back();
+            BarStoreWriter::encode(bars, begin, count, blocks.back());
+            counts.push_back((uint32_t)count);
+            bytes += blocks.back().size();
+        }
+
+        BarColumns decoded;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            BarStoreReader::decode(blocks[i].data(), blocks[i].size(), counts[i], decoded);
+        }
+        size_t bad = decoded.size() == n ? 0 : n;
+        for (size_t i = 0; !bad && i < n; ++i) {
+            bad += !same(bars, i, decoded, i);
+        }
+
+        const int REPEAT = 20;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < REPEAT; ++r) {
+            BarColumns d;
+            d.reserve(n);
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                BarStoreReader::decode(blocks[i].data(), blocks[i].size(), counts[i], d);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        printf("%s prices: %zu bars, %.1f bytes/bar, %.1fx smaller than T6 (%zu bytes), %.1fx smaller than Bar (%zu bytes), "
+            "decode %.1f M bars/s, round trip %s\n",
+            cents ? "cent" : "unrounded", n, (double)bytes / n, (double)sizeof(T6) * n / bytes, sizeof(T6),
+            (double)sizeof(Bar) * n / bytes, sizeof(Bar), REPEAT * n / seconds / 1e6, bad ? "FAILED" : "ok");
+
+        // through the file, as brokerCommand(2003) writes it and BrokerHistory2 reads it
+        {
+            BarStoreSink sink(path, 0, 0, 1);
+            writeDescending(bars, sink);
+            sink.close();
+            if (!sink.error().empty()) {
+                printf("write failed: %s\n", sink.error().c_str());
+                return 1;
+            }
+        }
+        BarStoreReader reader(path);
+        if (!reader.isOpen()) {
+            printf("read failed: %s\n", reader.error().c_str());
+            return 1;
+        }
+        auto start = (__time32_t)bars.time[n / 2];
+        auto end = (__time32_t)bars.time[n / 2 + 5000];
+        CountSink range(start, end);
+        auto t1 = std::chrono::steady_clock::now();
+        reader.read(start, end, range);
+        double rangeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t1).count();
+        CountSink all(0, 0);
+        auto t2 = std::chrono::steady_clock::now();
+        reader.read(0, 0, all);
+        double allMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t2).count();
+        printf("  file: %zu blocks, 5001 bars in range -> %u read in %.2f ms, all %u bars in %.2f ms\n",
+            reader.blocks().size(), range.count(), rangeMs, all.count(), allMs);
+    }
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Spread from the first to the last send of 100 market orders: one BrokerBuy2 per order against
+// the concurrent submit of brokerCommand(2016), which goes through requestAllRaw (Client::submitOrders).
+//
+// The stand-in server accepts each order after the given latency, +-40% uniform jitter.
+//
+// usage: batch_submit [latency_ms] [in_flight]    in_flight 0 sends one order after the other
+// The rate limiter counts for the whole process, run each setting on its own.
+
+#include "stdafx.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+#include "request.h"
+#include "alpaca/order.h"
+#include "fake_http.h"
+
+using namespace alpaca;
+
+namespace alpaca {
+    class Client;
+}
+
+namespace {
+
+    const int ORDERS = 100;
+    int s_latency = 50;
+    std::mt19937 s_rng(7);
+    int s_nextOrder = 1;
+
+    bench::Reply answer(const std::string&, const char* data) {
+        std::string body(data ? data : "");
+        auto from = body.find("\"client_order_id\":\"") + 19;
+        auto clientOrderId = body.substr(from, body.find('"', from) - from);
+        bench::Reply reply;
+        reply.latencyMs = (int)(s_latency * std::uniform_real_distribution<double>(0.6, 1.4)(s_rng));
+        reply.body = "{\"id\":\"o" + std::to_string(s_nextOrder++) + "\",\"client_order_id\":\"" + clientOrderId +
+            "\",\"symbol\":\"AAPL\",\"asset_class\":\"us_equity\",\"qty\":\"1\",\"filled_qty\":\"0\",\"type\":\"market\","
+            "\"side\":\"buy\",\"time_in_force\":\"day\",\"status\":\"accepted\"}";
+        return reply;
+    }
+
+    std::string orderBody(int i) {
+        return "{\"symbol\":\"S" + std::to_string(i) + "\",\"qty\":1,\"side\":\"buy\",\"type\":\"market\","
+            "\"time_in_force\":\"day\",\"client_order_id\":\"ZORRO_" + std::to_string(1000 + i) + "\"}";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    s_latency = argc > 1 ? atoi(argv[1]) : 50;
+    size_t inFlight = argc > 2 ? (size_t)atoi(argv[2]) : 0;
+    bench::server = answer;
+
+    auto start = bench::Clock::now();
+    size_t accepted = 0;
+    if (!inFlight) {
+        for (int i = 0; i < ORDERS; ++i) {
+            auto body = orderBody(i);
+            accepted += (bool)request<Order, Client>("/v2/orders", "", body.c_str(), nullptr);
+        }
+    }
+    else {
+        std::vector<std::string> urls(ORDERS, "/v2/orders");
+        std::vector<std::string> bodies;
+        for (int i = 0; i < ORDERS; ++i) {
+            bodies.push_back(orderBody(i));
+        }
+        for (auto& raw : requestAllRaw<Client>(urls, "", nullptr, inFlight, nullptr, &bodies)) {
+            accepted += raw && (bool)parseResponse<Order, Client>(raw.content());
+        }
+    }
+    auto done = bench::Clock::now();
+
+    printf("latency %d ms, %s: first to last send %.0f ms, all accepted after %.0f ms, %zu of %d accepted\n",
+        s_latency, inFlight ? (std::to_string(inFlight) + " in flight").c_str() : "sequential",
+        bench::ms(bench::sendTimes.front(), bench::sendTimes.back()), bench::ms(start, done), accepted, ORDERS);
+    return 0;
+}
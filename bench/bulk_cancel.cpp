@@ -0,0 +1,139 @@
+// Time to flat for 100 open orders: one cancel per trade against the bulk DELETE /v2/orders of
+// brokerCommand(2014) and concurrent DELETEs through requestAllRaw (Client::cancelOrders).
+//
+// The stand-in server answers after a fixed round trip and confirms a cancel CONFIRM ms after it
+// arrived. The per-trade path replays the old cancelOrder with the trade stream down: DELETE, then
+// getOrder until the order is no longer pending_cancel. The other paths end with one sweep of the
+// open orders, as the plugin confirms the cancels afterwards.
+//
+// usage: bulk_cancel [rtt_ms] [mode]    mode 1 per trade, 2 bulk, 3 concurrent (4 in flight)
+// The rate limiter counts for the whole process, run each mode on its own.
+
+#include "stdafx.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "logger.h"
+#include "request.h"
+#include "alpaca/order.h"
+#include "fake_http.h"
+
+using namespace alpaca;
+
+namespace alpaca {
+    class Client;
+}
+
+namespace {
+
+    const int ORDERS = 100;
+    const int CONFIRM = 30;
+    int s_rtt = 40;
+    std::map<std::string, bench::Clock::time_point> s_canceledAt;
+
+    std::string orderId(int i) { return "o" + std::to_string(i); }
+
+    const char* statusOf(const std::string& id) {
+        auto it = s_canceledAt.find(id);
+        if (it == s_canceledAt.end()) {
+            return "new";
+        }
+        return bench::Clock::now() >= it->second + std::chrono::milliseconds(CONFIRM) ? "canceled" : "pending_cancel";
+    }
+
+    std::string orderJson(const std::string& id, const char* status) {
+        return "{\"id\":\"" + id + "\",\"client_order_id\":\"ZORRO_" + id.substr(1) + "\",\"symbol\":\"AAPL\","
+            "\"asset_class\":\"us_equity\",\"qty\":\"1\",\"filled_qty\":\"0\",\"type\":\"limit\",\"side\":\"buy\","
+            "\"time_in_force\":\"gtc\",\"status\":\"" + status + "\"}";
+    }
+
+    bench::Reply answer(const std::string& url, const char* data) {
+        bool del = data && std::string(data) == "#DELETE";
+        auto now = bench::Clock::now();
+        bench::Reply reply;
+        reply.latencyMs = s_rtt;
+        if (del && url == "/v2/orders") {
+            reply.body = "[";
+            for (int i = 0; i < ORDERS; ++i) {
+                auto id = orderId(i);
+                s_canceledAt.emplace(id, now);
+                reply.body += (i ? ",{\"id\":\"" : "{\"id\":\"") + id + "\",\"status\":200,\"body\":" + orderJson(id, "pending_cancel") + "}";
+            }
+            reply.body += "]";
+            reply.latencyMs += ORDERS / 10;    // the venue works through the list
+        }
+        else if (del) {
+            s_canceledAt.emplace(url.substr(url.rfind('/') + 1), now);
+        }
+        else if (url.find("/v2/orders?") == 0) {
+            reply.body = "[";
+            for (int i = 0; i < ORDERS; ++i) {
+                auto id = orderId(i);
+                auto status = statusOf(id);
+                if (strcmp(status, "canceled")) {
+                    reply.body += (reply.body.size() > 1 ? "," : "") + orderJson(id, status);
+                }
+            }
+            reply.body += "]";
+        }
+        else {
+            auto id = url.substr(url.rfind('/') + 1);
+            reply.body = orderJson(id, statusOf(id));
+        }
+        return reply;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    s_rtt = argc > 1 ? atoi(argv[1]) : 40;
+    int mode = argc > 2 ? atoi(argv[2]) : 1;
+    bench::server = answer;
+
+    auto start = bench::Clock::now();
+    if (mode == 1) {
+        for (int i = 0; i < ORDERS; ++i) {
+            auto url = "/v2/orders/" + orderId(i);
+            requestRaw<Client>(url, "", "#DELETE");
+            Order order;
+            do {
+                order = request<Order, Client>(url, "", nullptr, nullptr).content();
+            } while (order.status == "pending_cancel");
+        }
+        printf("rtt %d ms, one cancelOrder per trade: %.0f ms to flat, %d requests\n", s_rtt, bench::ms(start), bench::requests);
+        return 0;
+    }
+
+    std::unordered_set<std::string> ids;
+    if (mode == 2) {
+        auto bulk = request<std::vector<BulkOrderResult>, Client>("/v2/orders", "", "#DELETE", nullptr);
+        for (auto& result : bulk.content()) {
+            if (result.ok() && result.order.status == "pending_cancel") {
+                ids.insert(result.id);
+            }
+        }
+    }
+    else {
+        std::vector<std::string> urls;
+        for (int i = 0; i < ORDERS; ++i) {
+            urls.push_back("/v2/orders/" + orderId(i));
+            ids.insert(orderId(i));
+        }
+        requestAllRaw<Client>(urls, "", nullptr, 4, "#DELETE");
+    }
+    auto sent = bench::ms(start);
+    auto sweep = request<std::vector<Order>, Client>("/v2/orders?limit=500", "", nullptr, nullptr);
+    size_t open = 0;
+    for (auto& order : sweep.content()) {
+        open += ids.count(order.id);
+    }
+    printf("rtt %d ms, %s: %zu cancels sent in %.0f ms, %.0f ms with the sweep, %zu not confirmed yet, %d requests\n",
+        s_rtt, mode == 2 ? "bulk DELETE /v2/orders" : "concurrent DELETEs, 4 in flight", ids.size(), sent, bench::ms(start),
+        open, bench::requests);
+    return 0;
+}
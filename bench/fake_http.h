@@ -0,0 +1,96 @@
+#pragma once
+
+// Stand-in for the functions Zorro hands to BrokerOpen, so the plugin's request layer runs outside
+// Zorro against a scripted server. Each benchmark sets bench::server to answer its requests; a reply
+// becomes visible to http_status after its latency, like a real round trip. Include this header in
+// exactly one translation unit, it defines the function pointers that AlpacaZorroPlugin.cpp defines
+// in the plugin.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Reply {
+        int latencyMs = 0;
+        std::string body;
+        bool failed = false;    // http_status reports a failed transfer
+    };
+
+    /** Answers a request. data is the request body, "#DELETE" or nullptr for GET. */
+    std::function<Reply(const std::string& url, const char* data)> server;
+
+    /** Requests sent so far. */
+    int requests = 0;
+
+    /** Send time of each request. */
+    std::vector<Clock::time_point> sendTimes;
+
+    namespace detail {
+        struct Pending {
+            Clock::time_point ready;
+            Reply reply;
+        };
+        std::map<int, Pending> pending;
+        int nextId = 1;
+
+        int __cdecl brokerError(const char*) { return 1; }
+        int __cdecl brokerProgress(const int) { return 1; }
+
+        int __cdecl httpSend(char* url, char* data, char*) {
+            ++requests;
+            auto now = Clock::now();
+            sendTimes.push_back(now);
+            auto reply = server(url, data);
+            pending[nextId] = { now + std::chrono::milliseconds(reply.latencyMs), std::move(reply) };
+            return nextId++;
+        }
+
+        long __cdecl httpStatus(int id) {
+            auto it = pending.find(id);
+            if (it == pending.end()) {
+                return -1;
+            }
+            if (Clock::now() < it->second.ready) {
+                return 0;
+            }
+            if (it->second.reply.failed) {
+                return -1;
+            }
+            // an empty 200 reply still has to read as received
+            return it->second.reply.body.empty() ? 1 : (long)it->second.reply.body.size();
+        }
+
+        long __cdecl httpResult(int id, char* content, long size) {
+            auto& body = pending[id].reply.body;
+            auto n = std::min<long>(size, (long)body.size());
+            memcpy(content, body.data(), n);
+            if (n < size) {
+                content[n] = 0;
+            }
+            return n;
+        }
+
+        void __cdecl httpFree(int id) { pending.erase(id); }
+    }
+
+    inline double ms(Clock::time_point from, Clock::time_point to = Clock::now()) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+}
+
+namespace alpaca {
+    int(__cdecl* BrokerError)(const char* txt) = bench::detail::brokerError;
+    int(__cdecl* BrokerProgress)(const int percent) = bench::detail::brokerProgress;
+    int(__cdecl* http_send)(char* url, char* data, char* header) = bench::detail::httpSend;
+    long(__cdecl* http_status)(int id) = bench::detail::httpStatus;
+    long(__cdecl* http_result)(int id, char* content, long size) = bench::detail::httpResult;
+    void(__cdecl* http_free)(int id) = bench::detail::httpFree;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+// Stand-in for Polygon's /v2/aggs endpoint, answered through fake_http.h. Every weekday trades
+// 4:00-20:00 New York with one base bar a minute, and prices follow the time, so a bar has the same
+// values whichever request returns it. Pages are newest first. A page holds at most limit base bars,
+// 5000 without a limit parameter and never more than pageLimit. When a range holds more, next_url
+// points at the rest with a cursor, like Polygon's.
+//
+// A reply takes latencyMs plus the transfer of its body at mbPerSecond.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "alpaca/clock.h"
+#include "fake_http.h"
+
+namespace bench {
+namespace polygon {
+
+    int latencyMs = 50;
+    double mbPerSecond = 25.;
+    uint32_t pageLimit = 50000;
+    bool record = false;
+    std::vector<std::string> urls;  // every url requested when record is set, without the key
+
+    namespace detail {
+        const int64_t DAY = 86400;
+
+        int64_t daysFromCivil(int y, unsigned m, unsigned d) {
+            y -= m <= 2;
+            const int era = (y >= 0 ? y : y - 399) / 400;
+            const unsigned yoe = (unsigned)(y - era * 400);
+            const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+            const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+            return era * 146097 + (int64_t)doe - 719468;
+        }
+
+        // a YYYY-MM-DD date or the milliseconds of a next_url, as a UTC day
+        int64_t dayOf(const std::string& s) {
+            int y, m, d;
+            if (s.find('-') != std::string::npos && sscanf(s.c_str(), "%d-%d-%d", &y, &m, &d) == 3) {
+                return daysFromCivil(y, (unsigned)m, (unsigned)d) * DAY;
+            }
+            auto seconds = _atoi64(s.c_str()) / 1000;
+            return seconds - seconds % DAY;
+        }
+
+        std::string param(const std::string& url, const char* name) {
+            auto key = std::string(name) + "=";
+            auto pos = url.find("?" + key);
+            if (pos == std::string::npos) {
+                pos = url.find("&" + key);
+            }
+            if (pos == std::string::npos) {
+                return "";
+            }
+            pos += key.size() + 1;
+            return url.substr(pos, url.find('&', pos) - pos);
+        }
+
+        void appendBar(std::string& body, int64_t t, uint32_t volume) {
+            double price = 300. + 20. * std::sin((double)t / 86400.);
+            char bar[160];
+            sprintf_s(bar, sizeof(bar), "%s{\"v\":%u,\"vw\":%.4f,\"o\":%.2f,\"c\":%.2f,\"h\":%.2f,\"l\":%.2f,\"t\":%lld000,\"n\":%u}",
+                body.back() == '[' ? "" : ",", volume, price, price, price + 0.01, price + 0.02, price - 0.02, (long long)t, volume / 100);
+            body += bar;
+        }
+    }
+
+    Reply answer(const std::string& url, const char*) {
+        using namespace detail;
+        Reply reply;
+        auto path = url.substr(0, url.find('?'));
+        if (record) {
+            auto key = url.find("apiKey=");
+            urls.push_back(key == std::string::npos ? url : url.substr(0, key - 1));
+        }
+
+        // /v2/aggs/ticker/SYMBOL/range/MULTIPLIER/TIMESPAN/FROM/TO
+        std::vector<std::string> parts;
+        for (size_t begin = path.find("/range/") + 7, end; begin <= path.size(); begin = end + 1) {
+            end = path.find('/', begin);
+            end = end == std::string::npos ? path.size() : end;
+            parts.push_back(path.substr(begin, end - begin));
+        }
+        int multiplier = atoi(parts[0].c_str());
+        auto& timespan = parts[1];
+        auto from = dayOf(parts[2]);
+        auto to = dayOf(parts[3]);
+        auto limitParam = param(url, "limit");
+        auto limit = std::min<uint32_t>(limitParam.empty() ? 5000 : (uint32_t)atoi(limitParam.c_str()), pageLimit);
+        auto cursor = param(url, "cursor");
+        int64_t below = cursor.empty() ? INT64_MAX : _atoi64(cursor.c_str());
+
+        std::string body = "{\"ticker\":\"" + path.substr(path.find("/ticker/") + 8, path.find("/range/") - path.find("/ticker/") - 8) + "\",\"results\":[";
+        uint32_t base = 0;
+        uint32_t count = 0;
+        int64_t next = 0;
+        for (auto day = to; day >= from && !next; day -= DAY) {
+            auto weekday = (day / DAY + 4) % 7;
+            if (weekday == 0 || weekday == 6) {
+                continue;
+            }
+            // New York midnight, the offset of noon is clear of the 2:00 DST switch
+            int64_t midnight = day - alpaca::getNewYorkOffset((__time32_t)(day + 43200));
+            // bar start and the number of base bars in it, newest first
+            std::vector<std::pair<int64_t, uint32_t>> bars;
+            if (timespan == "minute" || timespan == "hour") {
+                // buckets are aligned to midnight and hold the base minutes of 4:00-20:00 in them
+                int minutes = timespan == "hour" ? 60 * multiplier : multiplier;
+                for (int b = (1199 / minutes) * minutes; b + minutes > 240; b -= minutes) {
+                    int first = std::max(b, 240);
+                    int last = std::min(b + minutes, 1200);
+                    bars.emplace_back(midnight + b * 60, (uint32_t)(last - first) / (timespan == "hour" ? 60 : 1));
+                }
+            }
+            else if (timespan == "day" && multiplier == 1) {
+                bars.emplace_back(midnight, 1);
+            }
+            for (auto& bar : bars) {
+                if (bar.first * 1000 >= below) {
+                    continue;
+                }
+                if (base + bar.second > limit) {
+                    next = bar.first;
+                    break;
+                }
+                appendBar(body, bar.first, 100 * (uint32_t)(1 + bar.first / 60 % 3000));
+                base += bar.second;
+                ++count;
+            }
+        }
+        body += "],\"queryCount\":" + std::to_string(base) + ",\"resultsCount\":" + std::to_string(count) +
+            ",\"adjusted\":true,\"status\":\"OK\",\"request_id\":\"r" + std::to_string(requests) + "\"";
+        if (next) {
+            auto range = path.substr(path.find("/v2/"));
+            range = range.substr(0, range.rfind('/', range.rfind('/') - 1));
+            body += ",\"next_url\":\"https://api.polygon.io" + range + "/" +
+                std::to_string(from * 1000) + "/" + std::to_string((to + DAY) * 1000 - 1) + "?cursor=" + std::to_string((next + 1) * 1000) + "\"";
+        }
+        body += "}";
+
+        reply.latencyMs = latencyMs + (int)(body.size() / (mbPerSecond * 1000.));
+        reply.body = std::move(body);
+        return reply;
+    }
+}
+}
@@ -0,0 +1,72 @@
+// Wall time of AlpacaMarketData::getLastQuotes (market_data/alpaca_market_data.cpp), which
+// brokerCommand(2001) uses to quote the whole asset list: 200 symbols per latest quotes request, several
+// requests in flight under the shared rate limiter.
+//
+// The replies come from a stand-in for /v2/stocks/quotes/latest through fake_http.h that answers
+// every symbol of the url after a round trip plus a time per symbol. The one request per asset of
+// the path it replaced is not run, the rate limit of 200 requests a minute bounds it.
+//
+// usage: latest_quotes [symbols] [latency_ms]
+
+#include "stdafx.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+#include "market_data/alpaca_market_data.h"
+#include "fake_http.h"
+
+using namespace alpaca;
+
+namespace {
+
+    int s_latencyMs = 150;
+    const double MS_PER_SYMBOL = 0.2;
+
+    bench::Reply latestQuotes(const std::string& url, const char*) {
+        bench::Reply reply;
+        auto list = url.substr(url.find("symbols=") + 8);
+        std::string body = "{\"quotes\":{";
+        size_t n = 0;
+        for (size_t begin = 0, end; begin < list.size(); begin = end + 1, ++n) {
+            end = list.find(',', begin);
+            end = end == std::string::npos ? list.size() : end;
+            char quote[256];
+            sprintf_s(quote, sizeof(quote), "%s\"%s\":{\"t\":\"2021-12-31T20:59:59.123456789Z\",\"ax\":\"V\",\"ap\":%.2f,\"as\":%zu,\"bx\":\"Q\",\"bp\":%.2f,\"bs\":%zu,\"c\":[\"R\"],\"z\":\"C\"}",
+                n ? "," : "", list.substr(begin, end - begin).c_str(), 100.01 + n % 50, 1 + n % 9, 100. + n % 50, 2 + n % 7);
+            body += quote;
+        }
+        body += "}}";
+        reply.latencyMs = s_latencyMs + (int)(n * MS_PER_SYMBOL);
+        reply.body = std::move(body);
+        return reply;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? (size_t)atoi(argv[1]) : 11000;
+    s_latencyMs = argc > 2 ? atoi(argv[2]) : 150;
+    bench::server = latestQuotes;
+    Logger logger;
+    AlpacaMarketData marketData("", logger);
+
+    std::vector<std::string> symbols;
+    for (size_t i = 0; i < count; ++i) {
+        symbols.push_back("S" + std::to_string(10000 + i));
+    }
+
+    size_t quoted = 0;
+    auto t0 = bench::Clock::now();
+    auto response = marketData.getLastQuotes(symbols, [&quoted](const std::string&, const Quote& quote) {
+        quoted += quote.ask_price > 0. && quote.bid_price > 0.;
+    });
+    auto ms = bench::ms(t0);
+
+    printf("%zu symbols, %d ms + %.1f ms per symbol: %zu quoted in %d requests, %.1f s%s\n", count, s_latencyMs, MS_PER_SYMBOL,
+        quoted, bench::requests, ms / 1000., response ? "" : (", " + response.what()).c_str());
+    printf("one request per symbol at 200 requests a minute: at least %.0f min\n", count / 200.);
+    return 0;
+}
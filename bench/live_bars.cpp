@@ -0,0 +1,161 @@
+// Real time replay of LiveBars (market_data/live_bars.cpp), the ring BrokerHistory2 serves the newest
+// bars from: are the served bars right, and how long after a bar boundary is the bar before it final?
+//
+// Five symbols trade at 0.1, 1, 5, 20 and 50 trades/s as Poisson processes. Every trade reaches
+// LiveBars 20-60 ms after its exchange time, so close trades arrive out of order like on the stream.
+// A feed thread delivers them on the wall clock, which LiveBars closes bars by, and Zorro's side reads
+// 1 and 5 minute bars of every symbol every 250 ms. Each served bar is compared with a direct
+// aggregation, in exchange time order, of all trades of its bucket.
+//
+// usage: live_bars [seconds]     default 660, the replay runs in real time and needs 10 minutes for a
+//                                5 minute bucket that is complete on every symbol
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "market_data/live_bars.h"
+
+using namespace alpaca;
+
+namespace {
+
+    struct Trade {
+        int symbol;
+        int64_t time;           // exchange time, ns
+        int64_t deliverMs;      // wall clock ms when it reaches LiveBars
+        double price;
+        uint32_t size;
+    };
+
+    int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    const char* SYMBOLS[] = { "THIN", "SLOW", "MID", "BUSY", "HOT" };
+    const double RATES[] = { 0.1, 1., 5., 20., 50. };
+
+    std::vector<Trade> generate(int64_t fromMs, int64_t toMs) {
+        std::mt19937 rng(36);
+        std::uniform_int_distribution<int> delay(20, 60);
+        std::vector<Trade> trades;
+        for (int s = 0; s < 5; ++s) {
+            std::exponential_distribution<double> gap(RATES[s]);
+            std::normal_distribution<double> move(0, 0.0004);
+            double price = 100. + 20. * s;
+            for (double t = (double)fromMs + gap(rng) * 1000.; t < toMs; t += gap(rng) * 1000.) {
+                price *= 1 + move(rng);
+                auto ns = (int64_t)(t * 1000000.);
+                trades.push_back(Trade{ s, ns, ns / 1000000 + delay(rng), std::round(price * 100.) / 100., (uint32_t)(1 + rng() % 5) * 100 });
+            }
+        }
+        return trades;
+    }
+
+    // bars of bucket seconds per symbol, from every trade in exchange time order
+    std::vector<std::map<uint32_t, Bar>> aggregate(std::vector<Trade> trades, uint32_t bucket) {
+        std::sort(trades.begin(), trades.end(), [](const Trade& a, const Trade& b) { return a.time < b.time; });
+        std::vector<std::map<uint32_t, Bar>> bars(5);
+        for (auto& trade : trades) {
+            auto seconds = (uint32_t)(trade.time / 1000000000);
+            auto start = seconds - seconds % bucket;
+            auto it = bars[trade.symbol].find(start);
+            if (it == bars[trade.symbol].end()) {
+                bars[trade.symbol][start] = Bar{ start, trade.price, trade.price, trade.price, trade.price, trade.size };
+                continue;
+            }
+            auto& bar = it->second;
+            bar.high_price = std::max(bar.high_price, trade.price);
+            bar.low_price = std::min(bar.low_price, trade.price);
+            bar.close_price = trade.price;
+            bar.volume += trade.size;
+        }
+        return bars;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 660;
+    LiveBars live;
+    for (auto symbol : SYMBOLS) {
+        live.watch(symbol);
+    }
+
+    auto startMs = nowMs();
+    auto endMs = startMs + seconds * 1000LL;
+    auto trades = generate(startMs, endMs);
+    std::sort(trades.begin(), trades.end(), [](const Trade& a, const Trade& b) { return a.deliverMs < b.deliverMs; });
+    size_t reordered = 0;
+    for (size_t i = 1; i < trades.size(); ++i) {
+        reordered += trades[i].symbol == trades[i - 1].symbol && trades[i].time < trades[i - 1].time;
+    }
+    printf("%zu trades over %d s, %zu arrive before an older trade of their symbol\n", trades.size(), seconds, reordered);
+
+    std::atomic<bool> done(false);
+    std::thread feed([&]() {
+        for (auto& trade : trades) {
+            auto wait = trade.deliverMs - nowMs();
+            if (wait > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+            }
+            live.add(StreamTrade{ SYMBOLS[trade.symbol], trade.time, trade.price, trade.size });
+        }
+        done = true;
+    });
+
+    // the last served version of every bar, checked once the replay is over
+    std::vector<std::map<uint32_t, Bar>> served[2] = { std::vector<std::map<uint32_t, Bar>>(5), std::vector<std::map<uint32_t, Bar>>(5) };
+    const int minutes[2] = { 1, 5 };
+    uint32_t changed = 0;   // a bar served twice with different values
+    while (!done || nowMs() < endMs + 2000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        for (int m = 0; m < 2; ++m) {
+            for (int s = 0; s < 5; ++s) {
+                VectorBarSink sink((__time32_t)(startMs / 1000), 0, 100000);
+                live.read(SYMBOLS[s], (__time32_t)(startMs / 1000), 0, minutes[m], sink);
+                for (auto& bar : sink.bars) {
+                    auto it = served[m][s].find(bar.time);
+                    if (it != served[m][s].end() && (it->second.close_price != bar.close_price || it->second.volume != bar.volume)) {
+                        ++changed;
+                    }
+                    served[m][s][bar.time] = bar;
+                }
+            }
+        }
+    }
+    feed.join();
+
+    for (int m = 0; m < 2; ++m) {
+        auto expected = aggregate(trades, minutes[m] * 60);
+        uint32_t bars = 0, mismatches = 0;
+        for (int s = 0; s < 5; ++s) {
+            for (auto& entry : served[m][s]) {
+                ++bars;
+                auto it = expected[s].find(entry.first);
+                auto& bar = entry.second;
+                if (it == expected[s].end() || it->second.open_price != bar.open_price || it->second.high_price != bar.high_price ||
+                    it->second.low_price != bar.low_price || it->second.close_price != bar.close_price || it->second.volume != bar.volume) {
+                    ++mismatches;
+                }
+            }
+        }
+        printf("%d minute bars: %u served, %u mismatches\n", minutes[m], bars, mismatches);
+    }
+
+    auto metrics = live.metrics();
+    auto latency = live.latency();
+    printf("%llu trades applied, %llu late, %u bars served twice differently\n",
+        (unsigned long long)metrics.trades, (unsigned long long)metrics.lateTrades, changed);
+    printf("bar final after its end: p50 %u ms, p95 %u ms, p99 %u ms (last %zu bars)\n",
+        latency.percentile(0.5), latency.percentile(0.95), latency.percentile(0.99), latency.samples());
+    return 0;
+}
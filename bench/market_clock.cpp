@@ -0,0 +1,91 @@
+// Error and cost of the MarketClock model (alpaca/market_clock.cpp) behind BrokerTime.
+//
+// Simulates an 8 h session with BrokerTime every second. Each /v2/clock round trip takes 20 ms each
+// way plus exponential jitter, and 5% of the legs get a 300 ms spike. The server clock is offset
+// from the local one and runs fast by the drift. The market is open 14:30-21:00 UTC.
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "alpaca/clock.h"
+#include "alpaca/market_clock.h"
+#include "fake_http.h"     // the other plugin sources link against the Zorro functions
+
+using namespace alpaca;
+
+namespace {
+
+    const int64_t NS = 1000000000ll;
+
+    bool marketOpen(int64_t seconds) {
+        int64_t day = seconds / 86400 * 86400;
+        return seconds >= day + 14 * 3600 + 1800 && seconds < day + 21 * 3600;
+    }
+
+    Clock clockReply(int64_t serverNanos) {
+        Clock clock;
+        clock.timestamp_ns = serverNanos;
+        clock.timestamp = (__time32_t)(serverNanos / NS);
+        int64_t day = clock.timestamp / 86400 * 86400;
+        int64_t open = day + 14 * 3600 + 1800;
+        int64_t close = day + 21 * 3600;
+        clock.is_open = marketOpen(clock.timestamp);
+        clock.next_open = (__time32_t)(clock.timestamp < open ? open : open + 86400);
+        clock.next_close = (__time32_t)(clock.timestamp < close ? close : close + 86400);
+        return clock;
+    }
+}
+
+int main() {
+    printf("jitter   drift     syncs   |error| p50 / p99 / max          wrong open state   BrokerTime\n");
+    for (double jitterMs : { 2., 10., 50. }) {
+        for (double driftPpm : { 0., 20., 100. }) {
+            std::mt19937_64 rng(42);
+            std::exponential_distribution<double> jitter(1. / (jitterMs * 1e6));
+            std::uniform_real_distribution<double> uniform(0, 1);
+            auto leg = [&]() { return 20e6 + jitter(rng) + (uniform(rng) < 0.05 ? 300e6 : 0); };
+
+            const int64_t localStart = 5000 * NS;
+            const int64_t serverStart = 1614611730ll * NS;  // 2021-03-01 15:15:30 UTC, market open
+            auto server = [&](int64_t local) {
+                return serverStart + 1234567890ll + (local - localStart) + (int64_t)(driftPpm * 1e-6 * (local - localStart));
+            };
+
+            MarketClock clock;
+            std::vector<double> errors;
+            int syncs = 0;
+            int wrongState = 0;
+            double cost = 0;
+            for (int64_t local = localStart; local < localStart + 8 * 3600 * NS; local += NS) {
+                if (clock.due(local)) {
+                    ++syncs;
+                    int64_t at = local + (int64_t)leg();
+                    int64_t received = at + (int64_t)leg();
+                    clock.sync(local, received, clockReply(server(at)));
+                    local = received;
+                }
+                auto t0 = std::chrono::steady_clock::now();
+                bool due = clock.due(local);
+                int64_t now = clock.now(local);
+                bool isOpen = clock.isOpen(local);
+                cost += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+                (void)due;
+
+                errors.push_back(std::abs((double)(now - server(local))) / 1e6);
+                wrongState += isOpen != marketOpen(server(local) / NS);
+            }
+
+            std::sort(errors.begin(), errors.end());
+            printf("%2.0f ms    %3.0f ppm   %5d   %6.2f / %6.2f / %6.2f ms   %5d s            %.0f ns\n",
+                jitterMs, driftPpm, syncs, errors[errors.size() / 2], errors[errors.size() * 99 / 100], errors.back(),
+                wrongState, cost / errors.size());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+// NegativeCache (negative_cache.cpp) as BrokerAsset uses it for unknown symbols: the time of a lookup
+// and how many lookups its Bloom filter answers without the map.
+//
+// 500 unknown symbols are stored, then 11,000 symbols that exist, the size of the Alpaca asset list,
+// are looked up round-robin, which is what a subscribe or price call of a valid symbol costs. The
+// stored symbols are looked up as well, those are the requests the cache saves.
+//
+// usage: negative_cache [stored]
+
+#include "stdafx.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "negative_cache.h"
+
+using namespace alpaca;
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::string> symbols(const char* prefix, size_t n) {
+        std::vector<std::string> result;
+        for (size_t i = 0; i < n; ++i) {
+            result.push_back(prefix + std::to_string(i));
+        }
+        return result;
+    }
+
+    double ns(Clock::time_point from, size_t n) {
+        return std::chrono::duration<double, std::nano>(Clock::now() - from).count() / n;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t stored = argc > 1 ? (size_t)atoi(argv[1]) : 500;
+    auto known = symbols("S", 11000);
+    auto unknown = symbols("ZZX", stored);
+
+    NegativeCache cache(5 * 60 * 1000);
+    for (auto& symbol : unknown) {
+        cache.add(symbol);
+    }
+
+    const size_t ROUNDS = 200;
+    size_t cached = 0;
+    auto t0 = Clock::now();
+    for (size_t r = 0; r < ROUNDS; ++r) {
+        for (auto& symbol : known) {
+            cached += cache.contains(symbol);
+        }
+    }
+    auto knownNs = ns(t0, ROUNDS * known.size());
+    auto metrics = cache.metrics();
+    printf("%zu unknown symbols stored, filter of %u bits\n", stored, NegativeCache::FILTER_BITS);
+    printf("existing symbol   %5.1f ns per lookup, %.2f%% answered by the filter, %zu wrongly cached\n",
+        knownNs, 100. * metrics.filtered / metrics.lookups, cached);
+
+    auto before = metrics;
+    cached = 0;
+    t0 = Clock::now();
+    for (size_t r = 0; r < ROUNDS * known.size() / unknown.size(); ++r) {
+        for (auto& symbol : unknown) {
+            cached += cache.contains(symbol);
+        }
+    }
+    auto lookups = ROUNDS * known.size() / unknown.size() * unknown.size();
+    printf("unknown symbol    %5.1f ns per lookup, %zu of %zu requests avoided\n", ns(t0, lookups), cached, lookups);
+    metrics = cache.metrics();
+    printf("metrics           %llu lookups, %llu hits, %llu filtered\n", (unsigned long long)(metrics.lookups - before.lookups),
+        (unsigned long long)(metrics.hits - before.hits), (unsigned long long)(metrics.filtered - before.filtered));
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Requests and BrokerTrade latency with the open order snapshot of OrderPoller (alpaca/order_poller.cpp)
+// against one getOrder per open trade and loop.
+//
+// The REST API is the stand-in Client of bench/stub with a 2 ms round trip. Each of 10 loops asks for
+// every trade, and 2% of the orders fill between loops. Final orders are answered by the order store
+// in the plugin, so the poller run doesn't ask for them again.
+//
+// Build with bench\stub ahead of the plugin directory on the include path.
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+#include "alpaca/client.h"
+#include "alpaca/order_poller.h"
+#include "alpaca/order_updates.h"
+
+using namespace alpaca;
+
+namespace alpaca {
+    int(__cdecl* BrokerError)(const char* txt) = [](const char*) { return 1; };
+    FakeOrderBook s_book;
+}
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    std::string orderId(int i) {
+        char id[40];
+        sprintf_s(id, sizeof(id), "ord-%06d", i);
+        return id;
+    }
+
+    void fill(int i) {
+        auto& order = s_book.all[orderId(i)];
+        order.status = "filled";
+        order.filled_qty = order.qty;
+        order.filled_avg_price = 100.;
+        s_book.open.erase(order.id);
+    }
+}
+
+int main() {
+    const int LOOPS = 10;
+    Logger logger;
+    Client client;
+
+    for (int n : { 10, 100, 500, 1200 }) {
+        for (bool usePoller : { false, true }) {
+            s_book = FakeOrderBook();
+            for (int i = 1; i <= n; ++i) {
+                Order order;
+                order.id = orderId(i);
+                order.internal_id = i;
+                order.symbol = "AAPL";
+                order.qty = 10;
+                order.status = "new";
+                order.type = OrderType::Limit;
+                char submitted[40];
+                sprintf_s(submitted, sizeof(submitted), "2021-03-01T15:%02d:%02d.%06dZ", i / 3600 % 60, i / 60 % 60, i);
+                order.submitted_at = submitted;
+                s_book.all[order.id] = order;
+                s_book.open[order.id] = order;
+            }
+
+            OrderPoller poller(client, logger, 1000);
+            std::vector<double> latencies;
+            std::vector<char> final(n + 1, 0);
+            bool stale = false;
+            for (int loop = 0; loop < LOOPS; ++loop) {
+                for (int i = 1 + loop; i <= n; i += 50) {
+                    if (s_book.open.count(orderId(i))) {
+                        fill(i);
+                    }
+                }
+                poller.expire();    // Zorro loops are at least an interval apart
+                for (int i = 1; i <= n; ++i) {
+                    auto t0 = Clock::now();
+                    Order order;
+                    if (usePoller && final[i]) {
+                        order = s_book.all[orderId(i)];
+                    }
+                    else if (!usePoller || !poller.get(orderId(i), order)) {
+                        order = client.getOrder(orderId(i)).content();
+                        if (usePoller) {
+                            poller.put(order);
+                        }
+                    }
+                    final[i] = isFinal(order.status);
+                    latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+                    stale |= order.status != s_book.all[orderId(i)].status;
+                }
+            }
+
+            std::sort(latencies.begin(), latencies.end());
+            double sum = 0;
+            for (auto latency : latencies) {
+                sum += latency;
+            }
+            printf("%4d open trades  %-9s  requests/loop %6.1f  BrokerTrade mean %7.1f us  p50 %7.1f us  p99 %7.1f us  %s\n",
+                n, usePoller ? "poller" : "per-order", s_book.requests / (double)LOOPS, sum / latencies.size(),
+                latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], stale ? "STALE" : "ok");
+        }
+    }
+    return 0;
+}
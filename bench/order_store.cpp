@@ -0,0 +1,168 @@
+// Memory and lookup time of OrderStore (alpaca/order_store.cpp) against the
+// unordered_map<uint32_t, Order> it replaced, holding the same filled orders.
+//
+// Memory is what operator new handed out while the container was filled. Lookups go through the
+// trade ids in a scattered order, 1M finds and 100k updates of existing orders per size.
+//
+// usage: order_store [spillfile]    spillfile takes the evicted orders, bench_spill.csv by default
+
+#include "stdafx.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "alpaca/order_store.h"
+#include "fake_http.h"     // the other plugin sources link against the Zorro functions
+
+using namespace alpaca;
+
+namespace {
+    size_t s_allocated = 0;
+}
+
+void* operator new(size_t n) {
+    s_allocated += n;
+    if (auto p = malloc(n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    Order makeOrder(uint32_t i) {
+        static const char* symbols[] = { "AAPL", "MSFT", "SPY", "QQQ", "TSLA", "AMZN", "NVDA", "META" };
+        char id[64];
+        sprintf_s(id, sizeof(id), "%08x-1234-4abc-9def-%012x", i * 2654435761u, i);
+        Order order;
+        order.id = id;
+        order.internal_id = (int32_t)i;
+        order.client_order_id = "ZORRO_1_" + std::to_string(i);
+        order.asset_id = "b0b6dd9d-8b9b-48a9-ba46-b9d54906e415";
+        order.symbol = symbols[i % 8];
+        order.qty = 100;
+        order.filled_qty = 100;
+        order.filled_avg_price = 123.45;
+        order.side = OrderSide::Buy;
+        order.tif = TimeInForce::Day;
+        order.type = OrderType::Market;
+        order.status = "filled";
+        order.created_at = "2021-03-01T15:00:00Z";
+        order.updated_at = order.created_at;
+        order.submitted_at = order.created_at;
+        order.filled_at = order.created_at;
+        return order;
+    }
+
+    // scattered trade id k of n, 1-based
+    uint32_t pick(uint32_t k, uint32_t n) { return 1 + k * 7919u % n; }
+
+    double ns(Clock::time_point from, Clock::time_point to, int count) {
+        return std::chrono::duration<double, std::nano>(to - from).count() / count;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* spillPath = argc > 1 ? argv[1] : "bench_spill.csv";
+    const int FINDS = 1000000;
+    const int UPDATES = 100000;
+    uint64_t sum = 0;   // keeps the lookups from being optimized away
+
+    for (uint32_t n : { 10000u, 100000u, 1000000u }) {
+        std::vector<Order> orders;
+        orders.reserve(n);
+        for (uint32_t i = 1; i <= n; ++i) {
+            orders.push_back(makeOrder(i));
+        }
+
+        {
+            s_allocated = 0;
+            std::unordered_map<uint32_t, Order> map;
+            for (auto& order : orders) {
+                map.emplace(order.internal_id, order);
+            }
+            auto bytes = s_allocated;
+            auto t0 = Clock::now();
+            for (int k = 0; k < FINDS; ++k) {
+                sum += (uint64_t)map.find(pick(k, n))->second.qty;
+            }
+            auto t1 = Clock::now();
+            for (int k = 0; k < UPDATES; ++k) {
+                auto i = pick(k, n);
+                map[i] = orders[i - 1];
+            }
+            auto t2 = Clock::now();
+            printf("%7u orders  unordered_map  %4zu bytes/order  find %6.1f ns               update %6.1f ns\n",
+                n, bytes / n, ns(t0, t1, FINDS), ns(t1, t2, UPDATES));
+        }
+
+        OrderStore store;
+        for (auto& order : orders) {
+            store.put(order);
+        }
+        auto t0 = Clock::now();
+        for (int k = 0; k < FINDS; ++k) {
+            sum += (uint64_t)store.find(pick(k, n))->qty;
+        }
+        auto t1 = Clock::now();
+        for (int k = 0; k < FINDS; ++k) {
+            sum += (uint64_t)store.findById(orders[pick(k, n) - 1].id)->qty;
+        }
+        auto t2 = Clock::now();
+        for (int k = 0; k < UPDATES; ++k) {
+            store.put(orders[pick(k, n) - 1]);
+        }
+        auto t3 = Clock::now();
+        printf("%7u orders  OrderStore     %4zu bytes/order  find %6.1f ns  findById %6.1f ns  update %6.1f ns\n",
+            n, store.memoryUsage() / n, ns(t0, t1, FINDS), ns(t1, t2, FINDS), ns(t2, t3, UPDATES));
+
+        for (uint32_t i = 1; i <= n; i += 97) {
+            auto* record = store.find(i);
+            auto& order = orders[i - 1];
+            if (!record || store.idOf(*record) != order.id || store.clientOrderIdOf(*record) != order.client_order_id ||
+                store.symbolOf(*record) != order.symbol) {
+                printf("order %u doesn't match\n", i);
+                return 1;
+            }
+        }
+
+        if (n == 10000) {
+            // close every odd trade, a day later those are evicted and the even ones stay
+            for (uint32_t i = 1; i <= n; i += 2) {
+                store.markClosed(i);
+            }
+            auto now = 1614610800ll * 1000000000ll + 2ll * 86400 * 1000000000ll;
+            store.setSpillFile(spillPath);
+            auto evicted = store.evict(now);
+            bool ok = true;
+            store.forEachOfSymbol("AAPL", [&](const OrderRecord& record) { ok &= record.internalId % 2 == 0; });
+            for (uint32_t i = 1; i <= n; ++i) {
+                auto* record = store.find(i);
+                ok &= (i % 2 == 0) == (record != nullptr);
+                ok &= !record || store.findById(orders[i - 1].id) == record;
+            }
+            for (uint32_t i = 1; i <= n; i += 2) {
+                store.put(orders[i - 1]);
+            }
+            for (uint32_t i = 1; i <= n; ++i) {
+                auto* record = store.find(i);
+                ok &= record && store.findById(orders[i - 1].id) == record;
+            }
+            printf("evicted %zu, re-inserted to %zu orders, lookups %s\n", evicted, store.size(), ok ? "ok" : "FAILED");
+            remove(spillPath);
+            if (!ok) {
+                return 1;
+            }
+        }
+    }
+    return sum ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+// Requests and wall time of Polygon::getBars (market_data/polygon.cpp) with native timespans and
+// pages of up to 50000 base bars, against the minute aggregates it used before: every bar period built
+// from nTickMinutes minute bars, and pages of Polygon's default 5000 minute bars, 7 calendar days per
+// range, 8 ranges in flight.
+//
+// Both run the plugin's request layer against the stand-in Polygon of fake_polygon.h and download
+// one year, 2021, of 1-minute, 1-hour and 1-day bars. Each must return the same bars. A last run caps
+// the stand-in's pages below what getBars asks for, so every range follows its next_url cursors, and
+// prints the page sequence of one range.
+//
+// usage: polygon_pages [latency_ms] [page_limit]
+
+#include "stdafx.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+#include "request.h"
+#include "date/date.h"
+#include "alpaca/clock.h"
+#include "market_data/polygon.h"
+#include "market_data/bar_parser.h"
+#include "market_data/history_planner.h"
+#include "fake_polygon.h"
+
+using namespace alpaca;
+
+namespace {
+
+    const __time32_t START = 1609459200;    // 2021-01-01
+    const __time32_t END = 1640995199;      // 2021-12-31 23:59:59
+
+    std::string day(__time32_t t) {
+        return date::format("%F", date::sys_seconds{ std::chrono::seconds{ t } });
+    }
+
+    // Polygon::getBars before native timespans, without its logging
+    void minutePages(const std::string& symbol, __time32_t start, __time32_t end, int nTickMinutes, BarSink& sink) {
+        auto daysPerRange = (__time32_t)(5000 / (960. * 5. / 7.));
+        auto barsPerDay = (nTickMinutes < 1440 ? 960. / nTickMinutes : 1440. / nTickMinutes) * 5. / 7.;
+        HistoryPlanner planner(start + getNewYorkOffset(start), end + getNewYorkOffset(end), daysPerRange, barsPerDay);
+        auto flush = [&sink](const BarChunk& chunk) { return sink.write(chunk); };
+
+        while (sink.wantsMore() && !planner.done()) {
+            std::vector<std::string> urls;
+            for (auto& range : planner.next(8, sink.limit() - sink.count())) {
+                std::stringstream url;
+                url << "https://api.polygon.io/v2/aggs/ticker/" << symbol << "/range/" << nTickMinutes << "/minute/"
+                    << day(range.from) << "/" << day(range.to) << "?sort=desc&apiKey=key";
+                urls.emplace_back(url.str());
+            }
+
+            bool noMoreData = true;
+            for (auto& response : requestAllRaw<Polygon>(urls, "", nullptr, 8)) {
+                std::string nextUrl, error;
+                auto before = sink.count();
+                if (!response || !parseBars(response.content(), 1000, flush, nextUrl, error)) {
+                    return;
+                }
+                noMoreData &= sink.count() == before;
+            }
+            if (noMoreData) {
+                break;
+            }
+        }
+    }
+
+    struct Run {
+        double ms;
+        int requests;
+        std::vector<Bar> bars;
+    };
+
+    template<typename F>
+    Run run(F&& download) {
+        VectorBarSink sink(START, END, 1000000);
+        bench::requests = 0;
+        Sleep(1000);    // start with a fresh window of the Polygon rate limit
+        auto t0 = bench::Clock::now();
+        download(sink);
+        return Run{ bench::ms(t0), bench::requests, std::move(sink.bars) };
+    }
+
+    bool same(const std::vector<Bar>& a, const std::vector<Bar>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].time != b[i].time || a[i].close_price != b[i].close_price || a[i].volume != b[i].volume) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bench::polygon::latencyMs = argc > 1 ? atoi(argv[1]) : 50;
+    auto pageLimit = argc > 2 ? (uint32_t)atoi(argv[2]) : 20000u;
+    bench::server = bench::polygon::answer;
+    Logger logger;
+    Polygon polygon("key", logger);
+
+    printf("latency %d ms + %.0f MB/s, bars of 2021\n", bench::polygon::latencyMs, bench::polygon::mbPerSecond);
+    printf("bar       bars     minute pages of 5000        native timespan\n");
+    for (int nTickMinutes : { 1, 60, 1440 }) {
+        auto before = run([&](BarSink& sink) { minutePages("AAPL", START, END, nTickMinutes, sink); });
+        auto after = run([&](BarSink& sink) { polygon.getBars("AAPL", START, END, nTickMinutes, sink); });
+        printf("%4d min %7zu   %4d requests %8.0f ms   %4d requests %7.0f ms   %5.1fx   %s\n",
+            nTickMinutes, after.bars.size(), before.requests, before.ms, after.requests, after.ms, before.ms / after.ms,
+            same(before.bars, after.bars) ? "same bars" : "DIFFERENT BARS");
+    }
+
+    // pages capped below the 50000 getBars asks for, every range follows its cursor
+    auto reference = run([&](BarSink& sink) { minutePages("AAPL", START, END, 1, sink); });
+    bench::polygon::pageLimit = pageLimit;
+    bench::polygon::record = true;
+    auto paged = run([&](BarSink& sink) { polygon.getBars("AAPL", START, END, 1, sink); });
+    printf("\n1-minute bars, pages of at most %u: %d requests %.0f ms   %s\n", pageLimit, paged.requests, paged.ms,
+        same(reference.bars, paged.bars) ? "same bars" : "DIFFERENT BARS");
+
+    // the newest range: its first request, then the next_urls of its cursor
+    using bench::polygon::detail::dayOf;
+    auto& urls = bench::polygon::urls;
+    auto path = urls.front().substr(0, urls.front().find('?'));
+    auto to = path.substr(path.rfind('/') + 1);
+    path.resize(path.rfind('/'));
+    auto from = path.substr(path.rfind('/') + 1);
+    auto cursorRange = "/" + std::to_string(dayOf(from) * 1000) + "/" + std::to_string((dayOf(to) + 86400) * 1000 - 1) + "?";
+    printf("  %s\n", urls.front().c_str());
+    for (auto& url : urls) {
+        if (url.find(cursorRange) != std::string::npos) {
+            printf("  %s\n", url.c_str());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Wall time of Polygon::getBars (market_data/polygon.cpp), which downloads the day ranges of the
+// HistoryPlanner concurrently, against the sequential download it replaced: two-day windows walked
+// backward from end, one request after the other.
+//
+// Both run the plugin's request layer against the stand-in Polygon of fake_polygon.h, so the round
+// trip, the transfer time and the 100 ms reply poll of requestRaw are all in the figures. Both
+// download 1-minute bars of 2021 and must return the same bars.
+//
+// usage: polygon_ranges [latency_ms]
+
+#include "stdafx.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+#include "request.h"
+#include "date/date.h"
+#include "market_data/polygon.h"
+#include "market_data/bar_parser.h"
+#include "fake_polygon.h"
+
+using namespace alpaca;
+
+namespace {
+
+    const __time32_t START = 1609459200;    // 2021-01-01
+    const __time32_t END = 1640995199;      // 2021-12-31 23:59:59
+
+    std::string day(__time32_t t) {
+        return date::format("%F", date::sys_seconds{ std::chrono::seconds{ t } });
+    }
+
+    // Polygon::getBars before the planner, without its logging
+    void sequential(const std::string& symbol, __time32_t start, __time32_t end, int nTickMinutes, BarSink& sink) {
+        auto flush = [&sink](const BarChunk& chunk) { return sink.write(chunk); };
+        auto to = end;
+        __time32_t from;
+        do {
+            from = to - 2 * 86400;
+            std::stringstream url;
+            url << "https://api.polygon.io/v2/aggs/ticker/" << symbol << "/range/" << nTickMinutes << "/minute/"
+                << day(from) << "/" << day(to) << "?sort=desc&apiKey=key";
+            auto response = requestRaw<Polygon>(url.str());
+            if (!response) {
+                break;
+            }
+            std::string nextUrl, error;
+            auto before = sink.count();
+            if (!parseBars(response.content(), 1000, flush, nextUrl, error) || sink.count() == before) {
+                break;
+            }
+            to = from - 86400;
+        } while (sink.wantsMore() && from > start);
+    }
+
+    struct Run {
+        double ms;
+        int requests;
+        std::vector<Bar> bars;
+    };
+
+    template<typename F>
+    Run run(uint32_t limit, F&& download) {
+        VectorBarSink sink(START, END, limit);
+        bench::requests = 0;
+        Sleep(1000);    // start with a fresh window of the Polygon rate limit
+        auto t0 = bench::Clock::now();
+        download(sink);
+        return Run{ bench::ms(t0), bench::requests, std::move(sink.bars) };
+    }
+
+    bool same(const std::vector<Bar>& a, const std::vector<Bar>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].time != b[i].time || a[i].close_price != b[i].close_price || a[i].volume != b[i].volume) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bench::polygon::latencyMs = argc > 1 ? atoi(argv[1]) : 50;
+    bench::server = bench::polygon::answer;
+    Logger logger;
+    Polygon polygon("key", logger);
+
+    printf("latency %d ms + %.0f MB/s, 1-minute bars of 2021\n", bench::polygon::latencyMs, bench::polygon::mbPerSecond);
+    printf("bars        sequential                 getBars\n");
+    for (uint32_t limit : { 2000u, 20000u, 1000000u }) {
+        auto before = run(limit, [](BarSink& sink) { sequential("AAPL", START, END, 1, sink); });
+        auto after = run(limit, [&](BarSink& sink) { polygon.getBars("AAPL", START, END, 1, sink); });
+        printf("%7zu   %4d requests %8.0f ms   %4d requests %7.0f ms   %5.1fx   %s\n",
+            after.bars.size(), before.requests, before.ms, after.requests, after.ms, before.ms / after.ms,
+            same(before.bars, after.bars) ? "same bars" : "DIFFERENT BARS");
+    }
+    return 0;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+// Stand-in for the Windows SDK version header, see windows.h.
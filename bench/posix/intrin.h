@@ -0,0 +1,15 @@
+#pragma once
+
+// The MSVC CPU feature intrinsics used by simd.h, on top of GCC's <cpuid.h>. _xgetbv comes from
+// <immintrin.h> and needs -mxsave.
+#include <cpuid.h>
+#include <immintrin.h>
+
+#if __GNUC__ < 11
+inline void __cpuidex(int info[4], int leaf, int subleaf) {
+    __cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+}
+#endif
+
+#undef __cpuid
+inline void __cpuid(int info[4], int leaf) { __cpuidex(info, leaf, 0); }
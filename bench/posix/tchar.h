@@ -0,0 +1,4 @@
+#pragma once
+
+// Stand-in for the Windows SDK <tchar.h>, see windows.h. TCHAR and TEXT are defined there.
+#include "windows.h"
@@ -0,0 +1,122 @@
+#include "windows.h"
+
+#include <cerrno>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+    // a file handle is fd + 1, so 0 stays invalid; a mapping remembers its file and the shared memory of a name
+    struct Mapping {
+        int fd = -1;
+        size_t bytes = 0;
+        void* shared = nullptr;
+    };
+
+    std::map<const void*, size_t> s_views;
+    DWORD s_lastError = 0;
+
+    int fdOf(HANDLE handle) { return (int)(intptr_t)handle - 1; }
+
+    bool isMapping(HANDLE handle) { return (intptr_t)handle > 0x10000; }
+}
+
+void Sleep(DWORD ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+DWORD GetLastError() { return s_lastError; }
+
+HANDLE CreateFileA(const char* path, DWORD access, DWORD, void*, DWORD, DWORD, HANDLE) {
+    int fd = open(path, (access & GENERIC_WRITE) ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        s_lastError = errno;
+        return INVALID_HANDLE_VALUE;
+    }
+    return (HANDLE)(intptr_t)(fd + 1);
+}
+
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size) {
+    struct stat st;
+    if (fstat(fdOf(file), &st)) {
+        s_lastError = errno;
+        return FALSE;
+    }
+    size->QuadPart = st.st_size;
+    return TRUE;
+}
+
+HANDLE CreateFileMappingA(HANDLE file, void*, DWORD, DWORD, DWORD sizeLow, const char* name) {
+    static std::map<std::string, Mapping*> named;
+    s_lastError = 0;
+    if (file == INVALID_HANDLE_VALUE) {
+        // process-local stand-in for named shared memory
+        auto& mapping = named[name ? name : ""];
+        if (mapping) {
+            s_lastError = ERROR_ALREADY_EXISTS;
+            return mapping;
+        }
+        mapping = new Mapping();
+        mapping->bytes = sizeLow;
+        mapping->shared = calloc(1, sizeLow);
+        return mapping;
+    }
+    struct stat st;
+    if (fstat(fdOf(file), &st)) {
+        s_lastError = errno;
+        return nullptr;
+    }
+    auto* mapping = new Mapping();
+    mapping->fd = fdOf(file);
+    mapping->bytes = (size_t)st.st_size;
+    return mapping;
+}
+
+LPVOID MapViewOfFile(HANDLE handle, DWORD, DWORD, DWORD, size_t) {
+    auto* mapping = (Mapping*)handle;
+    if (mapping->shared) {
+        return mapping->shared;
+    }
+    void* view = mmap(nullptr, mapping->bytes, PROT_READ, MAP_PRIVATE, mapping->fd, 0);
+    if (view == MAP_FAILED) {
+        s_lastError = errno;
+        return nullptr;
+    }
+    s_views[view] = mapping->bytes;
+    return view;
+}
+
+BOOL UnmapViewOfFile(const void* view) {
+    auto it = s_views.find(view);
+    if (it != s_views.end()) {
+        munmap((void*)view, it->second);
+        s_views.erase(it);
+    }
+    return TRUE;
+}
+
+BOOL CloseHandle(HANDLE handle) {
+    if (!handle || handle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+    if (isMapping(handle)) {
+        auto* mapping = (Mapping*)handle;
+        if (!mapping->shared) {
+            delete mapping;
+        }
+        return TRUE;
+    }
+    return close(fdOf(handle)) == 0;
+}
+
+BOOL MoveFileExA(const char* from, const char* to, DWORD) {
+    if (rename(from, to)) {
+        s_lastError = errno;
+        return FALSE;
+    }
+    return TRUE;
+}
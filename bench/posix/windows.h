@@ -0,0 +1,81 @@
+#pragma once
+
+// The part of <windows.h> and the MSVC CRT the plugin sources in the benchmarks use, so they build
+// with GCC on Linux. Files are mapped with mmap, see windows.cpp. Nothing here is used by the plugin.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+typedef void* HANDLE;
+typedef void* LPVOID;
+typedef void* HWND;
+typedef void* HINSTANCE;
+typedef void* HMODULE;
+typedef unsigned long DWORD;
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef long LONG;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef char TCHAR;
+typedef long long(*FARPROC)();
+
+typedef union _LARGE_INTEGER {
+    struct {
+        DWORD LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+#define WINAPI
+#define APIENTRY
+#define __cdecl
+#define __declspec(x)
+#define TEXT(x) x
+#define TRUE 1
+#define FALSE 0
+
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define ERROR_ALREADY_EXISTS 183
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 1
+#define FILE_SHARE_WRITE 2
+#define OPEN_EXISTING 3
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define PAGE_READONLY 2
+#define PAGE_READWRITE 4
+#define FILE_MAP_READ 4
+#define FILE_MAP_ALL_ACCESS 0xf001f
+#define MOVEFILE_REPLACE_EXISTING 1
+
+void Sleep(DWORD ms);
+DWORD GetLastError();
+HANDLE CreateFileA(const char* path, DWORD access, DWORD share, void* security, DWORD disposition, DWORD flags, HANDLE templ);
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size);
+HANDLE CreateFileMappingA(HANDLE file, void* security, DWORD protect, DWORD sizeHigh, DWORD sizeLow, const char* name);
+#define CreateFileMapping CreateFileMappingA
+LPVOID MapViewOfFile(HANDLE mapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, size_t bytes);
+BOOL UnmapViewOfFile(const void* view);
+BOOL CloseHandle(HANDLE handle);
+BOOL MoveFileExA(const char* from, const char* to, DWORD flags);
+
+// MSVC CRT
+typedef int32_t __time32_t;
+#define _atoi64 atoll
+#define sprintf_s snprintf
+#define sscanf_s sscanf
+#define fscanf_s fscanf
+#define strtok_s strtok_r
+#define _fseeki64 fseeko
+#define _ftelli64 ftello
+#define strcpy_s(dest, size, src) (strncpy(dest, src, size), (dest)[(size) - 1] = 0)
+
+inline int fopen_s(FILE** file, const char* path, const char* mode) {
+    *file = fopen(path, mode);
+    return *file ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+// Cost of a GET_BOOK call (getBook in AlpacaZorroPlugin.cpp), served from the QuoteBook
+// (market_data/quote_book.cpp) without a request, alone and while a writer thread streams quotes in.
+//
+// 500 symbols are in the book and one million calls go round-robin over them, each timed on its own.
+// A call does what getBook does: the subscription check of DataStream::subscribeQuotes, a set insert
+// under a mutex that is reproduced here because DataStream needs WinHTTP, QuoteBook::get with the
+// symbol Zorro passed as char*, and filling ask and bid into the T2 array. The timer's own cost is
+// measured and reported, not subtracted.
+//
+// usage: quote_book
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "market_data/quote_book.h"
+#include "market_data/t6_sink.h"    // T2
+
+using namespace alpaca;
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    const size_t SYMBOLS = 500;
+    const size_t CALLS = 1000000;
+
+    // DataStream::subscribeQuotes for a symbol that is already subscribed
+    std::mutex s_streamMutex;
+    std::set<std::string> s_quoteSubscriptions;
+
+    void subscribeQuotes(const std::string& symbol) {
+        std::lock_guard<std::mutex> lock(s_streamMutex);
+        if (!s_quoteSubscriptions.insert(symbol).second) {
+            return;
+        }
+    }
+
+    int getBook(const QuoteBook& book, const char* asset, T2* out) {
+        subscribeQuotes(asset);
+        Quote quote;
+        if (!book.get(asset, quote)) {
+            return 0;
+        }
+        auto time = (DATE)(quote.timestamp / 1000000) / (24. * 60. * 60. * 1000.) + 25569.;
+        int n = 0;
+        if (quote.ask_price > 0.) {
+            out[n].time = time;
+            out[n].fVal = (float)quote.ask_price;
+            out[n].fVol = (float)quote.ask_size;
+            ++n;
+        }
+        if (quote.bid_price > 0.) {
+            out[n].time = time;
+            out[n].fVal = -(float)quote.bid_price;
+            out[n].fVol = (float)quote.bid_size;
+            ++n;
+        }
+        return n;
+    }
+
+    StreamQuote quoteOf(const std::string& symbol, uint64_t i) {
+        StreamQuote q;
+        q.symbol = symbol.c_str();
+        q.quote.bid_price = 100. + (double)(i % 100) / 100.;
+        q.quote.ask_price = q.quote.bid_price + 0.01;
+        q.quote.bid_size = q.quote.ask_size = 1 + (int)(i % 7);
+        q.quote.bid_exchange = q.quote.ask_exchange = 'V';
+        q.quote.timestamp = 1640995200000000000ULL + i * 1000;
+        return q;
+    }
+
+    struct Percentiles {
+        double p50, p99, all;   // ns per call, all the symbols once in us
+    };
+
+    Percentiles run(const QuoteBook& book, const std::vector<std::string>& symbols) {
+        std::vector<uint32_t> ns(CALLS);
+        T2 out[2];
+        int filled = 0;
+        for (size_t i = 0; i < CALLS; ++i) {
+            auto t0 = Clock::now();
+            filled += getBook(book, symbols[i % SYMBOLS].c_str(), out);
+            ns[i] = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        }
+        if (filled != (int)(2 * CALLS)) {
+            printf("only %d of %zu prices filled\n", filled, 2 * CALLS);
+        }
+
+        auto t0 = Clock::now();
+        for (int r = 0; r < 100; ++r) {
+            for (auto& symbol : symbols) {
+                getBook(book, symbol.c_str(), out);
+            }
+        }
+        auto all = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / 100;
+
+        std::sort(ns.begin(), ns.end());
+        return Percentiles{ (double)ns[CALLS / 2], (double)ns[CALLS * 99 / 100], all };
+    }
+}
+
+int main() {
+    std::vector<std::string> symbols;
+    QuoteBook book;
+    for (size_t i = 0; i < SYMBOLS; ++i) {
+        symbols.push_back("S" + std::to_string(1000 + i));
+        subscribeQuotes(symbols.back());
+        book.update(quoteOf(symbols.back(), i));
+    }
+
+    std::vector<uint32_t> timer(CALLS);
+    for (auto& t : timer) {
+        auto t0 = Clock::now();
+        t = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+    }
+    std::sort(timer.begin(), timer.end());
+    printf("%zu symbols, %zu calls, %u cores, timer alone p50 %u ns\n", SYMBOLS, CALLS, std::thread::hardware_concurrency(), timer[CALLS / 2]);
+    printf("writer          p50        p99    all symbols once\n");
+
+    for (uint32_t rate : { 0u, 100000u, 1000000u }) {
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> written(0);
+        std::thread writer;
+        if (rate) {
+            writer = std::thread([&]() {
+                // quotes in batches every millisecond, as fast as possible when that can't keep up
+                auto next = Clock::now();
+                uint64_t i = 0;
+                while (!stop) {
+                    for (uint32_t k = 0; k < rate / 1000; ++k, ++i) {
+                        book.update(quoteOf(symbols[i % SYMBOLS], i));
+                    }
+                    written = i;
+                    next += std::chrono::milliseconds(1);
+                    std::this_thread::sleep_until(next);
+                }
+            });
+        }
+        auto t0 = Clock::now();
+        auto p = run(book, symbols);
+        auto seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+        stop = true;
+        if (writer.joinable()) {
+            writer.join();
+        }
+        char label[32];
+        sprintf_s(label, sizeof(label), rate ? "%.0f k quotes/s" : "none", written / seconds / 1000.);
+        printf("%-14s %4.0f ns   %5.0f ns   %5.1f us\n", label, p.p50, p.p99, p.all);
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Stand-in for alpaca::Client in the order poller benchmark. It answers getOrders and getOrder from
+// an in-memory order book after a fixed round trip, without the request layer's 100 ms poll and the
+// 200 requests/minute limit, so a loop over hundreds of trades finishes in seconds. bench/stub comes
+// first on the include path of that benchmark, alpaca/order_poller.cpp then compiles against this.
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "request.h"
+#include "alpaca/order.h"
+
+namespace alpaca {
+
+    struct FakeOrderBook {
+        std::map<std::string, Order> open;
+        std::map<std::string, Order> all;
+        int requests = 0;
+        int roundTripUs = 2000;
+    };
+
+    extern FakeOrderBook s_book;
+
+    class Client {
+    public:
+        Response<std::vector<Order>> getOrders(
+            const ActionStatus = ActionStatus::Open,
+            const int limit = 50,
+            const std::string& after = "",
+            const std::string& = "",
+            const OrderDirection = OrderDirection::Descending,
+            const bool = false) const {
+            roundTrip();
+            std::vector<Order> orders;
+            for (auto& entry : s_book.open) {
+                if (entry.second.submitted_at > after) {
+                    orders.push_back(entry.second);
+                }
+            }
+            std::sort(orders.begin(), orders.end(), [](const Order& a, const Order& b) { return a.submitted_at < b.submitted_at; });
+            if ((int)orders.size() > limit) {
+                orders.resize(limit);
+            }
+            return Response<std::vector<Order>>(0, "OK", std::move(orders));
+        }
+
+        Response<Order> getOrder(const std::string& id, const bool = false, const bool = false) const {
+            roundTrip();
+            return Response<Order>(0, "OK", Order(s_book.all[id]));
+        }
+
+    private:
+        static void roundTrip() {
+            ++s_book.requests;
+            std::this_thread::sleep_for(std::chrono::microseconds(s_book.roundTripUs));
+        }
+    };
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+// Stand-in for alpaca::WebSocket in the trade stream benchmark. Instead of a WinHTTP connection it
+// serves the messages a benchmark pushes into s_server, and answers the authenticate and listen
+// messages of TradeStream like the trading API does. bench/stub comes first on the include path of
+// that benchmark, alpaca/trade_stream.cpp then compiles against this.
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace alpaca {
+
+    struct FakeStreamServer {
+        std::mutex mutex;
+        std::condition_variable pushed;
+        std::deque<std::string> messages;
+        bool open = false;
+        bool drop = false;          // the next receive fails, as if the connection broke
+        uint32_t connects = 0;
+
+        void push(std::string message) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                messages.push_back(std::move(message));
+            }
+            pushed.notify_all();
+        }
+
+        void disconnect() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                drop = true;
+            }
+            pushed.notify_all();
+        }
+    };
+
+    extern FakeStreamServer s_server;
+
+    class WebSocket {
+    public:
+        WebSocket() = default;
+        ~WebSocket() { close(); }
+
+        WebSocket(const WebSocket&) = delete;
+        WebSocket& operator=(const WebSocket&) = delete;
+
+        bool connect(const std::string&) {
+            std::lock_guard<std::mutex> lock(s_server.mutex);
+            s_server.open = true;
+            s_server.drop = false;
+            s_server.messages.clear();
+            ++s_server.connects;
+            open_ = true;
+            return true;
+        }
+
+        bool send(const std::string& text) {
+            if (text.find("\"authenticate\"") != std::string::npos) {
+                s_server.push("{\"stream\":\"authorization\",\"data\":{\"status\":\"authorized\",\"action\":\"authenticate\"}}");
+            }
+            else if (text.find("\"listen\"") != std::string::npos) {
+                s_server.push("{\"stream\":\"listening\",\"data\":{\"streams\":[\"trade_updates\"]}}");
+            }
+            return open_;
+        }
+
+        bool receive(std::string& message) {
+            std::unique_lock<std::mutex> lock(s_server.mutex);
+            s_server.pushed.wait(lock, [this]() { return !open_ || s_server.drop || !s_server.messages.empty(); });
+            if (!open_ || s_server.drop) {
+                error_ = "connection dropped";
+                return false;
+            }
+            message = std::move(s_server.messages.front());
+            s_server.messages.pop_front();
+            return true;
+        }
+
+        void close() noexcept {
+            std::lock_guard<std::mutex> lock(s_server.mutex);
+            open_ = false;
+            s_server.open = false;
+        }
+
+        void interrupt() noexcept {
+            {
+                std::lock_guard<std::mutex> lock(s_server.mutex);
+                open_ = false;
+            }
+            s_server.pushed.notify_all();
+        }
+
+        bool isOpen() const noexcept { return open_; }
+
+        const std::string& error() const noexcept { return error_; }
+
+    private:
+        std::atomic<bool> open_{ false };
+        std::string error_;
+    };
+
+} // namespace alpaca
@@ -0,0 +1,132 @@
+// The T6 conversion kernels of market_data/t6_sink.cpp: toT6Scalar, toT6Sse2 and toT6Avx2 must write
+// bit-identical records and the same BarCheck counts, and each is timed on 1M bars.
+//
+// The bars are a random walk, newest first, salted with the inconsistencies the kernels count: high
+// below low, NaN prices and times out of order. Each kernel converts them once in a single call and
+// once in calls of BarChunk::CAPACITY bars, as T6Sink does, so prevTime has to carry over.
+//
+// usage: t6_kernels
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "market_data/t6_sink.h"
+#include "simd.h"
+
+using namespace alpaca;
+
+namespace {
+
+    typedef void (*Kernel)(const BarArrays&, size_t, uint32_t, uint32_t&, T6*, BarCheck&);
+
+    struct Columns {
+        std::vector<uint32_t> time;
+        std::vector<double> open, high, low, close;
+        std::vector<uint32_t> volume;
+
+        BarArrays at(size_t i) const {
+            return BarArrays{ time.data() + i, open.data() + i, high.data() + i, low.data() + i, close.data() + i, volume.data() + i };
+        }
+    };
+
+    Columns randomBars(size_t n) {
+        std::mt19937 rng(7);
+        std::normal_distribution<double> move(0, 0.0006);
+        Columns bars;
+        double price = 300.;
+        uint32_t t = 1640995140;    // 2021-12-31 23:59 UTC, walking backward
+        for (size_t i = 0; i < n; ++i, t -= 60) {
+            double open = price;
+            double close = price * (1 + move(rng));
+            double high = std::max(open, close) + (rng() % 4) * 0.01;
+            double low = std::min(open, close) - (rng() % 4) * 0.01;
+            auto salt = rng() % 1000;
+            if (salt == 0) {
+                std::swap(high, low);
+            }
+            else if (salt == 1) {
+                close = std::numeric_limits<double>::quiet_NaN();
+            }
+            bars.time.push_back(salt == 2 ? t + 120 : t);
+            bars.open.push_back(open);
+            bars.high.push_back(high);
+            bars.low.push_back(low);
+            bars.close.push_back(close);
+            bars.volume.push_back(100 * (1 + rng() % 3000));
+            price = std::isnan(close) ? price : close;
+        }
+        return bars;
+    }
+
+    BarCheck convert(Kernel kernel, const Columns& bars, size_t step, std::vector<T6>& out) {
+        BarCheck check;
+        uint32_t prevTime = std::numeric_limits<uint32_t>::max();
+        for (size_t i = 0; i < bars.time.size(); i += step) {
+            kernel(bars.at(i), std::min(step, bars.time.size() - i), 60, prevTime, out.data() + i, check);
+        }
+        return check;
+    }
+
+    bool same(const BarCheck& a, const BarCheck& b) {
+        return a.highBelowLow == b.highBelowLow && a.nan == b.nan && a.timeOrder == b.timeOrder && a.invalid == b.invalid;
+    }
+}
+
+int main() {
+    const size_t N = 1000000;
+    auto bars = randomBars(N);
+
+    struct Entry {
+        const char* name;
+        Kernel kernel;
+        bool available;
+    };
+    Entry kernels[] = {
+        { "scalar", toT6Scalar, true },
+#ifdef ALPACA_SSE2
+        { "sse2", toT6Sse2, true },
+#endif
+#ifdef ALPACA_AVX2
+        { "avx2", toT6Avx2, hasAvx2() },
+#endif
+    };
+
+    std::vector<T6> expected(N);
+    auto expectedCheck = convert(toT6Scalar, bars, N, expected);
+    printf("%zu bars: %u high below low, %u NaN, %u out of order, %u invalid\n\n",
+        N, expectedCheck.highBelowLow, expectedCheck.nan, expectedCheck.timeOrder, expectedCheck.invalid);
+
+    printf("kernel   one call      calls of %zu\n", BarChunk::CAPACITY);
+    std::vector<T6> out(N);
+    for (auto& entry : kernels) {
+        if (!entry.available) {
+            printf("%-6s   not supported by this CPU\n", entry.name);
+            continue;
+        }
+        double ns[2];
+        bool ok = true;
+        size_t steps[2] = { N, BarChunk::CAPACITY };
+        for (int s = 0; s < 2; ++s) {
+            memset(out.data(), 0, N * sizeof(T6));
+            auto check = convert(entry.kernel, bars, steps[s], out);
+            ok &= same(check, expectedCheck) && memcmp(out.data(), expected.data(), N * sizeof(T6)) == 0;
+
+            const int repeat = 20;
+            auto t0 = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeat; ++r) {
+                convert(entry.kernel, bars, steps[s], out);
+            }
+            ns[s] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / ((double)N * repeat);
+        }
+        printf("%-6s   %5.2f ns/bar   %5.2f ns/bar   %s\n", entry.name, ns[0], ns[1], ok ? "identical" : "MISMATCH");
+    }
+    return 0;
+}
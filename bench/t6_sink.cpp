@@ -0,0 +1,196 @@
+// Memory and time of BrokerHistory2's bar path (market_data/bar_parser.h, market_data/t6_sink.h):
+// Polygon pages streamed by parseBars into a T6Sink over the caller's ticks, against the path it
+// replaced: every page parsed into a DOM and copied into a vector<Bar>, the vector sorted, deduplicated
+// and reversed, then copied into the ticks.
+//
+// The pages hold 1-minute bars newest first, at most 5000 to a page like Polygon's default. The heap is
+// counted by replacing operator new and delete; the pages and the ticks array exist before either path
+// runs and are not counted, as in the plugin, where the request layer and Zorro own them. Both paths
+// must produce the same ticks. The DOM is the one of the rapidjson build in use, its size and speed
+// depend on it; the vector<Bar> column is what the old path holds whichever DOM parsed the pages.
+//
+// usage: t6_sink
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "rapidjson/document.h"
+#include "market_data/bar_parser.h"
+#include "market_data/t6_sink.h"
+
+using namespace alpaca;
+
+namespace {
+    size_t s_heap = 0;
+    size_t s_peak = 0;
+}
+
+void* operator new(size_t size) {
+    auto* p = (size_t*)malloc(size + 16);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    *p = size;
+    s_heap += size;
+    s_peak = std::max(s_peak, s_heap);
+    return (char*)p + 16;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr) {
+        auto* p = (size_t*)((char*)ptr - 16);
+        s_heap -= *p;
+        free(p);
+    }
+}
+
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+namespace {
+
+    const uint32_t NEWEST = 1640995140;    // 2021-12-31 23:59 UTC, the newest bar
+
+    size_t s_barVectors = 0;    // capacity of the vector<Bar>s of the last DOM path, in bytes
+
+    // n 1-minute bars ending at NEWEST, newest first, in pages of at most 5000
+    std::vector<std::string> pages(uint32_t n) {
+        std::vector<std::string> result;
+        for (uint32_t i = 0; i < n;) {
+            std::string body = "{\"ticker\":\"AAPL\",\"results\":[";
+            auto first = i;
+            for (; i < n && i - first < 5000; ++i) {
+                int64_t t = NEWEST - (int64_t)i * 60;
+                double price = 300. + (double)(t / 60 % 997) / 100.;
+                char bar[160];
+                sprintf_s(bar, sizeof(bar), "%s{\"v\":%u,\"vw\":%.4f,\"o\":%.2f,\"c\":%.2f,\"h\":%.2f,\"l\":%.2f,\"t\":%lld000,\"n\":%u}",
+                    i == first ? "" : ",", 100 * (uint32_t)(1 + t / 60 % 3000), price, price, price + 0.01, price + 0.02, price - 0.02, (long long)t, 7u);
+                body += bar;
+            }
+            body += "],\"status\":\"OK\"}";
+            result.emplace_back(std::move(body));
+        }
+        return result;
+    }
+
+    // BrokerHistory2 before the sinks: DOM pages into vector<Bar>, sort, unique, reverse, copy
+    void domPath(const std::vector<std::string>& content, __time32_t start, __time32_t end, int nTickMinutes, uint32_t nTicks, T6* ticks) {
+        std::vector<Bar> rtBars;
+        rtBars.reserve(nTicks);
+        size_t resultsCapacity = 0;
+        for (auto& page : content) {
+            rapidjson::Document d;
+            d.Parse(page.c_str());
+            std::vector<Bar> results;
+            if (d.HasMember("results") && d["results"].IsArray()) {
+                auto& items = d["results"];
+                results.reserve(items.Size());
+                for (auto& item : items.GetArray()) {
+                    Bar bar;
+                    bar.time = (uint32_t)(item["t"].GetUint64() / 1000);
+                    bar.open_price = item["o"].GetDouble();
+                    bar.high_price = item["h"].GetDouble();
+                    bar.low_price = item["l"].GetDouble();
+                    bar.close_price = item["c"].GetDouble();
+                    bar.volume = item["v"].GetUint();
+                    results.emplace_back(bar);
+                }
+            }
+            resultsCapacity = std::max(resultsCapacity, results.capacity());
+            for (auto& bar : results) {
+                if ((__time32_t)bar.time <= end && (__time32_t)bar.time >= start) {
+                    rtBars.push_back(bar);
+                }
+            }
+        }
+
+        s_barVectors = (rtBars.capacity() + resultsCapacity) * sizeof(Bar);
+
+        std::sort(rtBars.begin(), rtBars.end(), [](const Bar& a, const Bar& b) { return a.time > b.time; });
+        rtBars.erase(std::unique(rtBars.begin(), rtBars.end(), [](const Bar& a, const Bar& b) { return a.time == b.time; }), rtBars.end());
+        if (rtBars.size() > nTicks) {
+            rtBars.resize(nTicks);
+        }
+        std::reverse(rtBars.begin(), rtBars.end());
+
+        int barsDownloaded = 0;
+        for (int i = (int)rtBars.size() - 1; i >= 0; --i) {
+            auto& bar = rtBars[i];
+            auto& tick = ticks[barsDownloaded++];
+            tick.time = (DATE)(bar.time + nTickMinutes * 60) / (24. * 60. * 60.) + 25569.;
+            tick.fOpen = (float)bar.open_price;
+            tick.fHigh = (float)bar.high_price;
+            tick.fLow = (float)bar.low_price;
+            tick.fClose = (float)bar.close_price;
+            tick.fVol = (float)bar.volume;
+        }
+    }
+
+    void sinkPath(const std::vector<std::string>& content, __time32_t start, __time32_t end, int nTickMinutes, uint32_t nTicks, T6* ticks) {
+        T6Sink sink(start, end, nTicks, nTickMinutes, ticks);
+        auto flush = [&sink](const BarChunk& chunk) { return sink.write(chunk); };
+        for (auto& page : content) {
+            std::string nextUrl, error;
+            if (!parseBars(page, 1000, flush, nextUrl, error) || !sink.wantsMore()) {
+                break;
+            }
+        }
+    }
+
+    struct Run {
+        double us;      // per call
+        size_t peak;    // heap above what was allocated before the call
+    };
+
+    template<typename F>
+    Run run(int repeat, F&& f) {
+        auto base = s_heap;
+        s_peak = s_heap;
+        f();
+        auto peak = s_peak - base;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; ++r) {
+            f();
+        }
+        auto us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / repeat;
+        return Run{ us, peak };
+    }
+
+    bool same(const std::vector<T6>& a, const std::vector<T6>& b) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].time != b[i].time || a[i].fOpen != b[i].fOpen || a[i].fHigh != b[i].fHigh || a[i].fLow != b[i].fLow ||
+                a[i].fClose != b[i].fClose || a[i].fVol != b[i].fVol) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main() {
+    printf("          DOM + vector<Bar>                          parseBars + T6Sink\n");
+    printf(" ticks          time       heap  in vector<Bar>             time     heap\n");
+    for (uint32_t nTicks : { 1000u, 100000u }) {
+        // one page more than needed, like the head range of getBars
+        auto content = pages(nTicks + 5000);
+        std::vector<T6> before(nTicks), after(nTicks);
+        auto start = (__time32_t)(NEWEST - (nTicks + 5000) * 60);
+        int repeat = nTicks < 10000 ? 200 : 10;
+
+        auto dom = run(repeat, [&]() { domPath(content, start, NEWEST, 1, nTicks, before.data()); });
+        auto sax = run(repeat, [&]() { sinkPath(content, start, NEWEST, 1, nTicks, after.data()); });
+        printf("%6u  %9.0f us %8zu B     %8zu B     %9.0f us %6zu B   %s\n",
+            nTicks, dom.us, dom.peak, s_barVectors, sax.us, sax.peak, same(before, after) ? "same ticks" : "DIFFERENT TICKS");
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Throughput of the tick download path of brokerCommand(2002): the SAX TickHandler
+// (market_data/tick_parser.h) decoding Polygon v2 ticks pages and TickFileSink (market_data/tick_sink.cpp)
+// writing them into .t1 and .t2 files.
+//
+// The pages are built from the fixtures in fixtures/, one page of trades and one of NBBO quotes in
+// the v2 ticks format, newest first as reverse=true returns them. Their ticks are repeated, each
+// repetition shifted further back in time, into 20 pages of 50000 ticks, the page size getTicks asks
+// for. Decoding, writing and both together are timed separately.
+//
+// The files go to ./History like the plugin's, so run it from a directory that has one.
+//
+// usage: tick_sink [fixture_dir]
+
+#include "stdafx.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "market_data/tick_parser.h"
+#include "market_data/tick_sink.h"
+#include "market_data/t6_sink.h"    // T1 and T2
+
+using namespace alpaca;
+
+namespace {
+
+    const size_t PAGE = 50000;
+    const size_t PAGES = 20;
+
+    std::string readFile(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::stringstream content;
+        content << in.rdbuf();
+        return content.str();
+    }
+
+    // the fixture's ticks repeated into pages of PAGE ticks, every repetition older than the last
+    std::vector<std::string> pages(const std::string& fixture, int64_t& oldest) {
+        auto begin = fixture.find("\"results\":[") + 11;
+        auto end = fixture.find("],\"map\"");
+        std::vector<std::pair<int64_t, std::string>> ticks;     // time and the rest of the object after it
+        for (auto pos = begin; pos < end;) {
+            auto next = fixture.find(",{\"t\":", pos);
+            next = next == std::string::npos || next > end ? end : next;
+            auto object = fixture.substr(pos, next - pos);
+            auto digits = object.find("\"t\":") + 4;
+            auto rest = object.find(',', digits);
+            ticks.emplace_back(_atoi64(object.c_str() + digits), object.substr(rest));
+            pos = next + 1;
+        }
+        auto span = ticks.front().first - ticks.back().first + 1000000;
+
+        std::vector<std::string> result;
+        size_t n = 0;
+        for (size_t p = 0; p < PAGES; ++p) {
+            std::string page = "{\"ticker\":\"AAPL\",\"results_count\":" + std::to_string(PAGE) + ",\"success\":true,\"results\":[";
+            for (size_t i = 0; i < PAGE; ++i, ++n) {
+                auto& tick = ticks[n % ticks.size()];
+                oldest = tick.first - (int64_t)(n / ticks.size()) * span;
+                page += (i ? ",{\"t\":" : "{\"t\":") + std::to_string(oldest) + tick.second;
+            }
+            page += fixture.substr(end);
+            result.emplace_back(std::move(page));
+        }
+        return result;
+    }
+
+    double seconds(std::chrono::steady_clock::time_point from) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - from).count();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string dir = argc > 1 ? argv[1] : "fixtures";
+    printf("%zu pages of %zu ticks     decoded             written             decoded and written\n", PAGES, PAGE);
+
+    for (auto type : { TickType::Trades, TickType::Quotes }) {
+        auto fixture = readFile(dir + (type == TickType::Quotes ? "/polygon_nbbo.json" : "/polygon_trades.json"));
+        if (fixture.find("\"results\":[") == std::string::npos) {
+            printf("no fixture in %s\n", dir.c_str());
+            return 1;
+        }
+        int64_t oldest = 0;
+        auto content = pages(fixture, oldest);
+        size_t bytes = 0;
+        for (auto& page : content) {
+            bytes += page.size();
+        }
+        auto start = (__time32_t)(oldest / 1000000000);
+        std::string error;
+        TickPage page;
+
+        // decoding only, the chunks are kept for the write run
+        std::vector<TickChunk> chunks;
+        chunks.reserve(PAGES * PAGE / TickChunk::CAPACITY + PAGES);
+        auto keep = [&chunks](const TickChunk& chunk) { chunks.push_back(chunk); return true; };
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t decoded = 0;
+        for (auto& body : content) {
+            if (!parseTicks(body, keep, page, error)) {
+                printf("%s\n", error.c_str());
+                return 1;
+            }
+            decoded += page.count;
+        }
+        auto decode = seconds(t0);
+
+        uint64_t records;
+        double write;
+        {
+            TickFileSink sink("AAPL", type, start, 0);
+            t0 = std::chrono::steady_clock::now();
+            for (auto& chunk : chunks) {
+                sink.write(chunk);
+            }
+            sink.close();
+            write = seconds(t0);
+            records = sink.records();
+            if (!sink.error().empty()) {
+                printf("%s, is there a History directory?\n", sink.error().c_str());
+                return 1;
+            }
+        }
+
+        double both;
+        {
+            TickFileSink sink("AAPL", type, start, 0);
+            auto flush = [&sink](const TickChunk& chunk) { return sink.write(chunk); };
+            t0 = std::chrono::steady_clock::now();
+            for (auto& body : content) {
+                parseTicks(body, flush, page, error);
+            }
+            sink.close();
+            both = seconds(t0);
+        }
+
+        printf("%-6s %7.1f MB JSON   %5.1f M ticks/s %4.0f MB/s   %5.1f M ticks/s %4.0f MB/s   %5.1f M ticks/s\n",
+            type == TickType::Quotes ? "quotes" : "trades", bytes / 1e6,
+            decoded / decode / 1e6, bytes / decode / 1e6,
+            decoded / write / 1e6, records * (type == TickType::Quotes ? sizeof(T2) : sizeof(T1)) / write / 1e6,
+            decoded / both / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Orders read from the trade_updates stream: TradeStream (alpaca/trade_stream.cpp) parsing the stream
+// into OrderUpdates (alpaca/order_updates.cpp), read the way readOrder in AlpacaZorroPlugin.cpp reads
+// them, from the stream if it has the current state, from REST otherwise, which is then seeded.
+//
+// The socket is the stand-in in stub/websocket.h, the stream messages are pushed by the benchmark in
+// the trade_updates layout. REST reads are counted, not sent.
+//
+// 1. IOC orders: each is "sent", its fill event is pushed 1-5 ms later by another thread while
+//    Zorro's thread waits for the final state like the IOC loop of BrokerBuy2. Measured is the time
+//    from the push until the waiting thread has the fill.
+// 2. BrokerTrade of 20 open orders every bar for 100 bars, with one dropped connection halfway. The
+//    stream reconnects after its 1 s delay, until then every read goes to REST. Against it the
+//    getOrder per trade and bar of the path before the stream.
+//
+// usage: trade_stream [bar_ms]    default 1000, the reconnect delay decides how many bars miss the stream
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+#include "alpaca/trade_stream.h"
+#include "fake_http.h"
+
+using namespace alpaca;
+
+namespace alpaca {
+    FakeStreamServer s_server;
+}
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    int s_restReads = 0;
+
+    std::string now() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        time_t seconds = (time_t)(ns / 1000000000);
+        tm utc;
+        gmtime_r(&seconds, &utc);
+        char text[64];
+        auto n = strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &utc);
+        sprintf_s(text + n, sizeof(text) - n, ".%09lldZ", (long long)(ns % 1000000000));
+        return text;
+    }
+
+    std::string orderJson(const std::string& id, const char* tif, const char* status, uint32_t filled, const std::string& updated) {
+        return "{\"id\":\"" + id + "\",\"client_order_id\":\"c" + id + "\",\"created_at\":\"" + updated + "\",\"updated_at\":\"" + updated +
+            "\",\"submitted_at\":\"" + updated + "\",\"asset_id\":\"904837e3-3b76-47ec-b432-046db621571b\",\"symbol\":\"AAPL\","
+            "\"asset_class\":\"us_equity\",\"qty\":\"100\",\"filled_qty\":\"" + std::to_string(filled) + "\",\"filled_avg_price\":\"" +
+            (filled ? "172.31" : "") + "\",\"order_class\":\"\",\"type\":\"limit\",\"side\":\"buy\",\"time_in_force\":\"" + tif +
+            "\",\"limit_price\":\"172.35\",\"status\":\"" + status + "\",\"extended_hours\":false}";
+    }
+
+    std::string event(const char* name, const std::string& order, const std::string& time) {
+        return "{\"stream\":\"trade_updates\",\"data\":{\"event\":\"" + std::string(name) + "\",\"timestamp\":\"" + time +
+            "\",\"order\":" + order + "}}";
+    }
+
+    // readOrder without the open order snapshot, which came later
+    bool readOrder(OrderUpdates& updates, const std::string& id, uint32_t waitMs, Order& order) {
+        if (waitMs ? updates.wait(id, waitMs, order) : updates.get(id, order)) {
+            return true;
+        }
+        auto epoch = updates.epoch();
+        ++s_restReads;
+        Order rest;
+        rest.id = id;
+        rest.status = "new";
+        rest.updated_at = now();
+        updates.seed(rest, epoch);
+        order = rest;
+        return false;
+    }
+
+    template<typename Done>
+    bool waitFor(Done done, uint32_t ms) {
+        for (auto until = Clock::now() + std::chrono::milliseconds(ms); Clock::now() < until; std::this_thread::sleep_for(std::chrono::milliseconds(1))) {
+            if (done()) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int barMs = argc > 1 ? atoi(argv[1]) : 1000;
+    Logger logger;
+    OrderUpdates updates;
+    TradeStream stream("https://paper-api.alpaca.markets", "key", "secret", updates, logger);
+    stream.start();
+    if (!waitFor([&updates]() { return updates.live(); }, 5000)) {
+        printf("stream didn't connect\n");
+        return 1;
+    }
+
+    // 1. IOC orders
+    const int IOC_ORDERS = 200;
+    std::mt19937 rng(41);
+    std::vector<double> visibleMs;
+    for (int i = 0; i < IOC_ORDERS; ++i) {
+        auto id = "ioc-" + std::to_string(i);
+        auto delayUs = 1000 + (int)(rng() % 4000);
+        Clock::time_point pushed;
+        std::thread venue([&]() {
+            std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+            auto time = now();
+            pushed = Clock::now();
+            s_server.push(event("fill", orderJson(id, "ioc", "filled", 100, time), time));
+        });
+        Order order;
+        bool local = readOrder(updates, id, 5000, order);
+        auto seen = Clock::now();
+        venue.join();
+        if (local && order.status == "filled") {
+            visibleMs.push_back(std::chrono::duration<double, std::milli>(seen - pushed).count());
+        }
+    }
+    std::sort(visibleMs.begin(), visibleMs.end());
+    printf("%d IOC orders: %zu fills read from the stream, %d REST reads\n", IOC_ORDERS, visibleMs.size(), s_restReads);
+    if (!visibleMs.empty()) {
+        printf("fill visible to the waiting thread after the event: p50 %.2f ms, p99 %.2f ms\n",
+            visibleMs[visibleMs.size() / 2], visibleMs[visibleMs.size() * 99 / 100]);
+    }
+
+    // 2. BrokerTrade every bar
+    const int TRADES = 20;
+    const int BARS = 100;
+    s_restReads = 0;
+    int restBars = 0;
+    for (int bar = 0; bar < BARS; ++bar) {
+        if (bar == BARS / 2) {
+            s_server.disconnect();
+            waitFor([&updates]() { return !updates.live(); }, 1000);
+        }
+        auto before = s_restReads;
+        for (int t = 0; t < TRADES; ++t) {
+            Order order;
+            readOrder(updates, "open-" + std::to_string(t), 0, order);
+        }
+        restBars += s_restReads > before;
+        std::this_thread::sleep_for(std::chrono::milliseconds(barMs));
+    }
+    printf("\n%d open trades over %d bars of %d ms, one reconnect: %d REST reads on %d bars, %d with a getOrder per trade and bar\n",
+        TRADES, BARS, barMs, s_restReads, restBars, TRADES * BARS);
+
+    auto metrics = updates.metrics();
+    printf("stream: %llu events, %u connects, %llu local reads, %llu REST reads\n", (unsigned long long)metrics.events, metrics.connects,
+        (unsigned long long)metrics.localReads, (unsigned long long)metrics.restReads);
+    stream.stop();
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Stop-out latency and slippage of a stop Zorro manages against one Alpaca holds, the model behind
+// SET_ORDERTYPE +8 (alpaca/exit_orders.cpp). It is a simulation, not a measurement: the price is a
+// driftless random walk in 1 ms steps, a long position is entered at $100 with a stop distance of
+// 0.5 and its stop price comes from exitPrices.
+//
+// Zorro's stop: the script loop looks at the price every loop ms, at a random phase. Once it sees the
+// price at or below the stop it sends a market order, which fills one round trip later. A dip below
+// the stop that is over before the next loop goes unnoticed. The venue's stop: triggers at the first
+// step at or below the stop and fills the next millisecond, the 1 ms is an assumption. Latency runs
+// from the step the price went below the stop to the fill, slippage is the stop price minus the fill
+// price. A position not stopped out within 5 minutes is closed and doesn't count.
+//
+// usage: venue_stops [stop_outs]
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "alpaca/exit_orders.h"
+
+using namespace alpaca;
+
+namespace {
+
+    const double SIGMA = 0.004;         // $ per 1 ms step
+    const double STOP_DIST = 0.5;
+    const uint32_t MAX_HOLD_MS = 5 * 60 * 1000;
+
+    struct Result {
+        std::vector<double> latencyMs;
+        std::vector<double> slippage;
+    };
+
+    // loopMs 0 is the venue's stop
+    Result simulate(uint32_t loopMs, uint32_t rttMs, size_t stopOuts) {
+        std::mt19937_64 rng(47);
+        std::normal_distribution<double> step(0., SIGMA);
+        std::uniform_int_distribution<uint32_t> phase(0, loopMs ? loopMs - 1 : 0);
+        ExitConfig config;
+        Result result;
+        while (result.latencyMs.size() < stopOuts) {
+            double price = 100.;
+            auto stop = exitPrices(config, OrderSide::Buy, price, STOP_DIST).stop;
+            auto next = phase(rng);     // the next loop of Zorro, in ms from the entry
+            int64_t crossed = -1;
+            uint32_t t = 1;
+            for (; t <= MAX_HOLD_MS; ++t) {
+                price += step(rng);
+                if (price > stop) {
+                    crossed = -1;
+                }
+                else if (crossed < 0) {
+                    crossed = t;
+                    if (!loopMs) {
+                        break;
+                    }
+                }
+                if (loopMs && t >= next) {
+                    if (price <= stop) {
+                        break;
+                    }
+                    next += loopMs;
+                }
+            }
+            if (t > MAX_HOLD_MS) {
+                continue;
+            }
+            // the order fills at the price after its delay
+            auto delay = loopMs ? rttMs : 1;
+            for (uint32_t d = 0; d < delay; ++d) {
+                price += step(rng);
+            }
+            result.latencyMs.push_back((double)(t + delay - crossed));
+            result.slippage.push_back(stop - price);
+        }
+        return result;
+    }
+
+    double mean(const std::vector<double>& v) {
+        double sum = 0.;
+        for (auto x : v) {
+            sum += x;
+        }
+        return sum / v.size();
+    }
+
+    double p99(std::vector<double> v) {
+        std::sort(v.begin(), v.end());
+        return v[v.size() * 99 / 100];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t stopOuts = argc > 1 ? (size_t)atoi(argv[1]) : 1700;
+    printf("random walk of $%.3f per ms, stop %.1f below a $100 entry, %zu stop-outs each\n\n", SIGMA, STOP_DIST, stopOuts);
+    printf("stop          loop    rtt    latency mean   p99       slippage mean   p99\n");
+    struct Setting {
+        uint32_t loopMs, rttMs;
+    };
+    for (auto s : { Setting{ 100, 20 }, Setting{ 500, 40 }, Setting{ 1000, 80 }, Setting{ 0, 0 } }) {
+        auto r = simulate(s.loopMs, s.rttMs, stopOuts);
+        if (s.loopMs) {
+            printf("Zorro      %5u ms %4u ms", s.loopMs, s.rttMs);
+        }
+        else {
+            printf("venue            -       -");
+        }
+        printf("   %7.0f ms %6.0f ms      $%.3f      $%.3f\n", mean(r.latencyMs), p99(r.latencyMs), mean(r.slippage), p99(r.slippage));
+    }
+    return 0;
+}